@@ -28,97 +28,30 @@
  *
  */
 
-#include "driver/spi_master.h"
-#include "driver/gpio.h"
-#include "esp_timer.h"
+#include <stdio.h>
 #include "esp_log.h"
-#include "freertos/FreeRTOS.h"
-#include "freertos/task.h"
 #include "DieselHeaterRF.h"
+#ifdef ESP_PLATFORM
+#include "DieselHeaterSpiBus.h"
+#endif
 
 static const char *const RF_TAG = "diesel_heater_rf";
 
-// Local helpers replacing Arduino equivalents
-static inline uint32_t _millis() {
-  return (uint32_t)(esp_timer_get_time() / 1000LL);
-}
-static inline void _delay_ms(uint32_t ms) {
-  vTaskDelay(pdMS_TO_TICKS(ms));
-}
-
-// ---------------------------------------------------------------------------
-// pre_cb/post_cb: manual CS management and CC1101 chip-ready wait.
-//
-// ESP-IDF calls pre_cb BEFORE asserting hardware CS, so we cannot use
-// hardware-managed CS for chip-ready detection. Instead, spics_io_num=-1
-// (no hardware CS) and these callbacks drive CS via GPIO:
-//   pre_cb:  assert CS LOW → wait for MISO LOW (crystal oscillator stable)
-//   post_cb: deassert CS HIGH
-//
-// t->user encodes both pins: (cs_pin << 8) | miso_pin  (uint16_t)
-// Runs in task context (polling transmit) — regular GPIO access is safe.
-// ---------------------------------------------------------------------------
-static void cc1101_pre_cb(spi_transaction_t *t) {
-  uint16_t pins     = (uint16_t)(uintptr_t)t->user;
-  gpio_num_t cs     = (gpio_num_t)((pins >> 8) & 0xFF);
-  gpio_num_t miso   = (gpio_num_t)(pins & 0xFF);
-  gpio_set_level(cs, 0);                        // assert CS
-  int64_t t0 = esp_timer_get_time();
-  while (gpio_get_level(miso)) {                // wait for chip-ready (MISO LOW)
-    if (esp_timer_get_time() - t0 > 5000) break;  // 5 ms timeout
-  }
-}
-
-static void cc1101_post_cb(spi_transaction_t *t) {
-  uint16_t pins = (uint16_t)(uintptr_t)t->user;
-  gpio_num_t cs = (gpio_num_t)((pins >> 8) & 0xFF);
-  gpio_set_level(cs, 1);                        // deassert CS
-}
-
 void DieselHeaterRF::begin() {
   begin(0);
 }
 
 void DieselHeaterRF::begin(uint32_t heaterAddr) {
   _heaterAddr = heaterAddr;
-
-  // CS: configure as GPIO output, idle HIGH. spics_io_num=-1 means the SPI
-  // driver does not touch CS — pre_cb/post_cb drive it manually so that the
-  // chip-ready wait happens after CS is actually asserted.
-  gpio_set_direction((gpio_num_t)_pinSs, GPIO_MODE_OUTPUT);
-  gpio_set_level((gpio_num_t)_pinSs, 1);
-
-  gpio_set_direction((gpio_num_t)_pinGdo2, GPIO_MODE_INPUT);
-
-  spi_bus_config_t buscfg = {};
-  buscfg.mosi_io_num   = _pinMosi;
-  buscfg.miso_io_num   = _pinMiso;
-  buscfg.sclk_io_num   = _pinSck;
-  buscfg.quadwp_io_num = -1;
-  buscfg.quadhd_io_num = -1;
-
-  esp_err_t ret = spi_bus_initialize(SPI2_HOST, &buscfg, SPI_DMA_DISABLED);
-  if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE) {
-    return;
+#ifdef ESP_PLATFORM
+  if (_bus == nullptr) {
+    auto *bus = new DieselHeaterSpiBus(_pinSck, _pinMiso, _pinMosi, _pinSs, _pinGdo2, _asyncSpi);
+    _bus = bus;
+    _busOwned = true;
+    if (!bus->begin()) return;
   }
-
-  // Pullup on MISO so it idles HIGH when CC1101 is not driving it.
-  // pre_cb waits for MISO HIGH→LOW (chip-ready); without pullup MISO floats LOW.
-  gpio_set_pull_mode((gpio_num_t)_pinMiso, GPIO_PULLUP_ONLY);
-
-  // Encode CS and MISO pin numbers into a single word passed via t->user.
-  _pinEnc = ((uint16_t)_pinSs << 8) | (uint16_t)_pinMiso;
-
-  spi_device_interface_config_t devcfg = {};
-  devcfg.mode           = 0;
-  devcfg.clock_speed_hz = 1 * 1000 * 1000;  // 1 MHz — matches ESPHome CC1101 component; 4 MHz caused compilation-sensitive TX failures
-  devcfg.spics_io_num   = -1;   // CS managed manually in pre_cb / post_cb
-  devcfg.queue_size     = 1;
-  devcfg.pre_cb         = cc1101_pre_cb;
-  devcfg.post_cb        = cc1101_post_cb;
-
-  spi_bus_add_device(SPI2_HOST, &devcfg, &_spi);
-
+#endif
+  if (_bus == nullptr) return;
   initRadio();
 }
 
@@ -127,49 +60,56 @@ void DieselHeaterRF::setAddress(uint32_t heaterAddr) {
 }
 
 void DieselHeaterRF::sendCommand(uint8_t cmd, uint32_t addr, uint8_t numTransmits, uint8_t seq) {
-  char buf[10];
-  buf[0] = 9;
-  buf[1] = cmd;
-  buf[2] = (addr >> 24) & 0xFF;
-  buf[3] = (addr >> 16) & 0xFF;
-  buf[4] = (addr >> 8)  & 0xFF;
-  buf[5] =  addr        & 0xFF;
-  buf[6] = seq;
-  buf[9] = 0;
-  uint16_t crc = crc16_2(buf, 7);
-  buf[7] = (crc >> 8) & 0xFF;
-  buf[8] =  crc       & 0xFF;
+  using namespace HeaterProtocol;
+  // Frame prefix and its CRC state are kept between bursts — a new command or address
+  // rebuilds it, otherwise only the sequence number and CRC change.
+  if (!_txFrame.matches(cmd, addr)) _txFrame = CommandFrame(cmd, addr);
+  const uint8_t *buf = _txFrame.finish(seq);
+  rxMode(RXM_OFF);
   // Log TX packet hex for protocol debugging
-  ESP_LOGD(RF_TAG, "TX pkt: %02X %02X %02X%02X%02X%02X seq=%02X crc=%02X%02X",
-           (uint8_t)buf[0], (uint8_t)buf[1], (uint8_t)buf[2], (uint8_t)buf[3],
-           (uint8_t)buf[4], (uint8_t)buf[5], (uint8_t)buf[6], (uint8_t)buf[7], (uint8_t)buf[8]);
+  ESP_LOGD(RF_TAG, "TX pkt: %02X %02X %08X seq=%02X crc=%02X%02X", buf[OFF_LEN], buf[OFF_CMD],
+           (unsigned)readAddress(buf), buf[OFF_SEQ], buf[OFF_CRC], buf[OFF_CRC + 1]);
 
   txBurstLoop(numTransmits, buf);
 }
 
-void DieselHeaterRF::txBurstLoop(uint8_t numTransmits, const char *buf) {
+void DieselHeaterRF::txBurstLoop(uint8_t numTransmits, const uint8_t *buf) {
+  uint32_t cpu0 = _bus->cpuUs();
+  int64_t t0 = nowUs();
+  txBurstPackets(numTransmits, buf);
+  spiSync();
+  _lastBurstWallUs = (uint32_t)(nowUs() - t0);
+  _lastBurstCpuUs  = _bus->cpuUs() - cpu0;
+  ESP_LOGD(RF_TAG, "Burst SPI (%s): cpu=%luus wall=%luus", _asyncSpi ? "async" : "polling",
+           (unsigned long)_lastBurstCpuUs, (unsigned long)_lastBurstWallUs);
+}
+
+// In async mode the FIFO load and STX of each packet are queued back to back and only
+// the first MARCSTATE read waits for them.
+void DieselHeaterRF::txBurstPackets(uint8_t numTransmits, const uint8_t *buf) {
   writeReg(0x17, (_ccaMode << 4) | 0x01); // MCSM1: CCA_MODE=_ccaMode, TXOFF_MODE=FSTXON
   txFlush();
 
   uint8_t completed = 0;
   for (int i = 0; i < numTransmits; i++) {
-    writeBurst(0x7F, 10, (char*)buf);
+    writeBurst(0x7F, HeaterProtocol::kCommandFrame, (char *) buf);
     writeStrobe(0x35); // STX
 
     // Phase 1: spin until CC1101 leaves IDLE/FSTXON (confirms STX accepted).
     // Include 0x00 — first MARCSTATE read after writeStrobe returns corrupted
     // data (SPI_USR_MISO was disabled during the strobe), so treat 0x00 as
     // "still waiting" to avoid a race where Phase 2 sees stale FSTXON.
-    uint32_t t = _millis();
+    uint32_t t = nowMs();
     uint8_t ms;
     uint8_t p1_first = 0xFF;
     do {
       ms = writeReg(0xF5, 0xFF);
       if (p1_first == 0xFF) p1_first = ms;
-      if (_millis() - t > 50) {
+      if (nowMs() - t > 50) {
         ESP_LOGW(RF_TAG, "P1 timeout i=%d ms=0x%02X first=0x%02X done=%d/%d", i, ms, p1_first, completed, numTransmits);
         _lastP1First = p1_first; _lastP1Last = ms;
         _lastBurstCompleted = completed; _lastBurstRequested = numTransmits;
+        _p1Timeouts++;
         writeReg(0x17, (_ccaMode << 4));
         writeStrobe(0x36);
         return;
@@ -179,7 +119,7 @@ void DieselHeaterRF::txBurstLoop(uint8_t numTransmits, const char *buf) {
     _lastP1First = p1_first; _lastP1Last = ms;
 
     // Phase 2: wait for packet done (FSTXON = 0x12)
-    t = _millis();
+    t = nowMs();
     uint8_t p2_first = 0xFF;
     do {
       ms = writeReg(0xF5, 0xFF);
@@ -187,14 +127,16 @@ void DieselHeaterRF::txBurstLoop(uint8_t numTransmits, const char *buf) {
       if (ms == 0x16) { // TXFIFO_UNDERFLOW — flush and abort
         ESP_LOGW(RF_TAG, "TXFIFO underflow i=%d done=%d/%d", i, completed, numTransmits);
         _lastBurstCompleted = completed; _lastBurstRequested = numTransmits;
+        _txUnderflows++;
         txFlush();
         writeReg(0x17, (_ccaMode << 4));
         return;
       }
-      _delay_ms(1);
-      if (_millis() - t > 100) {
+      delayMs(1);
+      if (nowMs() - t > 100) {
         ESP_LOGW(RF_TAG, "P2 timeout i=%d ms=0x%02X first=0x%02X done=%d/%d", i, ms, p2_first, completed, numTransmits);
         _lastBurstCompleted = completed; _lastBurstRequested = numTransmits;
+        _p2Timeouts++;
         writeReg(0x17, (_ccaMode << 4));
         writeStrobe(0x36);
         return;
@@ -219,6 +161,7 @@ void DieselHeaterRF::endTxBurst() {
 }
 
 void DieselHeaterRF::startRx() {
+  leaveWor();
   rxFlush();
   rxEnable();
   _lastRxEntryState = writeReg(0xF5, 0xFF); // MARCSTATE after SRX
@@ -229,32 +172,111 @@ void DieselHeaterRF::startRxFromFstxon() {
   // SRX goes directly to RX without STARTCAL — avoids the ~720μs
   // calibration window where VCC droop can reset the CC1101.
   writeStrobe(0x34); // SRX
+  rxMode(RXM_ON);
   _lastRxEntryState = writeReg(0xF5, 0xFF); // MARCSTATE after SRX
 }
 
+bool DieselHeaterRF::startWor(uint32_t periodUs, uint8_t rxTime) {
+  if (rxTime > 6) rxTime = 6;
+  uint64_t event0 = ((uint64_t)periodUs * 26 + 375) / 750;  // t_EVENT0 = 750 / f_XOSC · EVENT0
+  if (event0 < 1) event0 = 1;
+  if (event0 > 0xFFFF) event0 = 0xFFFF;
+  rxFlush();                                 // IDLE, FIFO empty, GDO2 low
+  // SLEEP resets TEST2..0, so every sniff runs with their reset values. Write TEST0's
+  // (VCO_SEL_CAL_EN set, valid on every band) before SWOR so the first sniff matches the rest.
+  writeReg(0x2E, 0x0B);                      // TEST0
+  writeReg(0x1E, (uint8_t)(event0 >> 8));    // WOREVT1
+  writeReg(0x1F, (uint8_t)event0);           // WOREVT0
+  writeReg(0x20, 0x78);                      // WORCTRL: RC osc on, EVENT1=7 (~1.4 ms XOSC start), RC_CAL, WOR_RES=0
+  writeReg(0x16, rxTime);                    // MCSM2: RX_TIME_QUAL=0, RX_TIME=rxTime
+  writeStrobe(0x3C);                         // SWORRST
+  writeStrobe(0x38);                         // SWOR — sleeps once CSn goes high
+  spiSync();
+
+  uint32_t period = (uint32_t)(event0 * 750 / 26);
+  uint32_t on = (period >> (rxTime + 3)) + (isCalCached() ? kWorSettleCachedUs : kWorSettleCalUs);
+  _worDutyPpm = on >= period ? 1000000 : (uint32_t)((uint64_t)on * 1000000 / period);
+  _worActive = true;
+  rxMode(RXM_WOR);
+  return true;
+}
+
+void DieselHeaterRF::leaveWor() {
+  if (!_worActive) return;
+  _worActive = false;
+  rxMode(RXM_OFF);
+  // First access since SWOR: between sniffs the chip sleeps with the crystal off.
+  if (!_bus->wake()) ESP_LOGW(RF_TAG, "CC1101 not ready after wake-on-radio");
+  writeStrobe(0x36);    // SIDLE — ends the sniff cycle
+  writeReg(0x16, 0x07); // MCSM2: RX_TIME=7, no RX timeout
+  writeReg(0x20, 0xFB); // WORCTRL: RC oscillator off
+  writeSleepLostRegs(); // the sniffs' SLEEP reset TEST2..0 and PATABLE
+}
+
+void DieselHeaterRF::writeSleepLostRegs() {
+  // Registers the CC1101 does not retain in SLEEP.
+  writeReg(0x2C, 0x81); // TEST2
+  writeReg(0x2D, 0x35); // TEST1
+  writeReg(0x2E, 0x09); // TEST0
+
+  char patable[8] = {0x00, 0x12, 0x0E, 0x34, 0x60, (char)0xC5, (char)0xC1, (char)0xC0};
+  writeBurst(0x7E, 8, patable); // PATABLE
+}
+
+void DieselHeaterRF::rxMode(RxMode mode) {
+  int64_t now = nowUs();
+  _rxOnUs += rxOpenUs(now);
+  _rxMode = mode;
+  _rxModeUs = now;
+}
+
+uint64_t DieselHeaterRF::rxOpenUs(int64_t now) const {
+  uint64_t dt = (uint64_t)(now - _rxModeUs);
+  if (_rxMode == RXM_ON) return dt;
+  if (_rxMode == RXM_WOR) return dt * _worDutyPpm / 1000000;
+  return 0;
+}
+
 bool DieselHeaterRF::isRxAvailable() {
-  return gpio_get_level((gpio_num_t)_pinGdo2);
+  spiSync();  // GDO2 must reflect every queued strobe
+  return gdo2High();
 }
 
 bool DieselHeaterRF::readPacket(heater_state_t *state) {
+  uint32_t address;
+  return readPacket(state, &address) && address == _heaterAddr;
+}
+
+bool DieselHeaterRF::readPacket(heater_state_t *state, uint32_t *addr) {
+  using namespace HeaterProtocol;
   uint8_t rxLen = writeReg(0xFB, 0xFF); // RXBYTES
-  if (rxLen != 26) { rxFlush(); return false; }
-  char buf[26];
-  rx(26, buf);
+  if (rxLen != kStateRxLen) { rxFlush(); return false; }
+  uint8_t buf[kStateRxLen];
+  rx(kStateRxLen, (char *) buf);
   rxFlush();
-  if (!((uint8_t)buf[25] & 0x80)) return false; // CRC_OK bit
-  uint32_t address = parseAddress(buf);
-  if (address != _heaterAddr) return false;
-  state->state      = buf[6];
-  state->power      = buf[7];
-  state->errorCode  = buf[11];  // was buf[8] — neither byte confirmed by protocol docs
-  state->voltage    = buf[9] / 10.0f;
-  state->ambientTemp = buf[10];
-  state->caseTemp   = buf[12];
-  state->setpoint   = buf[13];
-  state->autoMode   = buf[14] == 0x32;
-  state->pumpFreq   = buf[15] / 10.0f;
-  state->rssi       = ((uint8_t)buf[24] >= 128 ? (int)(buf[24]) - 256 : (int)(uint8_t)buf[24]) / 2 - 74;
+  StateView frame(buf);
+  if (!frame.crcOk()) return false;
+  *addr = frame.address();
+  // FREQEST holds the offset measured on the last received packet; read in IDLE
+  // (after rxFlush) so the value is not mistaken for a status byte.
+  state->freqEst = getFreqEst();
+  state->lqi     = frame.lqi();
+  state->rssi    = rssiToDbm(frame.rssiRaw());
+  frame.decode(state);
+  return true;
+}
+
+bool DieselHeaterRF::readAnyPacket(uint32_t *addr, int16_t *rssi, uint8_t *rxLen) {
+  using namespace HeaterProtocol;
+  uint8_t len = writeReg(0xFB, 0xFF); // RXBYTES
+  if (len != kStateRxLen && len != kRemoteRxLen) { rxFlush(); return false; }
+  uint8_t buf[kStateRxLen];
+  rx(len, (char *) buf);
+  rxFlush();
+  if (!(buf[len - 1] & 0x80)) return false; // CRC_OK bit
+  *addr  = readAddress(buf);
+  *rssi  = rssiToDbm(buf[len - 2]);
+  *rxLen = len;
   return true;
 }
 
@@ -267,26 +289,82 @@ void DieselHeaterRF::getFreqRegisters(uint8_t *freq2, uint8_t *freq1, uint8_t *f
   *freq0 = writeReg(0x8F, 0xFF);  // read FREQ0
 }
 
+bool DieselHeaterRF::probe(char *info, size_t len) {
+  uint8_t partnum = getPartNum();
+  uint8_t version = getVersion();
+  uint8_t f2, f1, f0;
+  getFreqRegisters(&f2, &f1, &f0);
+  ESP_LOGI(RF_TAG, "CC1101 FREQ regs readback: 0x%02X%02X%02X (written: 0x%02X%02X%02X)",
+           f2, f1, f0, _freq2, _freq1, _freq0);
+  if (partnum == 0x00 && version == 0x14) {
+    snprintf(info, len, "OK freq=0x%02X%02X%02X", f2, f1, f0);
+    return true;
+  }
+  snprintf(info, len, "ERROR PARTNUM=0x%02X VERSION=0x%02X", partnum, version);
+  return false;
+}
+
+// Outside IDLE a register read returns the status byte (e.g. SYNC1=0xD3) — never
+// report that as a lost configuration.
+HeaterRadio::Health DieselHeaterRF::checkHealth(bool full) {
+  if (full) {
+    uint8_t bad = checkConfig();
+    return bad == 0xFF ? HEALTH_BUSY : bad != 0 ? HEALTH_LOST : HEALTH_OK;
+  }
+  if (getMarcstate() != 0x01) return HEALTH_BUSY;
+  return readConfigReg(0x04) == 0x7E ? HEALTH_OK : HEALTH_LOST;  // SYNC1
+}
+
+void DieselHeaterRF::dumpConfig(char *buf, size_t len) {
+  uint8_t r[0x13];
+  readBurst(0x00, sizeof(r), r);
+  snprintf(buf, len, "IOCFG2=0x%02X SYNC=0x%02X%02X FREQ=0x%02X%02X%02X MDMCFG4/3/2=0x%02X/%02X/%02X MARCSTATE=0x%02X",
+           r[0x00], r[0x04], r[0x05], r[0x0D], r[0x0E], r[0x0F], r[0x10], r[0x11], r[0x12], getMarcstate());
+}
+
+void DieselHeaterRF::getFscal(uint8_t *fscal3, uint8_t *fscal2, uint8_t *fscal1) {
+  *fscal3 = writeReg(0xA3, 0xFF);  // read FSCAL3
+  *fscal2 = writeReg(0xA4, 0xFF);  // read FSCAL2
+  *fscal1 = writeReg(0xA5, 0xFF);  // read FSCAL1
+}
+
+bool DieselHeaterRF::calibrateNow() {
+  if (writeReg(0xF5, 0xFF) != 0x01) return false;  // SCAL is only valid from IDLE
+  writeStrobe(0x33);  // SCAL
+  uint32_t t = nowMs();
+  uint8_t ms;
+  do {
+    ms = writeReg(0xF5, 0xFF);
+    if (nowMs() - t > 2) return false;
+  } while (ms != 0x01);  // MANCAL (0x03..0x05) → back to IDLE
+  getFscal(&_fscal3, &_fscal2, &_fscal1);
+  _calValid = true;
+  _calCount++;
+  if (_calCache) writeReg(0x18, 0x08);  // MCSM0: autocal off from now on
+  return true;
+}
+
 void DieselHeaterRF::setFrequency(uint8_t freq2, uint8_t freq1, uint8_t freq0) {
+  if (freq2 != _freq2 || freq1 != _freq1 || freq0 != _freq0) _calValid = false;  // calibration is per frequency
   _freq2 = freq2;
   _freq1 = freq1;
   _freq0 = freq0;
 }
 
 bool DieselHeaterRF::receiveRaw(char *bytes, uint8_t *len, uint16_t timeout) {
-  uint32_t t = _millis();
+  uint32_t t = nowMs();
   *len = 0;
 
   writeReg(0x00, 0x01); // IOCFG2: assert when RX FIFO >= threshold or end of packet
   rxFlush();
   rxEnable();
 
-  while (!gpio_get_level((gpio_num_t)_pinGdo2)) {
-    if (_millis() - t > timeout) {
+  while (!gdo2High()) {
+    if (nowMs() - t > timeout) {
       writeReg(0x00, 0x07); // restore IOCFG2
       return false;
     }
-    taskYIELD();
+    _bus->yield();
   }
 
   uint8_t rxLen = writeReg(0xFB, 0xFF);  // RXBYTES
@@ -303,56 +381,77 @@ bool DieselHeaterRF::receiveRaw(char *bytes, uint8_t *len, uint16_t timeout) {
   return true;
 }
 
+void DieselHeaterRF::startRawCapture() {
+  leaveWor();
+  writeStrobe(0x36);    // SIDLE — config writes only in IDLE
+  writeReg(0x00, 0x01); // IOCFG2: assert when RX FIFO >= threshold or end of packet
+  rxFlush();
+  rxEnable();
+}
+
+bool DieselHeaterRF::readRawFrame(uint8_t *bytes, uint8_t *len, int8_t *freqEst) {
+  uint8_t rxLen = writeReg(0xFB, 0xFF);  // RXBYTES — bit 7 = RXFIFO_OVERFLOW
+  *len = 0;
+  if (rxLen == 0 || rxLen > 64) {
+    rxFlush();
+    return false;
+  }
+  rx(rxLen, (char *) bytes);
+  rxFlush();
+  *freqEst = getFreqEst();  // read in IDLE, after rxFlush()
+  *len = rxLen;
+  return true;
+}
+
+void DieselHeaterRF::stopRawCapture() {
+  writeStrobe(0x36);    // SIDLE
+  writeReg(0x00, 0x07); // restore IOCFG2
+  rxFlush();
+}
+
 uint32_t DieselHeaterRF::findAddress(uint16_t timeout) {
-  char buf[26];
+  uint8_t buf[HeaterProtocol::kStateRxLen];
   if (receivePacket(buf, timeout)) {
-    return parseAddress(buf);
+    return HeaterProtocol::readAddress(buf);
   }
   return 0;
 }
 
-uint32_t DieselHeaterRF::parseAddress(char *buf) {
-  uint32_t address = 0;
-  address |= (buf[2] << 24);
-  address |= (buf[3] << 16);
-  address |= (buf[4] << 8);
-  address |= buf[5];
-  return address;
-}
-
-bool DieselHeaterRF::receivePacket(char *bytes, uint16_t timeout) {
-  uint32_t t = _millis();
+bool DieselHeaterRF::receivePacket(uint8_t *bytes, uint16_t timeout) {
+  uint32_t t = nowMs();
   uint8_t rxLen;
 
   rxFlush();
   rxEnable();
 
   while (1) {
-    if (_millis() - t > timeout) { rxFlush(); return false; }
+    if (nowMs() - t > timeout) { rxFlush(); return false; }
 
-    while (!gpio_get_level((gpio_num_t)_pinGdo2)) {
-      if (_millis() - t > timeout) { rxFlush(); return false; }
-      taskYIELD();
+    while (!gdo2High()) {
+      if (nowMs() - t > timeout) { rxFlush(); return false; }
+      _bus->yield();
     }
 
     rxLen = writeReg(0xFB, 0xFF);
-    if (rxLen == 26) break;  // length byte 0x17=23 + 2 APPEND_STATUS = 26 total
+    if (rxLen == HeaterProtocol::kStateRxLen) break;  // length byte 0x17=23 + 2 APPEND_STATUS = 26 total
 
     rxFlush();
     rxEnable();
   }
 
-  rx(rxLen, bytes);
+  rx(rxLen, (char *) bytes);
   rxFlush();
 
   // Hardware CRC validated by CC1101 (APPEND_STATUS: buf[25] bit7 = CRC_OK)
-  return (uint8_t)bytes[25] & 0x80;
+  return HeaterProtocol::StateView(bytes).crcOk();
 }
 
 void DieselHeaterRF::initRadio() {
+  _worActive = false;  // SRES restores the non-WOR defaults, initRadio() the rest
+  rxMode(RXM_OFF);
   writeStrobe(0x30); // SRES
 
-  _delay_ms(100);
+  delayMs(100);
 
   writeReg(0x00, 0x07); // IOCFG2: assert when packet received with CRC OK
   writeReg(0x02, 0x06); // IOCFG0
@@ -361,7 +460,7 @@ void DieselHeaterRF::initRadio() {
   writeReg(0x08, 0x05); // PKTCTRL0
   writeReg(0x0A, 0x00); // CHANNR
   writeReg(0x0B, 0x06); // FSCTRL1
-  writeReg(0x0C, 0x00); // FSCTRL0
+  writeReg(0x0C, (uint8_t)_freqOff); // FSCTRL0: FREQOFF (frequency-offset tracking)
   writeReg(0x0D, _freq2); // FREQ2
   writeReg(0x0E, _freq1); // FREQ1
   writeReg(0x0F, _freq0); // FREQ0
@@ -373,7 +472,7 @@ void DieselHeaterRF::initRadio() {
   writeReg(0x15, 0x26); // DEVIATN
   writeReg(0x16, 0x07); // MCSM2: RX_TIME=7 (no RX timeout — stay in RX until packet received)
   writeReg(0x17, (_ccaMode << 4)); // MCSM1: CCA_MODE=_ccaMode, TXOFF_MODE=IDLE
-  writeReg(0x18, 0x18); // MCSM0
+  writeReg(0x18, isCalCached() ? 0x08 : 0x18); // MCSM0: FS_AUTOCAL off while a cached calibration is restored
   writeReg(0x19, 0x17); // FOCCFG
   writeReg(0x1A, 0x6C); // BSCFG
   writeReg(0x1B, 0x03); // AGCTRL2
@@ -382,27 +481,43 @@ void DieselHeaterRF::initRadio() {
   writeReg(0x20, 0xFB); // WORCTRL
   writeReg(0x21, 0x56); // FREND1
   writeReg(0x22, 0x10 | _txPower); // FREND0: PA_POWER selects PATABLE index
-  writeReg(0x23, 0xE9); // FSCAL3
-  writeReg(0x24, 0x2A); // FSCAL2
-  writeReg(0x25, 0x00); // FSCAL1
+  writeReg(0x23, _fscal3); // FSCAL3 (0xE9 unless restored from a previous calibration)
+  writeReg(0x24, _fscal2); // FSCAL2 (0x2A)
+  writeReg(0x25, _fscal1); // FSCAL1 (0x00)
   writeReg(0x26, 0x1F); // FSCAL0
-  writeReg(0x2C, 0x81); // TEST2
-  writeReg(0x2D, 0x35); // TEST1
-  writeReg(0x2E, 0x09); // TEST0
+  writeSleepLostRegs();  // TEST2..0, PATABLE
   writeReg(0x09, 0x00); // ADDR
   writeReg(0x04, 0x7E); // SYNC1
   writeReg(0x05, 0x3C); // SYNC0
 
-  char patable[8] = {0x00, 0x12, 0x0E, 0x34, 0x60, (char)0xC5, (char)0xC1, (char)0xC0};
-  writeBurst(0x7E, 8, patable); // PATABLE
-
   writeStrobe(0x31); // SFSTXON
   writeStrobe(0x36); // SIDLE
   writeStrobe(0x3B); // SFTX
   writeStrobe(0x36); // SIDLE
   writeStrobe(0x3A); // SFRX
 
-  _delay_ms(136);
+  delayMs(136);
+}
+
+uint8_t DieselHeaterRF::checkConfig() {
+  if (getMarcstate() != 0x01) return 0xFF;
+  uint8_t regs[0x2F];
+  readBurst(0x00, sizeof(regs), regs);
+  // Same values as initRadio(). Not checked: MCSM1 (rewritten per burst by sendCommand()),
+  // FSCAL3..1 (overwritten by every calibration) and the read-only/unused 0x1E–0x1F, 0x27–0x2B.
+  const uint8_t expected[][2] = {
+    {0x00, 0x07}, {0x02, 0x06}, {0x03, 0x47}, {0x04, 0x7E}, {0x05, 0x3C}, {0x07, 0x04},
+    {0x08, 0x05}, {0x09, 0x00}, {0x0A, 0x00}, {0x0B, 0x06}, {0x0C, (uint8_t)_freqOff},
+    {0x0D, _freq2}, {0x0E, _freq1}, {0x0F, _freq0}, {0x10, 0xF8}, {0x11, 0x93}, {0x12, 0x13},
+    {0x13, 0x22}, {0x14, 0xF8}, {0x15, 0x26}, {0x16, 0x07}, {0x18, (uint8_t)(isCalCached() ? 0x08 : 0x18)}, {0x19, 0x17},
+    {0x1A, 0x6C}, {0x1B, 0x03}, {0x1C, 0x40}, {0x1D, 0x91}, {0x20, 0xFB}, {0x21, 0x56},
+    {0x22, (uint8_t)(0x10 | _txPower)}, {0x26, 0x1F}, {0x2C, 0x81}, {0x2D, 0x35}, {0x2E, 0x09},
+  };
+  uint8_t bad = 0;
+  for (const auto &r : expected) {
+    if (regs[r[0]] != r[1]) bad++;
+  }
+  return bad;
 }
 
 void DieselHeaterRF::txBurst(uint8_t len, char *bytes) {
@@ -420,27 +535,28 @@ void DieselHeaterRF::txFlush() {
 // Header byte 0xFF = R=1, Burst=1, addr=0x3F (RXFIFO).
 // The first received byte is the CC1101 status byte; data follows from index 1.
 void DieselHeaterRF::rx(uint8_t len, char *bytes) {
-  uint8_t tx[27] = {};
-  uint8_t rxbuf[27] = {};
-  tx[0] = 0xFF;  // RXFIFO burst read
-  // remaining tx bytes are 0x00 — don't-care, just clock out the FIFO
-
-  spi_transaction_t t = {};
-  t.length    = (size_t)(len + 1) * 8;
-  t.tx_buffer = tx;
-  t.rx_buffer = rxbuf;
-  t.user      = (void *)(uintptr_t)_pinEnc;
-  spi_device_polling_transmit(_spi, &t);
+  if (len > 64) len = 64;  // 1 header + up to 64 FIFO bytes (raw capture drains a full FIFO)
+  uint8_t tx[65] = {0xFF};  // RXFIFO burst read; the rest is don't-care, just clocks out the FIFO
+  const uint8_t *in = _bus->transfer(tx, len + 1, true);
+  memcpy(bytes, in + 1, len);  // skip status byte at index 0
+}
 
-  memcpy(bytes, rxbuf + 1, len);  // skip status byte at index 0
+// Burst-read len configuration registers starting at addr (header R=1, Burst=1).
+void DieselHeaterRF::readBurst(uint8_t addr, uint8_t len, uint8_t *bytes) {
+  if (len > 47) len = 47;
+  uint8_t tx[48] = {(uint8_t)(addr | 0xC0)};
+  const uint8_t *in = _bus->transfer(tx, len + 1, true);
+  memcpy(bytes, in + 1, len);  // skip status byte at index 0
 }
 
 void DieselHeaterRF::rxFlush() {
+  rxMode(RXM_OFF);
   writeStrobe(0x36); // SIDLE
+  spiSync();
   // De-assert GDO2 by reading one FIFO byte — but only if FIFO has data.
   // Reading from an empty FIFO triggers RXFIFO underflow (CC1101 auto-recovers
   // to IDLE, but the brief error state can leave the chip fragile).
-  if (gpio_get_level((gpio_num_t)_pinGdo2)) {
+  if (gdo2High()) {
     writeReg(0xBF, 0xFF); // read one byte → GDO2 de-asserts
   }
   writeStrobe(0x3A); // SFRX — flush RX FIFO (valid in IDLE or RXFIFO_OVERFLOW)
@@ -448,64 +564,26 @@ void DieselHeaterRF::rxFlush() {
 
 void DieselHeaterRF::rxEnable() {
   writeStrobe(0x34); // SRX
+  rxMode(RXM_ON);
 }
 
 // 2-byte transaction: send addr, send val, return received byte from second transfer.
 uint8_t DieselHeaterRF::writeReg(uint8_t addr, uint8_t val) {
-  spi_transaction_t t = {};
-  t.length = 16;
-  t.flags  = SPI_TRANS_USE_TXDATA | SPI_TRANS_USE_RXDATA;
-  t.tx_data[0] = addr;
-  t.tx_data[1] = val;
-  t.user = (void *)(uintptr_t)_pinEnc;
-  spi_device_polling_transmit(_spi, &t);
-  return t.rx_data[1];
+  uint8_t tx[2] = {addr, val};
+  return _bus->transfer(tx, 2, true)[1];
 }
 
 // Burst write: send addr byte then len data bytes in one CS assertion.
-// Non-NULL rx_buffer keeps SPI_USR_MISO enabled so the next SPI read
-// (e.g. getMarcstate) returns valid data on the first call.
+// Async transport: queued, not waited for — the bus copies the data.
 void DieselHeaterRF::writeBurst(uint8_t addr, uint8_t len, char *bytes) {
-  uint8_t tx[32];  // max burst: 1 (addr) + 10 (TX packet) or 8 (PATABLE) = 11 max
-  uint8_t rx[32];  // discarded — only present to keep MISO enabled
-  tx[0] = addr;
+  if (len > 64) len = 64;  // max used: 10 (TX packet) or 8 (PATABLE)
+  uint8_t tx[65] = {addr};
   memcpy(tx + 1, bytes, len);
-
-  spi_transaction_t t = {};
-  t.length    = (size_t)(len + 1) * 8;
-  t.tx_buffer = tx;
-  t.rx_buffer = rx;
-  t.user      = (void *)(uintptr_t)_pinEnc;
-  spi_device_polling_transmit(_spi, &t);
+  _bus->transfer(tx, len + 1, false);
 }
 
 // Single-byte strobe command — no data byte needed.
-// SPI_TRANS_USE_RXDATA keeps SPI_USR_MISO enabled so the next SPI read
-// returns valid data on the first call (without needing a warmup read).
+// Async transport: queued, not waited for.
 void DieselHeaterRF::writeStrobe(uint8_t addr) {
-  spi_transaction_t t = {};
-  t.length = 8;
-  t.flags  = SPI_TRANS_USE_TXDATA | SPI_TRANS_USE_RXDATA;
-  t.tx_data[0] = addr;
-  t.user = (void *)(uintptr_t)_pinEnc;
-  spi_device_polling_transmit(_spi, &t);
-}
-
-/*
- * CRC-16/MODBUS
- */
-uint16_t DieselHeaterRF::crc16_2(char *buf, int len) {
-  uint16_t crc = 0xFFFF;
-  for (int pos = 0; pos < len; pos++) {
-    crc ^= (uint8_t)buf[pos];
-    for (int i = 8; i != 0; i--) {
-      if ((crc & 0x0001) != 0) {
-        crc >>= 1;
-        crc ^= 0xA001;
-      } else {
-        crc >>= 1;
-      }
-    }
-  }
-  return crc;
+  _bus->transfer(&addr, 1, false);
 }
@@ -18,6 +18,34 @@
  *   - MDMCFG1 NUM_PREAMBLE set to match original remote (4 bytes)
  *   - MCSM1 CCA_MODE configurable via setCcaMode() (default 0 = always TX)
  *   - readPacket() now parses buf[11] as errorCode into heater_state_t
+ *   - readAnyPacket(): non-blocking, address-agnostic read for multi-device discovery
+ *   - startRawCapture()/readRawFrame()/stopRawCapture(): non-blocking raw capture for debug mode
+ *   - readPacket() captures FREQEST and LQI per valid packet; FSCTRL0 FREQOFF is
+ *     settable via setFreqOffset() for automatic frequency-offset tracking
+ *   - readPacket(state, addr): address-agnostic state read so one transceiver can serve
+ *     several heaters; the caller routes the packet by the returned address
+ *   - checkConfig(): single burst read of the configuration registers, compared with
+ *     the values written by initRadio() (startup readiness gate)
+ *   - setFscal()/getFscal(): FSCAL3..1 start values for initRadio() can be restored
+ *     from a previous calibration instead of the fixed SmartRF defaults
+ *   - Calibration caching: calibrateNow() runs SCAL once and caches FSCAL3..1; while the
+ *     cache is valid initRadio() restores it with MCSM0 FS_AUTOCAL=0, so IDLE→TX/RX skips
+ *     the synthesizer calibration (and its VCC-droop window)
+ *   - Optional async SPI transport (setAsyncSpi()): DMA-capable bus, transfers queued to
+ *     the SPI driver with interrupt completion; strobes and FIFO loads are not waited for,
+ *     the chip-ready wait sleeps on a MISO edge interrupt instead of spinning in pre_cb.
+ *     getLastBurstCpuUs()/getLastBurstWallUs() report the SPI CPU time of each TX burst
+ *   - getP1Timeouts()/getP2Timeouts()/getTxUnderflows(): burst abort counters since begin()
+ *   - Hardware access goes through DieselHeaterBus: the ESP-IDF SPI master, GDO2 GPIO and
+ *     clock moved to DieselHeaterSpiBus, and setBus() swaps in the host CC1101 model of
+ *     tools/sim (virtual clock, simulated heater, fault injection)
+ *   - Implements HeaterRadio (probe(), checkHealth(), dumpConfig(), idle(), startRxAfterTx())
+ *     so the component can drive an SX1262 through the same interface; protocol constants
+ *     and heater_state_t moved to HeaterRadio.h
+ *   - Frame building and parsing go through HeaterProtocol.h (table-driven CRC, cached
+ *     command frame, StateView); parseAddress() no longer sign-extends address bytes
+ *   - startWor(): wake-on-radio RX sniffing (WOREVT/WORCTRL, MCSM2 RX_TIME) for low-power
+ *     passive listening; getRxOnUs() accounts receiver on-time as a current proxy
  *
  * Feel free to use this library as you please, but do it at your own risk!
  */
@@ -27,7 +55,8 @@
 
 #include <stdint.h>
 #include <string.h>
-#include "driver/spi_master.h"
+#include "HeaterProtocol.h"
+#include "HeaterRadio.h"
 
 #define HEATER_SCK_PIN   18
 #define HEATER_MISO_PIN  19
@@ -35,39 +64,36 @@
 #define HEATER_SS_PIN    5
 #define HEATER_GDO2_PIN  4
 
-#define HEATER_CMD_GET_STATUS 0x23
-#define HEATER_CMD_MODE   0x24
-#define HEATER_CMD_POWER  0x2b
-#define HEATER_CMD_UP     0x3c
-#define HEATER_CMD_DOWN   0x3e
-
-#define HEATER_STATE_OFF            0x00
-#define HEATER_STATE_STARTUP        0x01
-#define HEATER_STATE_WARMING        0x02
-#define HEATER_STATE_WARMING_WAIT   0x03
-#define HEATER_STATE_PRE_RUN        0x04
-#define HEATER_STATE_RUNNING        0x05
-#define HEATER_STATE_SHUTDOWN       0x06
-#define HEATER_STATE_SHUTTING_DOWN  0x07
-#define HEATER_STATE_COOLING        0x08
-
-#define HEATER_TX_REPEAT    10 // Number of times to re-transmit command packets
-#define HEATER_RX_TIMEOUT   5000
-
-typedef struct {
-  uint8_t state       = 0;
-  uint8_t power       = 0;
-  uint8_t errorCode   = 0;
-  float voltage       = 0;
-  int8_t ambientTemp  = 0;
-  uint8_t caseTemp    = 0;
-  int8_t setpoint     = 0;
-  uint8_t autoMode    = 0;
-  float pumpFreq      = 0;
-  int16_t rssi        = 0;
-} heater_state_t;
-
-class DieselHeaterRF {
+// Board seam — everything the driver takes from the hardware. On the ESP32 begin() uses
+// a DieselHeaterSpiBus (DieselHeaterSpiBus.h: SPI master, GPIO, esp_timer/vTaskDelay)
+// unless setBus() supplied another bus; tools/sim plugs in a CC1101 register/MARCSTATE
+// model with a virtual clock. transfer() gets each SPI transaction exactly as the chip
+// sees it between CS low and CS high, so a model needs no knowledge of the driver.
+class DieselHeaterBus {
+  public:
+    virtual ~DieselHeaterBus() = default;
+    // One transaction of len bytes (≤ 65), header byte first. Returns the len bytes
+    // clocked in — the chip status byte first — valid until the next transfer(). Without
+    // wait a queueing transport may return before the transfer has run, and nullptr.
+    virtual const uint8_t *transfer(const uint8_t *tx, size_t len, bool wait) = 0;
+    // Completes every queued transfer.
+    virtual void sync() {}
+    // Completes queued transfers, then holds CS low until the chip signals ready on SO —
+    // the crystal restarting after SLEEP. False if it did not within 5 ms.
+    virtual bool wake() {
+      sync();
+      return true;
+    }
+    virtual bool gdo2() = 0;
+    virtual int64_t micros() = 0;
+    virtual void delay(uint32_t ms) = 0;
+    // Lets other tasks run inside the blocking receive loops.
+    virtual void yield() {}
+    // CPU time spent in transfers since start, µs, wrapping.
+    virtual uint32_t cpuUs() const { return 0; }
+};
+
+class DieselHeaterRF : public HeaterRadio {
   public:
     DieselHeaterRF() {
       _pinSck = HEATER_SCK_PIN;
@@ -83,58 +109,127 @@ class DieselHeaterRF {
       _pinSs = ss;
       _pinGdo2 = gdo2;
     }
-    ~DieselHeaterRF() {}
+    ~DieselHeaterRF() {
+      if (_busOwned) delete _bus;
+    }
 
     void begin();
-    void begin(uint32_t heaterAddr);
-    void setAddress(uint32_t heaterAddr);
-    void setFrequency(uint8_t freq2, uint8_t freq1, uint8_t freq0);
+    const char *chipName() const override { return "CC1101"; }
+    void begin(uint32_t heaterAddr) override;
+    void setAddress(uint32_t heaterAddr) override;
+    void setFrequency(uint8_t freq2, uint8_t freq1, uint8_t freq0) override;
     void setCcaMode(uint8_t mode) { _ccaMode = mode & 0x03; }
-    void setTxPower(uint8_t index) { _txPower = index & 0x07; }
-    void reinitRadio() { initRadio(); }
+    void setTxPower(uint8_t index) override { _txPower = index & 0x07; }
+    // FSCTRL0 FREQOFF (f_XOSC/2^14 steps) — written on the next initRadio()/reinitRadio().
+    void setFreqOffset(int8_t off) override { _freqOff = off; }
+    int8_t getFreqOffset() const override { return _freqOff; }
+    // FSCAL3/2/1 written by initRadio(); getFscal() reads the chip's current values (IDLE only).
+    // setFscal() also marks them as a valid cached calibration (used if caching is on).
+    void setFscal(uint8_t fscal3, uint8_t fscal2, uint8_t fscal1) override {
+      _fscal3 = fscal3; _fscal2 = fscal2; _fscal1 = fscal1; _calValid = true;
+    }
+    void getFscal(uint8_t *fscal3, uint8_t *fscal2, uint8_t *fscal1) override;
+    // Calibration cache. Disabled: MCSM0 autocal on every IDLE→TX/RX, as originally.
+    void setCalCache(bool enabled) override { _calCache = enabled; }
+    bool isCalCached() const override { return _calCache && _calValid; }
+    void invalidateCal() { _calValid = false; }
+    // SCAL from IDLE, wait for completion, cache FSCAL3..1 and switch autocal off. Blocks ≤ 2 ms.
+    bool calibrateNow() override;
+    uint32_t getCalCount() const override { return _calCount; }
+    void reinitRadio() override { initRadio(); }
+    // SPI transport, fixed at begin(). Polling (default): every transfer spins the CPU until
+    // done. Async: transfers are queued and complete by interrupt; the caller only sleeps
+    // when it needs a result. See DieselHeaterSpiBus.h.
+    void setAsyncSpi(bool enabled) { _asyncSpi = enabled; }
+    // Replace the hardware with another bus, e.g. a model (before begin(); the pins and
+    // async SPI then do not apply). The bus must outlive the driver.
+    void setBus(DieselHeaterBus *bus) { _bus = bus; }
+    bool isAsyncSpi() const { return _asyncSpi; }
 
     // Blocking TX — sends numTransmits packets with Phase 1/Phase 2 MARCSTATE polling.
     // Caller provides seq# explicitly; use nextSeq() for a new seq, or reuse for retransmit.
-    void sendCommand(uint8_t cmd, uint32_t addr, uint8_t numTransmits, uint8_t seq);
+    void sendCommand(uint8_t cmd, uint32_t addr, uint8_t numTransmits, uint8_t seq) override;
     uint8_t nextSeq() { return _packetSeq++; }
 
-    void endTxBurst();
+    void endTxBurst() override;
+    void idle() override { leaveWor(); sidle(); }
 
     // Non-blocking RX —————————————————————————————————————
     // rxFlush + rxEnable — puts CC1101 into RX mode (requires calibration).
-    void startRx();
+    void startRx() override;
     // SRX from FSTXON — enters RX directly without calibration (synth already locked).
     void startRxFromFstxon();
+    void startRxAfterTx() override { startRxFromFstxon(); }
     // True if GDO2 is high (packet in RX FIFO).
-    bool isRxAvailable();
+    bool isRxAvailable() override;
     // Read RX FIFO, validate CRC and address, parse into state. Non-blocking.
     // Returns false if FIFO size wrong, CRC fail, or address mismatch; calls rxFlush() on failure.
-    bool readPacket(heater_state_t *state);
+    bool readPacket(heater_state_t *state) override;
+    // Same, without the address filter — returns the sender in *addr (multi-heater RX).
+    bool readPacket(heater_state_t *state, uint32_t *addr) override;
+    // Like readPacket() but without the address filter — for discovery. Accepts heater
+    // state packets (26 bytes) and remote command packets (12 bytes); CRC must be OK.
+    bool readAnyPacket(uint32_t *addr, int16_t *rssi, uint8_t *rxLen) override;
 
     // Diagnostics —————————————————————————————————————————
+    // PARTNUM/VERSION 0x00/0x14 and the FREQ registers as written.
+    bool probe(char *info, size_t len) override;
+    // MARCSTATE not IDLE → HEALTH_BUSY. full: checkConfig(), otherwise SYNC1 only.
+    Health checkHealth(bool full) override;
+    void dumpConfig(char *buf, size_t len) override;
     uint8_t getPartNum();
     uint8_t getVersion();
     void getFreqRegisters(uint8_t *freq2, uint8_t *freq1, uint8_t *freq0);
     uint8_t getMarcstate();
-    uint8_t getRxBytes() { return writeReg(0xFB, 0xFF); }  // RXBYTES status register
+    uint8_t getRxBytes() override { return writeReg(0xFB, 0xFF); }  // RXBYTES status register
     uint8_t readConfigReg(uint8_t addr) { return writeReg(addr | 0x80, 0xFF); }
-    uint8_t getLastBurstCompleted() const { return _lastBurstCompleted; }
-    uint8_t getLastBurstRequested() const { return _lastBurstRequested; }
+    // Burst-reads 0x00–0x2E and compares with what initRadio() wrote. Returns the number
+    // of mismatching registers, or 0xFF if the chip is not IDLE (reads would be status bytes).
+    uint8_t checkConfig();
+    int8_t getFreqEst() { return (int8_t)writeReg(0xF2, 0xFF); }  // FREQEST status register
+    uint8_t getLastBurstCompleted() const override { return _lastBurstCompleted; }
+    uint8_t getLastBurstRequested() const override { return _lastBurstRequested; }
     uint8_t getLastRxEntryState() const { return _lastRxEntryState; }
     uint8_t getLastP1First() const { return _lastP1First; }
     uint8_t getLastP1Last() const { return _lastP1Last; }
+    // Last sendCommand(): CPU time spent in SPI transfers (issuing, spinning on completion
+    // or chip-ready; ISR and context-switch overhead not included) and wall time of the burst.
+    uint32_t getLastBurstCpuUs() const override { return _lastBurstCpuUs; }
+    uint32_t getLastBurstWallUs() const override { return _lastBurstWallUs; }
+    // Burst aborts since begin(): STX not accepted, packet not finished, TXFIFO underflow.
+    uint32_t getP1Timeouts() const override { return _p1Timeouts; }
+    uint32_t getP2Timeouts() const override { return _p2Timeouts; }
+    uint32_t getTxUnderflows() const override { return _txUnderflows; }
     void calibrate() { writeStrobe(0x33); }  // SCAL — manual frequency calibration
-    void sidle()    { writeStrobe(0x36); }  // SIDLE — force chip to IDLE state
+    void sidle()    { rxMode(RXM_OFF); writeStrobe(0x36); }  // SIDLE — force chip to IDLE state
+    // Non-blocking raw capture — IOCFG2=0x01 so GDO2 also asserts for CRC-failed frames.
+    // readRawFrame() drains the FIFO (≤64 bytes incl. APPEND_STATUS) and reports FREQEST;
+    // call startRx() afterwards to re-arm. stopRawCapture() restores IOCFG2 and goes IDLE.
+    void startRawCapture() override;
+    bool readRawFrame(uint8_t *bytes, uint8_t *len, int8_t *freqEst) override;
+    void stopRawCapture() override;
+    // Wake-on-radio —————————————————————————————————————
+    // SWOR with EVENT0 = periodUs (WOR_RES=0: 28.85 µs steps, ≤ 1.89 s), the RC oscillator
+    // on and MCSM2 RX_TIME = rxTime (0..6 → 12.5 %…0.195 % of the period). RX_TIME_QUAL=0:
+    // a sniff that finds a sync word stays in RX for the packet, which ends IDLE with GDO2
+    // high. The chip sleeps between sniffs and CSn low wakes it, so nothing may touch SPI
+    // until GDO2 asserts. SLEEP loses TEST2..0 and PATABLE: sniffs run with the reset TEST
+    // values, and leaveWor() restores them along with MCSM2/WORCTRL; idle(), startRx(),
+    // startRawCapture() and reinitRadio() call it.
+    bool startWor(uint32_t periodUs, uint8_t rxTime) override;
+    bool isWorActive() const { return _worActive; }
+    uint64_t getRxOnUs() override { return _rxOnUs + rxOpenUs(nowUs()); }
     // Blocking raw RX — for debug/find_address only.
     bool receiveRaw(char *bytes, uint8_t *len, uint16_t timeout);
     uint32_t findAddress(uint16_t timeout);
 
   private:
     uint8_t _pinSck, _pinMiso, _pinMosi, _pinSs, _pinGdo2;
-    uint16_t _pinEnc{0};  // (cs_pin << 8) | miso_pin — packed into spi_transaction_t::user
-    spi_device_handle_t _spi{nullptr};
+    DieselHeaterBus *_bus{nullptr};
+    bool _busOwned{false};  // created by begin()
     uint32_t _heaterAddr = 0;
     uint8_t _packetSeq = 0;
+    HeaterProtocol::CommandFrame _txFrame;  // last command frame; rebuilt on a new cmd/addr
     uint8_t _lastBurstCompleted{0};
     uint8_t _lastBurstRequested{0};
     uint8_t _lastRxEntryState{0};
@@ -143,20 +238,54 @@ class DieselHeaterRF {
     uint8_t _freq2{0x10}, _freq1{0xB0}, _freq0{0x9E};
     uint8_t _ccaMode{0};
     uint8_t _txPower{7};  // PATABLE index 0-7; 7=+10dBm, 5=+7dBm, 4=0dBm, 3=-10dBm
+    int8_t _freqOff{0};   // FSCTRL0 value applied by initRadio()
+    uint8_t _fscal3{0xE9}, _fscal2{0x2A}, _fscal1{0x00};
+    bool _calCache{false};
+    bool _calValid{false};
+    uint32_t _calCount{0};
+
+    bool _asyncSpi{false};
+    uint32_t _lastBurstCpuUs{0};
+    uint32_t _lastBurstWallUs{0};
+    uint32_t _p1Timeouts{0};
+    uint32_t _p2Timeouts{0};
+    uint32_t _txUnderflows{0};
+
+    // Receiver on-time (getRxOnUs()): the mode is switched on every SRX, SWOR and SIDLE/SRES
+    // the driver issues. RX the chip ends by itself (packet received → IDLE) counts until
+    // the driver next touches the chip — at loop() latency, close enough for a proxy.
+    enum RxMode : uint8_t { RXM_OFF, RXM_ON, RXM_WOR };
+    static constexpr uint32_t kWorSettleCalUs = 810;   // per sniff: FS calibration + PLL settle
+    static constexpr uint32_t kWorSettleCachedUs = 90;  // ... PLL settle only (FS_AUTOCAL off)
+    RxMode _rxMode{RXM_OFF};
+    int64_t _rxModeUs{0};
+    uint64_t _rxOnUs{0};
+    uint32_t _worDutyPpm{0};  // RX share of a WOR period, settling included
+    bool _worActive{false};   // MCSM2/WORCTRL hold the WOR values
+    void rxMode(RxMode mode);
+    uint64_t rxOpenUs(int64_t now) const;
+    void leaveWor();
+    void writeSleepLostRegs();
+
+    uint32_t nowMs() { return (uint32_t)(_bus->micros() / 1000); }
+    int64_t nowUs() { return _bus->micros(); }
+    void delayMs(uint32_t ms) { _bus->delay(ms); }
+    bool gdo2High() { return _bus->gdo2(); }
+    void spiSync() { _bus->sync(); }
 
     void initRadio();
-    void txBurstLoop(uint8_t numTransmits, const char *buf);
+    void txBurstLoop(uint8_t numTransmits, const uint8_t *buf);
+    void txBurstPackets(uint8_t numTransmits, const uint8_t *buf);
     void txBurst(uint8_t len, char *bytes);
     void txFlush();
     void rx(uint8_t len, char *bytes);
+    void readBurst(uint8_t addr, uint8_t len, uint8_t *bytes);
     void rxFlush();
     void rxEnable();
     uint8_t writeReg(uint8_t addr, uint8_t val);
     void writeBurst(uint8_t addr, uint8_t len, char *bytes);
     void writeStrobe(uint8_t addr);
-    bool receivePacket(char *bytes, uint16_t timeout);
-    uint32_t parseAddress(char *buf);
-    uint16_t crc16_2(char *buf, int len);
+    bool receivePacket(uint8_t *bytes, uint16_t timeout);
 };
 
 #endif
@@ -0,0 +1,485 @@
+/*
+ * DieselHeaterSX1262.cpp — see DieselHeaterSX1262.h and docs/sx1262-port-guide.md.
+ *
+ * Corrections to the port guide, checked against the SX1262 datasheet (DS.SX1261-2 Rev 2.1):
+ *   - GFSK bit rate register is 32 × f_XTAL / bitrate: 0x019052 for 9992 bps, not 0x000C83
+ *   - bandwidth 0x12 is 187.2 kHz in the GFSK table; 58.6 kHz is 0x0C
+ *   - SetPacketType is 0x8A and SetDioIrqParams 0x08 (the guide's 0x01 is not an opcode,
+ *     0x02 is ClearIrqStatus); IRQ bits: TxDone 0, RxDone 1, CrcErr 6, Timeout 9
+ *   - the heater packets carry the CC1101 hardware CRC (the CC1101 driver checks CRC_OK,
+ *     not the CRC-16/MODBUS field), so the SX1262 CRC is enabled with the CC1101 polynomial and seed
+ *
+ * tools/sim/sx1262_check runs this file against a command model of the chip and checks
+ * these corrections, the CRC and sync word registers, the IRQ flow and the RX timeout.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "esp_log.h"
+#include "DieselHeaterSX1262.h"
+#ifdef ESP_PLATFORM
+#include "DieselHeaterSX1262SpiBus.h"
+#endif
+
+static const char *const RF_TAG = "diesel_heater_rf";
+
+// Modem settings — tunable without touching the protocol logic.
+#define SX1262_BITRATE_REG   0x019052  // 32 × 32 MHz / 9992 bps
+#define SX1262_FREQDEV_REG   0x002D80  // 11.1 kHz × 2^25 / 32 MHz
+#define SX1262_BW_REG        0x0C      // RX bandwidth 58.6 kHz
+#define SX1262_PULSESHAPE    0x09      // GFSK BT=0.5
+#define SX1262_PREAMBLE_LEN  32        // bits (4 bytes, as the original remote)
+#define SX1262_TX_TIMEOUT_MS 50        // per packet; one packet is ~15 ms on air
+
+// Opcodes
+static constexpr uint8_t OP_SET_STANDBY            = 0x80;
+static constexpr uint8_t OP_SET_TX                 = 0x83;
+static constexpr uint8_t OP_SET_RX                 = 0x82;
+static constexpr uint8_t OP_SET_RF_FREQUENCY       = 0x86;
+static constexpr uint8_t OP_SET_PACKET_TYPE        = 0x8A;
+static constexpr uint8_t OP_SET_MODULATION_PARAMS  = 0x8B;
+static constexpr uint8_t OP_SET_PACKET_PARAMS      = 0x8C;
+static constexpr uint8_t OP_SET_TX_PARAMS          = 0x8E;
+static constexpr uint8_t OP_SET_BUFFER_BASE        = 0x8F;
+static constexpr uint8_t OP_SET_FALLBACK_MODE      = 0x93;
+static constexpr uint8_t OP_SET_PA_CONFIG          = 0x95;
+static constexpr uint8_t OP_SET_REGULATOR_MODE     = 0x96;
+static constexpr uint8_t OP_SET_DIO3_AS_TCXO_CTRL  = 0x97;
+static constexpr uint8_t OP_CALIBRATE_IMAGE        = 0x98;
+static constexpr uint8_t OP_SET_DIO2_AS_RF_SWITCH  = 0x9D;
+static constexpr uint8_t OP_CALIBRATE              = 0x89;
+static constexpr uint8_t OP_SET_DIO_IRQ_PARAMS     = 0x08;
+static constexpr uint8_t OP_CLEAR_IRQ_STATUS       = 0x02;
+static constexpr uint8_t OP_CLEAR_DEVICE_ERRORS    = 0x07;
+static constexpr uint8_t OP_WRITE_REGISTER         = 0x0D;
+static constexpr uint8_t OP_READ_REGISTER          = 0x1D;
+static constexpr uint8_t OP_WRITE_BUFFER           = 0x0E;
+static constexpr uint8_t OP_READ_BUFFER            = 0x1E;
+static constexpr uint8_t OP_GET_PACKET_TYPE        = 0x11;
+static constexpr uint8_t OP_GET_IRQ_STATUS         = 0x12;
+static constexpr uint8_t OP_GET_RX_BUFFER_STATUS   = 0x13;
+static constexpr uint8_t OP_GET_PACKET_STATUS      = 0x14;
+static constexpr uint8_t OP_GET_DEVICE_ERRORS      = 0x17;
+static constexpr uint8_t OP_GET_STATUS             = 0xC0;
+
+static constexpr uint16_t REG_CRC_INIT   = 0x06BC;  // 2 bytes seed, then 2 bytes polynomial
+static constexpr uint16_t REG_SYNC_WORD  = 0x06C0;
+
+static constexpr uint16_t IRQ_TX_DONE = 0x0001;
+static constexpr uint16_t IRQ_RX_DONE = 0x0002;
+static constexpr uint16_t IRQ_CRC_ERR = 0x0040;
+static constexpr uint16_t IRQ_TIMEOUT = 0x0200;
+static constexpr uint16_t IRQ_USED    = IRQ_TX_DONE | IRQ_RX_DONE | IRQ_CRC_ERR | IRQ_TIMEOUT;
+
+static constexpr uint8_t MODE_STBY_RC = 0x2;
+static constexpr uint8_t MODE_RX      = 0x5;
+static constexpr uint8_t MODE_TX      = 0x6;
+
+static constexpr uint32_t kBusyTimeoutMs = 20;       // longest: Calibrate(all) ~3.5 ms
+static constexpr uint32_t kRxContinuous = 0xFFFFFF;
+static constexpr uint32_t kTimeoutStepsPerMs = 64;   // SetTx/SetRx timeout unit is 15.625 µs
+
+// PATABLE index → dBm, matching DieselHeaterRF's table where the SX1262 can (min -9 dBm).
+static const int8_t kTxPowerDbm[8] = {-9, -9, -9, -9, 0, 7, 8, 10};
+
+void DieselHeaterSX1262::begin(uint32_t heaterAddr) {
+  _heaterAddr = heaterAddr;
+#ifdef ESP_PLATFORM
+  if (_bus == nullptr) {
+    auto *bus = new DieselHeaterSX1262SpiBus(_pinSck, _pinMiso, _pinMosi, _pinNss, _pinDio1, _pinBusy, _pinRst);
+    _bus = bus;
+    _busOwned = true;
+    if (!bus->begin()) return;
+  }
+#endif
+  if (_bus == nullptr) return;
+  hardReset();
+  configure();
+}
+
+void DieselHeaterSX1262::setFrequency(uint8_t freq2, uint8_t freq1, uint8_t freq0) {
+  uint32_t reg = ((uint32_t)freq2 << 16) | ((uint32_t)freq1 << 8) | freq0;
+  if (reg != _freqReg) _calValid = false;  // image calibration is per band
+  _freqReg = reg;
+}
+
+// f = FREQ × 26 MHz / 2^16 = RFfreq × 32 MHz / 2^25  →  RFfreq = FREQ × 416 (exact).
+uint32_t DieselHeaterSX1262::rfFreq() const {
+  return _freqReg * 416 + (int32_t)_freqOff * 1664;
+}
+
+void DieselHeaterSX1262::hardReset() {
+  _bus->reset(false);
+  _bus->delay(2);
+  _bus->reset(true);
+  _bus->delay(10);
+  waitBusy(kBusyTimeoutMs);
+  _resets++;
+}
+
+// One-time setup after power-on, RST or a brownout: reference clock, full calibration
+// (it fails at power-on while the TCXO is still off), regulator and RF switch. With a
+// crystal the power-on calibration has already succeeded.
+void DieselHeaterSX1262::initChip() {
+  setStandby();
+  if (_tcxoVoltage != kNoTcxo) {
+    const uint8_t tcxo[4] = {(uint8_t)(_tcxoVoltage & 0x07), 0x00, 0x01, 0x40};  // 5 ms start-up
+    command(OP_SET_DIO3_AS_TCXO_CTRL, tcxo, 4);
+    const uint8_t calAll = 0x7F;
+    command(OP_CALIBRATE, &calAll, 1);
+  }
+  const uint8_t dcdc = 0x01;
+  command(OP_SET_REGULATOR_MODE, &dcdc, 1);
+  const uint8_t rfSwitch = 0x01;
+  command(OP_SET_DIO2_AS_RF_SWITCH, &rfSwitch, 1);
+  _calValid = false;
+}
+
+// Equivalent of DieselHeaterRF::initRadio(), without the reset: the chip is only
+// reinitialised when the sync word shows it lost its configuration. Leaves STDBY_RC.
+void DieselHeaterSX1262::configure() {
+  if (!waitBusy(kBusyTimeoutMs)) hardReset();
+  setStandby();
+  uint8_t sync[2];
+  readRegister(REG_SYNC_WORD, sync, 2);
+  if (sync[0] != 0x7E || sync[1] != 0x3C) initChip();
+
+  const uint8_t gfsk = 0x00;
+  command(OP_SET_PACKET_TYPE, &gfsk, 1);
+  uint32_t f = rfFreq();
+  const uint8_t freq[4] = {(uint8_t)(f >> 24), (uint8_t)(f >> 16), (uint8_t)(f >> 8), (uint8_t)f};
+  command(OP_SET_RF_FREQUENCY, freq, 4);
+  if (!isCalCached()) calibrateImage();
+
+  const uint8_t pa[4] = {0x04, 0x07, 0x00, 0x01};  // SX1262 high-power PA, up to +22 dBm
+  command(OP_SET_PA_CONFIG, pa, 4);
+  const uint8_t txp[2] = {(uint8_t)kTxPowerDbm[_txPower], 0x04};  // 200 µs ramp
+  command(OP_SET_TX_PARAMS, txp, 2);
+
+  const uint8_t mod[8] = {
+    (uint8_t)(SX1262_BITRATE_REG >> 16), (uint8_t)(SX1262_BITRATE_REG >> 8), (uint8_t)SX1262_BITRATE_REG,
+    SX1262_PULSESHAPE, SX1262_BW_REG,
+    (uint8_t)(SX1262_FREQDEV_REG >> 16), (uint8_t)(SX1262_FREQDEV_REG >> 8), (uint8_t)SX1262_FREQDEV_REG,
+  };
+  command(OP_SET_MODULATION_PARAMS, mod, 8);
+  setPacketParams(0xFF);
+
+  const uint8_t syncWord[2] = {0x7E, 0x3C};
+  writeRegister(REG_SYNC_WORD, syncWord, 2);
+  const uint8_t crc[4] = {0xFF, 0xFF, 0x80, 0x05};  // CC1101 CRC16: seed 0xFFFF, poly 0x8005
+  writeRegister(REG_CRC_INIT, crc, 4);
+
+  const uint8_t base[2] = {0x00, 0x80};  // TX at 0, RX at 128
+  command(OP_SET_BUFFER_BASE, base, 2);
+  const uint8_t fallbackFs = 0x40;  // stay in FS after TX/RX — synth locked, like FSTXON
+  command(OP_SET_FALLBACK_MODE, &fallbackFs, 1);
+  const uint8_t irq[8] = {IRQ_USED >> 8, IRQ_USED & 0xFF, IRQ_USED >> 8, IRQ_USED & 0xFF, 0, 0, 0, 0};
+  command(OP_SET_DIO_IRQ_PARAMS, irq, 8);
+  clearIrqStatus(0xFFFF);
+  const uint8_t noErrors[2] = {0x00, 0x00};
+  command(OP_CLEAR_DEVICE_ERRORS, noErrors, 2);
+}
+
+// Variable length: payloadLen is the TX length, and the largest accepted in RX.
+void DieselHeaterSX1262::setPacketParams(uint8_t payloadLen) {
+  const uint8_t pkt[9] = {
+    SX1262_PREAMBLE_LEN >> 8, SX1262_PREAMBLE_LEN & 0xFF,
+    0x05,        // preamble detector: 16 bits
+    0x10,        // sync word: 16 bits
+    0x00,        // no address filtering
+    0x01,        // variable length
+    payloadLen,
+    0x02,        // 2-byte CRC, not inverted
+    0x00,        // no whitening
+  };
+  command(OP_SET_PACKET_PARAMS, pkt, 9);
+}
+
+void DieselHeaterSX1262::calibrateImage() {
+  uint32_t mhz = (uint32_t)((((uint64_t)rfFreq() * 32000000ULL) >> 25) / 1000000);
+  uint8_t band[2];
+  if (mhz >= 900)      { band[0] = 0xE1; band[1] = 0xE9; }
+  else if (mhz >= 850) { band[0] = 0xD7; band[1] = 0xDB; }
+  else if (mhz >= 770) { band[0] = 0xC1; band[1] = 0xC5; }
+  else if (mhz >= 460) { band[0] = 0x75; band[1] = 0x81; }
+  else                 { band[0] = 0x6B; band[1] = 0x6F; }
+  command(OP_CALIBRATE_IMAGE, band, 2);
+}
+
+bool DieselHeaterSX1262::calibrateNow() {
+  if (getChipMode() != MODE_STBY_RC) return false;
+  calibrateImage();
+  if (!waitBusy(kBusyTimeoutMs)) return false;
+  _calValid = true;
+  _calCount++;
+  return true;
+}
+
+void DieselHeaterSX1262::setStandby() {
+  const uint8_t rc = 0x00;
+  command(OP_SET_STANDBY, &rc, 1);
+  clearIrqStatus(0xFFFF);
+}
+
+bool DieselHeaterSX1262::setRx(uint32_t timeout) {
+  setPacketParams(0xFF);
+  clearIrqStatus(0xFFFF);
+  _bus->clearDio1();
+  const uint8_t t[3] = {(uint8_t)(timeout >> 16), (uint8_t)(timeout >> 8), (uint8_t)timeout};
+  return command(OP_SET_RX, t, 3);
+}
+
+void DieselHeaterSX1262::startRx() {
+  setStandby();
+  setRx(kRxContinuous);
+}
+
+void DieselHeaterSX1262::startRxAfterTx() {
+  setRx((uint32_t)HEATER_RX_TIMEOUT * kTimeoutStepsPerMs);
+}
+
+bool DieselHeaterSX1262::isRxAvailable() {
+  return _bus->dio1();
+}
+
+void DieselHeaterSX1262::sendCommand(uint8_t cmd, uint32_t addr, uint8_t numTransmits, uint8_t seq) {
+  using namespace HeaterProtocol;
+  if (!_txFrame.matches(cmd, addr)) _txFrame = CommandFrame(cmd, addr);
+  const uint8_t *buf = _txFrame.finish(seq);
+  ESP_LOGD(RF_TAG, "TX pkt: %02X %02X %08X seq=%02X crc=%02X%02X", buf[OFF_LEN], buf[OFF_CMD],
+           (unsigned)readAddress(buf), buf[OFF_SEQ], buf[OFF_CRC], buf[OFF_CRC + 1]);
+
+  uint32_t cpu0 = _spiCpuUs;
+  int64_t t0 = _bus->micros();
+
+  // The packet engine sends the length byte (buf[0]) and the CRC; the buffer keeps the
+  // payload across SetTx calls, so it is written once per burst.
+  setPacketParams(buf[OFF_LEN]);
+  uint8_t payload[kCommandFrame];
+  payload[0] = 0x00;  // TX base offset
+  memcpy(payload + 1, buf + 1, kCommandLen);
+  command(OP_WRITE_BUFFER, payload, sizeof(payload));
+
+  const uint32_t timeout = SX1262_TX_TIMEOUT_MS * kTimeoutStepsPerMs;
+  const uint8_t t[3] = {(uint8_t)(timeout >> 16), (uint8_t)(timeout >> 8), (uint8_t)timeout};
+  uint8_t completed = 0;
+  for (int i = 0; i < numTransmits; i++) {
+    clearIrqStatus(0xFFFF);
+    _bus->clearDio1();  // drop an edge left from an earlier packet
+    if (!command(OP_SET_TX, t, 3)) {
+      ESP_LOGW(RF_TAG, "P1 timeout i=%d (BUSY stuck) done=%d/%d", i, completed, numTransmits);
+      _p1Timeouts++;
+      break;
+    }
+    // TxDone, or the hardware timeout — both raise DIO1. The extra margin only matters
+    // if the edge itself was lost; the IRQ register is authoritative either way.
+    _bus->waitDio1(SX1262_TX_TIMEOUT_MS + 10);
+    uint16_t irq = getIrqStatus();
+    if (!(irq & IRQ_TX_DONE)) {
+      ESP_LOGW(RF_TAG, "P2 timeout i=%d irq=0x%04X done=%d/%d", i, irq, completed, numTransmits);
+      _p2Timeouts++;
+      setStandby();
+      break;
+    }
+    completed++;
+  }
+  clearIrqStatus(0xFFFF);
+
+  _lastBurstCompleted = completed;
+  _lastBurstRequested = numTransmits;
+  _lastBurstWallUs = (uint32_t)(_bus->micros() - t0);
+  _lastBurstCpuUs  = _spiCpuUs - cpu0;
+  ESP_LOGD(RF_TAG, "Burst %d/%d packets: cpu=%luus wall=%luus", completed, numTransmits,
+           (unsigned long)_lastBurstCpuUs, (unsigned long)_lastBurstWallUs);
+}
+
+bool DieselHeaterSX1262::readFrame(uint8_t *bytes, uint8_t *len, int16_t *rssi, bool *crcOk) {
+  uint16_t irq = getIrqStatus();
+  clearIrqStatus(0xFFFF);
+  if (!(irq & IRQ_RX_DONE)) return false;  // RX timeout
+  uint8_t status[2];
+  read(OP_GET_RX_BUFFER_STATUS, nullptr, 0, status, 2);
+  uint8_t n = status[0];
+  if (n == 0 || n > 61) return false;  // + length byte + 2 status bytes must fit 64
+  read(OP_READ_BUFFER, &status[1], 1, bytes + 1, n);
+  uint8_t pkt[3];
+  read(OP_GET_PACKET_STATUS, nullptr, 0, pkt, 3);  // RxStatus, RssiSync, RssiAvg
+  bytes[0] = n;
+  *len = n;
+  *rssi = -(int16_t)pkt[1] / 2;
+  *crcOk = !(irq & IRQ_CRC_ERR);
+  return true;
+}
+
+bool DieselHeaterSX1262::readPacket(heater_state_t *state) {
+  uint32_t address;
+  return readPacket(state, &address) && address == _heaterAddr;
+}
+
+bool DieselHeaterSX1262::readPacket(heater_state_t *state, uint32_t *addr) {
+  uint8_t buf[64];
+  uint8_t len;
+  int16_t rssi;
+  bool crcOk;
+  bool ok = readFrame(buf, &len, &rssi, &crcOk);
+  setStandby();
+  if (!ok || !crcOk || len != HeaterProtocol::kStateLen) return false;
+  HeaterProtocol::StateView frame(buf);
+  *addr = frame.address();
+  frame.decode(state);
+  state->freqEst = 0;
+  state->lqi     = 0;
+  state->rssi    = rssi;
+  return true;
+}
+
+bool DieselHeaterSX1262::readAnyPacket(uint32_t *addr, int16_t *rssi, uint8_t *rxLen) {
+  uint8_t buf[64];
+  uint8_t len;
+  bool crcOk;
+  bool ok = readFrame(buf, &len, rssi, &crcOk);
+  setStandby();
+  if (!ok || !crcOk || (len != HeaterProtocol::kStateLen && len != HeaterProtocol::kCommandLen)) return false;
+  *addr = HeaterProtocol::readAddress(buf);
+  *rxLen = len + 3;
+  return true;
+}
+
+bool DieselHeaterSX1262::readRawFrame(uint8_t *bytes, uint8_t *len, int8_t *freqEst) {
+  uint8_t n;
+  int16_t rssi;
+  bool crcOk;
+  *len = 0;
+  bool ok = readFrame(bytes, &n, &rssi, &crcOk);
+  setStandby();
+  if (!ok) return false;
+  bytes[n + 1] = dbmToRssi(rssi);
+  bytes[n + 2] = crcOk ? 0x80 : 0x00;  // LQI not available
+  *len = n + 3;
+  *freqEst = 0;
+  return true;
+}
+
+// Diagnostics ——————————————————————————————————————————————————
+
+bool DieselHeaterSX1262::probe(char *info, size_t len) {
+  uint8_t mode = getChipMode();
+  uint8_t sync[2];
+  readRegister(REG_SYNC_WORD, sync, 2);
+  uint8_t err[2];
+  read(OP_GET_DEVICE_ERRORS, nullptr, 0, err, 2);
+  uint32_t hz = (uint32_t)(((uint64_t)rfFreq() * 32000000ULL) >> 25);
+  if (mode == MODE_STBY_RC && sync[0] == 0x7E && sync[1] == 0x3C) {
+    snprintf(info, len, "OK freq=%lu.%03lu MHz", (unsigned long)(hz / 1000000), (unsigned long)(hz / 1000 % 1000));
+    return true;
+  }
+  snprintf(info, len, "ERROR mode=%u sync=0x%02X%02X errors=0x%02X%02X", mode, sync[0], sync[1], err[0], err[1]);
+  return false;
+}
+
+HeaterRadio::Health DieselHeaterSX1262::checkHealth(bool full) {
+  uint8_t mode = getChipMode();
+  if (mode == MODE_RX || mode == MODE_TX) return HEALTH_BUSY;
+  uint8_t sync[2];
+  readRegister(REG_SYNC_WORD, sync, 2);
+  if (sync[0] != 0x7E || sync[1] != 0x3C) return HEALTH_LOST;
+  if (!full) return HEALTH_OK;
+  uint8_t type, crc[4], err[2];
+  read(OP_GET_PACKET_TYPE, nullptr, 0, &type, 1);
+  readRegister(REG_CRC_INIT, crc, 4);
+  read(OP_GET_DEVICE_ERRORS, nullptr, 0, err, 2);
+  bool ok = type == 0x00 && crc[0] == 0xFF && crc[1] == 0xFF && crc[2] == 0x80 && crc[3] == 0x05 &&
+            err[0] == 0 && err[1] == 0;
+  return ok ? HEALTH_OK : HEALTH_LOST;
+}
+
+void DieselHeaterSX1262::dumpConfig(char *buf, size_t len) {
+  uint8_t mode = getChipMode();
+  uint8_t sync[2], type, err[2];
+  readRegister(REG_SYNC_WORD, sync, 2);
+  read(OP_GET_PACKET_TYPE, nullptr, 0, &type, 1);
+  read(OP_GET_DEVICE_ERRORS, nullptr, 0, err, 2);
+  snprintf(buf, len, "mode=%u type=%u SYNC=0x%02X%02X RFfreq=0x%08lX errors=0x%02X%02X irq=0x%04X resets=%lu", mode,
+           type, sync[0], sync[1], (unsigned long)rfFreq(), err[0], err[1], getIrqStatus(), (unsigned long)_resets);
+}
+
+// SPI ——————————————————————————————————————————————————————————
+
+uint8_t DieselHeaterSX1262::getChipMode() {
+  uint8_t tx[2] = {OP_GET_STATUS, 0x00};
+  uint8_t rx[2] = {0xFF, 0xFF};
+  transfer(tx, rx, 2);
+  return (rx[1] >> 4) & 0x07;
+}
+
+uint16_t DieselHeaterSX1262::getIrqStatus() {
+  uint8_t irq[2] = {0, 0};
+  read(OP_GET_IRQ_STATUS, nullptr, 0, irq, 2);
+  return ((uint16_t)irq[0] << 8) | irq[1];
+}
+
+void DieselHeaterSX1262::clearIrqStatus(uint16_t mask) {
+  const uint8_t m[2] = {(uint8_t)(mask >> 8), (uint8_t)mask};
+  command(OP_CLEAR_IRQ_STATUS, m, 2);
+}
+
+void DieselHeaterSX1262::writeRegister(uint16_t addr, const uint8_t *data, uint8_t len) {
+  uint8_t p[2 + 8];
+  if (len > 8) len = 8;
+  p[0] = addr >> 8;
+  p[1] = addr & 0xFF;
+  memcpy(p + 2, data, len);
+  command(OP_WRITE_REGISTER, p, 2 + len);
+}
+
+void DieselHeaterSX1262::readRegister(uint16_t addr, uint8_t *data, uint8_t len) {
+  const uint8_t p[2] = {(uint8_t)(addr >> 8), (uint8_t)addr};
+  read(OP_READ_REGISTER, p, 2, data, len);
+}
+
+// Opcode + parameters; the status bytes clocked back are not needed.
+bool DieselHeaterSX1262::command(uint8_t opcode, const uint8_t *params, uint8_t len) {
+  uint8_t tx[kMaxTransfer];
+  uint8_t rx[kMaxTransfer];
+  if (len > kMaxTransfer - 1) len = kMaxTransfer - 1;
+  tx[0] = opcode;
+  if (len > 0) memcpy(tx + 1, params, len);
+  return transfer(tx, rx, len + 1);
+}
+
+// Opcode + parameters + one status byte (NOP), then outLen data bytes.
+bool DieselHeaterSX1262::read(uint8_t opcode, const uint8_t *params, uint8_t paramLen, uint8_t *out,
+                              uint8_t outLen) {
+  uint8_t tx[kMaxTransfer] = {};
+  uint8_t rx[kMaxTransfer];
+  uint8_t head = 1 + paramLen + 1;
+  if (outLen > kMaxTransfer - head) outLen = kMaxTransfer - head;
+  tx[0] = opcode;
+  if (paramLen > 0) memcpy(tx + 1, params, paramLen);
+  if (!transfer(tx, rx, head + outLen)) {
+    memset(out, 0xFF, outLen);
+    return false;
+  }
+  memcpy(out, rx + head, outLen);
+  return true;
+}
+
+// Every transaction waits for BUSY low first — commands sent while the chip is busy are
+// silently dropped.
+bool DieselHeaterSX1262::transfer(const uint8_t *tx, uint8_t *rx, uint8_t len) {
+  int64_t t0 = _bus->micros();
+  bool ready = waitBusy(kBusyTimeoutMs);
+  if (ready) _bus->transfer(tx, rx, len);
+  _spiCpuUs += (uint32_t)(_bus->micros() - t0);
+  return ready;
+}
+
+bool DieselHeaterSX1262::waitBusy(uint32_t timeoutMs) {
+  int64_t t0 = _bus->micros();
+  while (_bus->busy()) {
+    int64_t waited = _bus->micros() - t0;
+    if (waited > (int64_t)timeoutMs * 1000) return false;
+    if (waited > 200) _bus->yield();  // calibration and TCXO start-up take milliseconds
+  }
+  return true;
+}
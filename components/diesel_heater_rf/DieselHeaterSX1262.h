@@ -0,0 +1,189 @@
+/*
+ * DieselHeaterSX1262.h
+ *
+ * Semtech SX1262 backend for the heater protocol, GFSK only — see
+ * docs/sx1262-port-guide.md for how the modem settings follow from the CC1101 registers
+ * in DieselHeaterRF::initRadio(). Differences from the CC1101 driver:
+ *   - every SPI transaction waits for BUSY low; the chip is reset through RST
+ *   - TX/RX completion is an IRQ on DIO1 (TxDone, RxDone, CrcErr, Timeout). sendCommand()
+ *     sleeps on the DIO1 edge instead of polling MARCSTATE; SetTx carries a hardware
+ *     timeout per packet, and the RX after a burst a hardware timeout of HEATER_RX_TIMEOUT
+ *   - the length byte and the CC1101-compatible CRC (poly 0x8005, init 0xFFFF) are
+ *     handled by the packet engine; RSSI comes from GetPacketStatus, and there is no
+ *     FREQEST equivalent in GFSK mode (freqEst is always 0, so AFC holds its value)
+ *   - calibration caching covers the image calibration for the band (CalibrateImage);
+ *     there are no FSCAL values to restore
+ *   - the reference clock is board-specific: setTcxoVoltage() for a TCXO powered from
+ *     DIO3 (the T3-S3's 1.8 V one), kNoTcxo for a plain crystal
+ */
+
+#ifndef DieselHeaterSX1262_h
+#define DieselHeaterSX1262_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include "HeaterProtocol.h"
+#include "HeaterRadio.h"
+
+// LILYGO T3-S3 V1.3
+#define SX1262_SCK_PIN   5
+#define SX1262_MISO_PIN  3
+#define SX1262_MOSI_PIN  6
+#define SX1262_NSS_PIN   7
+#define SX1262_DIO1_PIN  1
+#define SX1262_RST_PIN   8
+#define SX1262_BUSY_PIN  13
+
+// Board side of the driver. begin() creates a DieselHeaterSX1262SpiBus
+// (DieselHeaterSX1262SpiBus.h: SPI master, BUSY/DIO1/RST GPIO, DIO1 interrupt, esp_timer)
+// unless setBus() supplied another bus; tools/sim plugs in an SX1262 command model.
+class DieselHeaterSX1262Bus {
+  public:
+    virtual ~DieselHeaterSX1262Bus() = default;
+    // One NSS-framed transaction of len bytes; rx gets the len bytes clocked in. BUSY is
+    // the driver's to wait for.
+    virtual void transfer(const uint8_t *tx, uint8_t *rx, uint8_t len) = 0;
+    virtual bool busy() = 0;
+    virtual bool dio1() = 0;
+    virtual void reset(bool level) = 0;  // RST pin, active low
+    // Forgets a DIO1 edge seen earlier, so the next waitDio1() waits for a new one.
+    virtual void clearDio1() = 0;
+    // Sleeps until a DIO1 rising edge. False after timeoutMs without one.
+    virtual bool waitDio1(uint32_t timeoutMs) = 0;
+    virtual int64_t micros() = 0;
+    virtual void delay(uint32_t ms) = 0;
+    // Lets other tasks run inside the BUSY wait.
+    virtual void yield() {}
+};
+
+class DieselHeaterSX1262 : public HeaterRadio {
+  public:
+    DieselHeaterSX1262(uint8_t sck, uint8_t miso, uint8_t mosi, uint8_t nss, uint8_t dio1, uint8_t busy,
+                       uint8_t rst) {
+      _pinSck = sck;
+      _pinMiso = miso;
+      _pinMosi = mosi;
+      _pinNss = nss;
+      _pinDio1 = dio1;
+      _pinBusy = busy;
+      _pinRst = rst;
+    }
+    ~DieselHeaterSX1262() {
+      if (_busOwned) delete _bus;
+    }
+
+    // SetDio3AsTcxoCtrl voltage code (0x00 1.6 V … 0x07 3.3 V), or kNoTcxo for a crystal.
+    // Set before begin().
+    static constexpr uint8_t kNoTcxo = 0xFF;
+    void setTcxoVoltage(uint8_t code) { _tcxoVoltage = code; }
+    void setBus(DieselHeaterSX1262Bus *bus) { _bus = bus; }
+
+    const char *chipName() const override { return "SX1262"; }
+    void begin(uint32_t heaterAddr) override;
+    void setAddress(uint32_t heaterAddr) override { _heaterAddr = heaterAddr; }
+    // CC1101 FREQ2/1/0 — converted to the SX1262's 32 MHz / 2^25 steps (× 416).
+    void setFrequency(uint8_t freq2, uint8_t freq1, uint8_t freq0) override;
+    // PATABLE index as on the CC1101, mapped to the nearest SX1262 output power.
+    void setTxPower(uint8_t index) override { _txPower = index & 0x07; }
+    // f_XOSC/2^14 steps of the CC1101 (1664 SX1262 frequency steps each).
+    void setFreqOffset(int8_t off) override { _freqOff = off; }
+    int8_t getFreqOffset() const override { return _freqOff; }
+    void reinitRadio() override { configure(); }
+
+    // GetStatus in standby and the sync word read back.
+    bool probe(char *info, size_t len) override;
+    // Chip mode RX/TX → HEALTH_BUSY. full: sync word, packet type, CRC setup and device
+    // errors; otherwise the sync word only (reset value 0x9723 after a brownout).
+    Health checkHealth(bool full) override;
+    void dumpConfig(char *buf, size_t len) override;
+
+    void sendCommand(uint8_t cmd, uint32_t addr, uint8_t numTransmits, uint8_t seq) override;
+    void endTxBurst() override { setStandby(); }
+    void idle() override { setStandby(); }
+
+    // Continuous RX, until the next command.
+    void startRx() override;
+    // From FS (the TX fallback mode): single RX with a HEATER_RX_TIMEOUT hardware timeout.
+    void startRxAfterTx() override;
+    // DIO1 high: RxDone (CRC good or bad) or RX timeout — readPacket() tells them apart.
+    bool isRxAvailable() override;
+    uint8_t getRxBytes() override { return 0; }
+    bool readPacket(heater_state_t *state) override;
+    bool readPacket(heater_state_t *state, uint32_t *addr) override;
+    // *rxLen counts like the CC1101 FIFO (length byte + payload + 2 status bytes), so
+    // state packets are 26 and remote commands 12.
+    bool readAnyPacket(uint32_t *addr, int16_t *rssi, uint8_t *rxLen) override;
+
+    // RX already reports CRC-failed frames (CrcErr with RxDone); the status bytes are
+    // synthesised from GetPacketStatus and the CrcErr flag.
+    void startRawCapture() override { startRx(); }
+    bool readRawFrame(uint8_t *bytes, uint8_t *len, int8_t *freqEst) override;
+    void stopRawCapture() override { setStandby(); }
+
+    // Image calibration for the band of the configured frequency. With the cache on,
+    // configure() skips it once it has been done for the current frequency.
+    void setCalCache(bool enabled) override { _calCache = enabled; }
+    bool isCalCached() const override { return _calCache && _calValid; }
+    bool calibrateNow() override;
+    uint32_t getCalCount() const override { return _calCount; }
+
+    uint8_t getLastBurstCompleted() const override { return _lastBurstCompleted; }
+    uint8_t getLastBurstRequested() const override { return _lastBurstRequested; }
+    // CPU time in SPI transfers and BUSY waits — the TX itself is waited for asleep.
+    uint32_t getLastBurstCpuUs() const override { return _lastBurstCpuUs; }
+    uint32_t getLastBurstWallUs() const override { return _lastBurstWallUs; }
+    // P1: SetTx not accepted (BUSY stuck); P2: no TxDone before the hardware timeout.
+    uint32_t getP1Timeouts() const override { return _p1Timeouts; }
+    uint32_t getP2Timeouts() const override { return _p2Timeouts; }
+    uint32_t getTxUnderflows() const override { return 0; }
+    uint32_t getResets() const { return _resets; }
+
+  private:
+    uint8_t _pinSck, _pinMiso, _pinMosi, _pinNss, _pinDio1, _pinBusy, _pinRst;
+    DieselHeaterSX1262Bus *_bus{nullptr};
+    bool _busOwned{false};  // created by begin()
+    uint8_t _tcxoVoltage{0x02};  // 1.8 V, T3-S3
+    uint32_t _heaterAddr = 0;
+    uint32_t _freqReg{0x10B09E};  // CC1101 FREQ2..0
+    int8_t _freqOff{0};
+    uint8_t _txPower{7};
+    HeaterProtocol::CommandFrame _txFrame;  // last command frame; rebuilt on a new cmd/addr
+    bool _calCache{false};
+    bool _calValid{false};
+    uint32_t _calCount{0};
+    uint32_t _resets{0};
+
+    uint8_t _lastBurstCompleted{0};
+    uint8_t _lastBurstRequested{0};
+    uint32_t _spiCpuUs{0};  // running total, wraps
+    uint32_t _lastBurstCpuUs{0};
+    uint32_t _lastBurstWallUs{0};
+    uint32_t _p1Timeouts{0};
+    uint32_t _p2Timeouts{0};
+
+    static constexpr uint8_t kMaxTransfer = 72;  // opcode + offset + status + 64 data, rounded up
+
+    uint32_t rfFreq() const;
+    void hardReset();
+    void initChip();
+    void configure();
+    void setPacketParams(uint8_t payloadLen);
+    void calibrateImage();
+    void setStandby();
+    bool setRx(uint32_t timeout);
+    uint16_t getIrqStatus();
+    void clearIrqStatus(uint16_t mask);
+    uint8_t getChipMode();
+    // Payload into bytes[1..] with the length in bytes[0], like the CC1101 FIFO minus the
+    // status bytes. False if no RxDone (RX timeout) or the length is out of range.
+    bool readFrame(uint8_t *bytes, uint8_t *len, int16_t *rssi, bool *crcOk);
+
+    bool waitBusy(uint32_t timeoutMs);
+    bool command(uint8_t opcode, const uint8_t *params, uint8_t len);
+    bool read(uint8_t opcode, const uint8_t *params, uint8_t paramLen, uint8_t *out, uint8_t outLen);
+    void writeRegister(uint16_t addr, const uint8_t *data, uint8_t len);
+    void readRegister(uint16_t addr, uint8_t *data, uint8_t len);
+    bool transfer(const uint8_t *tx, uint8_t *rx, uint8_t len);
+};
+
+#endif
@@ -0,0 +1,91 @@
+/*
+ * DieselHeaterSX1262SpiBus.cpp — ESP-IDF transport for DieselHeaterSX1262, see
+ * DieselHeaterSX1262SpiBus.h.
+ */
+
+#include "driver/spi_master.h"
+#include "driver/gpio.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "DieselHeaterSX1262SpiBus.h"
+
+static void IRAM_ATTR sx1262_dio1_isr(void *arg) {
+  BaseType_t woken = pdFALSE;
+  xSemaphoreGiveFromISR((SemaphoreHandle_t)arg, &woken);
+  if (woken) portYIELD_FROM_ISR();
+}
+
+bool DieselHeaterSX1262SpiBus::begin() {
+  gpio_set_direction((gpio_num_t)_pinRst, GPIO_MODE_OUTPUT);
+  gpio_set_level((gpio_num_t)_pinRst, 1);
+  gpio_set_direction((gpio_num_t)_pinBusy, GPIO_MODE_INPUT);
+  gpio_set_direction((gpio_num_t)_pinDio1, GPIO_MODE_INPUT);
+
+  spi_bus_config_t buscfg = {};
+  buscfg.mosi_io_num   = _pinMosi;
+  buscfg.miso_io_num   = _pinMiso;
+  buscfg.sclk_io_num   = _pinSck;
+  buscfg.quadwp_io_num = -1;
+  buscfg.quadhd_io_num = -1;
+  esp_err_t ret = spi_bus_initialize(SPI2_HOST, &buscfg, SPI_DMA_DISABLED);
+  if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE) {
+    return false;
+  }
+
+  // No chip-ready handshake on MISO as on the CC1101 — the driver waits for BUSY low
+  // before each transaction is started, so the SPI driver can drive NSS.
+  spi_device_interface_config_t devcfg = {};
+  devcfg.mode           = 0;
+  devcfg.clock_speed_hz = 8 * 1000 * 1000;
+  devcfg.spics_io_num   = _pinNss;
+  devcfg.queue_size     = 1;
+  spi_bus_add_device(SPI2_HOST, &devcfg, &_spi);
+
+  _dio1Sem = xSemaphoreCreateBinary();
+  gpio_install_isr_service(0);  // ESP_ERR_INVALID_STATE if already installed — fine
+  gpio_set_intr_type((gpio_num_t)_pinDio1, GPIO_INTR_POSEDGE);
+  gpio_isr_handler_add((gpio_num_t)_pinDio1, sx1262_dio1_isr, _dio1Sem);
+  return true;
+}
+
+void DieselHeaterSX1262SpiBus::transfer(const uint8_t *tx, uint8_t *rx, uint8_t len) {
+  spi_transaction_t t = {};
+  t.length    = (size_t)len * 8;
+  t.tx_buffer = tx;
+  t.rx_buffer = rx;
+  spi_device_polling_transmit(_spi, &t);
+}
+
+bool DieselHeaterSX1262SpiBus::busy() {
+  return gpio_get_level((gpio_num_t)_pinBusy);
+}
+
+bool DieselHeaterSX1262SpiBus::dio1() {
+  return gpio_get_level((gpio_num_t)_pinDio1);
+}
+
+void DieselHeaterSX1262SpiBus::reset(bool level) {
+  gpio_set_level((gpio_num_t)_pinRst, level ? 1 : 0);
+}
+
+void DieselHeaterSX1262SpiBus::clearDio1() {
+  xSemaphoreTake(_dio1Sem, 0);
+}
+
+bool DieselHeaterSX1262SpiBus::waitDio1(uint32_t timeoutMs) {
+  return xSemaphoreTake(_dio1Sem, pdMS_TO_TICKS(timeoutMs)) == pdTRUE;
+}
+
+int64_t DieselHeaterSX1262SpiBus::micros() {
+  return esp_timer_get_time();
+}
+
+void DieselHeaterSX1262SpiBus::delay(uint32_t ms) {
+  vTaskDelay(pdMS_TO_TICKS(ms));
+}
+
+void DieselHeaterSX1262SpiBus::yield() {
+  taskYIELD();
+}
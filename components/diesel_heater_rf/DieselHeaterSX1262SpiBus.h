@@ -0,0 +1,46 @@
+/*
+ * DieselHeaterSX1262SpiBus.h
+ *
+ * ESP-IDF board side of DieselHeaterSX1262: SPI master with hardware NSS, the BUSY, DIO1
+ * and RST GPIOs, a DIO1 rising-edge interrupt for the TX/RX completion waits, and
+ * esp_timer/FreeRTOS time. DieselHeaterSX1262::begin() creates one unless setBus() has
+ * supplied another DieselHeaterSX1262Bus, so DieselHeaterSX1262.h builds without ESP-IDF.
+ */
+
+#ifndef DieselHeaterSX1262SpiBus_h
+#define DieselHeaterSX1262SpiBus_h
+
+#include <stdint.h>
+#include "driver/spi_master.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "DieselHeaterSX1262.h"
+
+class DieselHeaterSX1262SpiBus : public DieselHeaterSX1262Bus {
+  public:
+    DieselHeaterSX1262SpiBus(uint8_t sck, uint8_t miso, uint8_t mosi, uint8_t nss, uint8_t dio1, uint8_t busy,
+                             uint8_t rst)
+        : _pinSck(sck), _pinMiso(miso), _pinMosi(mosi), _pinNss(nss), _pinDio1(dio1), _pinBusy(busy),
+          _pinRst(rst) {}
+
+    // SPI bus and device, GPIOs and the DIO1 interrupt. False if the SPI bus could not be
+    // initialised.
+    bool begin();
+
+    void transfer(const uint8_t *tx, uint8_t *rx, uint8_t len) override;
+    bool busy() override;
+    bool dio1() override;
+    void reset(bool level) override;
+    void clearDio1() override;
+    bool waitDio1(uint32_t timeoutMs) override;
+    int64_t micros() override;
+    void delay(uint32_t ms) override;
+    void yield() override;
+
+  private:
+    uint8_t _pinSck, _pinMiso, _pinMosi, _pinNss, _pinDio1, _pinBusy, _pinRst;
+    spi_device_handle_t _spi{nullptr};
+    SemaphoreHandle_t _dio1Sem{nullptr};  // given by the DIO1 rising-edge ISR
+};
+
+#endif
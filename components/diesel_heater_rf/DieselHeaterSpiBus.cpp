@@ -0,0 +1,224 @@
+/*
+ * DieselHeaterSpiBus.cpp — ESP-IDF transport for DieselHeaterRF, see DieselHeaterSpiBus.h.
+ */
+
+#include <string.h>
+#include "driver/spi_master.h"
+#include "driver/gpio.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "hal/gpio_ll.h"
+#include "soc/gpio_struct.h"
+#include "DieselHeaterSpiBus.h"
+
+// ---------------------------------------------------------------------------
+// pre_cb/post_cb: manual CS management and CC1101 chip-ready wait.
+//
+// ESP-IDF calls pre_cb BEFORE asserting hardware CS, so we cannot use
+// hardware-managed CS for chip-ready detection. Instead, spics_io_num=-1
+// (no hardware CS) and these callbacks drive CS via GPIO:
+//   pre_cb:  assert CS LOW → wait for MISO LOW (crystal oscillator stable)
+//   post_cb: deassert CS HIGH
+//
+// t->user encodes both pins: (cs_pin << 8) | miso_pin  (uint16_t)
+// Runs in task context (polling transmit) — regular GPIO access is safe.
+// ---------------------------------------------------------------------------
+static void cc1101_pre_cb(spi_transaction_t *t) {
+  uint16_t pins     = (uint16_t)(uintptr_t)t->user;
+  gpio_num_t cs     = (gpio_num_t)((pins >> 8) & 0xFF);
+  gpio_num_t miso   = (gpio_num_t)(pins & 0xFF);
+  gpio_set_level(cs, 0);                        // assert CS
+  int64_t t0 = esp_timer_get_time();
+  while (gpio_get_level(miso)) {                // wait for chip-ready (MISO LOW)
+    if (esp_timer_get_time() - t0 > 5000) break;  // 5 ms timeout
+  }
+}
+
+static void cc1101_post_cb(spi_transaction_t *t) {
+  uint16_t pins = (uint16_t)(uintptr_t)t->user;
+  gpio_num_t cs = (gpio_num_t)((pins >> 8) & 0xFF);
+  gpio_set_level(cs, 1);                        // deassert CS
+}
+
+// ---------------------------------------------------------------------------
+// Async transport callbacks. Queued transactions run pre_cb/post_cb from the SPI
+// interrupt, so they must live in IRAM, use the low-level GPIO writes and cannot wait:
+// the chip-ready check is done by waitChipReady() in task context before a batch is
+// queued. Within a batch SO is low as soon as CS is asserted: the crystal only stops in
+// SLEEP, which the driver enters with SWOR followed by sync(), and the first access after
+// it goes through wake() (DieselHeaterRF::leaveWor()).
+// ---------------------------------------------------------------------------
+static void IRAM_ATTR cc1101_pre_cb_async(spi_transaction_t *t) {
+  uint16_t pins = (uint16_t)(uintptr_t)t->user;
+  gpio_ll_set_level(&GPIO, (pins >> 8) & 0xFF, 0);
+}
+
+static void IRAM_ATTR cc1101_post_cb_async(spi_transaction_t *t) {
+  uint16_t pins = (uint16_t)(uintptr_t)t->user;
+  gpio_ll_set_level(&GPIO, (pins >> 8) & 0xFF, 1);
+}
+
+static void IRAM_ATTR cc1101_ready_isr(void *arg) {
+  BaseType_t woken = pdFALSE;
+  xSemaphoreGiveFromISR((SemaphoreHandle_t)arg, &woken);
+  if (woken) portYIELD_FROM_ISR();
+}
+
+bool DieselHeaterSpiBus::begin() {
+  // CS: configure as GPIO output, idle HIGH. spics_io_num=-1 means the SPI
+  // driver does not touch CS — pre_cb/post_cb drive it manually so that the
+  // chip-ready wait happens after CS is actually asserted.
+  gpio_set_direction((gpio_num_t)_pinSs, GPIO_MODE_OUTPUT);
+  gpio_set_level((gpio_num_t)_pinSs, 1);
+
+  gpio_set_direction((gpio_num_t)_pinGdo2, GPIO_MODE_INPUT);
+
+  spi_bus_config_t buscfg = {};
+  buscfg.mosi_io_num   = _pinMosi;
+  buscfg.miso_io_num   = _pinMiso;
+  buscfg.sclk_io_num   = _pinSck;
+  buscfg.quadwp_io_num = -1;
+  buscfg.quadhd_io_num = -1;
+
+  // The async transport clocks FIFO bursts by DMA; polling keeps the CPU-driven bus.
+  esp_err_t ret = spi_bus_initialize(SPI2_HOST, &buscfg, _async ? SPI_DMA_CH_AUTO : SPI_DMA_DISABLED);
+  if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE) {
+    return false;
+  }
+
+  // Pullup on MISO so it idles HIGH when CC1101 is not driving it.
+  // pre_cb waits for MISO HIGH→LOW (chip-ready); without pullup MISO floats LOW.
+  gpio_set_pull_mode((gpio_num_t)_pinMiso, GPIO_PULLUP_ONLY);
+
+  // Encode CS and MISO pin numbers into a single word passed via t->user.
+  _pinEnc = ((uint16_t)_pinSs << 8) | (uint16_t)_pinMiso;
+
+  spi_device_interface_config_t devcfg = {};
+  devcfg.mode           = 0;
+  devcfg.clock_speed_hz = 1 * 1000 * 1000;  // 1 MHz — matches ESPHome CC1101 component; 4 MHz caused compilation-sensitive TX failures
+  devcfg.spics_io_num   = -1;   // CS managed manually in pre_cb / post_cb
+  devcfg.queue_size     = _async ? kQueueDepth : 1;
+  devcfg.pre_cb         = _async ? cc1101_pre_cb_async : cc1101_pre_cb;
+  devcfg.post_cb        = _async ? cc1101_post_cb_async : cc1101_post_cb;
+
+  spi_bus_add_device(SPI2_HOST, &devcfg, &_spi);
+
+  if (_async) {
+    // MISO falling edge = chip ready. The interrupt is only enabled inside waitChipReady(),
+    // while no transfer is on the bus.
+    _readySem = xSemaphoreCreateBinary();
+    gpio_install_isr_service(0);  // ESP_ERR_INVALID_STATE if already installed — fine
+    gpio_isr_handler_add((gpio_num_t)_pinMiso, cc1101_ready_isr, _readySem);
+    gpio_intr_disable((gpio_num_t)_pinMiso);
+  }
+  return true;
+}
+
+// Up to 4 bytes (strobes, single registers) go through the transaction's own tx_data/
+// rx_data words, longer transfers through the slot buffers. Either way there is a receive
+// side: it keeps SPI_USR_MISO enabled, so the next read (e.g. MARCSTATE right after a
+// strobe or FIFO load) returns valid data on its first call without a warmup read.
+const uint8_t *DieselHeaterSpiBus::transfer(const uint8_t *tx, size_t len, bool wait) {
+  if (len > sizeof(Slot::tx)) len = sizeof(Slot::tx);
+  bool small = len <= 4;
+  Slot *s = slot();
+  s->t.length = len * 8;
+  if (small) {
+    s->t.flags = SPI_TRANS_USE_TXDATA | SPI_TRANS_USE_RXDATA;
+    memcpy(s->t.tx_data, tx, len);
+  } else {
+    memcpy(s->tx, tx, len);
+    s->t.tx_buffer = s->tx;
+    s->t.rx_buffer = s->rx;
+  }
+
+  // Polling: the transfer (and the chip-ready spin in pre_cb) completes before returning,
+  // all of it on the CPU. Async: queued behind earlier transfers; with wait the task
+  // sleeps until it — and so everything before it — has completed.
+  int64_t t0 = esp_timer_get_time();
+  if (!_async) {
+    spi_device_polling_transmit(_spi, &s->t);
+    _cpuUs += (uint32_t)(esp_timer_get_time() - t0);
+  } else {
+    if (_inFlight == 0) waitChipReady();
+    spi_device_queue_trans(_spi, &s->t, portMAX_DELAY);
+    _inFlight++;
+    _cpuUs += (uint32_t)(esp_timer_get_time() - t0);
+    if (!wait) return nullptr;
+    sync();
+  }
+  return small ? s->t.rx_data : s->rx;
+}
+
+// Collects every queued transfer (no-op in polling mode).
+void DieselHeaterSpiBus::sync() {
+  while (_inFlight > 0) {
+    spi_transaction_t *done;
+    spi_device_get_trans_result(_spi, &done, portMAX_DELAY);
+    _inFlight--;
+  }
+}
+
+bool DieselHeaterSpiBus::wake() {
+  sync();
+  return waitChipReady();
+}
+
+bool DieselHeaterSpiBus::gdo2() {
+  return gpio_get_level((gpio_num_t)_pinGdo2);
+}
+
+int64_t DieselHeaterSpiBus::micros() {
+  return esp_timer_get_time();
+}
+
+void DieselHeaterSpiBus::delay(uint32_t ms) {
+  vTaskDelay(pdMS_TO_TICKS(ms));
+}
+
+void DieselHeaterSpiBus::yield() {
+  taskYIELD();
+}
+
+// Next transfer slot, reset. In async mode the slots are reused in queue order, so if
+// all of them are in flight the oldest is collected first.
+DieselHeaterSpiBus::Slot *DieselHeaterSpiBus::slot() {
+  Slot *s = &_slots[_next];
+  if (_async && _inFlight == kQueueDepth) {
+    spi_transaction_t *done;
+    spi_device_get_trans_result(_spi, &done, portMAX_DELAY);
+    _inFlight--;
+  }
+  _next = (_next + 1) % kQueueDepth;
+  s->t = {};
+  s->t.user = (void *)(uintptr_t)_pinEnc;
+  return s;
+}
+
+// Chip-ready wait in task context with the bus idle: assert CS and, if SO is still high
+// (crystal not yet stable — after SRES, power-up or SLEEP), wait for it to drop. The async
+// transport sleeps on the MISO falling-edge interrupt, polling spins like cc1101_pre_cb.
+// Same 5 ms limit as cc1101_pre_cb.
+bool DieselHeaterSpiBus::waitChipReady() {
+  gpio_num_t miso = (gpio_num_t)_pinMiso;
+  gpio_set_level((gpio_num_t)_pinSs, 0);
+  bool ready = !gpio_get_level(miso);
+  if (!ready) {
+    _chipReadyWaits++;
+    if (_async) {
+      xSemaphoreTake(_readySem, 0);  // drop an edge left from an earlier wait
+      gpio_set_intr_type(miso, GPIO_INTR_NEGEDGE);
+      gpio_intr_enable(miso);
+      ready = !gpio_get_level(miso) || xSemaphoreTake(_readySem, pdMS_TO_TICKS(5)) == pdTRUE;
+      gpio_intr_disable(miso);
+    } else {
+      int64_t t0 = esp_timer_get_time();
+      while (!(ready = !gpio_get_level(miso)) && esp_timer_get_time() - t0 <= 5000) {
+      }
+    }
+  }
+  gpio_set_level((gpio_num_t)_pinSs, 1);
+  return ready;
+}
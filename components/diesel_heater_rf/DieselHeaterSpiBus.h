@@ -0,0 +1,69 @@
+/*
+ * DieselHeaterSpiBus.h
+ *
+ * ESP-IDF board side of DieselHeaterRF: SPI master with manual CS and the CC1101
+ * chip-ready wait, the GDO2 GPIO and esp_timer/FreeRTOS time. DieselHeaterRF::begin()
+ * creates one unless setBus() has supplied another DieselHeaterBus, so everything the
+ * driver needs from ESP-IDF lives here and DieselHeaterRF.h builds without it.
+ *
+ * Two transports, fixed at construction. Polling (default): every transfer, its chip-ready
+ * spin in pre_cb included, runs on the CPU before transfer() returns. Async: transfers are
+ * queued (up to kQueueDepth) on a DMA-capable bus and complete by interrupt; transfer()
+ * without wait returns at once, and the chip-ready wait sleeps on a MISO edge interrupt.
+ */
+
+#ifndef DieselHeaterSpiBus_h
+#define DieselHeaterSpiBus_h
+
+#include <stdint.h>
+#include "driver/spi_master.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "DieselHeaterRF.h"
+
+class DieselHeaterSpiBus : public DieselHeaterBus {
+  public:
+    DieselHeaterSpiBus(uint8_t sck, uint8_t miso, uint8_t mosi, uint8_t ss, uint8_t gdo2, bool async)
+        : _pinSck(sck), _pinMiso(miso), _pinMosi(mosi), _pinSs(ss), _pinGdo2(gdo2), _async(async) {}
+
+    // SPI bus and device, CS/GDO2 GPIO and (async) the ready interrupt. False if the SPI
+    // bus could not be initialised.
+    bool begin();
+
+    const uint8_t *transfer(const uint8_t *tx, size_t len, bool wait) override;
+    void sync() override;
+    bool wake() override;
+    bool gdo2() override;
+    int64_t micros() override;
+    void delay(uint32_t ms) override;
+    void yield() override;
+    uint32_t cpuUs() const override { return _cpuUs; }
+
+    uint32_t getChipReadyWaits() const { return _chipReadyWaits; }
+
+  private:
+    // Transfer slots. Async mode recycles them in queue order, so a slot is free again
+    // once every transfer queued before it has been collected.
+    static constexpr uint8_t kQueueDepth = 4;
+    struct Slot {
+      spi_transaction_t t;
+      alignas(4) uint8_t tx[68];  // 1 header + up to 64 FIFO bytes, padded for DMA
+      alignas(4) uint8_t rx[68];
+    };
+
+    uint8_t _pinSck, _pinMiso, _pinMosi, _pinSs, _pinGdo2;
+    bool _async;
+    uint16_t _pinEnc{0};  // (cs_pin << 8) | miso_pin — packed into spi_transaction_t::user
+    spi_device_handle_t _spi{nullptr};
+    Slot _slots[kQueueDepth]{};
+    uint8_t _next{0};
+    uint8_t _inFlight{0};
+    SemaphoreHandle_t _readySem{nullptr};  // given by the MISO falling-edge ISR
+    uint32_t _cpuUs{0};                    // running total, wraps
+    uint32_t _chipReadyWaits{0};
+
+    Slot *slot();
+    bool waitChipReady();
+};
+
+#endif
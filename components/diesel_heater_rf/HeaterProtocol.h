@@ -0,0 +1,177 @@
+/*
+ * HeaterProtocol.h
+ *
+ * Frame layout and codec for the heater protocol, shared by both radio drivers: command
+ * frames for TX, a typed view over received state packets, and the address field that
+ * discovery reads from state and remote-command frames alike. Everything is constexpr
+ * and allocation-free; the static_asserts at the end check the CRC and the frame
+ * builder at compile time.
+ *
+ * Offsets count from the length byte, as the frame sits in the CC1101 FIFO. See
+ * docs/rf-protocol-reverse-engineering.md for what is known about each field.
+ */
+
+#ifndef HeaterProtocol_h
+#define HeaterProtocol_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include "HeaterRadio.h"
+
+namespace HeaterProtocol {
+
+inline constexpr uint8_t kCommandLen   = 9;                 // length byte of a command frame
+inline constexpr uint8_t kCommandFrame = kCommandLen + 1;   // written to the TX FIFO (pad byte 0)
+inline constexpr uint8_t kStateLen     = 23;                // length byte of a state packet
+inline constexpr uint8_t kStateFrame   = kStateLen + 1;     // length byte + payload
+// RX FIFO contents with the two APPEND_STATUS bytes (RSSI, CRC_OK|LQI).
+inline constexpr uint8_t kStateRxLen   = kStateFrame + 2;   // 26 — heater state
+inline constexpr uint8_t kRemoteRxLen  = kCommandLen + 3;   // 12 — the remote's commands
+
+enum Offset : uint8_t {
+  OFF_LEN      = 0,
+  OFF_CMD      = 1,
+  OFF_ADDR     = 2,   // 4 bytes, big endian
+  // command frame
+  OFF_SEQ      = 6,
+  OFF_CRC      = 7,   // CRC-16/MODBUS over bytes 0-6, high byte first
+  // state packet
+  OFF_STATE    = 6,
+  OFF_POWER    = 7,
+  OFF_VOLTAGE  = 9,   // 0.1 V
+  OFF_AMBIENT  = 10,  // °C, signed
+  OFF_ERROR    = 11,  // was read from byte 8 before — neither confirmed by protocol docs
+  OFF_CASE     = 12,  // °C
+  OFF_SETPOINT = 13,  // °C, signed
+  OFF_AUTO     = 14,  // 0x32 = automatic (thermostat) mode
+  OFF_PUMP     = 15,  // 0.1 Hz
+  // APPEND_STATUS, CC1101 FIFO only
+  OFF_RSSI     = kStateFrame,
+  OFF_LQI      = kStateFrame + 1,
+};
+
+// CRC-16/MODBUS (reflected polynomial 0xA001, seed 0xFFFF), one table lookup per byte.
+// The table is generated by the compiler and lives in flash.
+struct Crc16Table {
+  uint16_t t[256];
+  constexpr Crc16Table() : t() {
+    for (int i = 0; i < 256; i++) {
+      uint16_t c = (uint16_t)i;
+      for (int b = 0; b < 8; b++) c = (c & 1) ? (uint16_t)((c >> 1) ^ 0xA001) : (uint16_t)(c >> 1);
+      t[i] = c;
+    }
+  }
+};
+inline constexpr Crc16Table kCrc16{};
+
+constexpr uint16_t crcUpdate(uint16_t crc, uint8_t b) {
+  return (uint16_t)((crc >> 8) ^ kCrc16.t[(crc ^ b) & 0xFF]);
+}
+
+constexpr uint16_t crc16(const uint8_t *buf, size_t len, uint16_t crc = 0xFFFF) {
+  for (size_t i = 0; i < len; i++) crc = crcUpdate(crc, buf[i]);
+  return crc;
+}
+
+// Address field of any frame — state packet, our commands or the remote's.
+constexpr uint32_t readAddress(const uint8_t *frame) {
+  return ((uint32_t)frame[OFF_ADDR] << 24) | ((uint32_t)frame[OFF_ADDR + 1] << 16) |
+         ((uint32_t)frame[OFF_ADDR + 2] << 8) | (uint32_t)frame[OFF_ADDR + 3];
+}
+
+// Command frame for one command and address. Everything up to the sequence number is
+// fixed, and so is the CRC state after it; finish() only folds in the sequence number.
+// A constant command and address give a frame built entirely at compile time.
+class CommandFrame {
+  public:
+    constexpr CommandFrame() : CommandFrame(0, 0) {}
+    constexpr CommandFrame(uint8_t cmd, uint32_t addr)
+        : _bytes{kCommandLen, cmd, (uint8_t)(addr >> 24), (uint8_t)(addr >> 16), (uint8_t)(addr >> 8),
+                 (uint8_t)addr, 0, 0, 0, 0},
+          _prefixCrc(crc16(_bytes, OFF_SEQ)) {}
+
+    constexpr bool matches(uint8_t cmd, uint32_t addr) const {
+      return _bytes[OFF_CMD] == cmd && readAddress(_bytes) == addr;
+    }
+
+    // Sets the sequence number and CRC; returns the kCommandFrame bytes for the FIFO.
+    constexpr const uint8_t *finish(uint8_t seq) {
+      uint16_t crc = crcUpdate(_prefixCrc, seq);
+      _bytes[OFF_SEQ] = seq;
+      _bytes[OFF_CRC] = (uint8_t)(crc >> 8);
+      _bytes[OFF_CRC + 1] = (uint8_t)crc;
+      return _bytes;
+    }
+
+    constexpr const uint8_t *bytes() const { return _bytes; }
+
+  private:
+    uint8_t _bytes[kCommandFrame];
+    uint16_t _prefixCrc;
+};
+
+// Typed view over a received state packet (kStateFrame bytes, or kStateRxLen with the
+// CC1101's APPEND_STATUS bytes). Does not copy; the buffer must outlive the view.
+class StateView {
+  public:
+    explicit constexpr StateView(const uint8_t *frame) : _f(frame) {}
+
+    constexpr uint8_t length() const { return _f[OFF_LEN]; }
+    constexpr uint32_t address() const { return readAddress(_f); }
+    constexpr uint8_t state() const { return _f[OFF_STATE]; }
+    constexpr uint8_t power() const { return _f[OFF_POWER]; }
+    constexpr uint8_t errorCode() const { return _f[OFF_ERROR]; }
+    constexpr float voltage() const { return _f[OFF_VOLTAGE] / 10.0f; }
+    constexpr int8_t ambientTemp() const { return (int8_t)_f[OFF_AMBIENT]; }
+    constexpr uint8_t caseTemp() const { return _f[OFF_CASE]; }
+    constexpr int8_t setpoint() const { return (int8_t)_f[OFF_SETPOINT]; }
+    constexpr bool autoMode() const { return _f[OFF_AUTO] == 0x32; }
+    constexpr float pumpFreq() const { return _f[OFF_PUMP] / 10.0f; }
+
+    // APPEND_STATUS — only valid on a kStateRxLen CC1101 FIFO read.
+    constexpr uint8_t rssiRaw() const { return _f[OFF_RSSI]; }
+    constexpr bool crcOk() const { return _f[OFF_LQI] & 0x80; }
+    constexpr uint8_t lqi() const { return _f[OFF_LQI] & 0x7F; }
+
+    // Protocol fields into *state. RSSI, LQI and FREQEST are the driver's to fill in.
+    void decode(heater_state_t *state) const {
+      state->state       = this->state();
+      state->power       = power();
+      state->errorCode   = errorCode();
+      state->voltage     = voltage();
+      state->ambientTemp = ambientTemp();
+      state->caseTemp    = caseTemp();
+      state->setpoint    = setpoint();
+      state->autoMode    = autoMode();
+      state->pumpFreq    = pumpFreq();
+    }
+
+  private:
+    const uint8_t *_f;
+};
+
+// Compile-time checks: the standard CRC-16/MODBUS check value, and a finished frame
+// carrying the CRC of its own first seven bytes.
+namespace detail {
+inline constexpr uint8_t kCrcCheckInput[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+static_assert(crc16(kCrcCheckInput, sizeof(kCrcCheckInput)) == 0x4B37, "CRC-16/MODBUS check value");
+
+constexpr bool frameSelfCheck(uint8_t cmd, uint32_t addr, uint8_t seq) {
+  CommandFrame f(cmd, addr);
+  const uint8_t *b = f.finish(seq);
+  uint16_t crc = crc16(b, OFF_CRC);
+  return b[OFF_LEN] == kCommandLen && readAddress(b) == addr && b[OFF_SEQ] == seq &&
+         b[OFF_CRC] == (uint8_t)(crc >> 8) && b[OFF_CRC + 1] == (uint8_t)crc && b[kCommandFrame - 1] == 0;
+}
+static_assert(frameSelfCheck(HEATER_CMD_GET_STATUS, 0x12AB34CD, 0x00), "command frame");
+static_assert(frameSelfCheck(HEATER_CMD_POWER, 0xFFFFFFFF, 0xFF), "command frame, high bytes");
+
+constexpr uint8_t kStateCheck[kStateRxLen] = {kStateLen, 0x00, 0x12, 0xAB, 0xF4, 0xCD, HEATER_STATE_RUNNING, 5,
+                                              0, 124, 0xFB, 0, 80, 22, 0x32, 35};
+static_assert(StateView(kStateCheck).address() == 0x12ABF4CD, "address bytes are not sign-extended");
+static_assert(StateView(kStateCheck).ambientTemp() == -5, "ambient temperature is signed");
+}  // namespace detail
+
+}  // namespace HeaterProtocol
+
+#endif
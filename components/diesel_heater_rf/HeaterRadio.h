@@ -0,0 +1,143 @@
+/*
+ * HeaterRadio.h
+ *
+ * Transceiver interface for the heater protocol — what DieselHeaterRFComponent needs from
+ * a radio, independent of the chip. Implemented by DieselHeaterRF (TI CC1101) and
+ * DieselHeaterSX1262 (Semtech SX1262, GFSK). Also holds the protocol constants and the
+ * parsed state packet shared by both drivers.
+ *
+ * Units follow the CC1101 driver, which the component was written against: frequency as
+ * FREQ2/1/0 (f_XOSC 26 MHz / 2^16), frequency offset and FREQEST in f_XOSC/2^14 steps,
+ * TX power as a PATABLE index 0-7, raw RSSI in APPEND_STATUS format. Other chips convert.
+ */
+
+#ifndef HeaterRadio_h
+#define HeaterRadio_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define HEATER_CMD_GET_STATUS 0x23
+#define HEATER_CMD_MODE   0x24
+#define HEATER_CMD_POWER  0x2b
+#define HEATER_CMD_UP     0x3c
+#define HEATER_CMD_DOWN   0x3e
+
+#define HEATER_STATE_OFF            0x00
+#define HEATER_STATE_STARTUP        0x01
+#define HEATER_STATE_WARMING        0x02
+#define HEATER_STATE_WARMING_WAIT   0x03
+#define HEATER_STATE_PRE_RUN        0x04
+#define HEATER_STATE_RUNNING        0x05
+#define HEATER_STATE_SHUTDOWN       0x06
+#define HEATER_STATE_SHUTTING_DOWN  0x07
+#define HEATER_STATE_COOLING        0x08
+
+#define HEATER_TX_REPEAT    10 // Number of times to re-transmit command packets
+#define HEATER_RX_TIMEOUT   5000
+
+typedef struct {
+  uint8_t state       = 0;
+  uint8_t power       = 0;
+  uint8_t errorCode   = 0;
+  float voltage       = 0;
+  int8_t ambientTemp  = 0;
+  uint8_t caseTemp    = 0;
+  int8_t setpoint     = 0;
+  uint8_t autoMode    = 0;
+  float pumpFreq      = 0;
+  int16_t rssi        = 0;
+  int8_t freqEst      = 0;  // FREQEST at packet end, f_XOSC/2^14 (~1.59 kHz) units
+  uint8_t lqi         = 0;  // APPEND_STATUS LQI (lower = better)
+} heater_state_t;
+
+class HeaterRadio {
+  public:
+    // checkHealth(): configuration verified, chip busy in TX/RX (nothing can be read
+    // back reliably — try again later), or configuration lost (reinitRadio() needed).
+    enum Health : uint8_t { HEALTH_OK, HEALTH_BUSY, HEALTH_LOST };
+
+    virtual ~HeaterRadio() = default;
+
+    virtual const char *chipName() const = 0;
+
+    // Configuration — setters take effect on the next begin()/reinitRadio().
+    virtual void begin(uint32_t heaterAddr) = 0;
+    virtual void setAddress(uint32_t heaterAddr) = 0;
+    virtual void setFrequency(uint8_t freq2, uint8_t freq1, uint8_t freq0) = 0;
+    virtual void setTxPower(uint8_t index) = 0;
+    virtual void setFreqOffset(int8_t off) = 0;
+    virtual int8_t getFreqOffset() const = 0;
+    // Reset and rewrite the configuration; leaves the chip idle.
+    virtual void reinitRadio() = 0;
+
+    // After begin(): true if the expected chip answered. info gets a short status line
+    // for the transceiver status sensor either way.
+    virtual bool probe(char *info, size_t len) = 0;
+    // Health check, chip idle: full compares the whole configuration, otherwise one or
+    // two registers that a brownout reset would change.
+    virtual Health checkHealth(bool full) = 0;
+    // Key configuration values as text, for logs. Only meaningful while idle.
+    virtual void dumpConfig(char *buf, size_t len) = 0;
+
+    // TX burst — numTransmits packets of one command, blocking. Leaves the synthesizer
+    // running so startRxAfterTx() can follow without recalibration.
+    virtual void sendCommand(uint8_t cmd, uint32_t addr, uint8_t numTransmits, uint8_t seq) = 0;
+    virtual void endTxBurst() = 0;
+    virtual void idle() = 0;
+
+    // Non-blocking RX: arm, poll the packet-ready line, read.
+    virtual void startRx() = 0;
+    virtual void startRxAfterTx() = 0;
+    virtual bool isRxAvailable() = 0;
+    // Bytes in the RX FIFO, for chips whose packet-ready line can be missed (overflow,
+    // stale frame); 0 where RX completion is latched in an IRQ register.
+    virtual uint8_t getRxBytes() = 0;
+    // State packet for our address / any address (sender in *addr); discovery also
+    // accepts the remote's 12-byte commands. False on bad length, CRC or address.
+    virtual bool readPacket(heater_state_t *state) = 0;
+    virtual bool readPacket(heater_state_t *state, uint32_t *addr) = 0;
+    virtual bool readAnyPacket(uint32_t *addr, int16_t *rssi, uint8_t *rxLen) = 0;
+
+    // Raw capture (debug mode): every frame, CRC failures included. readRawFrame() returns
+    // the length byte, payload and two APPEND_STATUS bytes (raw RSSI, CRC_OK|LQI);
+    // startRx() re-arms, stopRawCapture() leaves the chip idle.
+    virtual void startRawCapture() = 0;
+    virtual bool readRawFrame(uint8_t *bytes, uint8_t *len, int8_t *freqEst) = 0;
+    virtual void stopRawCapture() = 0;
+
+    // Wake-on-radio: the chip sniffs for packets on its own timer at a fraction of the RX
+    // current. A packet raises the packet-ready line with the chip idle; read it as usual
+    // and re-arm. Sniffs start every periodUs and listen for periodUs / 2^(rxTime + 3).
+    // startRx(), idle() and raw capture end WOR. False if the chip has no such mode.
+    virtual bool startWor(uint32_t periodUs, uint8_t rxTime) { return false; }
+    // Receiver on-time since begin() in µs, WOR counting its RX windows only; a current
+    // proxy for low-power setups. 0 = not tracked.
+    virtual uint64_t getRxOnUs() { return 0; }
+
+    // Calibration cache. Chips with nothing to restore keep the FSCAL defaults below.
+    virtual void setCalCache(bool enabled) = 0;
+    virtual bool isCalCached() const = 0;
+    virtual bool calibrateNow() = 0;
+    virtual uint32_t getCalCount() const = 0;
+    virtual void setFscal(uint8_t fscal3, uint8_t fscal2, uint8_t fscal1) {}
+    virtual void getFscal(uint8_t *fscal3, uint8_t *fscal2, uint8_t *fscal1) { *fscal3 = *fscal2 = *fscal1 = 0; }
+
+    // Link metrics for the last sendCommand() and since begin(). P1: a packet's TX did
+    // not start; P2: it did not finish; underflows: TX FIFO ran dry mid-packet.
+    virtual uint8_t getLastBurstCompleted() const = 0;
+    virtual uint8_t getLastBurstRequested() const = 0;
+    virtual uint32_t getLastBurstCpuUs() const = 0;
+    virtual uint32_t getLastBurstWallUs() const = 0;
+    virtual uint32_t getP1Timeouts() const = 0;
+    virtual uint32_t getP2Timeouts() const = 0;
+    virtual uint32_t getTxUnderflows() const = 0;
+
+    static int16_t rssiToDbm(uint8_t raw) { return (raw >= 128 ? (int)raw - 256 : (int)raw) / 2 - 74; }
+    static uint8_t dbmToRssi(int16_t dbm) {
+      int raw = (dbm + 74) * 2;
+      return (uint8_t)(int8_t)(raw < -128 ? -128 : raw > 127 ? 127 : raw);
+    }
+};
+
+#endif
@@ -1,25 +1,46 @@
 import esphome.codegen as cg
 import esphome.config_validation as cv
+from esphome import automation
 from esphome.components import sensor, text_sensor, binary_sensor
 from esphome.const import (
     CONF_ID,
+    CONF_TRIGGER_ID,
     CONF_UPDATE_INTERVAL,
+    UNIT_SECOND,
+    UNIT_HERTZ,
     UNIT_CELSIUS,
     UNIT_VOLT,
     UNIT_DECIBEL_MILLIWATT,
+    UNIT_PERCENT,
     DEVICE_CLASS_TEMPERATURE,
     DEVICE_CLASS_VOLTAGE,
     DEVICE_CLASS_SIGNAL_STRENGTH,
+    DEVICE_CLASS_DURATION,
+    DEVICE_CLASS_FREQUENCY,
     STATE_CLASS_MEASUREMENT,
+    STATE_CLASS_TOTAL_INCREASING,
 )
 
 DEPENDENCIES = ["api"]
 AUTO_LOAD = ["sensor", "text_sensor", "binary_sensor"]
+MULTI_CONF = True
 
 diesel_heater_rf_ns = cg.esphome_ns.namespace("diesel_heater_rf")
 DieselHeaterRFComponent = diesel_heater_rf_ns.class_(
     "DieselHeaterRFComponent", cg.PollingComponent
 )
+CommandCompleteTrigger = diesel_heater_rf_ns.class_(
+    "CommandCompleteTrigger",
+    automation.Trigger.template(cg.uint32, cg.std_string, cg.std_string, cg.uint32, cg.uint32),
+)
+RadioChip = diesel_heater_rf_ns.enum("RadioChip", is_class=True)
+TRANSCEIVERS = {
+    "cc1101": RadioChip.CC1101,
+    "sx1262": RadioChip.SX1262,
+}
+# SX1262 SetDio3AsTcxoCtrl voltage codes; "none" for a module with a plain crystal.
+TCXO_VOLTAGES = {1.6: 0x00, 1.7: 0x01, 1.8: 0x02, 2.2: 0x03, 2.4: 0x04, 2.7: 0x05, 3.0: 0x06, 3.3: 0x07}
+TCXO_NONE = 0xFF
 
 CONF_HEATER_ADDRESS = "heater_address"
 CONF_SCK_PIN = "sck_pin"
@@ -43,26 +64,267 @@ CONF_FREQUENCY = "frequency"
 CONF_FREQUENCY_OFFSET_HZ = "frequency_offset_hz"
 CONF_CCA_MODE = "cca_mode"
 CONF_TX_POWER = "tx_power"
+CONF_SET_VALUE_PIPELINED = "set_value_pipelined"
+CONF_SET_VALUE_TIME_SENSOR = "set_value_time_sensor"
+CONF_ADAPTIVE_TX = "adaptive_tx"
+CONF_MIN_BURST_PACKETS = "min_burst_packets"
+CONF_MAX_BURST_PACKETS = "max_burst_packets"
+CONF_MIN_RX_WINDOW = "min_rx_window"
+CONF_MAX_RX_WINDOW = "max_rx_window"
+CONF_MAX_RETRY_GAP = "max_retry_gap"
+CONF_LINK_POLICY_SENSOR = "link_policy_sensor"
+CONF_FREQUENCY_TRACKING = "frequency_tracking"
+CONF_FREQUENCY_OFFSET_SENSOR = "frequency_offset_sensor"
+CONF_PASSIVE_LISTEN = "passive_listen"
+CONF_POLL_SCHEDULE = "poll_schedule"
+CONF_IDLE = "idle"  # heater Off — "off" itself would parse as a YAML boolean
+CONF_TRANSITION = "transition"
+CONF_RUNNING = "running"
+CONF_POLLS_SAVED_SENSOR = "polls_saved_sensor"
+CONF_RADIO_ID = "radio_id"
+CONF_SERVICE_PREFIX = "service_prefix"
+CONF_COMMAND_LATENCY_SENSOR = "command_latency_sensor"
+CONF_FIRST_STATE_TIME_SENSOR = "first_state_time_sensor"
+CONF_STARTUP_MAX_WAIT = "startup_max_wait"
+CONF_CACHE_CALIBRATION = "cache_calibration"
+CONF_CALIBRATIONS_SENSOR = "calibrations_sensor"
+CONF_ASYNC_SPI = "async_spi"
+CONF_BURST_CPU_TIME_SENSOR = "burst_cpu_time_sensor"
+CONF_ON_COMMAND_COMPLETE = "on_command_complete"
+CONF_P1_TIMEOUTS_SENSOR = "p1_timeouts_sensor"
+CONF_P2_TIMEOUTS_SENSOR = "p2_timeouts_sensor"
+CONF_TX_UNDERFLOWS_SENSOR = "tx_underflows_sensor"
+CONF_WIFI_HOLDS_SENSOR = "wifi_holds_sensor"
+CONF_RF_STATS_SENSOR = "rf_stats_sensor"
+CONF_TRANSCEIVER = "transceiver"
+CONF_BUSY_PIN = "busy_pin"
+CONF_RESET_PIN = "reset_pin"
+CONF_TCXO_VOLTAGE = "tcxo_voltage"
+CONF_HISTORY_SIZE = "history_size"
+CONF_HISTORY_INTERVAL = "history_interval"
+CONF_DEADBANDS = "deadbands"
+CONF_DB_VOLTAGE = "voltage"
+CONF_DB_AMBIENT_TEMP = "ambient_temp"
+CONF_DB_CASE_TEMP = "case_temp"
+CONF_DB_PUMP_FREQ = "pump_freq"
+CONF_DB_RSSI = "rssi"
+CONF_PACKED_STATE_SENSOR = "packed_state_sensor"
+CONF_SUPPRESSED_PUBLISHES_SENSOR = "suppressed_publishes_sensor"
+CONF_WAKE_ON_RADIO = "wake_on_radio"
+CONF_INTERVAL = "interval"
+CONF_RX_DUTY = "rx_duty"
+CONF_FOLLOW_UP = "follow_up"
+CONF_LIGHT_SLEEP = "light_sleep"
+CONF_RX_ON_TIME_SENSOR = "rx_on_time_sensor"
+
+# p90 histogram sensors, in DieselHeaterRFComponent::RfStat order
+RF_STAT_SENSORS = [
+    ("queue_wait_sensor", "ms", "mdi:tray-full"),
+    ("wifi_wait_sensor", "ms", "mdi:wifi-clock"),
+    ("reinit_time_sensor", "ms", "mdi:restart"),
+    ("burst_airtime_sensor", "ms", "mdi:radio-tower"),
+    ("ack_delay_sensor", "ms", "mdi:timer-check-outline"),
+    ("attempts_sensor", None, "mdi:repeat"),
+]
+RF_FAULT_SENSORS = {
+    CONF_P1_TIMEOUTS_SENSOR: "set_p1_timeouts_sensor",
+    CONF_P2_TIMEOUTS_SENSOR: "set_p2_timeouts_sensor",
+    CONF_TX_UNDERFLOWS_SENSOR: "set_tx_underflows_sensor",
+    CONF_WIFI_HOLDS_SENSOR: "set_wifi_holds_sensor",
+    CONF_SUPPRESSED_PUBLISHES_SENSOR: "set_suppressed_publishes_sensor",
+}
 
 FREQUENCY_PRESETS = {
     "433": (0x10, 0xB0, 0x9E),  # 433.938 MHz — FREQ_REG=1,093,790; nominal 433.92 but measured heater center is ~+19 kHz higher
     "868": (0x21, 0x65, 0x6F),  # 868.30 MHz — FREQ_REG=2,188,655 = 868,300 kHz
 }
 
-CONFIG_SCHEMA = cv.Schema(
+ADAPTIVE_TX_SCHEMA = cv.Schema(
+    {
+        cv.Optional(CONF_MIN_BURST_PACKETS, default=8): cv.int_range(min=1, max=30),
+        cv.Optional(CONF_MAX_BURST_PACKETS, default=14): cv.int_range(min=1, max=30),
+        cv.Optional(CONF_MIN_RX_WINDOW, default="400ms"): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_MAX_RX_WINDOW, default="1500ms"): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_MAX_RETRY_GAP, default="1600ms"): cv.positive_time_period_milliseconds,
+    }
+)
+
+POLL_SCHEDULE_SCHEMA = cv.Schema(
+    {
+        cv.Optional(CONF_IDLE): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_TRANSITION): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_RUNNING): cv.positive_time_period_milliseconds,
+    }
+)
+
+# A reading is re-published once it moves more than its deadband from the value last
+# sent. 0 = every change (the default, same as without deadbands).
+DEADBANDS_SCHEMA = cv.Schema(
+    {
+        cv.Optional(CONF_DB_VOLTAGE, default=0.0): cv.float_range(min=0.0, max=5.0),
+        cv.Optional(CONF_DB_AMBIENT_TEMP, default=0): cv.int_range(min=0, max=20),
+        cv.Optional(CONF_DB_CASE_TEMP, default=0): cv.int_range(min=0, max=50),
+        cv.Optional(CONF_DB_PUMP_FREQ, default=0.0): cv.float_range(min=0.0, max=2.0),
+        cv.Optional(CONF_DB_RSSI, default=0): cv.int_range(min=0, max=30),
+    }
+)
+
+
+# Share of each WOR interval spent listening — CC1101 MCSM2 RX_TIME 0..6 (WOR_RES=0)
+WOR_RX_DUTY = {
+    "12.5%": 0,
+    "6.25%": 1,
+    "3.125%": 2,
+    "1.563%": 3,
+    "0.781%": 4,
+    "0.391%": 5,
+    "0.195%": 6,
+}
+
+WAKE_ON_RADIO_SCHEMA = cv.Schema(
+    {
+        cv.Optional(CONF_INTERVAL, default="200ms"): cv.All(
+            cv.positive_time_period_microseconds,
+            cv.Range(min=cv.TimePeriod(milliseconds=1), max=cv.TimePeriod(milliseconds=1890)),
+        ),
+        cv.Optional(CONF_RX_DUTY, default="12.5%"): cv.enum(WOR_RX_DUTY),
+        cv.Optional(CONF_FOLLOW_UP, default="2s"): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_LIGHT_SLEEP, default=False): cv.boolean,
+    }
+)
+
+
+def _tcxo_voltage(value):
+    if isinstance(value, str) and value.strip().lower() == "none":
+        return TCXO_NONE
+    volts = round(cv.voltage(value), 1)
+    if volts not in TCXO_VOLTAGES:
+        choices = ", ".join(f"{v}V" for v in TCXO_VOLTAGES)
+        raise cv.Invalid(f"TCXO voltage must be one of {choices} or none")
+    return TCXO_VOLTAGES[volts]
+
+
+def _validate_shared_radio(config):
+    # Every heater registers the same service names — the ones sharing a radio need a prefix.
+    if CONF_RADIO_ID in config and not config[CONF_SERVICE_PREFIX]:
+        raise cv.Invalid(f"'{CONF_SERVICE_PREFIX}' is required when '{CONF_RADIO_ID}' is set")
+    return config
+
+
+# Chip-level options: only the radio owner configures the transceiver.
+RADIO_OWNER_ONLY = (
+    CONF_SCK_PIN, CONF_MISO_PIN, CONF_MOSI_PIN, CONF_CS_PIN, CONF_GDO2_PIN, CONF_BUSY_PIN, CONF_RESET_PIN,
+    CONF_TCXO_VOLTAGE, CONF_TRANSCEIVER, CONF_FREQUENCY, CONF_FREQUENCY_OFFSET_HZ, CONF_CCA_MODE, CONF_TX_POWER, CONF_ASYNC_SPI,
+)
+
+
+def _reject_owner_only_options(config):
+    # Runs before the schema fills in defaults, so only keys the user wrote are seen.
+    if isinstance(config, dict) and CONF_RADIO_ID in config:
+        for key in RADIO_OWNER_ONLY:
+            if key in config:
+                raise cv.Invalid(f"'{key}' is set by the radio owner and can't be used with '{CONF_RADIO_ID}'",
+                                 path=[key])
+    return config
+
+
+def _validate_transceiver(config):
+    if config[CONF_TRANSCEIVER] == "sx1262":
+        for key in (CONF_BUSY_PIN, CONF_RESET_PIN):
+            if key not in config:
+                raise cv.Invalid(f"'{key}' is required for the SX1262")
+        if config[CONF_CCA_MODE] != 0 or config[CONF_ASYNC_SPI]:
+            raise cv.Invalid(f"'{CONF_CCA_MODE}' and '{CONF_ASYNC_SPI}' are CC1101 only")
+    elif CONF_BUSY_PIN in config or CONF_RESET_PIN in config or CONF_TCXO_VOLTAGE in config:
+        raise cv.Invalid(f"'{CONF_BUSY_PIN}', '{CONF_RESET_PIN}' and '{CONF_TCXO_VOLTAGE}' are SX1262 only")
+    return config
+
+
+def _validate_wake_on_radio(config):
+    # WOR replaces the radio owner's passive RX; the SX1262 backend has no WOR mode.
+    if CONF_WAKE_ON_RADIO not in config:
+        return config
+    if not config[CONF_PASSIVE_LISTEN] or CONF_RADIO_ID in config:
+        raise cv.Invalid(f"'{CONF_WAKE_ON_RADIO}' needs '{CONF_PASSIVE_LISTEN}: true' on the radio owner")
+    if config[CONF_TRANSCEIVER] != "cc1101":
+        raise cv.Invalid(f"'{CONF_WAKE_ON_RADIO}' is CC1101 only")
+    return config
+
+
+CONFIG_SCHEMA = cv.All(_reject_owner_only_options, cv.Schema(
     {
         cv.GenerateID(): cv.declare_id(DieselHeaterRFComponent),
         cv.Required(CONF_HEATER_ADDRESS): cv.hex_int,
+        cv.Optional(CONF_RADIO_ID): cv.use_id(DieselHeaterRFComponent),
+        cv.Optional(CONF_SERVICE_PREFIX, default=""): cv.string,
         cv.Optional(CONF_SCK_PIN, default=18): cv.int_,
         cv.Optional(CONF_MISO_PIN, default=19): cv.int_,
         cv.Optional(CONF_MOSI_PIN, default=23): cv.int_,
         cv.Optional(CONF_CS_PIN, default=5): cv.int_,
         cv.Optional(CONF_GDO2_PIN, default=4): cv.int_,
+        cv.Optional(CONF_TRANSCEIVER, default="cc1101"): cv.enum(TRANSCEIVERS, lower=True),
+        cv.Optional(CONF_BUSY_PIN): cv.int_,
+        cv.Optional(CONF_RESET_PIN): cv.int_,
+        cv.Optional(CONF_TCXO_VOLTAGE): _tcxo_voltage,
         cv.Optional(CONF_FREQUENCY, default="433"): cv.one_of(*FREQUENCY_PRESETS, lower=True),
         cv.Optional(CONF_FREQUENCY_OFFSET_HZ, default=0): cv.int_,
         cv.Optional(CONF_CCA_MODE, default=0): cv.int_range(min=0, max=3),
         cv.Optional(CONF_TX_POWER, default=7): cv.int_range(min=0, max=7),
+        cv.Optional(CONF_SET_VALUE_PIPELINED, default=False): cv.boolean,
+        cv.Optional(CONF_ADAPTIVE_TX): ADAPTIVE_TX_SCHEMA,
+        cv.Optional(CONF_FREQUENCY_TRACKING, default=True): cv.boolean,
+        cv.Optional(CONF_PASSIVE_LISTEN, default=False): cv.boolean,
+        cv.Optional(CONF_WAKE_ON_RADIO): WAKE_ON_RADIO_SCHEMA,
+        cv.Optional(CONF_POLL_SCHEDULE): POLL_SCHEDULE_SCHEMA,
+        cv.Optional(CONF_STARTUP_MAX_WAIT, default="25s"): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_CACHE_CALIBRATION, default=True): cv.boolean,
+        cv.Optional(CONF_ASYNC_SPI, default=False): cv.boolean,
+        # Bytes; 0 disables the history, anything below two 256-byte blocks does too.
+        cv.Optional(CONF_HISTORY_SIZE, default=4096): cv.int_range(min=0, max=16384),
+        cv.Optional(CONF_HISTORY_INTERVAL, default="10s"): cv.All(
+            cv.positive_time_period_milliseconds,
+            cv.Range(min=cv.TimePeriod(seconds=1), max=cv.TimePeriod(seconds=255)),
+        ),
+        cv.Optional(CONF_DEADBANDS): DEADBANDS_SCHEMA,
+        cv.Optional(CONF_ON_COMMAND_COMPLETE): automation.validate_automation(
+            {
+                cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(CommandCompleteTrigger),
+            }
+        ),
+        **{
+            cv.Optional(key): sensor.sensor_schema(
+                unit_of_measurement=unit,
+                accuracy_decimals=0,
+                state_class=STATE_CLASS_MEASUREMENT,
+                entity_category="diagnostic",
+                icon=icon,
+            )
+            for key, unit, icon in RF_STAT_SENSORS
+        },
+        **{
+            cv.Optional(key): sensor.sensor_schema(
+                accuracy_decimals=0,
+                state_class=STATE_CLASS_TOTAL_INCREASING,
+                entity_category="diagnostic",
+                icon="mdi:alert-circle-outline",
+            )
+            for key in RF_FAULT_SENSORS
+        },
+        cv.Optional(CONF_RF_STATS_SENSOR): text_sensor.text_sensor_schema(
+            entity_category="diagnostic",
+            icon="mdi:chart-histogram",
+        ),
         cv.Optional(CONF_STATE_SENSOR): text_sensor.text_sensor_schema(),
+        cv.Optional(CONF_RX_ON_TIME_SENSOR): sensor.sensor_schema(
+            unit_of_measurement=UNIT_PERCENT,
+            accuracy_decimals=1,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category="diagnostic",
+            icon="mdi:radio-tower",
+        ),
+        cv.Optional(CONF_PACKED_STATE_SENSOR): text_sensor.text_sensor_schema(
+            icon="mdi:package-variant-closed",
+        ),
         cv.Optional(CONF_VOLTAGE_SENSOR): sensor.sensor_schema(
             unit_of_measurement=UNIT_VOLT,
             accuracy_decimals=1,
@@ -113,8 +375,63 @@ CONFIG_SCHEMA = cv.Schema(
             entity_category="diagnostic",
             icon="mdi:radio-tower",
         ),
+        cv.Optional(CONF_SET_VALUE_TIME_SENSOR): sensor.sensor_schema(
+            unit_of_measurement=UNIT_SECOND,
+            accuracy_decimals=1,
+            device_class=DEVICE_CLASS_DURATION,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category="diagnostic",
+            icon="mdi:timer-check-outline",
+        ),
+        cv.Optional(CONF_LINK_POLICY_SENSOR): text_sensor.text_sensor_schema(
+            entity_category="diagnostic",
+            icon="mdi:tune-variant",
+        ),
+        cv.Optional(CONF_POLLS_SAVED_SENSOR): sensor.sensor_schema(
+            unit_of_measurement="polls/h",
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category="diagnostic",
+            icon="mdi:timer-sand",
+        ),
+        cv.Optional(CONF_CALIBRATIONS_SENSOR): sensor.sensor_schema(
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_TOTAL_INCREASING,
+            entity_category="diagnostic",
+            icon="mdi:tune-vertical",
+        ),
+        cv.Optional(CONF_BURST_CPU_TIME_SENSOR): sensor.sensor_schema(
+            unit_of_measurement="µs",
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category="diagnostic",
+            icon="mdi:chip",
+        ),
+        cv.Optional(CONF_FIRST_STATE_TIME_SENSOR): sensor.sensor_schema(
+            unit_of_measurement=UNIT_SECOND,
+            accuracy_decimals=1,
+            device_class=DEVICE_CLASS_DURATION,
+            entity_category="diagnostic",
+            icon="mdi:timer-play-outline",
+        ),
+        cv.Optional(CONF_COMMAND_LATENCY_SENSOR): sensor.sensor_schema(
+            unit_of_measurement="ms",
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category="diagnostic",
+            icon="mdi:timer-outline",
+        ),
+        cv.Optional(CONF_FREQUENCY_OFFSET_SENSOR): sensor.sensor_schema(
+            unit_of_measurement=UNIT_HERTZ,
+            accuracy_decimals=0,
+            device_class=DEVICE_CLASS_FREQUENCY,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category="diagnostic",
+            icon="mdi:sine-wave",
+        ),
     }
-).extend(cv.polling_component_schema("60s"))
+).extend(cv.polling_component_schema("60s")), _validate_shared_radio, _validate_transceiver,
+          _validate_wake_on_radio)
 
 
 async def to_code(config):
@@ -127,6 +444,17 @@ async def to_code(config):
     cg.add(var.set_mosi_pin(config[CONF_MOSI_PIN]))
     cg.add(var.set_cs_pin(config[CONF_CS_PIN]))
     cg.add(var.set_gdo2_pin(config[CONF_GDO2_PIN]))
+    cg.add(var.set_transceiver(config[CONF_TRANSCEIVER]))
+    if CONF_BUSY_PIN in config:
+        cg.add(var.set_busy_pin(config[CONF_BUSY_PIN]))
+    if CONF_RESET_PIN in config:
+        cg.add(var.set_reset_pin(config[CONF_RESET_PIN]))
+    if CONF_TCXO_VOLTAGE in config:
+        cg.add(var.set_tcxo_voltage(config[CONF_TCXO_VOLTAGE]))
+    if CONF_RADIO_ID in config:
+        parent = await cg.get_variable(config[CONF_RADIO_ID])
+        cg.add(var.set_radio_parent(parent))
+    cg.add(var.set_service_prefix(config[CONF_SERVICE_PREFIX]))
 
     f2, f1, f0 = FREQUENCY_PRESETS[config[CONF_FREQUENCY]]
     offset_hz = config[CONF_FREQUENCY_OFFSET_HZ]
@@ -140,6 +468,55 @@ async def to_code(config):
     cg.add(var.set_freq(f2, f1, f0))
     cg.add(var.set_cca_mode(config[CONF_CCA_MODE]))
     cg.add(var.set_tx_power(config[CONF_TX_POWER]))
+    cg.add(var.set_set_value_pipelined(config[CONF_SET_VALUE_PIPELINED]))
+    cg.add(var.set_frequency_tracking(config[CONF_FREQUENCY_TRACKING]))
+    cg.add(var.set_passive_listen(config[CONF_PASSIVE_LISTEN]))
+    cg.add(var.set_startup_max_wait(config[CONF_STARTUP_MAX_WAIT].total_milliseconds))
+    cg.add(var.set_cache_calibration(config[CONF_CACHE_CALIBRATION]))
+    cg.add(var.set_async_spi(config[CONF_ASYNC_SPI]))
+    cg.add(var.set_history_size(config[CONF_HISTORY_SIZE]))
+    cg.add(var.set_history_interval(config[CONF_HISTORY_INTERVAL].total_milliseconds))
+    if CONF_POLL_SCHEDULE in config:
+        conf = config[CONF_POLL_SCHEDULE]
+        cg.add(
+            var.set_poll_schedule(
+                conf[CONF_IDLE].total_milliseconds if CONF_IDLE in conf else 0,
+                conf[CONF_TRANSITION].total_milliseconds if CONF_TRANSITION in conf else 0,
+                conf[CONF_RUNNING].total_milliseconds if CONF_RUNNING in conf else 0,
+            )
+        )
+    if CONF_DEADBANDS in config:
+        conf = config[CONF_DEADBANDS]
+        cg.add(
+            var.set_deadbands(
+                conf[CONF_DB_VOLTAGE],
+                conf[CONF_DB_AMBIENT_TEMP],
+                conf[CONF_DB_CASE_TEMP],
+                conf[CONF_DB_PUMP_FREQ],
+                conf[CONF_DB_RSSI],
+            )
+        )
+    if CONF_WAKE_ON_RADIO in config:
+        conf = config[CONF_WAKE_ON_RADIO]
+        cg.add(
+            var.set_wake_on_radio(
+                conf[CONF_INTERVAL].total_microseconds,
+                conf[CONF_RX_DUTY],
+                conf[CONF_FOLLOW_UP].total_milliseconds,
+                conf[CONF_LIGHT_SLEEP],
+            )
+        )
+    if CONF_ADAPTIVE_TX in config:
+        conf = config[CONF_ADAPTIVE_TX]
+        cg.add(
+            var.set_adaptive_tx(
+                conf[CONF_MIN_BURST_PACKETS],
+                conf[CONF_MAX_BURST_PACKETS],
+                conf[CONF_MIN_RX_WINDOW].total_milliseconds,
+                conf[CONF_MAX_RX_WINDOW].total_milliseconds,
+                conf[CONF_MAX_RETRY_GAP].total_milliseconds,
+            )
+        )
 
     if CONF_STATE_SENSOR in config:
         s = await text_sensor.new_text_sensor(config[CONF_STATE_SENSOR])
@@ -188,3 +565,70 @@ async def to_code(config):
     if CONF_TRANSCEIVER_STATUS_SENSOR in config:
         s = await text_sensor.new_text_sensor(config[CONF_TRANSCEIVER_STATUS_SENSOR])
         cg.add(var.set_transceiver_status_sensor(s))
+
+    if CONF_SET_VALUE_TIME_SENSOR in config:
+        s = await sensor.new_sensor(config[CONF_SET_VALUE_TIME_SENSOR])
+        cg.add(var.set_set_value_time_sensor(s))
+
+    if CONF_LINK_POLICY_SENSOR in config:
+        s = await text_sensor.new_text_sensor(config[CONF_LINK_POLICY_SENSOR])
+        cg.add(var.set_link_policy_sensor(s))
+
+    if CONF_FREQUENCY_OFFSET_SENSOR in config:
+        s = await sensor.new_sensor(config[CONF_FREQUENCY_OFFSET_SENSOR])
+        cg.add(var.set_frequency_offset_sensor(s))
+
+    if CONF_POLLS_SAVED_SENSOR in config:
+        s = await sensor.new_sensor(config[CONF_POLLS_SAVED_SENSOR])
+        cg.add(var.set_polls_saved_sensor(s))
+
+    if CONF_COMMAND_LATENCY_SENSOR in config:
+        s = await sensor.new_sensor(config[CONF_COMMAND_LATENCY_SENSOR])
+        cg.add(var.set_command_latency_sensor(s))
+
+    if CONF_FIRST_STATE_TIME_SENSOR in config:
+        s = await sensor.new_sensor(config[CONF_FIRST_STATE_TIME_SENSOR])
+        cg.add(var.set_first_state_time_sensor(s))
+
+    if CONF_CALIBRATIONS_SENSOR in config:
+        s = await sensor.new_sensor(config[CONF_CALIBRATIONS_SENSOR])
+        cg.add(var.set_calibrations_sensor(s))
+
+    if CONF_BURST_CPU_TIME_SENSOR in config:
+        s = await sensor.new_sensor(config[CONF_BURST_CPU_TIME_SENSOR])
+        cg.add(var.set_burst_cpu_time_sensor(s))
+
+    for i, (key, _, _) in enumerate(RF_STAT_SENSORS):
+        if key in config:
+            s = await sensor.new_sensor(config[key])
+            cg.add(var.set_rf_stat_sensor(i, s))
+    for key, setter in RF_FAULT_SENSORS.items():
+        if key in config:
+            s = await sensor.new_sensor(config[key])
+            cg.add(getattr(var, setter)(s))
+    if CONF_RF_STATS_SENSOR in config:
+        s = await text_sensor.new_text_sensor(config[CONF_RF_STATS_SENSOR])
+        cg.add(var.set_rf_stats_sensor(s))
+    if CONF_RX_ON_TIME_SENSOR in config:
+        s = await sensor.new_sensor(config[CONF_RX_ON_TIME_SENSOR])
+        cg.add(var.set_rx_on_time_sensor(s))
+    if CONF_PACKED_STATE_SENSOR in config:
+        s = await text_sensor.new_text_sensor(config[CONF_PACKED_STATE_SENSOR])
+        cg.add(var.set_packed_state_sensor(s))
+
+    # Command completion events go out via fire_homeassistant_event()
+    cg.add_define("USE_API_HOMEASSISTANT_SERVICES")
+    for conf in config.get(CONF_ON_COMMAND_COMPLETE, []):
+        trigger = cg.new_Pvariable(conf[CONF_TRIGGER_ID])
+        cg.add(var.add_command_complete_trigger(trigger))
+        await automation.build_automation(
+            trigger,
+            [
+                (cg.uint32, "id"),
+                (cg.std_string, "command"),
+                (cg.std_string, "result"),
+                (cg.uint32, "latency_ms"),
+                (cg.uint32, "attempts"),
+            ],
+            conf,
+        )
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+namespace esphome {
+namespace diesel_heater_rf {
+
+// Timestamped raw RX frame as drained from the CC1101 FIFO (APPEND_STATUS bytes included).
+struct CaptureFrame {
+  uint32_t t_ms;
+  int8_t rssi;      // dBm, from the second-to-last byte
+  uint8_t lqi;      // last byte: bit 7 = CRC_OK, bits 6:0 = LQI
+  int8_t freq_est;  // FREQEST
+  uint8_t len;
+  uint8_t data[64];
+};
+
+// Fixed-size capture ring for debug mode. Overwrites the oldest frame when full; the
+// streaming cursor (pop) is independent of the retained history (at), so a dump service
+// can replay the last kCaptureFrames frames after they were streamed.
+//
+// Export record format (v1), hex-encoded one per log line as "CAP <hex>":
+//   u8 0xD1 | u32 LE t_ms | i8 rssi | u8 lqi | i8 freq_est | u8 len | data[len]
+// Decoded by tools/decode_capture.py.
+class CaptureRing {
+ public:
+  static constexpr uint8_t kCaptureFrames = 32;
+  static constexpr uint8_t kRecordMagic = 0xD1;
+  static constexpr size_t kRecordHeader = 9;
+  static constexpr size_t kMaxRecord = kRecordHeader + sizeof(CaptureFrame::data);
+
+  void push(const CaptureFrame &f) {
+    frames_[head_] = f;
+    head_ = (head_ + 1) % kCaptureFrames;
+    if (size_ < kCaptureFrames) size_++;
+    if (unread_ < kCaptureFrames) unread_++; else dropped_++;
+    total_++;
+  }
+  // Oldest frame not yet streamed, or nullptr.
+  const CaptureFrame *pop() {
+    if (unread_ == 0) return nullptr;
+    return &frames_[(head_ + kCaptureFrames - unread_--) % kCaptureFrames];
+  }
+  // i-th retained frame, oldest first.
+  const CaptureFrame &at(uint8_t i) const { return frames_[(head_ + kCaptureFrames - size_ + i) % kCaptureFrames]; }
+  uint8_t size() const { return size_; }
+  uint32_t total() const { return total_; }
+  uint32_t dropped() const { return dropped_; }  // overwritten before they were streamed
+  void clear() { head_ = size_ = unread_ = 0; }
+
+  // Serialise one frame as an export record; returns the record length.
+  static size_t encode(const CaptureFrame &f, uint8_t *out) {
+    out[0] = kRecordMagic;
+    out[1] = f.t_ms & 0xFF;
+    out[2] = (f.t_ms >> 8) & 0xFF;
+    out[3] = (f.t_ms >> 16) & 0xFF;
+    out[4] = (f.t_ms >> 24) & 0xFF;
+    out[5] = (uint8_t) f.rssi;
+    out[6] = f.lqi;
+    out[7] = (uint8_t) f.freq_est;
+    out[8] = f.len;
+    memcpy(out + kRecordHeader, f.data, f.len);
+    return kRecordHeader + f.len;
+  }
+
+ protected:
+  CaptureFrame frames_[kCaptureFrames]{};
+  uint8_t head_{0};
+  uint8_t size_{0};
+  uint8_t unread_{0};
+  uint32_t total_{0};
+  uint32_t dropped_{0};
+};
+
+}  // namespace diesel_heater_rf
+}  // namespace esphome
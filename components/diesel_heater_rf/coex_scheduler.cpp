@@ -0,0 +1,99 @@
+#include "coex_scheduler.h"
+
+namespace esphome {
+namespace diesel_heater_rf {
+
+void CoexScheduler::extend_(uint32_t until) {
+  uint32_t cur = busy_until_ms_.load(std::memory_order_relaxed);
+  while ((int32_t)(until - cur) > 0 &&
+         !busy_until_ms_.compare_exchange_weak(cur, until, std::memory_order_relaxed)) {
+  }
+}
+
+void CoexScheduler::on_wifi_event(uint32_t now, uint32_t hold_ms) {
+  events_.fetch_add(1, std::memory_order_relaxed);
+  if (hold_ms == 0) return;
+  last_activity_ms_.store(now, std::memory_order_relaxed);
+  activities_.fetch_add(1, std::memory_order_relaxed);
+  extend_(now + hold_ms);
+}
+
+void CoexScheduler::on_publish(uint32_t now, uint32_t messages) {
+  if (messages == 0) return;
+  uint32_t hold = kPublishBaseMs + (messages - 1) * kPublishPerMsgMs;
+  extend_(now + (hold > kPublishMaxMs ? kPublishMaxMs : hold));
+}
+
+// Picks up activity starts recorded by the event task. Only the latest timestamp is
+// kept there, so several events between two calls count as one start — they are one
+// activity burst anyway at loop() rates.
+void CoexScheduler::learn_() {
+  uint32_t n = activities_.load(std::memory_order_relaxed);
+  if (n == seen_activities_) return;
+  seen_activities_ = n;
+  uint32_t t = last_activity_ms_.load(std::memory_order_relaxed);
+  uint32_t gap = t - prev_activity_ms_;
+  if (prev_activity_ms_ != 0 && gap < kMinPeriodMs) return;  // same burst — keep its start
+  if (prev_activity_ms_ != 0 && gap <= kMaxPeriodMs) {
+    period_ms_ = period_ms_ == 0 ? gap : (period_ms_ * 7 + gap) / 8;
+    if (samples_ < kMinSamples) samples_++;
+  } else if (prev_activity_ms_ != 0) {
+    samples_ = 0;  // pattern broken — re-learn before predicting again
+    period_ms_ = 0;
+  }
+  prev_activity_ms_ = t;
+}
+
+uint32_t CoexScheduler::quiet_at(uint32_t now) const {
+  uint32_t until = busy_until_ms_.load(std::memory_order_relaxed);
+  if (startup_hold_ && (int32_t)(startup_until_ms_ - until) > 0) until = startup_until_ms_;
+  return (int32_t)(until - now) > 0 ? until : now;
+}
+
+uint32_t CoexScheduler::next_activity(uint32_t now) const {
+  if (samples_ < kMinSamples || period_ms_ == 0) return 0;
+  uint32_t since = now - prev_activity_ms_;
+  return now + (period_ms_ - since % period_ms_);
+}
+
+bool CoexScheduler::request(uint32_t now, uint32_t burst_ms) {
+  learn_();
+  bool held = (int32_t)(quiet_at(now) - now) > 0;
+  bool predicted = false;
+  if (!held) {
+    // Periods shorter than two bursts can't be dodged — predicting would only add latency.
+    uint32_t next = next_activity(now);
+    if (next != 0 && period_ms_ >= 2 * (burst_ms + kGuardMs) && next - now < burst_ms + kGuardMs) {
+      predicted = true;
+      if (wait_start_ms_ != 0 && now - wait_start_ms_ >= kMaxPredictWaitMs) {
+        forced_++;
+        predicted = false;
+      }
+    }
+  }
+
+  if (held || predicted) {
+    if (wait_start_ms_ == 0) {
+      wait_start_ms_ = now;
+      wait_predicted_ = false;
+      waits_++;
+    }
+    if (predicted && !wait_predicted_) {
+      wait_predicted_ = true;
+      predicted_++;
+    }
+    return false;
+  }
+
+  if (wait_start_ms_ != 0) {
+    uint32_t w = now - wait_start_ms_;
+    wait_start_ms_ = 0;
+    wait_ms_ += w;
+    wait_total_ms_ += w;
+    if (w > wait_max_ms_) wait_max_ms_ = w;
+  }
+  return true;
+}
+
+}  // namespace diesel_heater_rf
+}  // namespace esphome
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace esphome {
+namespace diesel_heater_rf {
+
+// WiFi/RF coexistence — decides when an RF burst may start so that it does not overlap
+// WiFi TX (3.3 V rail droop → CC1101 brownout reset). Two kinds of input:
+//
+//   holds:      WiFi events (scan done, connect, disconnect) and our own API traffic
+//               mark the air busy until a deadline. Event holds are fixed per event type;
+//               publish holds scale with the number of messages just queued to the API.
+//   prediction: the start times of event-driven activity are learned as an average
+//               period. A burst is only granted if it ends before the next predicted
+//               activity; holding for a prediction is capped at kMaxPredictWaitMs so a
+//               wrong guess costs latency, never a starved command.
+//
+// Task safety: on_wifi_event() runs in the event task and only touches the atomics below;
+// everything else (learning, grants, statistics) is called from loop(). Timestamps are
+// ms on the esp_timer clock, which millis() shares.
+class CoexScheduler {
+ public:
+  static constexpr uint32_t kPublishBaseMs = 20;       // first API message: TX + ACK
+  static constexpr uint32_t kPublishPerMsgMs = 8;      // each further message
+  static constexpr uint32_t kPublishMaxMs = 150;
+  static constexpr uint32_t kMaxPredictWaitMs = 1000;
+
+  // Event task. hold_ms 0 = routine event, counted for the startup gate only.
+  void on_wifi_event(uint32_t now, uint32_t hold_ms);
+  // loop(): messages just handed to the API (sensor publishes, HA events).
+  void on_publish(uint32_t now, uint32_t messages);
+  // loop(): startup gate — no burst before until. Kept apart from the event holds, so
+  // release_startup() ends it early without dropping a pending WiFi or publish hold.
+  void hold_startup(uint32_t until) {
+    startup_until_ms_ = until;
+    startup_hold_ = true;
+  }
+  void release_startup() { startup_hold_ = false; }
+
+  // loop(): may a burst of burst_ms start now? A false starts (or continues) a wait;
+  // the next true ends it and adds it to the statistics.
+  bool request(uint32_t now, uint32_t burst_ms);
+  // Wait accumulated since the last call — the caller attributes it to a command.
+  uint32_t take_wait_ms() {
+    uint32_t w = wait_ms_;
+    wait_ms_ = 0;
+    return w;
+  }
+
+  // Earliest time all known holds have expired (now if none).
+  uint32_t quiet_at(uint32_t now) const;
+  // Next predicted start of WiFi activity after now; 0 = no prediction yet.
+  uint32_t next_activity(uint32_t now) const;
+
+  uint32_t events() const { return events_.load(std::memory_order_relaxed); }
+  uint32_t waits() const { return waits_; }              // wait episodes
+  uint32_t predicted_waits() const { return predicted_; }  // ... held by the prediction
+  uint32_t forced_grants() const { return forced_; }     // prediction overridden after max wait
+  uint32_t wait_total_ms() const { return wait_total_ms_; }
+  uint32_t wait_max_ms() const { return wait_max_ms_; }
+  uint32_t period_ms() const { return period_ms_; }
+
+ protected:
+  static constexpr uint32_t kMinPeriodMs = 1000;     // shorter gaps belong to one activity burst
+  static constexpr uint32_t kMaxPeriodMs = 120000;   // longer gaps are not periodic
+  static constexpr uint8_t kMinSamples = 3;
+  static constexpr uint32_t kGuardMs = 20;           // margin between burst end and activity
+
+  void extend_(uint32_t until);
+  void learn_();
+
+  // Written from the event task
+  std::atomic<uint32_t> busy_until_ms_{0};
+  std::atomic<uint32_t> events_{0};
+  std::atomic<uint32_t> activities_{0};          // events that set a hold
+  std::atomic<uint32_t> last_activity_ms_{0};
+
+  // loop() only
+  bool startup_hold_{false};
+  uint32_t startup_until_ms_{0};
+  uint32_t seen_activities_{0};
+  uint32_t prev_activity_ms_{0};
+  uint32_t period_ms_{0};     // EWMA of activity start gaps, 1/8 weight
+  uint8_t samples_{0};
+  uint32_t wait_start_ms_{0};  // 0 = not waiting
+  bool wait_predicted_{false};
+  uint32_t wait_ms_{0};
+  uint32_t waits_{0};
+  uint32_t predicted_{0};
+  uint32_t forced_{0};
+  uint32_t wait_total_ms_{0};
+  uint32_t wait_max_ms_{0};
+};
+
+}  // namespace diesel_heater_rf
+}  // namespace esphome
@@ -0,0 +1,447 @@
+#include "command_cycle.h"
+#include <cmath>
+#include <cstdlib>
+#include "esp_log.h"
+#include "HeaterProtocol.h"
+
+namespace esphome {
+namespace diesel_heater_rf {
+
+static const char *const TAG = "diesel_heater_rf";
+
+void CommandCycle::bind(Host *host, HeaterRadio *radio, LinkPolicy *policy, CoexScheduler *coex,
+                        CalibrationMark *cal) {
+  host_ = host;
+  radio_ = radio;
+  policy_ = policy;
+  coex_ = coex;
+  cal_ = cal;
+}
+
+void CommandCycle::push(uint8_t cmd, uint32_t id, bool front) {
+  Queued q{cmd, id, host_->cycle_millis()};
+  if (front) {
+    queue_.insert(queue_.begin(), q);
+  } else {
+    queue_.push_back(q);
+  }
+}
+
+void CommandCycle::set_value_target(float target) {
+  target_value_ = target;
+  set_value_start_ms_ = host_->cycle_millis();
+}
+
+void CommandCycle::reset_backoff(uint32_t now) {
+  if (!offline_) return;
+  backoff_step_ = 0;
+  next_probe_ms_ = now + kBackoffMs[0];
+  ESP_LOGI(TAG, "User command while offline — resetting backoff to %lus", (unsigned long)(kBackoffMs[0] / 1000));
+}
+
+// ---------------------------------------------------------------------------
+// RX_LISTEN: non-blocking packet-ready poll
+// ---------------------------------------------------------------------------
+bool CommandCycle::loop_rx() {
+  if (!listening_) return false;
+
+  // Hot path: GDO2 GPIO only — zero SPI, zero bus contention with active RX.
+  bool gdo2 = radio_->isRxAvailable();
+  // Warm path: check RXBYTES via SPI every ~200ms to catch overflow/stale packets.
+  // Infrequent enough to avoid timing interference with incoming packets.
+  if (!gdo2 && host_->cycle_millis() > next_rxb_check_ms_) {
+    next_rxb_check_ms_ = host_->cycle_millis() + kRxbCheckMs;
+    uint8_t rxb = radio_->getRxBytes();
+    if (rxb >= HeaterProtocol::kStateRxLen) {
+      if (rxb >= 64) {
+        radio_->startRx();
+        return true;
+      }
+      gdo2 = true;
+    }
+  }
+  if (gdo2) {
+    heater_state_t state;
+    if (!radio_->readPacket(&state)) {
+      // Packet in FIFO but wrong address or bad CRC — restart RX, keep window
+      stats_.bad_packets++;
+      radio_->startRx();
+      return true;
+    }
+    // ACK received — the host defers publishing to a later loop() iteration so WiFi TX
+    // from API state pushes doesn't overlap with RF activity.
+    listening_ = false;
+    uint8_t attempts = fail_count_ + 1;
+    uint32_t ack_delay = host_->cycle_millis() - rx_start_ms_;
+    policy_->on_ack(attempts, ack_delay);
+    afc_update_(state);
+    fail_count_ = 0;
+    if (offline_) back_online_("ACK");
+    host_->cycle_acked(state, current_id_, attempts, ack_delay);
+
+    // Pipelined set_value step: the reply already carries the new setpoint/pumpFreq,
+    // so trim the steps still queued and go straight to the next burst.
+    if (pipeline_step_(current_cmd_)) {
+      pop_();
+      pipeline_steps_left_--;
+      pipeline_last_acked_ = true;
+      record_latency_();
+      pipeline_trim_(state);
+      if (pipeline_steps_left_ == 0) pipeline_finish_();
+      return true;
+    }
+
+    // MODE is a toggle: only pop when auto_mode actually flipped
+    if (current_cmd_ == HEATER_CMD_MODE && (bool)state.autoMode != mode_toggle_expected_) {
+      ESP_LOGD(TAG, "MODE: toggle not confirmed (auto_mode=%d, expected=%d) — retrying", (int)state.autoMode,
+               (int)mode_toggle_expected_);
+      return true;
+    }
+
+    record_latency_();
+    pop_();
+    return true;
+  }
+
+  if (host_->cycle_millis() > rx_end_ms_) {
+    if (radio_->isRxAvailable()) return true;  // last-chance GDO2 check
+    listening_ = false;
+    on_timeout_();
+  }
+  return true;
+}
+
+// RX window expired without a reply: retransmit, verify, or give up and go offline.
+void CommandCycle::on_timeout_() {
+  // Pipelined steps are never retransmitted — a missed reply is caught by the
+  // GET_STATUS verification queued when the pipeline finishes.
+  if (pipeline_step_(current_cmd_)) {
+    pop_();
+    cmd_start_ms_ = 0;
+    pipeline_steps_left_--;
+    pipeline_last_acked_ = false;
+    if (pipeline_steps_left_ == 0) pipeline_finish_();
+    return;
+  }
+
+  fail_count_++;
+  stats_.timeouts++;
+  policy_->on_timeout();
+  if (fail_count_ < kMaxAttempts) {
+    // Not yet exhausted — the command stays at the front of the queue; fail_count_ > 0
+    // makes loop_tx() retransmit.
+    next_retry_ms_ = host_->cycle_millis() + policy_->retry_gap_ms(fail_count_);
+    return;
+  }
+
+  policy_->on_command_failed(fail_count_);
+  fail_count_ = 0;
+  cmd_start_ms_ = 0;
+  radio_->endTxBurst();  // SIDLE
+
+  if (current_cmd_ != HEATER_CMD_GET_STATUS) {
+    // Action command exhausted its attempts — prepend GET_STATUS to verify heater state.
+    push(HEATER_CMD_GET_STATUS, 0, true);
+    return;
+  }
+
+  // GET_STATUS exhausted its attempts — check registers, then go offline.
+  fail_all_();
+  pipeline_active_ = false;
+  pipeline_steps_left_ = 0;
+  char regs[128];
+  radio_->dumpConfig(regs, sizeof(regs));
+  if (radio_->checkHealth(true) == HeaterRadio::HEALTH_LOST) {
+    ESP_LOGW(TAG, "%u failures + register corruption (%s) — reinitialising", kMaxAttempts, regs);
+    stats_.lost_reinits++;
+    radio_->reinitRadio();
+    radio_->dumpConfig(regs, sizeof(regs));
+    ESP_LOGI(TAG, "Post-reinit: %s", regs);
+    return;
+  }
+  ESP_LOGE(TAG, "%u failures, regs: %s — heater unreachable", kMaxAttempts, regs);
+  bool first = !offline_;
+  if (first) {
+    offline_ = true;
+    backoff_step_ = 0;
+    stats_.offline_episodes++;
+  } else if (backoff_step_ < kBackoffSteps - 1) {
+    backoff_step_++;
+  }
+  next_probe_ms_ = host_->cycle_millis() + kBackoffMs[backoff_step_];
+  if (first) {
+    ESP_LOGE(TAG, "Heater offline — first probe in %lus", (unsigned long)(kBackoffMs[0] / 1000));
+  } else {
+    ESP_LOGI(TAG, "Heater offline — next probe in %lus (step %d/%d)",
+             (unsigned long)(kBackoffMs[backoff_step_] / 1000), backoff_step_ + 1, (int)kBackoffSteps);
+  }
+  host_->cycle_offline(first);
+}
+
+// ---------------------------------------------------------------------------
+// IDLE: next command from the queue
+// ---------------------------------------------------------------------------
+void CommandCycle::loop_tx() {
+  if (listening_ || queue_.empty()) return;
+  uint32_t now = host_->cycle_millis();
+
+  // Wait for WiFi to settle before starting RF — WiFi TX causes 3.3V rail droops
+  // that brownout-reset the CC1101. This covers WiFi scans, reconnects, the settle
+  // period after our own sensor publishes and predicted periodic WiFi activity.
+  // Retransmits go out regardless; the RX window is already running late.
+  if (fail_count_ == 0 && coex_ != nullptr && !coex_->request(now, coex_burst_ms_())) return;
+  // Retry spacing from the link policy — backs off on a bad link, zero on a good one.
+  if (fail_count_ > 0 && (int32_t)(now - next_retry_ms_) < 0) return;
+
+  uint8_t cmd = queue_.front().cmd;
+  if (cmd_start_ms_ == 0) cmd_start_ms_ = now;
+  const heater_state_t &state = host_->cycle_state();
+
+  // CMD_SET_VALUE is a pseudo-command — evaluate target vs current state and insert
+  // the appropriate UP/DOWN step(s) at the front; re-evaluated after each state response
+  // (or after each pipeline round) until the target is reached.
+  if (cmd == CMD_SET_VALUE) {
+    int steps = set_value_steps_(state);
+    if (steps == 0) {
+      pop_();
+      cmd_start_ms_ = 0;
+      if (state.autoMode) {
+        ESP_LOGI(TAG, "set_value: target %d°C reached", static_cast<int8_t>(target_value_));
+      } else {
+        ESP_LOGI(TAG, "set_value: target %.1f Hz reached", target_value_);
+      }
+      if (set_value_start_ms_ != 0) {
+        uint32_t elapsed = now - set_value_start_ms_;
+        ESP_LOGI(TAG, "set_value: time to target %lu ms", (unsigned long)elapsed);
+        set_value_start_ms_ = 0;
+        host_->cycle_set_value_reached(elapsed);
+      }
+      return;
+    }
+    uint8_t step = (steps > 0) ? HEATER_CMD_UP : HEATER_CMD_DOWN;
+    uint8_t count = pipelined_ ? static_cast<uint8_t>(steps > 0 ? steps : -steps) : 1;
+    if (state.autoMode) {
+      ESP_LOGD(TAG, "set_value: setpoint %d→%d, queuing %d× %s", state.setpoint, static_cast<int8_t>(target_value_),
+               count, step == HEATER_CMD_UP ? "UP" : "DOWN");
+    } else {
+      ESP_LOGD(TAG, "set_value: pumpFreq %.1f→%.1f, queuing %d× %s", state.pumpFreq, target_value_, count,
+               step == HEATER_CMD_UP ? "UP" : "DOWN");
+    }
+    queue_.insert(queue_.begin(), count, Queued{step, queue_.front().id, now});
+    if (pipelined_) {
+      pipeline_active_ = true;
+      pipeline_last_acked_ = false;
+      pipeline_steps_left_ = count;
+    }
+    return;
+  }
+
+  // Pre-send idempotency checks — if GET_STATUS revealed the heater already
+  // reached the expected state, skip the command instead of retrying with a new seq#.
+  if (cmd == HEATER_CMD_POWER) {
+    bool effectively_on = (state.state != HEATER_STATE_OFF && state.state != HEATER_STATE_SHUTDOWN &&
+                           state.state != HEATER_STATE_SHUTTING_DOWN && state.state != HEATER_STATE_COOLING);
+    if (effectively_on == power_target_on_) {
+      ESP_LOGI(TAG, "POWER: heater already %s — skipping", effectively_on ? "on" : "off");
+      stats_.skipped++;
+      pop_();
+      cmd_start_ms_ = 0;
+      return;
+    }
+  }
+  if (cmd == HEATER_CMD_MODE && (bool)state.autoMode == mode_toggle_expected_) {
+    ESP_LOGI(TAG, "MODE: already %s — skipping", state.autoMode ? "auto" : "manual");
+    stats_.skipped++;
+    pop_();
+    cmd_start_ms_ = 0;
+    return;
+  }
+
+  // Unified TX path — handles both first burst and retransmit.
+  // GET_STATUS: new seq# every 3 attempts (0,3,6,9), retransmit on others.
+  // Action cmds: new seq# only on attempt 0, retransmit on the rest.
+  bool retransmit = cmd == HEATER_CMD_GET_STATUS ? (fail_count_ % 3) != 0 : fail_count_ > 0;
+
+  // Shared radio: user commands go before routine polls; otherwise round-robin by heater.
+  if (!host_->cycle_acquire(cmd != HEATER_CMD_GET_STATUS)) return;
+  if (!retransmit) {
+    current_cmd_ = cmd;
+    current_seq_ = host_->cycle_take_seq();
+  }
+  current_id_ = queue_.front().id;
+  host_->cycle_sending(current_id_, queue_.front().queued_ms, retransmit);
+  tx_burst_(cmd);
+}
+
+// Isolated TX path — noinline so changes elsewhere in the cycle don't shift the compiled
+// binary layout of delay/reinit/sendCommand/startRx.
+void __attribute__((noinline)) CommandCycle::tx_burst_(uint8_t cmd) {
+  host_->cycle_delay(50);
+  radio_->setAddress(addr_);  // readPacket() filter for our RX window
+  radio_->setFreqOffset(freq_offset_);
+  uint32_t reinit_start = host_->cycle_millis();
+  radio_->reinitRadio();
+  if (cal_cache_) {
+    if (const char *reason = calibration_due_()) {
+      if (radio_->calibrateNow()) {
+        uint8_t f3, f2, f1;
+        radio_->getFscal(&f3, &f2, &f1);
+        cal_->ms = host_->cycle_millis();
+        cal_->temp_valid = host_->cycle_state_valid();
+        cal_->temp = host_->cycle_state().ambientTemp;
+        ESP_LOGD(TAG, "%s calibrated (%s): FSCAL=%02X/%02X/%02X, %lu total", radio_->chipName(), reason, f3, f2, f1,
+                 (unsigned long)radio_->getCalCount());
+      } else {
+        stats_.cal_failed++;
+        ESP_LOGW(TAG, "%s calibration (%s) did not complete — autocal stays on", radio_->chipName(), reason);
+      }
+    }
+  }
+  uint32_t reinit_ms = host_->cycle_millis() - reinit_start;
+  radio_->sendCommand(cmd, addr_, policy_->burst_packets(), current_seq_);
+  // After sendCommand the synthesizer is still locked. startRxAfterTx() enters RX directly
+  // without recalibration — preserves VCO tuning from the TX burst. startRx() would SIDLE
+  // first, killing the synth lock and forcing recalibration that can drift the RX frequency.
+  radio_->startRxAfterTx();
+  stats_.bursts++;
+  rx_start_ms_ = host_->cycle_millis();
+  // Pipelined steps don't need the full window — the reply arrives within ~200 ms,
+  // and a missed one is recovered by the final verification instead of a retransmit.
+  rx_end_ms_ = rx_start_ms_ + (pipeline_step_(cmd) ? kPipelineRxWindowMs : policy_->rx_window_ms());
+  next_rxb_check_ms_ = rx_start_ms_ + kRxbCheckMs;
+  listening_ = true;
+  host_->cycle_sent(reinit_ms);
+}
+
+// Expected TX airtime of the next burst, for the coexistence prediction: the last burst's
+// wall time, or ~16 ms per packet before the first one.
+uint32_t CommandCycle::coex_burst_ms_() const {
+  uint32_t last = radio_->getLastBurstWallUs() / 1000;
+  return last != 0 ? last : policy_->burst_packets() * 16;
+}
+
+// Calibration cache triggers — returns the reason, or nullptr if the cache is still good.
+const char *CommandCycle::calibration_due_() {
+  if (!radio_->isCalCached()) return "no cached calibration";
+  if (host_->cycle_millis() - cal_->ms >= kCalMaxAgeMs) return "age";
+  if (fail_count_ > 0 && fail_count_ % kCalAfterFailures == 0) return "RX timeouts";
+  if (host_->cycle_state_valid()) {
+    int8_t ambient = host_->cycle_state().ambientTemp;
+    if (!cal_->temp_valid) {
+      // Restored or first calibration without a temperature reference — adopt this one.
+      cal_->temp = ambient;
+      cal_->temp_valid = true;
+    } else if (abs(ambient - cal_->temp) >= kCalTempDelta) {
+      return "temperature";
+    }
+  }
+  return nullptr;
+}
+
+// ---------------------------------------------------------------------------
+// Frequency-offset tracking
+// ---------------------------------------------------------------------------
+void CommandCycle::afc_update_(const heater_state_t &state) {
+  if (!freq_tracking_ || state.lqi > kAfcMaxLqi) return;
+  // FREQEST is relative to whatever FSCTRL0 the chip had at RX time — with a shared
+  // radio that may be another heater's offset.
+  int8_t applied = freq_offset_;
+  float measured = radio_->getFreqOffset() + state.freqEst;
+  afc_estimate_ += kAfcAlpha * (measured - afc_estimate_);
+  if (fabsf(afc_estimate_ - applied) < kAfcHysteresis) return;
+
+  long next = lroundf(afc_estimate_);
+  if (next > kAfcMaxSteps) next = kAfcMaxSteps;
+  if (next < -kAfcMaxSteps) next = -kAfcMaxSteps;
+  if (next == applied) return;
+  // Takes effect on our next burst's reinitRadio() — never touch config registers mid-RX.
+  freq_offset_ = static_cast<int8_t>(next);
+  stats_.afc_steps++;
+  ESP_LOGI(TAG, "Frequency offset tracking: FREQOFF %d→%ld (%+.0f Hz, FREQEST=%d LQI=%u)", applied, next,
+           next * kAfcHzPerStep, state.freqEst, state.lqi);
+  host_->cycle_freq_offset_changed();
+}
+
+void CommandCycle::on_state_heard(const heater_state_t &state) {
+  afc_update_(state);
+  if (offline_) back_online_("passive RX");
+}
+
+void CommandCycle::back_online_(const char *via) {
+  offline_ = false;
+  backoff_step_ = 0;
+  ESP_LOGI(TAG, "Heater 0x%08X back online (%s) — resuming normal polling", (unsigned)addr_, via);
+  host_->cycle_online();
+}
+
+void CommandCycle::record_latency_() {
+  if (cmd_start_ms_ == 0) return;
+  uint32_t ms = host_->cycle_millis() - cmd_start_ms_;
+  cmd_start_ms_ = 0;
+  host_->cycle_latency(ms);
+}
+
+// ---------------------------------------------------------------------------
+// Queue
+// ---------------------------------------------------------------------------
+
+// Removes the head entry; its service call is complete once no other entry carries its id
+// (set_value completes with its CMD_SET_VALUE entry, not with the UP/DOWN steps before it).
+void CommandCycle::pop_() {
+  if (queue_.empty()) return;
+  uint32_t id = queue_.front().id;
+  queue_.erase(queue_.begin());
+  if (id == 0) return;
+  for (const auto &q : queue_) {
+    if (q.id == id) return;
+  }
+  host_->cycle_completed(id, true);
+}
+
+void CommandCycle::fail_all_() {
+  std::vector<Queued> failed;
+  failed.swap(queue_);
+  for (size_t i = 0; i < failed.size(); i++) {
+    uint32_t id = failed[i].id;
+    bool seen = false;
+    for (size_t j = 0; j < i && !seen; j++) seen = failed[j].id == id;
+    if (id != 0 && !seen) host_->cycle_completed(id, false);
+  }
+}
+
+// ---------------------------------------------------------------------------
+// Pipelined set_value
+// ---------------------------------------------------------------------------
+int CommandCycle::set_value_steps_(const heater_state_t &state) const {
+  if (state.autoMode)
+    return static_cast<int8_t>(target_value_) - state.setpoint;
+  // Pump frequency moves in 0.1 Hz steps
+  return static_cast<int>(lroundf((target_value_ - state.pumpFreq) * 10.0f));
+}
+
+// Drop queued pipeline steps the heater no longer needs (target reached early, or a
+// new set_value target was accepted mid-pipeline in the opposite direction).
+void CommandCycle::pipeline_trim_(const heater_state_t &state) {
+  int needed = set_value_steps_(state);
+  if (current_cmd_ == HEATER_CMD_DOWN) needed = -needed;
+  if (needed < 0) needed = 0;
+  while (pipeline_steps_left_ > needed && !queue_.empty() &&
+         (queue_.front().cmd == HEATER_CMD_UP || queue_.front().cmd == HEATER_CMD_DOWN)) {
+    pop_();
+    pipeline_steps_left_--;
+  }
+}
+
+// Last pipelined step done — CMD_SET_VALUE is next in the queue and verifies the result.
+// If the last step went unanswered the host's state is stale, so fetch a fresh status first.
+void CommandCycle::pipeline_finish_() {
+  pipeline_active_ = false;
+  pipeline_steps_left_ = 0;
+  if (!pipeline_last_acked_) {
+    ESP_LOGD(TAG, "set_value: pipeline done, last step unanswered — verifying with GET_STATUS");
+    push(HEATER_CMD_GET_STATUS, 0, true);
+  }
+}
+
+}  // namespace diesel_heater_rf
+}  // namespace esphome
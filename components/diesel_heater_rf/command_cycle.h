@@ -0,0 +1,203 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "HeaterRadio.h"
+#include "coex_scheduler.h"
+#include "link_policy.h"
+
+namespace esphome {
+namespace diesel_heater_rf {
+
+// Calibration cache bookkeeping — one per radio, shared by the heaters on it.
+struct CalibrationMark {
+  uint32_t ms{0};           // last SCAL
+  int8_t temp{0};           // heater ambient reading at that time
+  bool temp_valid{false};
+};
+
+// The RF command cycle of one heater: command queue, coexistence gate, retry spacing,
+// idempotency checks, set_value stepping, TX burst, RX window, retransmit and offline
+// escalation, frequency-offset tracking and calibration caching. Free of ESPHome so the
+// host simulator (tools/sim) runs the same code as DieselHeaterRFComponent.
+//
+//   loop_rx():  RX window of the last burst — ACK, bad packet or timeout. True while the
+//               cycle owns the chip; the caller returns from its loop().
+//   loop_tx():  IDLE — next queued command, one burst per call.
+//
+// Everything around the cycle (the clock, the shared-radio grant, sequence numbers,
+// publishing, command records, persistence) is the Host's.
+class CommandCycle {
+ public:
+  // Pseudo-command: never sent over RF; evaluated against the last state and replaced
+  // by UP/DOWN steps until the set_value target is reached.
+  static constexpr uint8_t CMD_SET_VALUE = 0xFE;
+  static constexpr uint8_t kMaxAttempts = 12;
+  // Offline probing: 30 s → 1 min → 2 min → 5 min → 15 min → 30 min → 1 h
+  static constexpr uint32_t kBackoffMs[] = {30000, 60000, 120000, 300000, 900000, 1800000, 3600000};
+  static constexpr uint8_t kBackoffSteps = sizeof(kBackoffMs) / sizeof(kBackoffMs[0]);
+  static constexpr uint32_t kPipelineRxWindowMs = 400;  // heater replies within ~100-200 ms
+  static constexpr float kAfcHzPerStep = 26000000.0f / 16384.0f;  // f_XOSC/2^14 ≈ 1587 Hz
+  static constexpr int8_t kAfcMaxSteps = 40;                      // clamp to ±63 kHz
+
+  class Host {
+   public:
+    virtual ~Host() = default;
+    virtual uint32_t cycle_millis() = 0;
+    virtual void cycle_delay(uint32_t ms) = 0;
+    // Last known heater state (received or restored); valid = not the zero default.
+    virtual const heater_state_t &cycle_state() = 0;
+    virtual bool cycle_state_valid() = 0;
+    // Shared radio grant for one TX/RX cycle; urgent = user command, not a poll.
+    virtual bool cycle_acquire(bool urgent) { return true; }
+    virtual uint8_t cycle_take_seq() = 0;
+    // Head entry about to go out; retransmit = same seq as the previous burst.
+    virtual void cycle_sending(uint32_t id, uint32_t queued_ms, bool retransmit) {}
+    // Burst sent, chip in RX; reinit_ms = reinitRadio() plus calibration.
+    virtual void cycle_sent(uint32_t reinit_ms) {}
+    // Reply to our burst, before the queue moves on.
+    virtual void cycle_acked(const heater_state_t &state, uint32_t id, uint8_t attempts, uint32_t ack_delay_ms) = 0;
+    // Service call id left the queue: ACKed/skipped (ok) or dropped on going offline.
+    virtual void cycle_completed(uint32_t id, bool ok) = 0;
+    // Head of queue → ACK, including the wait for coexistence and the shared radio.
+    virtual void cycle_latency(uint32_t ms) {}
+    virtual void cycle_set_value_reached(uint32_t elapsed_ms) {}
+    virtual void cycle_offline(bool first) {}
+    virtual void cycle_online() {}
+    virtual void cycle_freq_offset_changed() {}
+  };
+
+  // coex may be nullptr (no coexistence gate); cal is the radio owner's.
+  void bind(Host *host, HeaterRadio *radio, LinkPolicy *policy, CoexScheduler *coex, CalibrationMark *cal);
+  void set_address(uint32_t addr) { addr_ = addr; }
+  void set_pipelined(bool v) { pipelined_ = v; }
+  void set_cal_cache(bool v) { cal_cache_ = v; }
+  void set_freq_tracking(bool v) { freq_tracking_ = v; }
+  bool freq_tracking() const { return freq_tracking_; }
+  void restore_freq_offset(int8_t off) { freq_offset_ = off; afc_estimate_ = off; }
+  int8_t freq_offset() const { return freq_offset_; }
+
+  // Queue — id ties an entry to the service call it serves (0 = internal poll or
+  // verification); set_value's UP/DOWN steps carry the set_value's id.
+  void push(uint8_t cmd, uint32_t id, bool front = false);
+  bool empty() const { return queue_.empty(); }
+  // Toggle targets — a toggle is skipped if the last state already shows the target.
+  void expect_power(bool on) { power_target_on_ = on; }
+  void expect_mode(bool auto_mode) { mode_toggle_expected_ = auto_mode; }
+  void set_value_target(float target);
+  float target_value() const { return target_value_; }
+
+  bool loop_rx();
+  void loop_tx();
+  // State packet for our address heard outside the cycle (passive RX).
+  void on_state_heard(const heater_state_t &state);
+
+  bool listening() const { return listening_; }
+  bool pipelining() const { return pipeline_active_; }
+  bool offline() const { return offline_; }
+  // Offline: a status poll is only worth sending once the backoff has run out.
+  bool probe_due(uint32_t now) const { return !offline_ || (int32_t)(now - next_probe_ms_) >= 0; }
+  uint32_t next_probe_ms() const { return next_probe_ms_; }
+  // User command while offline — probe aggressively again.
+  void reset_backoff(uint32_t now);
+
+  struct Stats {
+    uint32_t bursts{0};
+    uint32_t timeouts{0};        // RX windows without a reply
+    uint32_t bad_packets{0};     // readPacket() false: CRC, length or address
+    uint32_t skipped{0};         // idempotency checks
+    uint32_t lost_reinits{0};    // kMaxAttempts failures + register corruption
+    uint32_t offline_episodes{0};
+    uint32_t afc_steps{0};
+    uint32_t cal_failed{0};
+  };
+  const Stats &stats() const { return stats_; }
+
+ protected:
+  // Calibration: recalibrate when the cache is older than kCalMaxAgeMs, the heater's
+  // ambient reading moved kCalTempDelta °C since the last SCAL, or after every
+  // kCalAfterFailures consecutive RX timeouts.
+  static constexpr uint32_t kCalMaxAgeMs = 1800000;
+  static constexpr int kCalTempDelta = 8;
+  static constexpr uint8_t kCalAfterFailures = 6;
+  // Frequency-offset tracking: every valid packet contributes FSCTRL0 + FREQEST to an
+  // exponential filter; the rounded estimate is applied by the next burst's reinitRadio().
+  // Low-quality packets (high LQI value) are ignored.
+  static constexpr uint8_t kAfcMaxLqi = 64;
+  static constexpr float kAfcAlpha = 0.25f;
+  static constexpr float kAfcHysteresis = 0.75f;  // steps before re-applying
+  static constexpr uint32_t kRxbCheckMs = 200;
+
+  struct Queued {
+    uint8_t cmd;
+    uint32_t id;
+    uint32_t queued_ms;
+  };
+
+  void tx_burst_(uint8_t cmd);
+  void on_timeout_();
+  const char *calibration_due_();
+  void afc_update_(const heater_state_t &state);
+  void back_online_(const char *via);
+  void record_latency_();
+  void pop_();
+  void fail_all_();
+  bool pipeline_step_(uint8_t cmd) const {
+    return pipeline_active_ && (cmd == HEATER_CMD_UP || cmd == HEATER_CMD_DOWN);
+  }
+  int set_value_steps_(const heater_state_t &state) const;
+  void pipeline_trim_(const heater_state_t &state);
+  void pipeline_finish_();
+  uint32_t coex_burst_ms_() const;
+
+  Host *host_{nullptr};
+  HeaterRadio *radio_{nullptr};
+  LinkPolicy *policy_{nullptr};
+  CoexScheduler *coex_{nullptr};
+  CalibrationMark *cal_{nullptr};
+  uint32_t addr_{0};
+
+  std::vector<Queued> queue_;
+  uint8_t current_cmd_{0xFF};
+  uint32_t current_id_{0};
+  uint8_t current_seq_{0};
+  uint8_t fail_count_{0};
+  uint32_t cmd_start_ms_{0};   // head of queue first considered; 0 = none
+
+  bool listening_{false};
+  uint32_t rx_start_ms_{0};    // burst end, for the ACK delay
+  uint32_t rx_end_ms_{0};
+  uint32_t next_rxb_check_ms_{0};
+  uint32_t next_retry_ms_{0};  // retransmit not before this timestamp
+
+  bool offline_{false};
+  uint8_t backoff_step_{0};
+  uint32_t next_probe_ms_{0};
+
+  // Expected state after toggle commands — set once when queued, checked before retry.
+  bool mode_toggle_expected_{false};
+  bool power_target_on_{false};
+
+  // set_value: temperature (°C, auto mode) or pump frequency (Hz, manual mode).
+  // Pipelined, the full UP/DOWN step count is queued at once and each step is sent as
+  // its own burst (new seq#) without waiting for the publish/settle cycle. Replies to
+  // the steps trim the remaining count; a missed reply is not retried — the final
+  // CMD_SET_VALUE re-evaluation (after a GET_STATUS if the last step was unanswered)
+  // verifies the result and queues a correction round if needed.
+  float target_value_{0.0f};
+  uint32_t set_value_start_ms_{0};  // 0 = no target pending
+  bool pipelined_{false};
+  bool pipeline_active_{false};
+  bool pipeline_last_acked_{false};
+  uint8_t pipeline_steps_left_{0};  // pipelined UP/DOWN entries still at the front of queue_
+
+  bool cal_cache_{true};
+  bool freq_tracking_{true};
+  int8_t freq_offset_{0};      // our FREQOFF; applied to the (possibly shared) driver before each burst
+  float afc_estimate_{0.0f};
+
+  Stats stats_;
+};
+
+}  // namespace diesel_heater_rf
+}  // namespace esphome
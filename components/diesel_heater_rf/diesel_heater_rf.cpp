@@ -1,49 +1,86 @@
 #include "diesel_heater_rf.h"
 #include "esphome/core/hal.h"
+#include "esp_attr.h"
+#include "esp_system.h"
+#include "esp_sleep.h"
+#include "driver/gpio.h"
+#include <algorithm>
+#include <cstdlib>
 
 namespace esphome {
 namespace diesel_heater_rf {
 
 static const char *const TAG = "diesel_heater_rf";
 
+// Survives software resets (OTA, panic, watchdog) but not power-on; validated by magic + CRC.
+struct RtcRecord {
+  uint32_t magic;
+  PersistedState data;
+  uint16_t crc;
+};
+static constexpr uint32_t kRtcMagic = 0xD1E5E1A5;
+static RTC_NOINIT_ATTR RtcRecord s_rtc_records[RfScheduler::kMaxClients];
+
+static uint16_t rtc_crc(const RtcRecord &r) {
+  return crc16(reinterpret_cast<const uint8_t *>(&r.data), sizeof(r.data));
+}
+
 void DieselHeaterRFComponent::setup() {
-  heater_ = new DieselHeaterRF(sck_pin_, miso_pin_, mosi_pin_, cs_pin_, gdo2_pin_);
+  if (cycle_.freq_tracking()) {
+    afc_pref_ = global_preferences->make_preference<int8_t>(fnv1_hash("diesel_heater_rf_afc") ^ addr_);
+    int8_t saved = 0;
+    if (afc_pref_.load(&saved) && saved >= -CommandCycle::kAfcMaxSteps && saved <= CommandCycle::kAfcMaxSteps) {
+      cycle_.restore_freq_offset(saved);
+      ESP_LOGI(TAG, "Restored frequency offset: FREQOFF=%d (%+.0f Hz)", saved, saved * CommandCycle::kAfcHzPerStep);
+    }
+  }
+  if (!owns_radio_()) {
+    setup_shared_radio_();
+    return;
+  }
+
+  if (radio_chip_ == RadioChip::SX1262) {
+    auto *sx1262 = new DieselHeaterSX1262(sck_pin_, miso_pin_, mosi_pin_, cs_pin_, gdo2_pin_, busy_pin_, reset_pin_);
+    sx1262->setTcxoVoltage(tcxo_voltage_);
+    heater_ = sx1262;
+  } else {
+    auto *cc1101 = new DieselHeaterRF(sck_pin_, miso_pin_, mosi_pin_, cs_pin_, gdo2_pin_);
+    cc1101->setCcaMode(cca_mode_);
+    cc1101->setAsyncSpi(async_spi_);
+    heater_ = cc1101;
+  }
   heater_->setFrequency(freq2_, freq1_, freq0_);
-  heater_->setCcaMode(cca_mode_);
   heater_->setTxPower(tx_power_);
-  delay(100); // CC1101 power-on settling before first SPI access
+  heater_->setFreqOffset(cycle_.freq_offset());
+  heater_->setCalCache(cal_cache_);
+  bind_cycle_();
+  persist_restore_(0);  // before begin() so initRadio() starts from the saved FSCAL values
+  delay(100); // transceiver power-on settling before first SPI access
   heater_->begin(addr_);
+  if (light_sleep_) {
+    // GDO2 goes high on a received packet — the light-sleep wake source.
+    gpio_wakeup_enable((gpio_num_t)gdo2_pin_, GPIO_INTR_HIGH_LEVEL);
+    esp_sleep_enable_gpio_wakeup();
+  }
   user_poll_interval_ms_ = get_update_interval();
-  ESP_LOGI(TAG, "Initialized: address=0x%08X freq=0x%02X%02X%02X", addr_, freq2_, freq1_, freq0_);
-
-  uint8_t partnum = heater_->getPartNum();
-  uint8_t version = heater_->getVersion();
-  uint8_t rf2, rf1, rf0;
-  heater_->getFreqRegisters(&rf2, &rf1, &rf0);
-  ESP_LOGI(TAG, "CC1101 FREQ regs readback: 0x%02X%02X%02X (written: 0x%02X%02X%02X)",
-           rf2, rf1, rf0, freq2_, freq1_, freq0_);
-  // Diagnostic: snapshot key registers immediately after initRadio to confirm init worked.
-  uint8_t sync1_init = heater_->readConfigReg(0x04);
-  uint8_t mdmcfg4_init = heater_->readConfigReg(0x10);
-  uint8_t marcstate_init = heater_->getMarcstate();
-  ESP_LOGI(TAG, "Post-init regs: SYNC1=0x%02X FREQ=0x%02X%02X%02X MDMCFG4=0x%02X MARCSTATE=0x%02X",
-           sync1_init, rf2, rf1, rf0, mdmcfg4_init, marcstate_init);
-
-  if (partnum == 0x00 && version == 0x14) {
-    cc1101_ok_ = true;
-    ESP_LOGI(TAG, "CC1101 OK: PARTNUM=0x%02X VERSION=0x%02X", partnum, version);
-    if (transceiver_status_sensor_ != nullptr) {
-      char buf[48];
-      snprintf(buf, sizeof(buf), "OK freq=0x%02X%02X%02X", rf2, rf1, rf0);
-      transceiver_status_sensor_->publish_state(buf);
-    }
+  // PollingComponent starts the poller after setup() returns, so this is the only place
+  // the update interval is changed — the per-state schedule is applied inside update().
+  set_update_interval(kPollTickMs);
+  ESP_LOGI(TAG, "Initialized: %s address=0x%08X freq=0x%02X%02X%02X", heater_->chipName(), addr_, freq2_, freq1_,
+           freq0_);
+
+  char info[64];
+  cc1101_ok_ = heater_->probe(info, sizeof(info));
+  if (cc1101_ok_) {
+    // Diagnostic: snapshot key registers immediately after init to confirm it worked.
+    char regs[128];
+    heater_->dumpConfig(regs, sizeof(regs));
+    ESP_LOGI(TAG, "%s %s — post-init: %s", heater_->chipName(), info, regs);
   } else {
-    char buf[48];
-    snprintf(buf, sizeof(buf), "ERROR PARTNUM=0x%02X VERSION=0x%02X", partnum, version);
-    ESP_LOGE(TAG, "CC1101 unexpected response: %s (expected 0x00/0x14 — check SPI wiring)", buf);
-    if (transceiver_status_sensor_ != nullptr)
-      transceiver_status_sensor_->publish_state(buf);
+    ESP_LOGE(TAG, "%s unexpected response: %s (check SPI wiring)", heater_->chipName(), info);
   }
+  if (transceiver_status_sensor_ != nullptr)
+    transceiver_status_sensor_->publish_state(info);
 
   if (found_address_sensor_ != nullptr) {
     if (addr_ != 0) {
@@ -55,158 +92,333 @@ void DieselHeaterRFComponent::setup() {
     }
   }
 
-  register_service(&DieselHeaterRFComponent::on_power, "power");
-  register_service(&DieselHeaterRFComponent::on_emergency_stop, "emergency_stop");
-  register_service(&DieselHeaterRFComponent::on_get_status, "get_status");
-  register_service(&DieselHeaterRFComponent::on_mode, "mode");
-  register_service(&DieselHeaterRFComponent::on_temp_up, "temp_up");
-  register_service(&DieselHeaterRFComponent::on_temp_down, "temp_down");
-  register_service(&DieselHeaterRFComponent::on_set_value, "set_value", {"value"});
-  register_service(&DieselHeaterRFComponent::on_find_address, "find_address");
-  register_service(&DieselHeaterRFComponent::on_ping, "ping");
+  register_services_();
+  history_begin_();
+  rf_slot_ = scheduler_->add_client(addr_, [this](const heater_state_t &s) { on_passive_state_(s); });
 
   if (!cc1101_ok_) {
-    ESP_LOGE(TAG, "CC1101 init failed — RF polling disabled. Check SPI wiring.");
+    ESP_LOGE(TAG, "Transceiver init failed — RF polling disabled. Check SPI wiring.");
+    return;
+  }
+  start_rf_();
+}
+
+// Additional heater on a CC1101 owned by radio_parent_ — no SPI/driver setup of our own.
+void DieselHeaterRFComponent::setup_shared_radio_() {
+  heater_ = radio_parent_->heater_;
+  scheduler_ = radio_parent_->scheduler_;
+  coex_ = radio_parent_->coex_;
+  bind_cycle_();
+  cc1101_ok_ = radio_parent_->cc1101_ok_;
+  user_poll_interval_ms_ = get_update_interval();
+  set_update_interval(kPollTickMs);
+  ESP_LOGI(TAG, "Initialized: address=0x%08X on shared CC1101 (services prefixed \"%s\")", addr_,
+           service_prefix_.c_str());
+  if (found_address_sensor_ != nullptr) {
+    char buf[12];
+    snprintf(buf, sizeof(buf), "0x%08X", addr_);
+    found_address_sensor_->publish_state(buf);
+  }
+
+  register_services_();
+  history_begin_();
+  rf_slot_ = scheduler_->add_client(addr_, [this](const heater_state_t &s) { on_passive_state_(s); });
+  if (rf_slot_ == RfScheduler::kNone) {
+    ESP_LOGE(TAG, "Too many heaters on one CC1101 (max %u) — 0x%08X disabled", RfScheduler::kMaxClients, addr_);
+    cc1101_ok_ = false;
+    return;
+  }
+  persist_restore_(rf_slot_);
+  if (!cc1101_ok_) return;
+  start_rf_();
+}
+
+void DieselHeaterRFComponent::bind_cycle_() {
+  cycle_.bind(this, heater_, &link_policy_, coex_, &radio_owner_()->cal_mark_);
+  cycle_.set_address(addr_);
+  cycle_.set_cal_cache(cal_cache_);
+}
+
+void DieselHeaterRFComponent::register_services_() {
+  register_service(&DieselHeaterRFComponent::on_power, service_prefix_ + "power");
+  register_service(&DieselHeaterRFComponent::on_emergency_stop, service_prefix_ + "emergency_stop");
+  register_service(&DieselHeaterRFComponent::on_get_status, service_prefix_ + "get_status");
+  register_service(&DieselHeaterRFComponent::on_mode, service_prefix_ + "mode");
+  register_service(&DieselHeaterRFComponent::on_temp_up, service_prefix_ + "temp_up");
+  register_service(&DieselHeaterRFComponent::on_temp_down, service_prefix_ + "temp_down");
+  register_service(&DieselHeaterRFComponent::on_set_value, service_prefix_ + "set_value", {"value"});
+  register_service(&DieselHeaterRFComponent::on_find_address, service_prefix_ + "find_address");
+  register_service(&DieselHeaterRFComponent::on_ping, service_prefix_ + "ping");
+  register_service(&DieselHeaterRFComponent::on_dump_capture, service_prefix_ + "dump_capture");
+  register_service(&DieselHeaterRFComponent::on_dump_history, service_prefix_ + "dump_history");
+}
+
+void DieselHeaterRFComponent::start_rf_() {
+  // Track WiFi activity to avoid overlapping RF with WiFi TX bursts — once per radio,
+  // the coexistence scheduler is shared with the other heaters on it.
+  if (owns_radio_()) esp_event_handler_register(WIFI_EVENT, ESP_EVENT_ANY_ID, &on_wifi_event_, coex_);
+  esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP, &on_ip_event_, this);
+  // WiFi connect, DHCP, mDNS and the API handshake all cause sustained TX activity that
+  // can brownout-reset the CC1101 — RF stays off until startup_gate_poll_() sees the link
+  // settle, bounded by startup_max_wait_ms_.
+  startup_ms_ = wifi_window_start_ms_ = millis();
+  if (owns_radio_()) coex_->hold_startup(startup_ms_ + startup_max_wait_ms_);
+}
+
+// Called from loop() until the gate opens. Each condition is cheap; the CC1101 check is
+// a single burst read, done last and only once the link is quiet.
+void DieselHeaterRFComponent::startup_gate_poll_() {
+  uint32_t now = millis();
+  if (now - startup_ms_ >= startup_max_wait_ms_) {
+    open_startup_gate_("max wait reached");
     return;
   }
 
-  // Track WiFi activity to avoid overlapping RF with WiFi TX bursts.
-  esp_event_handler_register(WIFI_EVENT, ESP_EVENT_ANY_ID, &on_wifi_event_, this);
-  // Mark WiFi as busy for the first 25 s — WiFi connects, DHCP, mDNS, API handshake
-  // all cause sustained TX activity that can brownout-reset the CC1101.
-  wifi_busy_until_ms_ = millis() + 25000;
+  uint32_t events = coex_->events();
+  if (now - wifi_window_start_ms_ >= kStartupWindowMs) {
+    wifi_rate_ok_ = events - wifi_window_events_ <= kStartupMaxEvents;
+    wifi_window_events_ = events;
+    wifi_window_start_ms_ = now;
+  }
+
+  if (api::global_api_server != nullptr && api::global_api_server->is_connected()) {
+    if (api_connected_ms_ == 0) api_connected_ms_ = now;
+  } else {
+    api_connected_ms_ = 0;
+  }
 
-  // Delay the first poll by 25 s to let WiFi fully settle before first SPI access.
-  set_timeout(25000, [this]() { pending_cmds_.push_back(HEATER_CMD_GET_STATUS); });
+  if (!got_ip_ || api_connected_ms_ == 0 || now - api_connected_ms_ < kApiSettleMs || !wifi_rate_ok_) return;
+
+  if (!owns_radio_()) {
+    // The radio owner runs the CC1101 check; follow it once it is through.
+    if (!radio_parent_->startup_gate_) open_startup_gate_("network ready, shared CC1101 ready");
+    return;
+  }
+  if (!cc1101_config_ok_) {
+    if (!scheduler_->try_acquire_idle(rf_slot_)) return;  // debug capture / scan has the chip
+    HeaterRadio::Health health = heater_->checkHealth(true);
+    if (health == HeaterRadio::HEALTH_BUSY) return;  // not idle yet
+    if (health == HeaterRadio::HEALTH_LOST) {
+      ESP_LOGW(TAG, "Startup: %s config check failed — reinitialising", heater_->chipName());
+      heater_->reinitRadio();
+      return;
+    }
+    cc1101_config_ok_ = true;
+  }
+  open_startup_gate_("network ready, CC1101 config OK");
+}
+
+void DieselHeaterRFComponent::open_startup_gate_(const char *reason) {
+  uint32_t now = millis();
+  startup_gate_ = false;
+  if (owns_radio_()) coex_->release_startup();  // WiFi and publish holds still pending stay
+  cycle_.push(HEATER_CMD_GET_STATUS, 0);
+  last_poll_ms_ = last_tick_ms_ = stats_hour_start_ms_ = now;
+  ESP_LOGI(TAG, "RF enabled %lu ms after boot (%s; ip=%d api=%d wifi_events=%lu)", (unsigned long)now, reason,
+           (int)got_ip_, (int)(api_connected_ms_ != 0), (unsigned long)coex_->events());
 }
 
 void DieselHeaterRFComponent::update() {
   if (!cc1101_ok_) return;
   if (!initial_update_seen_) { initial_update_seen_ = true; return; }
+  if (afc_dirty_ && millis() - afc_saved_ms_ >= kAfcSaveIntervalMs) afc_save_();
+  if (persist_dirty_ && millis() - persist_saved_ms_ >= kPersistIntervalMs) persist_save_(false);
+  if (last_poll_ms_ == 0) return;  // startup hold-off — open_startup_gate_() sets last_poll_ms_ and queues the first poll
   if (debug_mode_ || find_address_active_) return;
 
+  // Poll (and health check) only when the interval for the current heater state has
+  // elapsed. Offline probing keeps its own backoff timing (cycle_.probe_due()); the
+  // health check still runs once per regular poll interval while offline.
+  uint32_t now = millis();
+  uint32_t interval = cycle_.offline() ? user_poll_interval_ms_ : poll_interval_for_state_();
+  if (now - last_poll_ms_ < interval) {
+    account_poll_stats_(false);
+    return;
+  }
+  if (!cycle_.offline() && passive_listen_ && last_state_ms_ != 0 && now - last_state_ms_ < interval) {
+    // State already fresh from passive RX (or a recent command ACK) — skip this poll.
+    polls_skipped_++;
+    last_poll_ms_ = last_state_ms_;
+    account_poll_stats_(false);
+    ESP_LOGD(TAG, "Poll skipped — state is %lus old (%lu passive states, %lu polls skipped)",
+             (unsigned long)((now - last_state_ms_) / 1000), (unsigned long)passive_states_,
+             (unsigned long)polls_skipped_);
+    return;
+  }
+
   // Never touch SPI during an active TX/RX cycle — any SPI transaction during
   // active RX risks bit-flipping the R/W bit (e.g. read 0x84 → write 0x04),
   // which would silently corrupt CC1101 registers and break packet reception.
-  if (poll_phase_ != PollPhase::IDLE) return;
-
-  // Verify CC1101 is still configured (SYNC1 should be 0x7E).
-  // Only check when IDLE — reading registers while CC1101 is in RX/TX returns the STATUS byte
-  // instead of the register value, producing false-alarm reinits (e.g. SYNC1=0xD3 = STATUS byte).
-  uint8_t marcstate = heater_->getMarcstate();
-  if (marcstate != 0x01) return;  // not IDLE — skip health check
-  uint8_t sync1 = heater_->readConfigReg(0x04);
-  if (sync1 != 0x7E) {
-    ESP_LOGW(TAG, "CC1101 config lost (SYNC1=0x%02X) — reinitialising", sync1);
-    heater_->reinitRadio();
-    sync1 = heater_->readConfigReg(0x04);
-    if (sync1 != 0x7E) {
-      ESP_LOGE(TAG, "CC1101 reinit failed (SYNC1=0x%02X) — check VCC decoupling", sync1);
-      if (transceiver_status_sensor_ != nullptr)
-        transceiver_status_sensor_->publish_state("ERROR: CC1101 not responding after reinit");
-      return;
+  // Retried on the next tick.
+  if (cycle_.listening()) return;
+  last_poll_ms_ = now;
+
+  // CC1101 health check — done by the radio owner only, and only while no other heater
+  // sharing the chip is mid-cycle (the grant is returned by loop()).
+  if (owns_radio_() && scheduler_->try_acquire_idle(rf_slot_)) {
+    // Passive RX is ours to interrupt — drop to IDLE for the health check; loop() re-arms it.
+    if (passive_rx_active_) {
+      heater_->idle();
+      passive_rx_active_ = false;
+    }
+
+    // Verify the transceiver is still configured (CC1101: SYNC1 should be 0x7E).
+    // Only checked when idle — reading CC1101 registers in RX/TX returns the STATUS byte
+    // instead of the register value, producing false-alarm reinits (e.g. SYNC1=0xD3 = STATUS byte).
+    HeaterRadio::Health health = heater_->checkHealth(false);
+    if (health == HeaterRadio::HEALTH_BUSY) return;  // not idle — skip health check
+    if (health == HeaterRadio::HEALTH_LOST) {
+      ESP_LOGW(TAG, "%s config lost — reinitialising", heater_->chipName());
+      heater_->reinitRadio();
+      if (heater_->checkHealth(false) != HeaterRadio::HEALTH_OK) {
+        char regs[128];
+        heater_->dumpConfig(regs, sizeof(regs));
+        ESP_LOGE(TAG, "%s reinit failed (%s) — check VCC decoupling", heater_->chipName(), regs);
+        if (transceiver_status_sensor_ != nullptr)
+          transceiver_status_sensor_->publish_state(std::string("ERROR: ") + heater_->chipName() +
+                                                    " not responding after reinit");
+        return;
+      }
+      ESP_LOGI(TAG, "%s reinit OK", heater_->chipName());
     }
-    ESP_LOGI(TAG, "CC1101 reinit OK");
   }
 
-  if (offline_) {
-    // In offline mode probing is timed by next_backoff_probe_ms_, not by update_interval.
-    // update() still fires on the normal schedule (for the CC1101 health check above),
-    // but only enqueues a probe when the backoff window has elapsed.
-    if (millis() < next_backoff_probe_ms_) return;
+  // In offline mode probing is timed by the cycle's backoff, not by update_interval.
+  // update() still reaches this point once per poll interval (for the CC1101 health
+  // check above), but only enqueues a probe when the backoff window has elapsed.
+  if (!cycle_.probe_due(millis())) {
+    account_poll_stats_(false);
+    return;
   }
 
   // HEATER_CMD_GET_STATUS (0x23) is a status-poll: requests a state packet from the heater.
   // The heater responds to any valid command regardless of its WOR sleep state, so no
   // special wake sequence is needed — this is purely a periodic state refresh.
-  pending_cmds_.push_back(HEATER_CMD_GET_STATUS);
+  cycle_.push(HEATER_CMD_GET_STATUS, 0);
+  account_poll_stats_(true);
+}
+
+// Poll interval for the last known heater state. Off and Running are the steady states;
+// everything between them (startup, warming, pre-run, shutdown, cooling) is a transition
+// where the user is waiting for feedback.
+uint32_t DieselHeaterRFComponent::poll_interval_for_state_() const {
+  uint32_t ms = 0;
+  if (last_state_ms_ != 0) {
+    switch (pending_state_.state) {
+      case HEATER_STATE_OFF:
+        ms = poll_off_ms_;
+        break;
+      case HEATER_STATE_RUNNING:
+        ms = poll_running_ms_;
+        break;
+      default:
+        ms = poll_transition_ms_;
+        break;
+    }
+  }
+  return ms != 0 ? ms : user_poll_interval_ms_;
+}
+
+// Called once per update() tick. Publishes polls saved against the flat baseline
+// at the end of each hour.
+void DieselHeaterRFComponent::account_poll_stats_(bool polled) {
+  uint32_t now = millis();
+  if (user_poll_interval_ms_ > 0) baseline_polls_ += (float)(now - last_tick_ms_) / user_poll_interval_ms_;
+  last_tick_ms_ = now;
+  if (polled) scheduled_polls_++;
+  if (now - stats_hour_start_ms_ < 3600000) return;
+
+  int32_t saved = (int32_t)lroundf(baseline_polls_) - (int32_t)scheduled_polls_;
+  polls_saved_total_ += saved;
+  ESP_LOGI(TAG, "Polling: %lu polls last hour, %ld saved vs %lus interval (%ld total, %lu skipped passively)",
+           (unsigned long)scheduled_polls_, (long)saved, (unsigned long)(user_poll_interval_ms_ / 1000),
+           (long)polls_saved_total_, (unsigned long)polls_skipped_);
+  if (polls_saved_sensor_ != nullptr) polls_saved_sensor_->publish_state(saved);
+  stats_hour_start_ms_ = now;
+  baseline_polls_ = 0.0f;
+  scheduled_polls_ = 0;
 }
 
 // ---------------------------------------------------------------------------
 // Service handlers — enqueue commands; loop() drives all RF activity
 // ---------------------------------------------------------------------------
 
-// Reset backoff to step 0 when the user explicitly sends a command while offline,
-// so probing becomes aggressive again while the user is actively trying to connect.
-void DieselHeaterRFComponent::reset_backoff_if_offline_() {
-  if (!offline_) return;
-  backoff_step_ = 0;
-  next_backoff_probe_ms_ = millis() + kBackoffMs[0];
-  ESP_LOGI(TAG, "User command while offline — resetting backoff to %lus",
-           (unsigned long)(kBackoffMs[0] / 1000));
-}
-
 void DieselHeaterRFComponent::on_power() {
-  if (offline_) {
+  if (cycle_.offline()) {
     ESP_LOGW(TAG, "Service: power ignored — heater offline");
+    reject_command_("power");
     return;
   }
   uint8_t s = pending_state_.state;
   if (s != HEATER_STATE_OFF && s != HEATER_STATE_RUNNING) {
     ESP_LOGW(TAG, "Service: power blocked — heater in transitional state %s (0x%02X)", state_to_string(s), s);
+    reject_command_("power");
     return;
   }
-  power_target_on_ = (s == HEATER_STATE_OFF);
-  ESP_LOGI(TAG, "Service: power %s", power_target_on_ ? "on" : "off");
-  pending_cmds_.push_back(HEATER_CMD_POWER);
+  cycle_.expect_power(s == HEATER_STATE_OFF);
+  ESP_LOGI(TAG, "Service: power %s", s == HEATER_STATE_OFF ? "on" : "off");
+  queue_command_(HEATER_CMD_POWER, "power");
 }
 
 void DieselHeaterRFComponent::on_emergency_stop() {
-  if (offline_) {
+  if (cycle_.offline()) {
     ESP_LOGW(TAG, "Service: emergency stop ignored — heater offline");
+    reject_command_("emergency_stop");
     return;
   }
   uint8_t s = pending_state_.state;
-  if (s == HEATER_STATE_OFF) {
-    ESP_LOGI(TAG, "Service: emergency stop — heater already off");
-    return;
-  }
-  if (s == HEATER_STATE_SHUTDOWN || s == HEATER_STATE_SHUTTING_DOWN || s == HEATER_STATE_COOLING) {
-    ESP_LOGI(TAG, "Service: emergency stop — heater already shutting down (%s)", state_to_string(s));
+  if (s == HEATER_STATE_OFF || s == HEATER_STATE_SHUTDOWN || s == HEATER_STATE_SHUTTING_DOWN ||
+      s == HEATER_STATE_COOLING) {
+    ESP_LOGI(TAG, "Service: emergency stop — heater already %s", s == HEATER_STATE_OFF ? "off" : "shutting down");
+    if (CommandRecord *r = new_command_("emergency_stop")) complete_command_(*r, "confirmed");
     return;
   }
-  power_target_on_ = false;
+  cycle_.expect_power(false);
   ESP_LOGW(TAG, "Service: EMERGENCY STOP from state %s (0x%02X)", state_to_string(s), s);
-  pending_cmds_.push_back(HEATER_CMD_POWER);
+  queue_command_(HEATER_CMD_POWER, "emergency_stop");
 }
 
 void DieselHeaterRFComponent::on_get_status() {
   ESP_LOGI(TAG, "Service: get_status");
-  reset_backoff_if_offline_();
-  pending_cmds_.push_back(HEATER_CMD_GET_STATUS);
+  cycle_.reset_backoff(millis());  // the user is actively trying to connect
+  queue_command_(HEATER_CMD_GET_STATUS, "get_status");
 }
 
 void DieselHeaterRFComponent::on_mode() {
-  if (offline_) {
+  if (cycle_.offline()) {
     ESP_LOGW(TAG, "Service: mode ignored — heater offline");
+    reject_command_("mode");
     return;
   }
-  mode_toggle_expected_ = !pending_state_.autoMode;
-  ESP_LOGI(TAG, "Service: mode toggle (target=%s)", mode_toggle_expected_ ? "auto" : "manual");
-  pending_cmds_.push_back(HEATER_CMD_MODE);
+  cycle_.expect_mode(!pending_state_.autoMode);
+  ESP_LOGI(TAG, "Service: mode toggle (target=%s)", pending_state_.autoMode ? "manual" : "auto");
+  queue_command_(HEATER_CMD_MODE, "mode");
 }
 
 void DieselHeaterRFComponent::on_temp_up() {
-  if (offline_) {
+  if (cycle_.offline()) {
     ESP_LOGW(TAG, "Service: temp_up ignored — heater offline");
+    reject_command_("temp_up");
     return;
   }
   ESP_LOGI(TAG, "Service: temp/freq up");
-  pending_cmds_.push_back(HEATER_CMD_UP);
+  queue_command_(HEATER_CMD_UP, "temp_up");
 }
 
 void DieselHeaterRFComponent::on_temp_down() {
-  if (offline_) {
+  if (cycle_.offline()) {
     ESP_LOGW(TAG, "Service: temp_down ignored — heater offline");
+    reject_command_("temp_down");
     return;
   }
   ESP_LOGI(TAG, "Service: temp/freq down");
-  pending_cmds_.push_back(HEATER_CMD_DOWN);
+  queue_command_(HEATER_CMD_DOWN, "temp_down");
 }
 
 void DieselHeaterRFComponent::on_set_value(float value) {
-  if (offline_) {
+  if (cycle_.offline()) {
     ESP_LOGW(TAG, "Service: set_value ignored — heater offline");
+    reject_command_("set_value");
     return;
   }
   if (pending_state_.autoMode) {
@@ -215,341 +427,671 @@ void DieselHeaterRFComponent::on_set_value(float value) {
     if (value > 35.0f) value = 35.0f;
     int8_t target = static_cast<int8_t>(value);
     ESP_LOGI(TAG, "Service: set_value %d°C (auto mode, current=%d°C)", target, pending_state_.setpoint);
-    target_value_ = static_cast<float>(target);
+    cycle_.set_value_target(static_cast<float>(target));
   } else {
     // Manual mode: clamp to valid pump frequency range and round to 0.1 Hz
     if (value < 1.7f) value = 1.7f;
     if (value > 5.5f) value = 5.5f;
     float target = roundf(value * 10.0f) / 10.0f;
     ESP_LOGI(TAG, "Service: set_value %.1f Hz (manual mode, current=%.1f Hz)", target, pending_state_.pumpFreq);
-    target_value_ = target;
+    cycle_.set_value_target(target);
   }
-  pending_cmds_.push_back(CMD_SET_VALUE);
+  queue_command_(CommandCycle::CMD_SET_VALUE, "set_value");
 }
 
 void DieselHeaterRFComponent::on_ping() {
   ESP_LOGI(TAG, "Service: ping — immediate status poll");
-  reset_backoff_if_offline_();
-  pending_cmds_.insert(pending_cmds_.begin(), HEATER_CMD_GET_STATUS);
+  cycle_.reset_backoff(millis());
+  queue_command_(HEATER_CMD_GET_STATUS, "ping", true);
+}
+
+void DieselHeaterRFComponent::on_dump_capture() {
+  ESP_LOGI(TAG, "Service: dump_capture — %u frames retained, %lu captured, %lu dropped before streaming",
+           capture_.size(), (unsigned long)capture_.total(), (unsigned long)capture_.dropped());
+  for (uint8_t i = 0; i < capture_.size(); i++)
+    log_capture_frame_(capture_.at(i));
+}
+
+void DieselHeaterRFComponent::on_dump_history() {
+  if (!history_.enabled()) {
+    ESP_LOGW(TAG, "Service: dump_history — history disabled (history_size < %u bytes or allocation failed)",
+             (unsigned)(2 * HistoryRing::kBlockSize));
+    return;
+  }
+  std::vector<uint8_t> out(history_.export_size());
+  history_.export_to(out.data(), out.size());
+  uint32_t now_s = millis() / 1000;
+  ESP_LOGI(TAG, "Service: dump_history — %lu samples (%lu since boot) from uptime %lus, %u of %u bytes",
+           (unsigned long)history_.samples(), (unsigned long)history_.total(), (unsigned long)history_.oldest_s(),
+           (unsigned)out.size(), (unsigned)history_.capacity());
+  char addr[11];
+  snprintf(addr, sizeof(addr), "0x%08X", addr_);
+  // Custom services can't return data, so the whole history goes out as one event.
+  fire_homeassistant_event("esphome.diesel_heater_rf_history", {
+      {"heater", addr},
+      {"format", "1"},
+      {"uptime_s", std::to_string(now_s)},
+      {"samples", std::to_string(history_.samples())},
+      {"oldest_s", std::to_string(history_.oldest_s())},
+      {"data", base64_encode(out.data(), out.size())},
+  });
+  coex_->on_publish(millis(), 1);
 }
 
 void DieselHeaterRFComponent::on_find_address() {
   if (find_address_active_) return;
-  ESP_LOGI(TAG, "Service: find_address — scanning (up to 10 attempts of 1.5s each)");
+  ESP_LOGI(TAG, "Service: find_address — listening for %lus", (unsigned long)(kDiscoveryWindowMs / 1000));
   if (found_address_sensor_ != nullptr)
     found_address_sensor_->publish_state("Searching...");
-  find_address_attempts_ = 0;
-  find_address_last_ms_ = 0;
+  discovered_count_ = 0;
+  discovery_rx_started_ = false;
   find_address_active_ = true;
 }
 
 // ---------------------------------------------------------------------------
-// Isolated TX path — noinline so changes elsewhere in loop() don't shift
-// the compiled binary layout of delay/reinit/sendCommand/startRx.
-// ---------------------------------------------------------------------------
-void __attribute__((noinline)) DieselHeaterRFComponent::execute_tx_burst_(uint8_t cmd) {
-  delay(50);
-  heater_->reinitRadio();
-  heater_->sendCommand(cmd, addr_, 14, current_seq_);
-  // After sendCommand, CC1101 is in FSTXON with synth locked.
-  // startRxFromFstxon() enters RX directly without recalibration — preserves
-  // VCO tuning from the TX burst.  startRx() would SIDLE first, killing the
-  // synth lock and forcing recalibration that can drift the RX frequency.
-  heater_->startRxFromFstxon();
-  rx_window_end_ms_ = millis() + 1000;
-  next_rxb_check_ms_ = millis() + 200;
-  poll_phase_ = PollPhase::RX_LISTEN;
-}
-
-// ---------------------------------------------------------------------------
-// Main loop — processes pending_cmds_ queue; one command per state-machine cycle
+// Main loop — the command cycle first; one command per state-machine cycle
 // ---------------------------------------------------------------------------
 
 void DieselHeaterRFComponent::loop() {
   if (!cc1101_ok_) return;
 
-  // ── RX_LISTEN: non-blocking GDO2 poll ────────────────────────────────────
-  if (poll_phase_ == PollPhase::RX_LISTEN) {
-    // Hot path: GDO2 GPIO only — zero SPI, zero bus contention with active RX.
-    bool gdo2 = heater_->isRxAvailable();
-    // Warm path: check RXBYTES via SPI every ~200ms to catch overflow/stale packets.
-    // Infrequent enough to avoid timing interference with incoming packets.
-    if (!gdo2 && millis() > next_rxb_check_ms_) {
-      next_rxb_check_ms_ = millis() + 200;
-      uint8_t rxb = heater_->getRxBytes();
-      if (rxb >= 26) {
-        if (rxb >= 64) {
-          heater_->startRx();
-          return;
-        }
-        gdo2 = true;
-      }
-    }
-    if (gdo2) {
-      heater_state_t state;
-      if (heater_->readPacket(&state)) {
-        // ACK received — defer sensor publishing to a later loop() iteration
-        // so WiFi TX from API state pushes doesn't overlap with RF activity.
-        poll_phase_ = PollPhase::IDLE;
-        cmd_fail_count_ = 0;
-
-        if (offline_) {
-          offline_ = false;
-          backoff_step_ = 0;
-          ESP_LOGI(TAG, "Heater back online — resuming normal polling");
-        }
-        // Save state for deferred publishing — don't publish now (WiFi TX during RF settle).
-        pending_state_ = state;
-        pending_publish_ = true;
-
-        // MODE is a toggle: only pop when auto_mode actually flipped
-        if (current_cmd_ == HEATER_CMD_MODE && state.autoMode != mode_toggle_expected_) {
-          ESP_LOGD(TAG, "MODE: toggle not confirmed (auto_mode=%d, expected=%d) — retrying",
-                   (int)state.autoMode, (int)mode_toggle_expected_);
-          return;
-        }
-
-        if (!pending_cmds_.empty())
-          pending_cmds_.erase(pending_cmds_.begin());
-      } else {
-        // Packet in FIFO but wrong address or bad CRC — restart RX, keep window
-        heater_->startRx();
-      }
-      return;
-    }
+  // Debug mode switched off — restore IOCFG2 and leave RX before normal operation resumes.
+  if (capture_rx_active_ && !debug_mode_) {
+    heater_->stopRawCapture();
+    capture_rx_active_ = false;
+  }
 
-    if (millis() > rx_window_end_ms_) {
-      if (heater_->isRxAvailable()) return;  // last-chance GDO2 check
-
-      cmd_fail_count_++;
-      if (cmd_fail_count_ >= 12) {
-        cmd_fail_count_ = 0;
-        heater_->endTxBurst();  // SIDLE
-
-        if (current_cmd_ != HEATER_CMD_GET_STATUS) {
-          // Action command exhausted 12 attempts — prepend GET_STATUS to verify heater state.
-          pending_cmds_.insert(pending_cmds_.begin(), HEATER_CMD_GET_STATUS);
-          poll_phase_ = PollPhase::IDLE;
-          return;
-        }
-
-        // GET_STATUS exhausted 12 attempts — check registers, then go offline.
-        pending_cmds_.clear();
-        uint8_t sync1 = heater_->readConfigReg(0x04);
-        uint8_t iocfg2 = heater_->readConfigReg(0x00);
-        uint8_t freq2 = heater_->readConfigReg(0x0D);
-        uint8_t freq1 = heater_->readConfigReg(0x0E);
-        uint8_t mdmcfg4 = heater_->readConfigReg(0x10);
-        uint8_t post_ms = heater_->getMarcstate();
-        bool regs_ok = (sync1 == 0x7E) && (iocfg2 == 0x07) && (freq2 == freq2_) && (freq1 == freq1_) && (mdmcfg4 == 0xF8);
-        if (!regs_ok) {
-          ESP_LOGW(TAG, "12 failures + register corruption (SYNC1=0x%02X IOCFG2=0x%02X FREQ2=0x%02X FREQ1=0x%02X MDMCFG4=0x%02X MS=0x%02X) — reinitialising",
-                   sync1, iocfg2, freq2, freq1, mdmcfg4, post_ms);
-          heater_->reinitRadio();
-          post_ms = heater_->getMarcstate();
-          ESP_LOGI(TAG, "Post-reinit MARCSTATE=0x%02X (expect 0x01)", post_ms);
-          poll_phase_ = PollPhase::IDLE;
-          return;
-        }
-        ESP_LOGE(TAG, "12 failures, regs: SYNC1=0x%02X IOCFG2=0x%02X FREQ2=0x%02X FREQ1=0x%02X MDMCFG4=0x%02X MS=0x%02X — heater unreachable",
-                 sync1, iocfg2, freq2, freq1, mdmcfg4, post_ms);
-        poll_phase_ = PollPhase::IDLE;
-        if (offline_) {
-          if (backoff_step_ < kBackoffSteps - 1) backoff_step_++;  // disabled for debugging
-          next_backoff_probe_ms_ = millis() + kBackoffMs[backoff_step_];
-          ESP_LOGI(TAG, "Heater offline — next probe in %lus (step %d/%d)",
-                   (unsigned long)(kBackoffMs[backoff_step_] / 1000), backoff_step_ + 1, (int)kBackoffSteps);
-        } else {
-          offline_ = true;
-          backoff_step_ = 0;
-          next_backoff_probe_ms_ = millis() + kBackoffMs[0];
-          if (state_sensor_ != nullptr) state_sensor_->publish_state("Offline");
-          ESP_LOGE(TAG, "Heater offline — first probe in %lus",
-                   (unsigned long)(kBackoffMs[0] / 1000));
-        }
-        return;
-      }
+  // ── RX_LISTEN: non-blocking GDO2 poll of the last burst's RX window ─────────
+  if (cycle_.loop_rx()) return;
 
-      // RX timeout, not yet exhausted — go IDLE so the unified TX path retransmits.
-      // Command stays at front of pending_cmds_; cmd_fail_count_ > 0 signals retransmit.
-      poll_phase_ = PollPhase::IDLE;
-    }
-    return;
-  }
+  // Cycle done — hand the shared radio to the next heater that wants it.
+  release_radio_if_done_();
+
+  if (startup_gate_) startup_gate_poll_();
 
   // ── Debug mode: raw packet capture ───────────────────────────────────────
   if (debug_mode_ && !find_address_active_) {
+    if (!scheduler_->acquire(rf_slot_, true)) return;
     uint32_t now = millis();
 
     // Every 10 s: read back key CC1101 registers; reinit only if in IDLE and SYNC1 is wrong.
+    // Capture is paused for the dump (registers only read reliably in IDLE) and re-armed below.
     if (now - debug_reg_dump_ms_ >= 10000) {
-      uint8_t marcstate = heater_->getMarcstate();
-      uint8_t sync1 = heater_->readConfigReg(0x04);
-      if (marcstate == 0x01 && sync1 != 0x7E) {
-        ESP_LOGW(TAG, "CC1101 config lost in debug mode (SYNC1=0x%02X) — reinitialising", sync1);
+      if (capture_rx_active_) {
+        heater_->stopRawCapture();
+        capture_rx_active_ = false;
+      }
+      HeaterRadio::Health health = heater_->checkHealth(false);
+      if (health == HeaterRadio::HEALTH_LOST) {
+        ESP_LOGW(TAG, "%s config lost in debug mode — reinitialising", heater_->chipName());
         heater_->reinitRadio();
-        sync1 = heater_->readConfigReg(0x04);
-        marcstate = heater_->getMarcstate();
+        health = heater_->checkHealth(false);
       }
-      if (marcstate == 0x01) {
-        uint8_t freq2     = heater_->readConfigReg(0x0D);
-        uint8_t freq1_reg = heater_->readConfigReg(0x0E);
-        uint8_t freq0     = heater_->readConfigReg(0x0F);
-        uint8_t mdmcfg4   = heater_->readConfigReg(0x10);
-        uint8_t mdmcfg3   = heater_->readConfigReg(0x11);
-        uint8_t mdmcfg2   = heater_->readConfigReg(0x12);
-        uint8_t sync0     = heater_->readConfigReg(0x05);
-        ESP_LOGI(TAG, "CC1101 regs: FREQ=0x%02X%02X%02X (want 0x10B09E) MDMCFG4=0x%02X MDMCFG3=0x%02X (want 0xF8/0x93) MDMCFG2=0x%02X (want 0x13) SYNC=0x%02X%02X (want 0x7E3C) MARCSTATE=0x%02X",
-                 freq2, freq1_reg, freq0, mdmcfg4, mdmcfg3, mdmcfg2, sync1, sync0, marcstate);
+      if (health != HeaterRadio::HEALTH_BUSY) {
+        char regs[128];
+        heater_->dumpConfig(regs, sizeof(regs));
+        ESP_LOGI(TAG, "%s regs: %s", heater_->chipName(), regs);
       } else {
-        ESP_LOGD(TAG, "CC1101 reg dump skipped — MARCSTATE=0x%02X (not IDLE, reads unreliable)", marcstate);
+        ESP_LOGD(TAG, "%s reg dump skipped — not idle, reads unreliable", heater_->chipName());
       }
       debug_reg_dump_ms_ = now;
     }
 
-    if (now - debug_last_ms_ < 200) return;
-
-    char raw[64];
-    uint8_t len = 0;
-    heater_->receiveRaw(raw, &len, 1000);
-    debug_last_ms_ = millis();
+    if (!capture_rx_active_) {
+      heater_->startRawCapture();
+      capture_rx_active_ = true;
+      passive_rx_active_ = false;
+    }
 
-    if (len > 0) {
-      char hex[196] = {};
-      for (int i = 0; i < len; i++)
-        snprintf(hex + i * 3, 4, "%02X ", (uint8_t) raw[i]);
-      const char *label = (len == 26) ? ", heater state" : (len == 12) ? ", remote command" : ", unexpected length";
-      ESP_LOGI(TAG, "RF RAW [%d bytes%s]: %s", len, label, hex);
-    } else {
-      ESP_LOGI(TAG, "RF RAW: no packet in 1s window");
+    if (heater_->isRxAvailable()) {
+      CaptureFrame f;
+      int8_t freq_est;
+      if (heater_->readRawFrame(f.data, &f.len, &freq_est)) {
+        f.t_ms = now;
+        f.freq_est = freq_est;
+        f.rssi = f.len >= 2 ? HeaterRadio::rssiToDbm(f.data[f.len - 2]) : 0;
+        f.lqi = f.data[f.len - 1];
+        capture_.push(f);
+      }
+      heater_->startRx();  // re-arm before any formatting/logging
+      return;
     }
+
+    // Stream one record per iteration while the CC1101 listens — logging no longer
+    // opens a window in which frames are missed.
+    if (const CaptureFrame *f = capture_.pop())
+      log_capture_frame_(*f);
     return;
   }
 
-  // ── Find address scan ─────────────────────────────────────────────────────
+  // ── Find address scan — non-blocking, same GDO2/RXBYTES polling as RX_LISTEN ──
   if (find_address_active_) {
+    if (!scheduler_->acquire(rf_slot_, true)) return;
     uint32_t now = millis();
-    if (now - find_address_last_ms_ < 200) return;
+    if (!discovery_rx_started_) {
+      if (capture_rx_active_) {  // debug capture re-arms itself once discovery ends
+        heater_->stopRawCapture();
+        capture_rx_active_ = false;
+      }
+      heater_->startRx();
+      discovery_rx_started_ = true;
+      passive_rx_active_ = false;
+      discovery_end_ms_ = now + kDiscoveryWindowMs;
+      next_rxb_check_ms_ = now + 200;
+    }
 
-    uint32_t addr = heater_->findAddress(1500);
-    find_address_last_ms_ = millis();
-    find_address_attempts_++;
+    bool avail = heater_->isRxAvailable();
+    if (!avail && now > next_rxb_check_ms_) {
+      next_rxb_check_ms_ = now + 200;
+      uint8_t rxb = heater_->getRxBytes();
+      if (rxb >= 64) {
+        heater_->startRx();
+      } else if (rxb >= HeaterProtocol::kStateRxLen) {
+        avail = true;
+      }
+    }
+    if (avail) {
+      uint32_t addr;
+      int16_t rssi;
+      uint8_t len;
+      if (heater_->readAnyPacket(&addr, &rssi, &len) && addr != 0)
+        discovery_record_(addr, rssi, len == HeaterProtocol::kStateRxLen);
+      heater_->startRx();
+    }
 
-    if (addr != 0) {
-      char buf[12];
-      snprintf(buf, sizeof(buf), "0x%08X", addr);
-      ESP_LOGI(TAG, "Found heater address: %s — update heater_address substitution and re-flash", buf);
-      if (found_address_sensor_ != nullptr)
-        found_address_sensor_->publish_state(buf);
-      find_address_active_ = false;
-    } else if (find_address_attempts_ >= 10) {
-      ESP_LOGW(TAG, "No heater found after %d attempts", find_address_attempts_);
-      if (found_address_sensor_ != nullptr)
-        found_address_sensor_->publish_state("Not found");
+    if ((int32_t)(now - discovery_end_ms_) >= 0) {
+      heater_->idle();
       find_address_active_ = false;
+      publish_discovery_table_();
     }
     return;
   }
 
   // ── Deferred sensor publishing — fires once per RX success, when RF is idle.
-  // publish_heater_state_() sets publish_settle_ms_ so WiFi TX from API pushes
-  // has time to complete before the next RF operation.
-  if (pending_publish_) {
+  // publish_heater_state_() ends with a coex_ hold sized by the messages it sent, so
+  // WiFi TX from API pushes has time to complete before the next RF operation. Held back while a set_value
+  // pipeline is running so the steps go out back-to-back; published once it finishes.
+  if (pending_publish_ && !cycle_.pipelining()) {
     pending_publish_ = false;
     publish_heater_state_();
     return;  // yield to ESPHome event loop — let WiFi flush before next RF
   }
 
+  // ── Passive listening — RX between our own commands, zero airtime ──────────
+  // Run by the radio owner for every heater on the chip; packets are routed by address.
+  if (passive_listen_ && owns_radio_() && !startup_gate_ && passive_listen_poll_()) return;
+
   // ── IDLE: process next command from queue ─────────────────────────────────
-  if (pending_cmds_.empty() || addr_ == 0) return;
-
-  // Wait for WiFi to settle before starting RF — WiFi TX causes 3.3V rail droops
-  // that brownout-reset the CC1101. This covers WiFi scans, reconnects, and the
-  // settle period after our own sensor publishes.
-  if (!is_wifi_quiet_() && cmd_fail_count_ == 0) return;
-
-  uint8_t cmd = pending_cmds_.front();
-
-  // CMD_SET_VALUE is a pseudo-command — evaluate target vs current state and insert
-  // the appropriate UP/DOWN step at the front; re-evaluated after each state response
-  // until the target is reached.
-  if (cmd == CMD_SET_VALUE) {
-    if (pending_state_.autoMode) {
-      int8_t target = static_cast<int8_t>(target_value_);
-      if (pending_state_.setpoint == target) {
-        pending_cmds_.erase(pending_cmds_.begin());
-        ESP_LOGI(TAG, "set_value: target %d°C reached", target);
-        return;
-      }
-      uint8_t step = (pending_state_.setpoint < target) ? HEATER_CMD_UP : HEATER_CMD_DOWN;
-      ESP_LOGD(TAG, "set_value: setpoint %d→%d, queuing %s", pending_state_.setpoint, target,
-               step == HEATER_CMD_UP ? "UP" : "DOWN");
-      pending_cmds_.insert(pending_cmds_.begin(), step);
+  if (cycle_.empty() || addr_ == 0) {
+    if (light_sleep_) light_sleep_if_idle_();
+    return;
+  }
+  cycle_.loop_tx();
+}
+
+// ---------------------------------------------------------------------------
+// Passive listening — returns true if a packet was handled this iteration.
+// Same GDO2 hot path / RXBYTES warm path as RX_LISTEN. The read is address-agnostic
+// and the scheduler routes each state packet to the heater component it belongs to;
+// unknown addresses and the remote's own 12-byte commands are dropped.
+// Passive RX only runs while no heater wants the radio and yields as soon as one does.
+// ---------------------------------------------------------------------------
+bool DieselHeaterRFComponent::passive_listen_poll_() {
+  if (passive_rx_active_ && scheduler_->contended(rf_slot_)) {
+    heater_->idle();
+    passive_rx_active_ = false;
+    wor_armed_ = false;
+    scheduler_->release(rf_slot_);
+    return false;
+  }
+  if (!passive_rx_active_) {
+    if (!scheduler_->try_acquire_idle(rf_slot_)) return false;
+    passive_rx_arm_();
+    passive_rx_active_ = true;
+    return false;
+  }
+  if (wor_period_us_ != 0 && !wor_armed_ && (int32_t)(millis() - wor_follow_until_ms_) >= 0) {
+    passive_rx_arm_();  // follow-up window over — back to sniffing
+    return false;
+  }
+  bool avail = heater_->isRxAvailable();
+  // The RXBYTES fallback is an SPI read, which would wake a sniffing chip — GDO2 only then.
+  if (!avail && !wor_armed_ && millis() > next_rxb_check_ms_) {
+    next_rxb_check_ms_ = millis() + 200;
+    uint8_t rxb = heater_->getRxBytes();
+    if (rxb >= 64) {
+      heater_->startRx();
+      return false;
+    }
+    avail = rxb >= HeaterProtocol::kStateRxLen;
+  }
+  if (!avail) return false;
+
+  heater_state_t state;
+  uint32_t addr;
+  bool ok = heater_->readPacket(&state, &addr);
+  if (wor_armed_) {
+    // A sniff caught a packet — usually the remote's command; the reply follows within ~1 s.
+    wor_wakes_++;
+    wor_follow_until_ms_ = millis() + wor_follow_ms_;
+    wor_armed_ = false;
+  }
+  heater_->startRx();
+  next_rxb_check_ms_ = millis() + 200;
+  return ok && scheduler_->dispatch(addr, state);
+}
+
+// Passive RX entry: WOR sniffing when configured and no follow-up window is open, full
+// RX otherwise (or when the chip has no WOR mode).
+void DieselHeaterRFComponent::passive_rx_arm_() {
+  uint32_t now = millis();
+  wor_armed_ = wor_period_us_ != 0 && (int32_t)(now - wor_follow_until_ms_) >= 0 &&
+               heater_->startWor(wor_period_us_, wor_rx_time_);
+  if (!wor_armed_) heater_->startRx();
+  next_rxb_check_ms_ = now + 200;
+}
+
+// Light sleep while the chip sniffs and nothing else needs the CPU: no command, publish or
+// RX window pending, debug capture and discovery off. GDO2 (a caught packet) or the timer
+// wakes the ESP32; millis() keeps counting across the sleep. The cap keeps the rest of
+// ESPHome (and WiFi) running at least once a second.
+void DieselHeaterRFComponent::light_sleep_if_idle_() {
+  if (!wor_armed_ || !passive_rx_active_ || cycle_.listening() || pending_publish_ || debug_mode_ ||
+      find_address_active_ || startup_gate_ || heater_->isRxAvailable())
+    return;
+  uint32_t now = millis();
+  uint32_t interval = cycle_.offline() ? user_poll_interval_ms_ : poll_interval_for_state_();
+  uint32_t until_poll = now - last_poll_ms_ >= interval ? 0 : interval - (now - last_poll_ms_);
+  uint32_t sleep_ms = std::min(until_poll, kMaxLightSleepMs);
+  if (sleep_ms < 20) return;  // not worth the wake-up cost
+  esp_sleep_enable_timer_wakeup((uint64_t)sleep_ms * 1000);
+  esp_light_sleep_start();
+  light_sleeps_++;
+  light_sleep_ms_ += millis() - now;
+}
+
+// State packet for our address heard by the radio owner's passive RX.
+void DieselHeaterRFComponent::on_passive_state_(const heater_state_t &state) {
+  passive_states_++;
+  cycle_.on_state_heard(state);
+  ESP_LOGD(TAG, "Passive state 0x%08X: %s (%d dBm)", addr_, state_to_string(state.state), state.rssi);
+  pending_state_ = state;
+  pending_publish_ = true;
+  last_state_ms_ = millis();
+  history_record_(state);
+  persist_state_received_();
+}
+
+// Radio grant is held for one TX/RX cycle, or for as long as debug capture, a discovery
+// scan or passive RX keeps the chip in RX.
+void DieselHeaterRFComponent::release_radio_if_done_() {
+  if (scheduler_->holds(rf_slot_) && !cycle_.listening() && !debug_mode_ && !find_address_active_ &&
+      !passive_rx_active_)
+    scheduler_->release(rf_slot_);
+}
+
+// ---------------------------------------------------------------------------
+// CommandCycle host side — instrumentation, command records, deferred publishing
+// ---------------------------------------------------------------------------
+void DieselHeaterRFComponent::cycle_sending(uint32_t id, uint32_t queued_ms, bool retransmit) {
+  if (!retransmit) {
+    rf_stats_[STAT_QUEUE_WAIT].add(millis() - queued_ms);
+    rf_stats_[STAT_WIFI_WAIT].add(coex_->take_wait_ms());
+  }
+  if (CommandRecord *r = command_record_(id)) {
+    if (r->first_tx_ms == 0) r->first_tx_ms = millis();
+    r->attempts++;
+  }
+  passive_rx_active_ = false;  // reinitRadio() in the TX path takes the chip out of RX
+}
+
+void DieselHeaterRFComponent::cycle_sent(uint32_t reinit_ms) {
+  rf_stats_[STAT_REINIT].add(reinit_ms);
+  rf_stats_[STAT_AIRTIME].add(heater_->getLastBurstWallUs() / 1000);
+}
+
+void DieselHeaterRFComponent::cycle_acked(const heater_state_t &state, uint32_t id, uint8_t attempts,
+                                          uint32_t ack_delay_ms) {
+  if (CommandRecord *r = command_record_(id))
+    if (r->ack_ms == 0) r->ack_ms = millis();
+  rf_stats_[STAT_ACK_DELAY].add(ack_delay_ms);
+  rf_stats_[STAT_ATTEMPTS].add(attempts);
+  // Save state for deferred publishing — don't publish now (WiFi TX during RF settle).
+  pending_state_ = state;
+  pending_publish_ = true;
+  last_state_ms_ = millis();
+  history_record_(state);
+  // Chip is IDLE after readPacket() — snapshot the calibration the burst just used.
+  heater_->getFscal(&fscal_[0], &fscal_[1], &fscal_[2]);
+  fscal_freq_ = radio_freq_();
+  fscal_freqoff_ = cycle_.freq_offset();
+  fscal_valid_ = true;
+  persist_state_received_();
+}
+
+void DieselHeaterRFComponent::cycle_completed(uint32_t id, bool ok) {
+  if (CommandRecord *r = command_record_(id)) complete_command_(*r, ok ? "confirmed" : "failed");
+}
+
+void DieselHeaterRFComponent::cycle_set_value_reached(uint32_t elapsed_ms) {
+  if (set_value_time_sensor_ != nullptr) set_value_time_sensor_->publish_state(elapsed_ms / 1000.0f);
+}
+
+void DieselHeaterRFComponent::cycle_offline(bool first) {
+  if (!first) return;
+  if (state_sensor_ != nullptr) state_sensor_->publish_state("Offline");
+  publish_link_policy_();
+}
+
+void DieselHeaterRFComponent::cycle_latency(uint32_t ms) {
+  last_cmd_latency_ms_ = ms;
+  cmd_latency_avg_ms_ = cmd_latency_avg_ms_ == 0.0f ? last_cmd_latency_ms_
+                                                   : cmd_latency_avg_ms_ + 0.2f * (last_cmd_latency_ms_ - cmd_latency_avg_ms_);
+  ESP_LOGD(TAG, "0x%08X: command latency %lu ms (avg %.0f ms, radio wait %lu ms, %u heater(s) on CC1101)", addr_,
+           (unsigned long)last_cmd_latency_ms_, cmd_latency_avg_ms_, (unsigned long)scheduler_->last_wait_ms(rf_slot_),
+           scheduler_->size());
+}
+
+// ---------------------------------------------------------------------------
+// Command completion tracking
+// ---------------------------------------------------------------------------
+DieselHeaterRFComponent::CommandRecord *DieselHeaterRFComponent::new_command_(const char *name) {
+  CommandRecord *slot = &cmd_log_[0];
+  for (auto &r : cmd_log_) {
+    if (r.id == 0) {
+      slot = &r;
+      break;
+    }
+    if ((int32_t)(r.queued_ms - slot->queued_ms) < 0) slot = &r;
+  }
+  if (slot->id != 0)
+    ESP_LOGW(TAG, "Command #%lu (%s) still pending — dropped from completion tracking", (unsigned long)slot->id,
+             slot->name);
+  *slot = {next_cmd_id_++, name, millis(), 0, 0, 0};
+  if (next_cmd_id_ == 0) next_cmd_id_ = 1;
+  return slot;
+}
+
+DieselHeaterRFComponent::CommandRecord *DieselHeaterRFComponent::command_record_(uint32_t id) {
+  if (id == 0) return nullptr;
+  for (auto &r : cmd_log_) {
+    if (r.id == id) return &r;
+  }
+  return nullptr;
+}
+
+void DieselHeaterRFComponent::queue_command_(uint8_t cmd, const char *name, bool front) {
+  CommandRecord *r = new_command_(name);
+  ESP_LOGD(TAG, "Command #%lu (%s) queued", (unsigned long)r->id, name);
+  cycle_.push(cmd, r->id, front);
+}
+
+void DieselHeaterRFComponent::reject_command_(const char *name) {
+  complete_command_(*new_command_(name), "rejected");
+}
+
+void DieselHeaterRFComponent::complete_command_(CommandRecord &r, const char *result) {
+  uint32_t now = millis();
+  uint32_t latency = now - r.queued_ms;
+  ESP_LOGI(TAG, "Command #%lu (%s) %s after %lu ms, %lu attempt(s)", (unsigned long)r.id, r.name, result,
+           (unsigned long)latency, (unsigned long)r.attempts);
+  for (auto *t : command_complete_triggers_) t->trigger(r.id, r.name, result, latency, r.attempts);
+  char addr[11];
+  snprintf(addr, sizeof(addr), "0x%08X", addr_);
+  auto since_queued = [&r](uint32_t t) { return t != 0 ? std::to_string(t - r.queued_ms) : std::string("-1"); };
+  fire_homeassistant_event("esphome.diesel_heater_rf_command", {
+      {"id", std::to_string(r.id)},
+      {"heater", addr},
+      {"command", r.name},
+      {"result", result},
+      {"latency_ms", std::to_string(latency)},
+      {"attempts", std::to_string(r.attempts)},
+      {"first_tx_ms", since_queued(r.first_tx_ms)},  // relative to the service call; -1 = never sent
+      {"ack_ms", since_queued(r.ack_ms)},
+  });
+  // The event is a WiFi TX like a sensor publish — same settle before the next RF.
+  coex_->on_publish(millis(), 1);
+  r.id = 0;
+}
+
+// ---------------------------------------------------------------------------
+// State history
+// ---------------------------------------------------------------------------
+void DieselHeaterRFComponent::history_begin_() {
+  if (history_size_ == 0) return;
+  RAMAllocator<uint8_t> allocator;  // PSRAM first, internal RAM as fallback
+  uint8_t *buf = allocator.allocate(history_size_);
+  if (buf == nullptr) {
+    ESP_LOGW(TAG, "History: could not allocate %lu bytes — disabled", (unsigned long)history_size_);
+    return;
+  }
+  history_.begin(buf, history_size_);
+  ESP_LOGI(TAG, "History: %u bytes, one sample per %lus", (unsigned)history_.capacity(),
+           (unsigned long)(history_interval_ms_ / 1000));
+}
+
+void DieselHeaterRFComponent::history_record_(const heater_state_t &state) {
+  if (!history_.enabled()) return;
+  uint32_t now = millis();
+  if (history_.total() != 0 && now - history_last_ms_ < history_interval_ms_) return;
+  history_last_ms_ = now;
+  history_.add(now / 1000, state);
+}
+
+// ---------------------------------------------------------------------------
+// Raw capture export — one CAP record per log line, see capture_ring.h for the layout.
+// ---------------------------------------------------------------------------
+void DieselHeaterRFComponent::log_capture_frame_(const CaptureFrame &f) {
+  static const char HEX_DIGITS[] = "0123456789ABCDEF";
+  uint8_t rec[CaptureRing::kMaxRecord];
+  size_t n = CaptureRing::encode(f, rec);
+  char hex[CaptureRing::kMaxRecord * 2 + 1];
+  for (size_t i = 0; i < n; i++) {
+    hex[i * 2] = HEX_DIGITS[rec[i] >> 4];
+    hex[i * 2 + 1] = HEX_DIGITS[rec[i] & 0x0F];
+  }
+  hex[n * 2] = '\0';
+  const char *label = f.len == HeaterProtocol::kStateRxLen    ? "heater state"
+                      : f.len == HeaterProtocol::kRemoteRxLen ? "remote command"
+                                                              : "unexpected length";
+  ESP_LOGD(TAG, "RF RAW [%d bytes, %s, %d dBm, CRC %s, FREQEST=%d]", f.len, label, f.rssi,
+           (f.lqi & 0x80) ? "OK" : "bad", f.freq_est);
+  ESP_LOGI(TAG, "CAP %s", hex);
+}
+
+// ---------------------------------------------------------------------------
+// Address discovery table
+// ---------------------------------------------------------------------------
+void DieselHeaterRFComponent::discovery_record_(uint32_t addr, int16_t rssi, bool from_heater) {
+  DiscoveredDevice *d = nullptr;
+  for (uint8_t i = 0; i < discovered_count_; i++) {
+    if (discovered_[i].addr == addr) { d = &discovered_[i]; break; }
+  }
+  if (d == nullptr) {
+    if (discovered_count_ < kDiscoveryMax) {
+      d = &discovered_[discovered_count_++];
     } else {
-      float target = target_value_;
-      if (fabsf(pending_state_.pumpFreq - target) < 0.05f) {
-        pending_cmds_.erase(pending_cmds_.begin());
-        ESP_LOGI(TAG, "set_value: target %.1f Hz reached", target);
-        return;
+      // Table full — evict the weakest single-packet entry (most likely noise or a distant unit)
+      for (uint8_t i = 0; i < kDiscoveryMax; i++) {
+        if (discovered_[i].packets == 1 && (d == nullptr || discovered_[i].rssi < d->rssi)) d = &discovered_[i];
       }
-      uint8_t step = (pending_state_.pumpFreq < target) ? HEATER_CMD_UP : HEATER_CMD_DOWN;
-      ESP_LOGD(TAG, "set_value: pumpFreq %.1f→%.1f, queuing %s", pending_state_.pumpFreq, target,
-               step == HEATER_CMD_UP ? "UP" : "DOWN");
-      pending_cmds_.insert(pending_cmds_.begin(), step);
+      if (d == nullptr) return;
     }
+    *d = {addr, rssi, 0, 0, false, false};
+    ESP_LOGD(TAG, "Discovery: new address 0x%08X (%d dBm, %s)", addr, rssi, from_heater ? "heater" : "remote");
+  }
+  if (rssi > d->rssi) d->rssi = rssi;
+  if (d->packets < 0xFFFF) d->packets++;
+  d->last_seen_ms = millis();
+  if (from_heater) d->from_heater = true; else d->from_remote = true;
+}
+
+void DieselHeaterRFComponent::publish_discovery_table_() {
+  if (discovered_count_ == 0) {
+    ESP_LOGW(TAG, "No heater found in %lus window", (unsigned long)(kDiscoveryWindowMs / 1000));
+    if (found_address_sensor_ != nullptr)
+      found_address_sensor_->publish_state("Not found");
     return;
   }
+  // Heater replies first, then most packets, then strongest — entry 0 is the best candidate.
+  std::sort(discovered_, discovered_ + discovered_count_, [](const DiscoveredDevice &a, const DiscoveredDevice &b) {
+    if (a.from_heater != b.from_heater) return a.from_heater;
+    if (a.packets != b.packets) return a.packets > b.packets;
+    return a.rssi > b.rssi;
+  });
 
-  // Pre-send idempotency checks — if GET_STATUS revealed the heater already
-  // reached the expected state, skip the command instead of retrying with a new seq#.
-  if (cmd == HEATER_CMD_POWER) {
-    bool effectively_on = (pending_state_.state != HEATER_STATE_OFF &&
-                           pending_state_.state != HEATER_STATE_SHUTDOWN &&
-                           pending_state_.state != HEATER_STATE_SHUTTING_DOWN &&
-                           pending_state_.state != HEATER_STATE_COOLING);
-    if (effectively_on == power_target_on_) {
-      ESP_LOGI(TAG, "POWER: heater already %s — skipping", effectively_on ? "on" : "off");
-      pending_cmds_.erase(pending_cmds_.begin());
-      return;
+  char table[256];
+  size_t pos = 0;
+  uint32_t now = millis();
+  for (uint8_t i = 0; i < discovered_count_; i++) {
+    const DiscoveredDevice &d = discovered_[i];
+    const char *kind = d.from_heater ? (d.from_remote ? "heater+remote" : "heater") : "remote";
+    ESP_LOGI(TAG, "Found address 0x%08X: %d dBm, %u packets, %s, last seen %lums ago", d.addr, d.rssi,
+             d.packets, kind, (unsigned long)(now - d.last_seen_ms));
+    if (pos < sizeof(table)) {
+      int n = snprintf(table + pos, sizeof(table) - pos, "%s0x%08X (%d dBm, %u pkts, %s)", i ? "; " : "",
+                       d.addr, d.rssi, d.packets, kind);
+      if (n > 0) pos += n;
     }
   }
-  if (cmd == HEATER_CMD_MODE && pending_state_.autoMode == mode_toggle_expected_) {
-    ESP_LOGI(TAG, "MODE: already %s — skipping", pending_state_.autoMode ? "auto" : "manual");
-    pending_cmds_.erase(pending_cmds_.begin());
+  ESP_LOGI(TAG, "Best candidate: 0x%08X — update heater_address substitution and re-flash", discovered_[0].addr);
+  if (found_address_sensor_ != nullptr)
+    found_address_sensor_->publish_state(table);
+}
+
+// ---------------------------------------------------------------------------
+// Frequency-offset tracking — the filter is CommandCycle's; persisted here
+// ---------------------------------------------------------------------------
+void DieselHeaterRFComponent::cycle_freq_offset_changed() {
+  afc_dirty_ = true;
+  if (millis() - afc_saved_ms_ >= kAfcSaveIntervalMs) afc_save_();
+}
+
+void DieselHeaterRFComponent::afc_save_() {
+  int8_t off = cycle_.freq_offset();
+  afc_pref_.save(&off);
+  afc_saved_ms_ = millis();
+  afc_dirty_ = false;
+}
+
+// ---------------------------------------------------------------------------
+// Persistence across reboots
+// ---------------------------------------------------------------------------
+PersistedState DieselHeaterRFComponent::persist_snapshot_() const {
+  PersistedState p{};
+  p.addr = addr_;
+  p.seq = next_seq_;
+  p.fscal_valid = fscal_valid_;
+  for (int i = 0; i < 3; i++) p.fscal[i] = fscal_[i];
+  p.fscal_freq = fscal_freq_;
+  p.fscal_freqoff = fscal_freqoff_;
+  p.state_valid = state_valid_;
+  p.state = pending_state_;
+  p.state_uptime_ms = last_state_ms_;
+  p.link = link_policy_.snapshot();
+  return p;
+}
+
+// Warm reset: the RTC record is exact. Cold boot: NVS, with seq resuming at the ceiling.
+// A restored state is not published — it only seeds pending_state_ so the service guards
+// (power/mode idempotency, set_value direction) work before the first poll completes.
+void DieselHeaterRFComponent::persist_restore_(uint8_t rtc_index) {
+  rtc_index_ = rtc_index;
+  persist_pref_ = global_preferences->make_preference<PersistedState>(fnv1_hash("diesel_heater_rf_state") ^ addr_);
+
+  PersistedState nvs{};
+  bool nvs_ok = persist_pref_.load(&nvs) && nvs.addr == addr_;
+  const RtcRecord &rtc = s_rtc_records[rtc_index_];
+  bool rtc_ok = esp_reset_reason() != ESP_RST_POWERON && rtc.magic == kRtcMagic && rtc.crc == rtc_crc(rtc) &&
+                rtc.data.addr == addr_;
+
+  const PersistedState *src = rtc_ok ? &rtc.data : nvs_ok ? &nvs : nullptr;
+  if (src == nullptr) {
+    ESP_LOGI(TAG, "No persisted state for 0x%08X — starting fresh", addr_);
     return;
   }
-
-  // Unified TX path — handles both first burst and retransmit.
-    // GET_STATUS: new seq# every 3 attempts (0,3,6), retransmit on others.
-  // Action cmds: new seq# only on attempt 0, retransmit on 1-8.
-  bool is_retransmit = cmd == HEATER_CMD_GET_STATUS ? (cmd_fail_count_ % 3) != 0 : cmd_fail_count_ > 0;
-  if (!is_retransmit) {
-    current_cmd_ = cmd;
-    current_seq_ = heater_->nextSeq();
-  } else {
+  next_seq_ = src->seq;
+  seq_ceiling_ = nvs_ok ? nvs.seq : next_seq_;
+  seqs_left_ = nvs_ok ? (uint8_t)(seq_ceiling_ - next_seq_) : 0;
+  if (seqs_left_ > kSeqReserve) seqs_left_ = 0;  // ceiling behind the RTC counter — move it on first use
+  if (src->state_valid) {
+    pending_state_ = src->state;
+    state_valid_ = true;
+  }
+  // A calibration is only valid for the frequency it was measured at. If the configured
+  // frequency or the restored FREQOFF differ, leave the cache empty so the first burst
+  // runs calibrateNow() instead of tuning the VCO with another band's values.
+  if (src->fscal_valid && src->fscal_freq == radio_freq_() && src->fscal_freqoff == cycle_.freq_offset()) {
+    fscal_valid_ = true;
+    for (int i = 0; i < 3; i++) fscal_[i] = src->fscal[i];
+    fscal_freq_ = src->fscal_freq;
+    fscal_freqoff_ = src->fscal_freqoff;
+    if (owns_radio_()) heater_->setFscal(fscal_[0], fscal_[1], fscal_[2]);
+  } else if (src->fscal_valid) {
+    ESP_LOGI(TAG, "Saved FSCAL was measured at FREQ=0x%06X FREQOFF=%d (now 0x%06X/%d) — recalibrating",
+             (unsigned)src->fscal_freq, src->fscal_freqoff, (unsigned)radio_freq_(), cycle_.freq_offset());
   }
+  link_policy_.restore(src->link);
+  ESP_LOGI(TAG, "Restored from %s: seq=%u state=%s (received %lus into previous boot) FSCAL=%02X/%02X/%02X%s",
+           rtc_ok ? "RTC" : "NVS", next_seq_, src->state_valid ? state_to_string(src->state.state) : "none",
+           (unsigned long)(src->state_uptime_ms / 1000), fscal_[0], fscal_[1], fscal_[2],
+           fscal_valid_ ? "" : " (defaults)");
+  persist_rtc_();
+}
 
-  execute_tx_burst_(cmd);
+void DieselHeaterRFComponent::persist_rtc_() {
+  RtcRecord &r = s_rtc_records[rtc_index_];
+  r.data = persist_snapshot_();
+  r.crc = rtc_crc(r);
+  r.magic = kRtcMagic;
+}
+
+void DieselHeaterRFComponent::persist_save_(bool sync) {
+  PersistedState p = persist_snapshot_();
+  p.seq = seq_ceiling_;
+  persist_pref_.save(&p);
+  if (sync) global_preferences->sync();
+  persist_saved_ms_ = millis();
+  persist_dirty_ = false;
+}
+
+void DieselHeaterRFComponent::persist_state_received_() {
+  state_valid_ = true;
+  persist_dirty_ = true;
+  persist_rtc_();
+}
+
+uint8_t DieselHeaterRFComponent::take_seq_() {
+  if (seqs_left_ == 0) {
+    // Reserve the next block in NVS before the first seq of it goes on air.
+    seq_ceiling_ = next_seq_ + kSeqReserve;
+    seqs_left_ = kSeqReserve;
+    persist_save_(true);
+  }
+  seqs_left_--;
+  uint8_t seq = next_seq_++;
+  persist_rtc_();
+  return seq;
 }
 
 // ---------------------------------------------------------------------------
-// WiFi event handler — extends wifi_busy_until_ms_ when WiFi does anything
-// that causes sustained TX: scanning, (re)connecting, or receiving disconnect.
-// Runs in the WiFi task context — only touch atomic/trivial members.
+// WiFi event handler — holds RF off when WiFi does anything that causes
+// sustained TX: scanning, (re)connecting, or receiving disconnect.
+// Runs in the WiFi task context — arg is the CoexScheduler, whose event side is atomic.
 // ---------------------------------------------------------------------------
 void DieselHeaterRFComponent::on_wifi_event_(void *arg, esp_event_base_t base, int32_t id, void *data) {
-  auto *self = static_cast<DieselHeaterRFComponent *>(arg);
   uint32_t settle = 0;
   switch (id) {
     case WIFI_EVENT_SCAN_DONE:        settle = 200; break;  // scan burst just ended
     case WIFI_EVENT_STA_CONNECTED:    settle = 500; break;  // DHCP + API handshake coming
     case WIFI_EVENT_STA_DISCONNECTED: settle = 300; break;  // reconnect attempt imminent
-    default: return;  // ignore routine events
+    default: break;  // routine event — counted for the startup gate only
   }
-  uint32_t now = (uint32_t)(esp_timer_get_time() / 1000LL);
-  uint32_t deadline = now + settle;
-  if ((int32_t)(deadline - self->wifi_busy_until_ms_) > 0)
-    self->wifi_busy_until_ms_ = deadline;
+  static_cast<CoexScheduler *>(arg)->on_wifi_event((uint32_t)(esp_timer_get_time() / 1000LL), settle);
+}
+
+void DieselHeaterRFComponent::on_ip_event_(void *arg, esp_event_base_t base, int32_t id, void *data) {
+  static_cast<DieselHeaterRFComponent *>(arg)->got_ip_ = true;
 }
 
 // ---------------------------------------------------------------------------
@@ -563,33 +1105,174 @@ void DieselHeaterRFComponent::publish_heater_state_() {
 
   // Publish only changed values — each publish_state() triggers an API message over WiFi.
   if (state_sensor_        && (!state_sensor_->has_state() || state_sensor_->state != state_str))
-    state_sensor_->publish_state(state_str);
-  if (voltage_sensor_      && (!voltage_sensor_->has_state() || voltage_sensor_->state != s.voltage))
-    voltage_sensor_->publish_state(s.voltage);
-  if (ambient_temp_sensor_ && (!ambient_temp_sensor_->has_state() || (int)ambient_temp_sensor_->state != s.ambientTemp))
-    ambient_temp_sensor_->publish_state(s.ambientTemp);
-  if (case_temp_sensor_    && (!case_temp_sensor_->has_state() || (int)case_temp_sensor_->state != s.caseTemp))
-    case_temp_sensor_->publish_state(s.caseTemp);
+    publish_(state_sensor_, state_str);
+  publish_banded_(voltage_sensor_, s.voltage, deadbands_.voltage);
+  publish_banded_(ambient_temp_sensor_, s.ambientTemp, deadbands_.ambient);
+  publish_banded_(case_temp_sensor_, s.caseTemp, deadbands_.case_temp);
   if (setpoint_sensor_     && (!setpoint_sensor_->has_state() || (int)setpoint_sensor_->state != s.setpoint))
-    setpoint_sensor_->publish_state(s.setpoint);
+    publish_(setpoint_sensor_, s.setpoint);
   if (heat_level_sensor_   && (!heat_level_sensor_->has_state() || (int)heat_level_sensor_->state != s.power))
-    heat_level_sensor_->publish_state(s.power);
-  if (pump_freq_sensor_    && (!pump_freq_sensor_->has_state() || fabsf(pump_freq_sensor_->state - s.pumpFreq) >= 0.05f))
-    pump_freq_sensor_->publish_state(s.pumpFreq);
-  if (rssi_sensor_         && (!rssi_sensor_->has_state() || (int)rssi_sensor_->state != s.rssi))
-    rssi_sensor_->publish_state(s.rssi);
+    publish_(heat_level_sensor_, s.power);
+  publish_banded_(pump_freq_sensor_, s.pumpFreq, deadbands_.pump_freq);
+  publish_banded_(rssi_sensor_, s.rssi, deadbands_.rssi);
   if (auto_mode_sensor_    && (!auto_mode_sensor_->has_state() || auto_mode_sensor_->state != (bool)s.autoMode))
-    auto_mode_sensor_->publish_state(s.autoMode);
+    publish_(auto_mode_sensor_, s.autoMode);
   const char *err_str = error_to_string(s.errorCode);
   if (error_sensor_        && (!error_sensor_->has_state() || error_sensor_->state != err_str))
-    error_sensor_->publish_state(err_str);
+    publish_(error_sensor_, err_str);
+  publish_packed_state_(s);
 
   ESP_LOGD(TAG, "state=%s mode=%s power=%d setpoint=%d°C pumpFreq=%.1fHz ambient=%d°C voltage=%.1fV error=%s",
            state_str, s.autoMode ? "auto" : "manual",
            s.power, s.setpoint, s.pumpFreq, s.ambientTemp, s.voltage, err_str);
 
-  // Publishing triggers WiFi TX — mark settle period before next RF.
-  publish_settle_ms_ = millis() + kPublishSettleMs;
+  float offset_hz = cycle_.freq_offset() * CommandCycle::kAfcHzPerStep;
+  if (frequency_offset_sensor_ && (!frequency_offset_sensor_->has_state() || frequency_offset_sensor_->state != offset_hz))
+    publish_(frequency_offset_sensor_, offset_hz);
+  publish_link_policy_();
+  float cal_count = heater_->getCalCount();
+  if (calibrations_sensor_ && (!calibrations_sensor_->has_state() || calibrations_sensor_->state != cal_count))
+    publish_(calibrations_sensor_, cal_count);
+  float burst_cpu_us = heater_->getLastBurstCpuUs();
+  if (burst_cpu_time_sensor_ && burst_cpu_us != 0 &&
+      (!burst_cpu_time_sensor_->has_state() || burst_cpu_time_sensor_->state != burst_cpu_us))
+    publish_(burst_cpu_time_sensor_, burst_cpu_us);
+  if (millis() - rf_stats_published_ms_ >= kRfStatsPublishMs) publish_rf_stats_();
+  if (!first_state_reported_) {
+    first_state_reported_ = true;
+    ESP_LOGI(TAG, "First heater state %lu ms after boot", (unsigned long)last_state_ms_);
+    if (first_state_time_sensor_ != nullptr) publish_(first_state_time_sensor_, last_state_ms_ / 1000.0f);
+  }
+  if (command_latency_sensor_ && last_cmd_latency_ms_ != 0 &&
+      (!command_latency_sensor_->has_state() || command_latency_sensor_->state != last_cmd_latency_ms_))
+    publish_(command_latency_sensor_, last_cmd_latency_ms_);
+
+  end_publish_round_();
+}
+
+// Outside the deadband when the value moved more than band from the last one sent. The
+// margin absorbs float noise, so a 0.2 V band passes 12.1 → 12.4 V but not 12.2 → 12.4 V.
+static bool outside_band(float last, float value, float band) { return fabsf(value - last) > band + 0.001f; }
+
+void DieselHeaterRFComponent::publish_banded_(sensor::Sensor *sensor, float value, float band) {
+  if (sensor == nullptr) return;
+  if (!sensor->has_state() || outside_band(sensor->state, value, band))
+    publish_(sensor, value);
+  else if (sensor->state != value)
+    publishes_suppressed_++;
+}
+
+// All fields in one JSON text state — one API message instead of up to ten. Published when
+// a discrete field changed or an analog one left its deadband (bands relative to the last
+// packed state sent).
+void DieselHeaterRFComponent::publish_packed_state_(const heater_state_t &s) {
+  if (packed_state_sensor_ == nullptr) return;
+  const heater_state_t &p = packed_sent_;
+  bool send = !packed_sent_valid_ || s.state != p.state || s.autoMode != p.autoMode || s.power != p.power ||
+              s.setpoint != p.setpoint || s.errorCode != p.errorCode ||
+              outside_band(p.voltage, s.voltage, deadbands_.voltage) ||
+              outside_band(p.ambientTemp, s.ambientTemp, deadbands_.ambient) ||
+              outside_band(p.caseTemp, s.caseTemp, deadbands_.case_temp) ||
+              outside_band(p.pumpFreq, s.pumpFreq, deadbands_.pump_freq) ||
+              outside_band(p.rssi, s.rssi, deadbands_.rssi);
+  if (!send) {
+    if (s.voltage != p.voltage || s.ambientTemp != p.ambientTemp || s.caseTemp != p.caseTemp ||
+        s.pumpFreq != p.pumpFreq || s.rssi != p.rssi)
+      publishes_suppressed_++;
+    return;
+  }
+  char buf[200];
+  snprintf(buf, sizeof(buf),
+           "{\"state\":\"%s\",\"auto\":%s,\"power\":%u,\"setpoint\":%d,\"pump\":%.1f,\"ambient\":%d,"
+           "\"case\":%u,\"voltage\":%.1f,\"error\":\"%s\",\"rssi\":%d}",
+           state_to_string(s.state), s.autoMode ? "true" : "false", s.power, s.setpoint, s.pumpFreq, s.ambientTemp,
+           s.caseTemp, s.voltage, error_to_string(s.errorCode), s.rssi);
+  publish_(packed_state_sensor_, buf);
+  packed_sent_ = s;
+  packed_sent_valid_ = true;
+}
+
+// Publishing triggers WiFi TX — hold RF for as long as the messages take to go out.
+void DieselHeaterRFComponent::end_publish_round_() {
+  coex_->on_publish(millis(), publish_msgs_);
+  publish_msgs_ = 0;
+}
+
+void DieselHeaterRFComponent::publish_rf_stats_() {
+  static const char *const kStatKeys[STAT_COUNT] = {"qwait", "wwait", "reinit", "air", "ack", "att"};
+  rf_stats_published_ms_ = millis();
+  for (uint8_t i = 0; i < STAT_COUNT; i++) {
+    if (rf_stat_sensors_[i] == nullptr || rf_stats_[i].count() == 0) continue;
+    float p90 = rf_stats_[i].percentile(90);
+    if (!rf_stat_sensors_[i]->has_state() || rf_stat_sensors_[i]->state != p90) publish_(rf_stat_sensors_[i], p90);
+  }
+  float p1 = heater_->getP1Timeouts(), p2 = heater_->getP2Timeouts(), uf = heater_->getTxUnderflows();
+  if (p1_timeouts_sensor_ && (!p1_timeouts_sensor_->has_state() || p1_timeouts_sensor_->state != p1))
+    publish_(p1_timeouts_sensor_, p1);
+  if (p2_timeouts_sensor_ && (!p2_timeouts_sensor_->has_state() || p2_timeouts_sensor_->state != p2))
+    publish_(p2_timeouts_sensor_, p2);
+  if (tx_underflows_sensor_ && (!tx_underflows_sensor_->has_state() || tx_underflows_sensor_->state != uf))
+    publish_(tx_underflows_sensor_, uf);
+  uint64_t rx_on_us = heater_->getRxOnUs();
+  if (rx_on_last_ms_ != 0 && rf_stats_published_ms_ != rx_on_last_ms_ && rx_on_us != 0) {
+    float pct = (float)(rx_on_us - rx_on_last_us_) / 10.0f / (float)(rf_stats_published_ms_ - rx_on_last_ms_);
+    if (rx_on_time_sensor_ != nullptr) publish_(rx_on_time_sensor_, roundf(pct * 10.0f) / 10.0f);
+    if (wor_period_us_ != 0)
+      ESP_LOGD(TAG, "WOR: RX on %.1f%%, %lu wakes, %lu light sleeps (%lu ms)", pct, (unsigned long)wor_wakes_,
+               (unsigned long)light_sleeps_, (unsigned long)light_sleep_ms_);
+  }
+  rx_on_last_us_ = rx_on_us;
+  rx_on_last_ms_ = rf_stats_published_ms_;
+  float suppressed = publishes_suppressed_;
+  if (suppressed_publishes_sensor_ &&
+      (!suppressed_publishes_sensor_->has_state() || suppressed_publishes_sensor_->state != suppressed))
+    publish_(suppressed_publishes_sensor_, suppressed);
+  float holds = coex_->waits();
+  if (wifi_holds_sensor_ && (!wifi_holds_sensor_->has_state() || wifi_holds_sensor_->state != holds))
+    publish_(wifi_holds_sensor_, holds);
+  ESP_LOGD(TAG,
+           "WiFi coex: %lu holds (%lu predicted, %lu forced), %lu ms total, max %lu ms; period %lu ms; "
+           "%lu publishes suppressed",
+           (unsigned long)coex_->waits(), (unsigned long)coex_->predicted_waits(),
+           (unsigned long)coex_->forced_grants(), (unsigned long)coex_->wait_total_ms(),
+           (unsigned long)coex_->wait_max_ms(), (unsigned long)coex_->period_ms(),
+           (unsigned long)publishes_suppressed_);
+  if (rf_stats_sensor_ == nullptr) return;
+
+  // {"qwait":[p50,p90,p99,n],...,"p1to":n,"p2to":n,"uflow":n}. Percentiles and counts grow
+  // without bound, so every write is checked: JSON that would exceed the 255-char state
+  // limit is not published at all rather than published truncated.
+  char buf[256];
+  size_t len = 0;
+  bool fits = true;
+  auto append = [&](int n) { fits = fits && n >= 0 && (size_t)n < sizeof(buf) - len; if (fits) len += n; };
+  buf[len++] = '{';
+  for (uint8_t i = 0; i < STAT_COUNT && fits; i++) {
+    const Histogram &h = rf_stats_[i];
+    append(snprintf(buf + len, sizeof(buf) - len, "\"%s\":[%lu,%lu,%lu,%lu],", kStatKeys[i],
+                    (unsigned long)h.percentile(50), (unsigned long)h.percentile(90),
+                    (unsigned long)h.percentile(99), (unsigned long)h.count()));
+  }
+  if (fits)
+    append(snprintf(buf + len, sizeof(buf) - len, "\"p1to\":%lu,\"p2to\":%lu,\"uflow\":%lu}",
+                    (unsigned long)heater_->getP1Timeouts(), (unsigned long)heater_->getP2Timeouts(),
+                    (unsigned long)heater_->getTxUnderflows()));
+  if (!fits) {
+    ESP_LOGW(TAG, "RF stats JSON exceeds %u chars, not published", (unsigned)(sizeof(buf) - 1));
+    return;
+  }
+  if (!rf_stats_sensor_->has_state() || rf_stats_sensor_->state != buf) publish_(rf_stats_sensor_, buf);
+}
+
+void DieselHeaterRFComponent::publish_link_policy_() {
+  if (link_policy_sensor_ == nullptr) return;
+  char buf[96];
+  snprintf(buf, sizeof(buf), "burst=%u rx=%lums gap=%lums ok=%d%% att=%.1f ack=%lums",
+           link_policy_.burst_packets(), (unsigned long)link_policy_.rx_window_ms(),
+           (unsigned long)link_policy_.retry_gap_ms(1), (int)(link_policy_.success_rate() * 100.0f),
+           link_policy_.attempts_per_ack(), (unsigned long)link_policy_.max_ack_delay_ms());
+  if (!link_policy_sensor_->has_state() || link_policy_sensor_->state != buf)
+    publish_(link_policy_sensor_, buf);
 }
 
 const char *DieselHeaterRFComponent::state_to_string(uint8_t state) {
@@ -1,32 +1,64 @@
 #pragma once
 
 #include <vector>
+#include <string>
 #include <cmath>
 #include "esphome/core/component.h"
+#include "esphome/core/automation.h"
+#include "esphome/core/hal.h"
 #include "esphome/core/log.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/preferences.h"
 #include "esphome/components/sensor/sensor.h"
 #include "esphome/components/text_sensor/text_sensor.h"
 #include "esphome/components/binary_sensor/binary_sensor.h"
 #include "esphome/components/api/custom_api_device.h"
+#include "esphome/components/api/api_server.h"
 #include "esp_event.h"
+#include "esp_netif.h"
 #include "esp_wifi.h"
 #include "esp_timer.h"
+#include "HeaterRadio.h"
 #include "DieselHeaterRF.h"
+#include "DieselHeaterSX1262.h"
+#include "link_policy.h"
+#include "capture_ring.h"
+#include "rf_scheduler.h"
+#include "coex_scheduler.h"
+#include "command_cycle.h"
+#include "persisted_state.h"
+#include "histogram.h"
+#include "history_ring.h"
 
 namespace esphome {
 namespace diesel_heater_rf {
 
-class DieselHeaterRFComponent : public PollingComponent, public api::CustomAPIDevice {
+// on_command_complete: id, command (service name), result ("confirmed", "failed",
+// "rejected"), latency_ms (service call → result), attempts (RF bursts sent)
+class CommandCompleteTrigger : public Trigger<uint32_t, std::string, std::string, uint32_t, uint32_t> {
  public:
-  // Pseudo-command: never sent over RF; consumed by loop() to drive set_value logic
-  static constexpr uint8_t CMD_SET_VALUE = 0xFE;
+  explicit CommandCompleteTrigger() {}
+};
+
+// Transceiver chip behind HeaterRadio — fixed at setup() by the radio owner.
+enum class RadioChip : uint8_t { CC1101, SX1262 };
 
+class DieselHeaterRFComponent : public PollingComponent, public api::CustomAPIDevice, protected CommandCycle::Host {
+ public:
   void set_heater_address(uint32_t addr) { addr_ = addr; }
   void set_sck_pin(uint8_t pin) { sck_pin_ = pin; }
   void set_miso_pin(uint8_t pin) { miso_pin_ = pin; }
   void set_mosi_pin(uint8_t pin) { mosi_pin_ = pin; }
   void set_cs_pin(uint8_t pin) { cs_pin_ = pin; }
-  void set_gdo2_pin(uint8_t pin) { gdo2_pin_ = pin; }
+  void set_gdo2_pin(uint8_t pin) { gdo2_pin_ = pin; }  // DIO1 on the SX1262
+  void set_transceiver(RadioChip chip) { radio_chip_ = chip; }
+  void set_busy_pin(uint8_t pin) { busy_pin_ = pin; }
+  void set_reset_pin(uint8_t pin) { reset_pin_ = pin; }
+  // SetDio3AsTcxoCtrl voltage code, DieselHeaterSX1262::kNoTcxo for a crystal.
+  void set_tcxo_voltage(uint8_t code) { tcxo_voltage_ = code; }
+  // Share the CC1101 owned by another heater component instead of driving our own.
+  void set_radio_parent(DieselHeaterRFComponent *parent) { radio_parent_ = parent; }
+  void set_service_prefix(const std::string &prefix) { service_prefix_ = prefix; }
 
   void set_state_sensor(text_sensor::TextSensor *s) { state_sensor_ = s; }
   void set_voltage_sensor(sensor::Sensor *s) { voltage_sensor_ = s; }
@@ -40,25 +72,72 @@ class DieselHeaterRFComponent : public PollingComponent, public api::CustomAPIDe
   void set_error_sensor(text_sensor::TextSensor *s) { error_sensor_ = s; }
   void set_found_address_sensor(text_sensor::TextSensor *s) { found_address_sensor_ = s; }
   void set_transceiver_status_sensor(text_sensor::TextSensor *s) { transceiver_status_sensor_ = s; }
+  void set_set_value_time_sensor(sensor::Sensor *s) { set_value_time_sensor_ = s; }
+  void set_set_value_pipelined(bool v) { cycle_.set_pipelined(v); }
+  void set_link_policy_sensor(text_sensor::TextSensor *s) { link_policy_sensor_ = s; }
+  void set_frequency_offset_sensor(sensor::Sensor *s) { frequency_offset_sensor_ = s; }
+  void set_frequency_tracking(bool v) { cycle_.set_freq_tracking(v); }
+  void set_passive_listen(bool v) { passive_listen_ = v; }
+  void set_wake_on_radio(uint32_t period_us, uint8_t rx_time, uint32_t follow_ms, bool light_sleep) {
+    wor_period_us_ = period_us;
+    wor_rx_time_ = rx_time;
+    wor_follow_ms_ = follow_ms;
+    light_sleep_ = light_sleep;
+  }
+  void set_rx_on_time_sensor(sensor::Sensor *s) { rx_on_time_sensor_ = s; }
+  void set_adaptive_tx(uint8_t min_burst, uint8_t max_burst, uint32_t min_rx_ms, uint32_t max_rx_ms,
+                       uint32_t max_retry_gap_ms) {
+    link_policy_.set_bounds(min_burst, max_burst, min_rx_ms, max_rx_ms, max_retry_gap_ms);
+  }
   void set_freq(uint8_t f2, uint8_t f1, uint8_t f0) { freq2_ = f2; freq1_ = f1; freq0_ = f0; }
   void set_cca_mode(uint8_t mode) { cca_mode_ = mode; }
   void set_tx_power(uint8_t p) { tx_power_ = p; }
   void set_debug_mode(bool v) { debug_mode_ = v; }
   bool is_debug_mode() const { return debug_mode_; }
-  void set_poll_interval_seconds(float seconds) {
-    user_poll_interval_ms_ = (uint32_t)(seconds * 1000.0f);
-    // Only restart poller if not in offline backoff — backoff is managed via
-    // next_backoff_probe_ms_, not via update_interval, to avoid duplicate timers.
-    if (!offline_) {
-      set_update_interval(user_poll_interval_ms_);
-      start_poller();
-    }
+  // Takes effect on the next update() tick — the poller itself runs at a fixed
+  // kPollTickMs and is never restarted (start_poller() would add a duplicate timer).
+  void set_poll_interval_seconds(float seconds) { user_poll_interval_ms_ = (uint32_t)(seconds * 1000.0f); }
+  // Per-state poll intervals; 0 = use the regular poll interval for that group.
+  void set_poll_schedule(uint32_t off_ms, uint32_t transition_ms, uint32_t running_ms) {
+    poll_off_ms_ = off_ms;
+    poll_transition_ms_ = transition_ms;
+    poll_running_ms_ = running_ms;
+  }
+  void set_polls_saved_sensor(sensor::Sensor *s) { polls_saved_sensor_ = s; }
+  void set_command_latency_sensor(sensor::Sensor *s) { command_latency_sensor_ = s; }
+  void set_first_state_time_sensor(sensor::Sensor *s) { first_state_time_sensor_ = s; }
+  void set_startup_max_wait(uint32_t ms) { startup_max_wait_ms_ = ms; }
+  void set_cache_calibration(bool v) { cal_cache_ = v; }
+  void set_calibrations_sensor(sensor::Sensor *s) { calibrations_sensor_ = s; }
+  void set_async_spi(bool v) { async_spi_ = v; }
+  void set_burst_cpu_time_sensor(sensor::Sensor *s) { burst_cpu_time_sensor_ = s; }
+  void add_command_complete_trigger(CommandCompleteTrigger *t) { command_complete_triggers_.push_back(t); }
+  // RF instrumentation histograms, in rf_stats_ order (see below)
+  enum RfStat : uint8_t { STAT_QUEUE_WAIT, STAT_WIFI_WAIT, STAT_REINIT, STAT_AIRTIME, STAT_ACK_DELAY, STAT_ATTEMPTS,
+                          STAT_COUNT };
+  void set_rf_stat_sensor(uint8_t stat, sensor::Sensor *s) {
+    if (stat < STAT_COUNT) rf_stat_sensors_[stat] = s;
   }
+  void set_p1_timeouts_sensor(sensor::Sensor *s) { p1_timeouts_sensor_ = s; }
+  void set_p2_timeouts_sensor(sensor::Sensor *s) { p2_timeouts_sensor_ = s; }
+  void set_tx_underflows_sensor(sensor::Sensor *s) { tx_underflows_sensor_ = s; }
+  void set_wifi_holds_sensor(sensor::Sensor *s) { wifi_holds_sensor_ = s; }
+  void set_suppressed_publishes_sensor(sensor::Sensor *s) { suppressed_publishes_sensor_ = s; }
+  void set_packed_state_sensor(text_sensor::TextSensor *s) { packed_state_sensor_ = s; }
+  void set_deadbands(float voltage, float ambient, float case_temp, float pump_freq, float rssi) {
+    deadbands_ = {voltage, ambient, case_temp, pump_freq, rssi};
+  }
+  void set_rf_stats_sensor(text_sensor::TextSensor *s) { rf_stats_sensor_ = s; }
+  void set_history_size(uint32_t bytes) { history_size_ = bytes; }
+  void set_history_interval(uint32_t ms) { history_interval_ms_ = ms; }
 
   void setup() override;
   void loop() override;
   void update() override;
-  float get_setup_priority() const override { return setup_priority::DATA; }
+  // Components sharing a radio set up after its owner, which creates the driver.
+  float get_setup_priority() const override {
+    return radio_parent_ != nullptr ? setup_priority::DATA - 1.0f : setup_priority::DATA;
+  }
 
   // HA API services
   void on_power();
@@ -71,30 +150,98 @@ class DieselHeaterRFComponent : public PollingComponent, public api::CustomAPIDe
   void on_set_value(float value);
   void on_find_address();
   void on_ping();
+  void on_dump_capture();
+  void on_dump_history();
 
  protected:
-  DieselHeaterRF *heater_{nullptr};
+  HeaterRadio *heater_{nullptr};
+  RadioChip radio_chip_{RadioChip::CC1101};
   uint32_t addr_{0};
   uint8_t sck_pin_{HEATER_SCK_PIN};
   uint8_t miso_pin_{HEATER_MISO_PIN};
   uint8_t mosi_pin_{HEATER_MOSI_PIN};
   uint8_t cs_pin_{HEATER_SS_PIN};
   uint8_t gdo2_pin_{HEATER_GDO2_PIN};
+  uint8_t busy_pin_{SX1262_BUSY_PIN};
+  uint8_t reset_pin_{SX1262_RST_PIN};
+  uint8_t tcxo_voltage_{0x02};  // 1.8 V, T3-S3
+
+  // Multi-heater: one component per heater address. The first owns the CC1101 driver and
+  // the RfScheduler and CoexScheduler; the others point at them via radio_parent_. Sequence
+  // numbers, queues, backoff and AFC state stay per component; readPacket()'s address filter
+  // and FSCTRL0 are re-applied before each of our bursts.
+  DieselHeaterRFComponent *radio_parent_{nullptr};
+  RfScheduler rf_scheduler_;
+  RfScheduler *scheduler_{&rf_scheduler_};
+  CoexScheduler coex_scheduler_;
+  CoexScheduler *coex_{&coex_scheduler_};
+  uint8_t rf_slot_{RfScheduler::kNone};
+  std::string service_prefix_;
+  bool owns_radio_() const { return radio_parent_ == nullptr; }
+  void setup_shared_radio_();
+  void register_services_();
+  void start_rf_();
+  void release_radio_if_done_();
 
-  // Command queue — all RF activity is driven from here; CMD_SET_VALUE is a pseudo-command
-  std::vector<uint8_t> pending_cmds_;
-  uint8_t current_cmd_{0xFF};
-  uint8_t current_seq_{0};
-  uint8_t cmd_fail_count_{0};
-  uint32_t next_rxb_check_ms_{0};
+  // Command queue, TX burst, RX window, retransmit/offline escalation, AFC and calibration
+  // caching — see command_cycle.h. The component is its Host: clock, radio grant, seq#,
+  // command records, publishing and persistence.
+  CommandCycle cycle_;
+  void bind_cycle_();
+  uint32_t cycle_millis() override { return millis(); }
+  void cycle_delay(uint32_t ms) override { delay(ms); }
+  const heater_state_t &cycle_state() override { return pending_state_; }
+  bool cycle_state_valid() override { return state_valid_; }
+  bool cycle_acquire(bool urgent) override { return scheduler_->acquire(rf_slot_, urgent); }
+  uint8_t cycle_take_seq() override { return take_seq_(); }
+  void cycle_sending(uint32_t id, uint32_t queued_ms, bool retransmit) override;
+  void cycle_sent(uint32_t reinit_ms) override;
+  void cycle_acked(const heater_state_t &state, uint32_t id, uint8_t attempts, uint32_t ack_delay_ms) override;
+  void cycle_completed(uint32_t id, bool ok) override;
+  void cycle_latency(uint32_t ms) override;
+  void cycle_set_value_reached(uint32_t elapsed_ms) override;
+  void cycle_offline(bool first) override;
+  void cycle_freq_offset_changed() override;
+  uint8_t next_seq_{0};              // per-heater packet sequence counter
+  uint8_t take_seq_();
 
-  // Target for CMD_SET_VALUE: temperature (°C, auto mode) or pump frequency (Hz, manual mode)
-  float target_value_{0.0f};
+  // Persistence: RTC copy refreshed on every seq/state change, NVS copy throttled to
+  // kPersistIntervalMs. The NVS seq is a ceiling kSeqReserve ahead of the counter and is
+  // written (and synced) only when the counter reaches it, so a cold boot resumes past
+  // any seq already sent at the cost of one flash write per kSeqReserve commands.
+  static constexpr uint8_t kSeqReserve = 32;
+  static constexpr uint32_t kPersistIntervalMs = 600000;
+  ESPPreferenceObject persist_pref_;
+  uint8_t rtc_index_{0};
+  uint8_t seq_ceiling_{0};
+  uint8_t seqs_left_{0};             // seqs usable before the ceiling must move
+  bool fscal_valid_{false};
+  uint8_t fscal_[3]{};
+  uint32_t fscal_freq_{0};           // FREQ2..0 and FREQOFF fscal_ was measured at
+  int8_t fscal_freqoff_{0};
+  bool state_valid_{false};          // pending_state_ holds a received or restored state
 
-  // Expected state after toggle commands — set once when queued, checked before retry.
-  // If GET_STATUS reveals the heater already reached the expected state, the command is skipped.
-  bool mode_toggle_expected_{false};
-  bool power_target_on_{false};
+  // Calibration caching: one SCAL per frequency, FSCAL3..1 restored by every reinitRadio()
+  // with autocal off; the triggers are in CommandCycle. Bookkeeping lives in the radio owner.
+  bool cal_cache_{true};
+  CalibrationMark cal_mark_;
+  sensor::Sensor *calibrations_sensor_{nullptr};
+  bool async_spi_{false};            // queued/DMA SPI transport (radio owner only)
+  sensor::Sensor *burst_cpu_time_sensor_{nullptr};
+  DieselHeaterRFComponent *radio_owner_() { return radio_parent_ != nullptr ? radio_parent_ : this; }
+  // FREQ2..0 the transceiver is tuned to (the owner's)
+  uint32_t radio_freq_() {
+    auto *o = radio_owner_();
+    return ((uint32_t)o->freq2_ << 16) | (o->freq1_ << 8) | o->freq0_;
+  }
+  bool persist_dirty_{false};
+  uint32_t persist_saved_ms_{0};
+  PersistedState persist_snapshot_() const;
+  void persist_restore_(uint8_t rtc_index);
+  void persist_rtc_();
+  void persist_save_(bool sync);
+  void persist_state_received_();
+  uint32_t next_rxb_check_ms_{0};   // passive RX and discovery RXBYTES fallback
 
   text_sensor::TextSensor *state_sensor_{nullptr};
   sensor::Sensor *voltage_sensor_{nullptr};
@@ -108,32 +255,86 @@ class DieselHeaterRFComponent : public PollingComponent, public api::CustomAPIDe
   text_sensor::TextSensor *error_sensor_{nullptr};
   text_sensor::TextSensor *found_address_sensor_{nullptr};
   text_sensor::TextSensor *transceiver_status_sensor_{nullptr};
+  sensor::Sensor *set_value_time_sensor_{nullptr};
+  text_sensor::TextSensor *link_policy_sensor_{nullptr};
+
+  // Burst length, RX window and retry spacing — fixed 14 / 1000 ms / 0 unless adaptive_tx
+  // bounds are configured.
+  LinkPolicy link_policy_;
+
+  // Automatic frequency-offset tracking (CommandCycle::afc_update_()); the applied value
+  // is persisted, throttled to one flash write per kAfcSaveIntervalMs.
+  static constexpr uint32_t kAfcSaveIntervalMs = 600000;
+  bool afc_dirty_{false};
+  uint32_t afc_saved_ms_{0};
+  ESPPreferenceObject afc_pref_;
+  sensor::Sensor *frequency_offset_sensor_{nullptr};
+  void afc_save_();
 
-  // Offline detection and backoff.
-  // Backoff probing is driven by next_backoff_probe_ms_ checked in update(), NOT by
+  // Offline backoff probing is driven by cycle_.probe_due() checked in update(), NOT by
   // changing update_interval — start_poller() creates a new scheduler entry on every
   // call without cancelling the old one, so using it for backoff creates duplicate timers.
-  // Backoff steps (ms): 30 s → 1 min → 2 min → 5 min → 15 min → 30 min → 1 h
-  static constexpr uint32_t kBackoffMs[] = {30000, 60000, 120000, 300000, 900000, 1800000, 3600000};
-  static constexpr uint8_t kBackoffSteps = sizeof(kBackoffMs) / sizeof(kBackoffMs[0]);
-  bool offline_{false};
-  uint8_t backoff_step_{0};
-  uint32_t next_backoff_probe_ms_{0};  // millis() timestamp when the next offline probe is due
   uint32_t user_poll_interval_ms_{60000};
 
-  bool find_address_active_{false};
-  uint8_t find_address_attempts_{0};
-  uint32_t find_address_last_ms_{0};
+  // State-aware polling. update() fires every kPollTickMs and enqueues GET_STATUS only
+  // when the interval for the last known heater state has elapsed since the previous
+  // poll, so schedule and poll-interval changes apply immediately without touching the
+  // poller. Savings are measured against the flat user_poll_interval_ms_ baseline:
+  // baseline polls accrue per tick, actual polls are counted, the difference per hour
+  // is published (negative while transition states poll faster than the baseline).
+  static constexpr uint32_t kPollTickMs = 5000;
+  uint32_t poll_off_ms_{0};
+  uint32_t poll_transition_ms_{0};
+  uint32_t poll_running_ms_{0};
+  uint32_t last_poll_ms_{0};
+  uint32_t last_tick_ms_{0};
+  uint32_t stats_hour_start_ms_{0};
+  float baseline_polls_{0.0f};       // polls the flat interval would have sent this hour
+  uint32_t scheduled_polls_{0};      // polls actually sent this hour
+  int32_t polls_saved_total_{0};
+  sensor::Sensor *polls_saved_sensor_{nullptr};
+  uint32_t poll_interval_for_state_() const;
+  void account_poll_stats_(bool polled);
 
-  enum class PollPhase { IDLE, RX_LISTEN };
-  PollPhase poll_phase_{PollPhase::IDLE};
-  uint32_t rx_window_end_ms_{0};
+  // Non-blocking address discovery — the CC1101 stays in RX for kDiscoveryWindowMs and
+  // every CRC-valid packet (heater reply or remote command) is tallied per address.
+  static constexpr uint32_t kDiscoveryWindowMs = 15000;
+  static constexpr uint8_t kDiscoveryMax = 6;
+  struct DiscoveredDevice {
+    uint32_t addr;
+    int16_t rssi;           // strongest seen, dBm
+    uint16_t packets;
+    uint32_t last_seen_ms;
+    bool from_heater;       // heard a 26-byte state packet
+    bool from_remote;       // heard a 12-byte remote command
+  };
+  bool find_address_active_{false};
+  bool discovery_rx_started_{false};
+  uint32_t discovery_end_ms_{0};
+  DiscoveredDevice discovered_[kDiscoveryMax]{};
+  uint8_t discovered_count_{0};
+  void discovery_record_(uint32_t addr, int16_t rssi, bool from_heater);
+  void publish_discovery_table_();
 
   bool initial_update_seen_{false};  // suppresses the immediate update() ESPHome fires at t=0
   bool cc1101_ok_{false};   // set true in setup() only if PARTNUM/VERSION match
   bool debug_mode_{false};
-  uint32_t debug_last_ms_{0};
   uint32_t debug_reg_dump_ms_{0};  // tracks periodic register readback in debug mode
+  // Debug-mode raw capture: the CC1101 stays armed in RX; frames go into the ring and are
+  // streamed as CAP records one per loop() iteration, after RX has been re-armed.
+  CaptureRing capture_;
+  bool capture_rx_active_{false};
+  void log_capture_frame_(const CaptureFrame &f);
+
+  // State history: one snapshot per history_interval_ms_ (ACKed or passive state, so the
+  // poll rate bounds it), delta-encoded — see history_ring.h. The buffer is allocated
+  // once in setup(), PSRAM when present; dump_history exports it in a single API event.
+  HistoryRing history_;
+  uint32_t history_size_{4096};  // bytes, 0 = off
+  uint32_t history_interval_ms_{10000};
+  uint32_t history_last_ms_{0};
+  void history_begin_();
+  void history_record_(const heater_state_t &state);
 
   uint8_t freq2_{0x10};
   uint8_t freq1_{0xB0};  // 433.938 MHz default
@@ -141,25 +342,158 @@ class DieselHeaterRFComponent : public PollingComponent, public api::CustomAPIDe
   uint8_t cca_mode_{0};  // 0 = always TX, 3 = RSSI+no RX
   uint8_t tx_power_{7};  // PATABLE index 0-7; 7=+10dBm (default)
 
-  // WiFi ↔ RF isolation: track WiFi activity to avoid overlapping RF operations
-  // with WiFi TX bursts that cause 3.3V rail droops and CC1101 brownout-resets.
-  uint32_t wifi_busy_until_ms_{0};   // don't start RF before this timestamp
-  uint32_t publish_settle_ms_{0};    // after publishing sensors, wait before next RF
-  static constexpr uint32_t kWifiSettleMs = 150;  // ms to wait after WiFi event before RF
-  static constexpr uint32_t kPublishSettleMs = 100; // ms to wait after publishing before RF
+  // WiFi ↔ RF isolation: coex_ holds RF off while WiFi is busy (events, our own API
+  // traffic) and around predicted WiFi activity — see coex_scheduler.h. publish_msgs_
+  // counts the API messages of the current publish round for the publish hold.
+  uint32_t publish_msgs_{0};
+  template<typename S, typename V> void publish_(S *sensor, V value) {
+    sensor->publish_state(value);
+    publish_msgs_++;
+  }
+  void end_publish_round_();
   static void on_wifi_event_(void *arg, esp_event_base_t base, int32_t id, void *data);
-  bool is_wifi_quiet_() const { uint32_t now = (uint32_t)(esp_timer_get_time() / 1000LL); return now > wifi_busy_until_ms_ && now > publish_settle_ms_; }
+  static void on_ip_event_(void *arg, esp_event_base_t base, int32_t id, void *data);
+
+  // Readiness-gated startup: the first poll waits for got-IP, an API client connected for
+  // kApiSettleMs (HA's initial state sync is a TX burst), a WiFi event rate at or below
+  // kStartupMaxEvents per kStartupWindowMs, and a clean CC1101 register readback — or
+  // startup_max_wait_ms_, whichever comes first. coex_'s startup hold keeps RF off until then.
+  static constexpr uint32_t kApiSettleMs = 1500;
+  static constexpr uint32_t kStartupWindowMs = 2000;
+  static constexpr uint32_t kStartupMaxEvents = 1;
+  uint32_t startup_max_wait_ms_{25000};
+  bool startup_gate_{true};
+  uint32_t startup_ms_{0};
+  volatile bool got_ip_{false};            // written from the event task
+  uint32_t wifi_window_start_ms_{0};
+  uint32_t wifi_window_events_{0};         // coex_->events() at window start
+  bool wifi_rate_ok_{false};               // last full window was at or below the limit
+  uint32_t api_connected_ms_{0};
+  bool cc1101_config_ok_{false};
+  bool first_state_reported_{false};
+  sensor::Sensor *first_state_time_sensor_{nullptr};
+  void startup_gate_poll_();
+  void open_startup_gate_(const char *reason);
+
+  // Passive listening: between our own commands the CC1101 sits in RX and picks up the
+  // heater's replies to the handheld remote. Any fresh state (passive or ACK) within the
+  // poll interval makes the next scheduled GET_STATUS redundant, so update() skips it.
+  bool passive_listen_{false};
+  bool passive_rx_active_{false};
+  uint32_t last_state_ms_{0};        // millis() of the last valid state packet, any source
+  uint32_t passive_states_{0};       // state packets received without transmitting
+  uint32_t polls_skipped_{0};
+  bool passive_listen_poll_();
+  void on_passive_state_(const heater_state_t &state);
+
+  // Wake-on-radio passive listening (wor_period_us_ != 0): instead of full RX the chip
+  // sniffs every wor_period_us_ (see HeaterRadio::startWor()). A sniff only catches a
+  // packet it overlaps with, which the remote's 14-packet command bursts allow; after a
+  // wake the chip stays in full RX for wor_follow_ms_ to hear the heater's reply, then
+  // goes back to sniffing. With light_sleep_ the ESP32 sleeps between loop() passes while
+  // nothing is pending, woken by GDO2 or after kMaxLightSleepMs.
+  static constexpr uint32_t kMaxLightSleepMs = 1000;
+  uint32_t wor_period_us_{0};
+  uint8_t wor_rx_time_{0};
+  uint32_t wor_follow_ms_{2000};
+  bool light_sleep_{false};
+  bool wor_armed_{false};
+  uint32_t wor_follow_until_ms_{0};
+  uint32_t wor_wakes_{0};
+  uint32_t light_sleeps_{0};
+  uint32_t light_sleep_ms_{0};
+  void passive_rx_arm_();
+  void light_sleep_if_idle_();
+
+  // Receiver on-time share since the last stats publish, from the driver's getRxOnUs().
+  uint64_t rx_on_last_us_{0};
+  uint32_t rx_on_last_ms_{0};
+  sensor::Sensor *rx_on_time_sensor_{nullptr};
+
+  // Command latency: head of queue → ACK, including time spent waiting for the shared
+  // radio (cycle_latency()). Published (last value) with the next state; the average is logged.
+  uint32_t last_cmd_latency_ms_{0};
+  float cmd_latency_avg_ms_{0.0f};
+  sensor::Sensor *command_latency_sensor_{nullptr};
+
+  // Command completion: every service call gets an id and a record of its lifecycle
+  // (millis(); 0 = not reached). A record completes when its last queue entry leaves the
+  // queue — confirmed (ACKed, or the heater was already in the target state), failed (queue
+  // dropped when the heater went offline) or rejected (never queued) — and is reported
+  // through on_command_complete and the esphome.diesel_heater_rf_command API event.
+  static constexpr uint8_t kCmdLogSize = 8;
+  struct CommandRecord {
+    uint32_t id;                       // 0 = free slot
+    const char *name;                  // service name
+    uint32_t queued_ms;
+    uint32_t first_tx_ms;
+    uint32_t ack_ms;
+    uint32_t attempts;
+  };
+  CommandRecord cmd_log_[kCmdLogSize]{};
+  uint32_t next_cmd_id_{1};
+  std::vector<CommandCompleteTrigger *> command_complete_triggers_;
+  CommandRecord *new_command_(const char *name);
+  CommandRecord *command_record_(uint32_t id);
+  void queue_command_(uint8_t cmd, const char *name, bool front = false);
+  void reject_command_(const char *name);
+  void complete_command_(CommandRecord &r, const char *result);
+
+  // RF instrumentation — where a command's time goes, all in ms except attempts:
+  //   queue wait:  entry queued → its first burst (retransmits excluded)
+  //   WiFi wait:   time the head command was held by coex_ before its first burst
+  //   reinit:      reinitRadio() plus calibration when due, before every burst
+  //   airtime:     sendCommand() burst wall time (driver getLastBurstWallUs())
+  //   ACK delay:   burst end → state reply
+  //   attempts:    bursts per acknowledged command
+  // Sensors publish p90 and the JSON text sensor p50/p90/p99/n for each, plus the driver's
+  // burst abort counters, at most every kRfStatsPublishMs with the next state publish.
+  static constexpr uint32_t kLatencyBoundsMs[] = {5, 10, 20, 50, 100, 150, 200, 300,
+                                                  500, 750, 1000, 2000, 5000, 10000, 30000, 60000};
+  static constexpr uint32_t kAttemptBounds[] = {1, 2, 3, 4, 5, 6, 8, 10, 12};
+  static constexpr uint8_t kLatencyBuckets = sizeof(kLatencyBoundsMs) / sizeof(kLatencyBoundsMs[0]);
+  static constexpr uint32_t kRfStatsPublishMs = 60000;
+  Histogram rf_stats_[STAT_COUNT]{
+      {kLatencyBoundsMs, kLatencyBuckets}, {kLatencyBoundsMs, kLatencyBuckets}, {kLatencyBoundsMs, kLatencyBuckets},
+      {kLatencyBoundsMs, kLatencyBuckets}, {kLatencyBoundsMs, kLatencyBuckets},
+      {kAttemptBounds, sizeof(kAttemptBounds) / sizeof(kAttemptBounds[0])},
+  };
+  uint32_t rf_stats_published_ms_{0};
+  sensor::Sensor *rf_stat_sensors_[STAT_COUNT]{};
+  sensor::Sensor *p1_timeouts_sensor_{nullptr};
+  sensor::Sensor *p2_timeouts_sensor_{nullptr};
+  sensor::Sensor *tx_underflows_sensor_{nullptr};
+  sensor::Sensor *wifi_holds_sensor_{nullptr};
+  text_sensor::TextSensor *rf_stats_sensor_{nullptr};
+  void publish_rf_stats_();
 
   // Deferred sensor publishing — publish only when RF is idle, with change detection.
-  // This separates WiFi TX (API state pushes) from RF activity.
+  // This separates WiFi TX (API state pushes) from RF activity. Analog readings have a
+  // deadband: one is re-published once it moves more than its band from the value last
+  // sent; smaller changes are counted in publishes_suppressed_ instead. The packed state
+  // sensor carries every field in one message, for configs that drop the single entities.
+  struct Deadbands {
+    float voltage;
+    float ambient;
+    float case_temp;
+    float pump_freq;
+    float rssi;
+  };
+  Deadbands deadbands_{};
   bool pending_publish_{false};
   heater_state_t pending_state_{};
+  heater_state_t packed_sent_{};
+  bool packed_sent_valid_{false};
+  uint32_t publishes_suppressed_{0};
+  text_sensor::TextSensor *packed_state_sensor_{nullptr};
+  sensor::Sensor *suppressed_publishes_sensor_{nullptr};
   void publish_heater_state_();
+  void publish_banded_(sensor::Sensor *sensor, float value, float band);
+  void publish_packed_state_(const heater_state_t &s);
 
   static const char *state_to_string(uint8_t state);
   static const char *error_to_string(uint8_t error);
-  void reset_backoff_if_offline_();
-  void __attribute__((noinline)) execute_tx_burst_(uint8_t cmd);
+  void publish_link_policy_();
 };
 
 }  // namespace diesel_heater_rf
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+
+namespace esphome {
+namespace diesel_heater_rf {
+
+// Fixed-bucket histogram for latency-style samples. Bucket i counts samples ≤ bounds[i];
+// one extra bucket takes everything above the last bound. Percentiles read back as the
+// upper bound of the bucket that holds them (capped at the largest sample seen), so they
+// are conservative by at most one bucket width. No allocation, O(buckets) per query.
+class Histogram {
+ public:
+  static constexpr uint8_t kMaxBounds = 16;
+
+  // bounds: ascending, static storage, at most kMaxBounds entries
+  Histogram(const uint32_t *bounds, uint8_t n) : bounds_(bounds), n_(n > kMaxBounds ? kMaxBounds : n) {}
+
+  void add(uint32_t v) {
+    uint8_t i = 0;
+    while (i < n_ && v > bounds_[i]) i++;
+    counts_[i]++;
+    total_++;
+    if (v > max_) max_ = v;
+  }
+
+  // p in 1..100; 0 if no samples.
+  uint32_t percentile(uint8_t p) const {
+    if (total_ == 0) return 0;
+    uint32_t rank = (total_ * p + 99) / 100;  // nearest-rank, rounded up
+    uint32_t seen = 0;
+    for (uint8_t i = 0; i <= n_; i++) {
+      seen += counts_[i];
+      if (seen >= rank) return i < n_ && bounds_[i] < max_ ? bounds_[i] : max_;
+    }
+    return max_;
+  }
+
+  uint32_t count() const { return total_; }
+  uint32_t max() const { return max_; }
+
+ protected:
+  const uint32_t *bounds_;
+  uint8_t n_;
+  uint32_t counts_[kMaxBounds + 1]{};
+  uint32_t total_{0};
+  uint32_t max_{0};
+};
+
+}  // namespace diesel_heater_rf
+}  // namespace esphome
@@ -0,0 +1,133 @@
+#include "history_ring.h"
+#include <cmath>
+#include <cstring>
+
+namespace esphome {
+namespace diesel_heater_rf {
+
+void HistoryRing::begin(uint8_t *buf, size_t len) {
+  buf_ = buf;
+  size_t blocks = buf != nullptr ? len / kBlockSize : 0;
+  blocks_ = blocks > kMaxBlocks ? kMaxBlocks : (uint16_t) blocks;
+  clear();
+}
+
+void HistoryRing::clear() {
+  head_ = count_ = 0;
+  have_prev_ = false;
+}
+
+void HistoryRing::fields(const heater_state_t &state, uint8_t *f) {
+  f[0] = (state.state & 0x7F) | (state.autoMode ? 0x80 : 0x00);
+  f[1] = state.power;
+  f[2] = state.errorCode;
+  f[3] = (uint8_t) lroundf(state.voltage * 10.0f);
+  f[4] = (uint8_t) state.ambientTemp;
+  f[5] = state.caseTemp;
+  f[6] = (uint8_t) state.setpoint;
+  f[7] = (uint8_t) lroundf(state.pumpFreq * 10.0f);
+}
+
+// Opens the next block, dropping the oldest when all are in use. The caller writes a
+// keyframe into it.
+void HistoryRing::new_block_() {
+  if (count_ == blocks_) {
+    head_ = (head_ + 1) % blocks_;
+    count_--;
+  }
+  uint16_t p = (head_ + count_) % blocks_;
+  used_[p] = 0;
+  block_samples_[p] = 0;
+  count_++;
+}
+
+size_t HistoryRing::encode_delta_(uint32_t dt, const uint8_t *f, uint8_t *rec) const {
+  uint8_t mask = 0;
+  uint8_t nib[kFields * 3];
+  size_t n = 0;
+  for (uint8_t i = 0; i < kFields; i++) {
+    if (f[i] == prev_[i]) continue;
+    mask |= 1 << i;
+    int8_t d = (int8_t) (uint8_t) (f[i] - prev_[i]);
+    if (d >= -7 && d <= 7) {
+      nib[n++] = d & 0x0F;
+    } else {
+      nib[n++] = kEscape;
+      nib[n++] = f[i] >> 4;
+      nib[n++] = f[i] & 0x0F;
+    }
+  }
+  rec[0] = (uint8_t) dt;
+  rec[1] = mask;
+  memset(rec + 2, 0, (n + 1) / 2);
+  for (size_t j = 0; j < n; j++) rec[2 + j / 2] |= (j % 2 == 0) ? nib[j] << 4 : nib[j];
+  return 2 + (n + 1) / 2;
+}
+
+void HistoryRing::add(uint32_t t_s, const heater_state_t &state) {
+  if (!enabled()) return;
+  uint8_t f[kFields];
+  fields(state, f);
+  uint32_t dt = t_s - prev_t_s_;
+  if (have_prev_ && dt == 0) return;  // one sample per second at most
+
+  uint8_t rec[2 + kFields * 3 / 2 + 1];  // worst-case delta, longer than a keyframe
+  size_t n = 0;
+  bool key = !have_prev_ || dt > 255;
+  if (!key) n = encode_delta_(dt, f, rec);
+  // Open a block only when the record doesn't fit the current one; a gap keyframe that
+  // fits (e.g. every sample with a 300 s idle poll) is written inline.
+  bool open = count_ == 0 || used_[(head_ + count_ - 1) % blocks_] + (key ? 5 + kFields : n) > kBlockSize;
+  if (key || open) {
+    rec[0] = kKeyframe;
+    rec[1] = t_s & 0xFF;
+    rec[2] = (t_s >> 8) & 0xFF;
+    rec[3] = (t_s >> 16) & 0xFF;
+    rec[4] = (t_s >> 24) & 0xFF;
+    memcpy(rec + 5, f, kFields);
+    n = 5 + kFields;
+  }
+  if (open) new_block_();
+  uint16_t p = (head_ + count_ - 1) % blocks_;
+  memcpy(buf_ + (size_t) p * kBlockSize + used_[p], rec, n);
+  used_[p] += n;
+  block_samples_[p]++;
+  memcpy(prev_, f, kFields);
+  prev_t_s_ = t_s;
+  have_prev_ = true;
+  total_++;
+}
+
+uint32_t HistoryRing::samples() const {
+  uint32_t n = 0;
+  for (uint16_t i = 0; i < count_; i++) n += block_samples_[(head_ + i) % blocks_];
+  return n;
+}
+
+uint32_t HistoryRing::oldest_s() const {
+  if (count_ == 0) return 0;
+  const uint8_t *b = block_(0);
+  return b[1] | (b[2] << 8) | (b[3] << 16) | ((uint32_t) b[4] << 24);
+}
+
+size_t HistoryRing::export_size() const {
+  size_t n = 0;
+  for (uint16_t i = 0; i < count_; i++) n += 2 + used_[(head_ + i) % blocks_];
+  return n;
+}
+
+size_t HistoryRing::export_to(uint8_t *out, size_t len) const {
+  if (len < export_size()) return 0;
+  size_t n = 0;
+  for (uint16_t i = 0; i < count_; i++) {
+    uint16_t used = used_[(head_ + i) % blocks_];
+    out[n++] = used & 0xFF;
+    out[n++] = used >> 8;
+    memcpy(out + n, block_(i), used);
+    n += used;
+  }
+  return n;
+}
+
+}  // namespace diesel_heater_rf
+}  // namespace esphome
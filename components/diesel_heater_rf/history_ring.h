@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "HeaterRadio.h"
+
+namespace esphome {
+namespace diesel_heater_rf {
+
+// On-device heater run log: state snapshots, delta-encoded into a fixed byte buffer.
+//
+// The buffer is split into kBlockSize blocks. Each block starts with a keyframe, so when
+// the buffer is full the oldest block is dropped whole and every retained block still
+// decodes on its own. Values are kept in protocol units (0.1 V, 0.1 Hz, °C), so the
+// encoding is lossless; RSSI, LQI and FREQEST are link data and not recorded.
+//
+// Record format (v1):
+//   keyframe: u8 0x00 | u32 LE t_s | field[8]
+//   delta:    u8 dt_s (1..255) | u8 changed-field mask | nibble stream
+// Fields, mask bit 0..7: state | auto_mode << 7, power, error, voltage, ambient (i8),
+// case, setpoint (i8), pump. Each changed field is one nibble holding the signed delta
+// (-7..7, mod 256) from the previous sample, or the escape nibble 0x8 followed by the new
+// value's two nibbles, high first. Nibbles fill each byte high first; the stream is padded
+// to a whole byte. A sample more than 255 s after the previous one is a keyframe, written
+// inline when it fits the current block.
+// An unchanged sample costs 2 bytes, a typical running one 3.
+//
+// Export (dump_history): per block u16 LE length | block bytes, oldest block first.
+// Decoded by tools/decode_history.py.
+class HistoryRing {
+ public:
+  static constexpr size_t kBlockSize = 256;
+  static constexpr uint16_t kMaxBlocks = 64;  // 16 KB
+  static constexpr uint8_t kFields = 8;
+  static constexpr uint8_t kKeyframe = 0x00;
+  static constexpr uint8_t kEscape = 0x8;
+
+  // buf is caller-owned; len is rounded down to whole blocks, at least two are needed.
+  void begin(uint8_t *buf, size_t len);
+  bool enabled() const { return blocks_ >= 2; }
+  void add(uint32_t t_s, const heater_state_t &state);
+  void clear();
+
+  uint32_t samples() const;                 // retained
+  uint32_t total() const { return total_; }  // since boot
+  uint32_t oldest_s() const;                // keyframe time of the oldest block
+  size_t capacity() const { return (size_t) blocks_ * kBlockSize; }
+  size_t export_size() const;
+  // Writes the export (see above) to out; returns the bytes written, 0 if len is short.
+  size_t export_to(uint8_t *out, size_t len) const;
+
+  static void fields(const heater_state_t &state, uint8_t *f);
+
+ protected:
+  uint8_t *block_(uint16_t i) const { return buf_ + (size_t) ((head_ + i) % blocks_) * kBlockSize; }
+  void new_block_();
+  size_t encode_delta_(uint32_t dt, const uint8_t *f, uint8_t *rec) const;
+
+  uint8_t *buf_{nullptr};
+  uint16_t blocks_{0};
+  uint16_t head_{0};   // oldest block
+  uint16_t count_{0};  // blocks in use, the last one is being filled
+  uint16_t used_[kMaxBlocks]{};
+  uint16_t block_samples_[kMaxBlocks]{};
+  uint8_t prev_[kFields]{};
+  uint32_t prev_t_s_{0};
+  bool have_prev_{false};
+  uint32_t total_{0};
+};
+
+}  // namespace diesel_heater_rf
+}  // namespace esphome
@@ -0,0 +1,106 @@
+#include "link_policy.h"
+
+namespace esphome {
+namespace diesel_heater_rf {
+
+void LinkPolicy::set_bounds(uint8_t min_burst, uint8_t max_burst, uint32_t min_rx_ms, uint32_t max_rx_ms,
+                            uint32_t max_gap_ms) {
+  min_burst_ = min_burst;
+  max_burst_ = max_burst < min_burst ? min_burst : max_burst;
+  min_rx_ms_ = min_rx_ms;
+  max_rx_ms_ = max_rx_ms < min_rx_ms ? min_rx_ms : max_rx_ms;
+  max_gap_ms_ = max_gap_ms;
+  burst_ = max_burst_;  // start conservative; shrink only on evidence
+}
+
+void LinkPolicy::push_(const Outcome &o) {
+  history_[head_] = o;
+  head_ = (head_ + 1) % kHistory;
+  if (count_ < kHistory) count_++;
+}
+
+LinkPolicy::Snapshot LinkPolicy::snapshot() const {
+  Snapshot s{burst_, head_, count_, {}};
+  for (uint8_t i = 0; i < kHistory; i++) s.history[i] = history_[i];
+  return s;
+}
+
+void LinkPolicy::restore(const Snapshot &s) {
+  if (s.head >= kHistory || s.count > kHistory) return;
+  burst_ = s.burst < min_burst_ ? min_burst_ : s.burst > max_burst_ ? max_burst_ : s.burst;
+  head_ = s.head;
+  count_ = s.count;
+  for (uint8_t i = 0; i < kHistory; i++) history_[i] = s.history[i];
+}
+
+void LinkPolicy::on_ack(uint8_t attempts, uint32_t ack_delay_ms) {
+  push_({attempts, true, static_cast<uint16_t>(ack_delay_ms > 0xFFFF ? 0xFFFF : ack_delay_ms)});
+  last_timed_out_ = false;
+  if (attempts > 1) {
+    clean_streak_ = 0;
+    return;
+  }
+  if (++clean_streak_ >= kShrinkAfter) {
+    clean_streak_ = 0;
+    if (burst_ > min_burst_) burst_--;
+  }
+}
+
+void LinkPolicy::on_timeout() {
+  last_timed_out_ = true;
+  clean_streak_ = 0;
+  burst_ = (burst_ + kGrowStep > max_burst_) ? max_burst_ : burst_ + kGrowStep;
+}
+
+void LinkPolicy::on_command_failed(uint8_t attempts) {
+  push_({attempts, false, 0});
+  burst_ = max_burst_;
+}
+
+uint32_t LinkPolicy::rx_window_ms() const {
+  if (last_timed_out_) return max_rx_ms_;
+  uint32_t slowest = max_ack_delay_ms();
+  if (slowest == 0) return max_rx_ms_;  // no data yet
+  uint32_t window = slowest + slowest / 2 + kRxMarginMs;
+  if (window < min_rx_ms_) return min_rx_ms_;
+  if (window > max_rx_ms_) return max_rx_ms_;
+  return window;
+}
+
+uint32_t LinkPolicy::retry_gap_ms(uint8_t fail_count) const {
+  if (fail_count == 0 || max_gap_ms_ == 0) return 0;
+  // Healthy link: a single miss is most likely a collision — retry immediately.
+  if (fail_count == 1 && success_rate() >= kHealthyRate) return 0;
+  uint8_t shift = fail_count - 1 > 4 ? 4 : fail_count - 1;
+  uint32_t gap = kBaseGapMs << shift;
+  return gap > max_gap_ms_ ? max_gap_ms_ : gap;
+}
+
+float LinkPolicy::success_rate() const {
+  if (count_ == 0) return 1.0f;
+  uint8_t ok = 0;
+  for (uint8_t i = 0; i < count_; i++)
+    if (history_[i].acked) ok++;
+  return static_cast<float>(ok) / count_;
+}
+
+float LinkPolicy::attempts_per_ack() const {
+  uint16_t attempts = 0;
+  uint8_t acks = 0;
+  for (uint8_t i = 0; i < count_; i++) {
+    if (!history_[i].acked) continue;
+    attempts += history_[i].attempts;
+    acks++;
+  }
+  return acks == 0 ? 0.0f : static_cast<float>(attempts) / acks;
+}
+
+uint32_t LinkPolicy::max_ack_delay_ms() const {
+  uint32_t slowest = 0;
+  for (uint8_t i = 0; i < count_; i++)
+    if (history_[i].acked && history_[i].ack_delay_ms > slowest) slowest = history_[i].ack_delay_ms;
+  return slowest;
+}
+
+}  // namespace diesel_heater_rf
+}  // namespace esphome
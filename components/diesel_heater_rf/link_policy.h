@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+
+namespace esphome {
+namespace diesel_heater_rf {
+
+// Adaptive TX policy — picks burst length, RX window and retry spacing from recent
+// ACK history, within configured bounds. With min == max bounds it degenerates to the
+// fixed 14-packet / 1000 ms / no-gap schedule.
+//
+//   burst:  starts at max; shrinks by 1 after kShrinkAfter consecutive first-attempt ACKs,
+//           grows by kGrowStep on every RX timeout (cheap to probe down, fast to back off).
+//   rx:     1.5 × slowest recent ACK delay + kRxMarginMs; max after a timeout.
+//   gap:    0 for the first retry on a healthy link, otherwise doubling from kBaseGapMs.
+class LinkPolicy {
+ public:
+  void set_bounds(uint8_t min_burst, uint8_t max_burst, uint32_t min_rx_ms, uint32_t max_rx_ms,
+                  uint32_t max_gap_ms);
+
+  void on_ack(uint8_t attempts, uint32_t ack_delay_ms);  // command acknowledged after N attempts
+  void on_timeout();                                     // one attempt's RX window expired
+  void on_command_failed(uint8_t attempts);              // command exhausted its attempts
+
+  uint8_t burst_packets() const { return burst_; }
+  uint32_t rx_window_ms() const;
+  uint32_t retry_gap_ms(uint8_t fail_count) const;
+
+  // Diagnostics over the last kHistory commands
+  float success_rate() const;
+  float attempts_per_ack() const;
+  uint32_t max_ack_delay_ms() const;
+  uint8_t history_size() const { return count_; }
+
+  static constexpr uint8_t kHistory = 16;
+  struct Outcome {
+    uint8_t attempts;
+    bool acked;
+    uint16_t ack_delay_ms;
+  };
+  // Learned state for persistence across reboots; bounds come from config, not the snapshot.
+  struct Snapshot {
+    uint8_t burst;
+    uint8_t head;
+    uint8_t count;
+    Outcome history[kHistory];
+  };
+  Snapshot snapshot() const;
+  void restore(const Snapshot &s);
+
+ protected:
+  static constexpr uint8_t kShrinkAfter = 4;
+  static constexpr uint8_t kGrowStep = 4;
+  static constexpr uint32_t kRxMarginMs = 150;
+  static constexpr uint32_t kBaseGapMs = 100;
+  static constexpr float kHealthyRate = 0.8f;
+
+  void push_(const Outcome &o);
+
+  Outcome history_[kHistory]{};
+  uint8_t head_{0};
+  uint8_t count_{0};
+
+  uint8_t min_burst_{14}, max_burst_{14};
+  uint32_t min_rx_ms_{1000}, max_rx_ms_{1000};
+  uint32_t max_gap_ms_{0};
+
+  uint8_t burst_{14};
+  uint8_t clean_streak_{0};
+  bool last_timed_out_{false};
+};
+
+}  // namespace diesel_heater_rf
+}  // namespace esphome
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include "DieselHeaterRF.h"
+#include "link_policy.h"
+
+namespace esphome {
+namespace diesel_heater_rf {
+
+// Per-heater state kept across reboots — in RTC memory for warm resets (OTA, crash, WDT)
+// and in NVS for cold boots. The NVS copy's seq is a ceiling (see kSeqReserve in
+// diesel_heater_rf.h); the RTC copy's seq is exact.
+struct PersistedState {
+  uint32_t addr;
+  uint8_t seq;
+  bool fscal_valid;
+  uint8_t fscal[3];           // FSCAL3, FSCAL2, FSCAL1 from the last calibration
+  uint32_t fscal_freq;        // FREQ2..0 the calibration was measured at
+  int8_t fscal_freqoff;       // ... and FSCTRL0 (FREQOFF)
+  bool state_valid;
+  heater_state_t state;
+  uint32_t state_uptime_ms;   // millis() at receipt, in the boot that saved it
+  LinkPolicy::Snapshot link;
+};
+
+}  // namespace diesel_heater_rf
+}  // namespace esphome
@@ -0,0 +1,82 @@
+#include "rf_scheduler.h"
+#include "esphome/core/hal.h"
+
+namespace esphome {
+namespace diesel_heater_rf {
+
+uint8_t RfScheduler::add_client(uint32_t addr, StateCallback on_state) {
+  if (count_ >= kMaxClients) return kNone;
+  clients_[count_] = {addr, std::move(on_state), 0, 0, false, 0, 0};
+  return count_++;
+}
+
+// Round-robin from the slot after the previous owner; urgent requests first.
+uint8_t RfScheduler::next_in_turn_(uint32_t now) const {
+  uint8_t start = last_owner_ == kNone ? 0 : (last_owner_ + 1) % count_;
+  for (int pass = 0; pass < 2; pass++) {
+    for (uint8_t i = 0; i < count_; i++) {
+      uint8_t s = (start + i) % count_;
+      const Client &c = clients_[s];
+      if (live_(c, now) && (pass == 1 || c.urgent)) return s;
+    }
+  }
+  return kNone;
+}
+
+bool RfScheduler::acquire(uint8_t slot, bool urgent) {
+  if (slot >= count_) return false;
+  if (owner_ == slot) return true;
+  uint32_t now = millis();
+  Client &c = clients_[slot];
+  if (!live_(c, now)) {
+    c.wait_start_ms = now;
+    c.urgent = false;
+  }
+  c.request_ms = now != 0 ? now : 1;
+  c.urgent |= urgent;
+  if (owner_ != kNone || next_in_turn_(now) != slot) return false;
+
+  owner_ = last_owner_ = slot;
+  c.request_ms = 0;
+  c.urgent = false;
+  c.last_wait_ms = now - c.wait_start_ms;
+  c.grants++;
+  return true;
+}
+
+bool RfScheduler::try_acquire_idle(uint8_t slot) {
+  if (slot >= count_) return false;
+  if (owner_ == slot) return true;
+  if (owner_ != kNone) return false;
+  uint32_t now = millis();
+  for (uint8_t i = 0; i < count_; i++) {
+    if (live_(clients_[i], now)) return false;
+  }
+  owner_ = slot;  // passive use does not advance the round-robin turn
+  return true;
+}
+
+void RfScheduler::release(uint8_t slot) {
+  if (owner_ == slot) owner_ = kNone;
+}
+
+bool RfScheduler::contended(uint8_t slot) const {
+  uint32_t now = millis();
+  for (uint8_t i = 0; i < count_; i++) {
+    if (i != slot && live_(clients_[i], now)) return true;
+  }
+  return false;
+}
+
+bool RfScheduler::dispatch(uint32_t addr, const heater_state_t &state) {
+  for (uint8_t i = 0; i < count_; i++) {
+    if (clients_[i].addr == addr && clients_[i].on_state) {
+      clients_[i].on_state(state);
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace diesel_heater_rf
+}  // namespace esphome
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include "DieselHeaterRF.h"
+
+namespace esphome {
+namespace diesel_heater_rf {
+
+// Airtime arbiter for several heater components sharing one CC1101. Exactly one client
+// owns the radio at a time; the owner holds it for one TX/RX cycle (or while a scan,
+// debug capture or passive RX needs the chip) and releases it from loop().
+//
+//   acquire():  registers a request and grants the radio if it is free and the caller
+//               is next in round-robin order after the previous owner. Urgent requests
+//               (user commands) go before routine polls. Requests not refreshed within
+//               kRequestTtlMs expire, so a client that stops asking never blocks others.
+//   passive:    try_acquire_idle() only succeeds with no owner and no live requests;
+//               a passive holder gives the radio up as soon as contended() is true.
+//   dispatch(): routes an unfiltered state packet to the client with that address.
+class RfScheduler {
+ public:
+  static constexpr uint8_t kMaxClients = 4;
+  static constexpr uint8_t kNone = 0xFF;
+  static constexpr uint32_t kRequestTtlMs = 1000;
+  using StateCallback = std::function<void(const heater_state_t &)>;
+
+  // Returns the client slot, or kNone if the table is full.
+  uint8_t add_client(uint32_t addr, StateCallback on_state);
+
+  bool acquire(uint8_t slot, bool urgent);
+  bool try_acquire_idle(uint8_t slot);
+  void release(uint8_t slot);
+  bool holds(uint8_t slot) const { return owner_ == slot; }
+  bool contended(uint8_t slot) const;  // another client has a live request
+
+  bool dispatch(uint32_t addr, const heater_state_t &state);
+
+  uint8_t size() const { return count_; }
+  uint32_t last_wait_ms(uint8_t slot) const { return slot < count_ ? clients_[slot].last_wait_ms : 0; }
+  uint32_t grants(uint8_t slot) const { return slot < count_ ? clients_[slot].grants : 0; }
+
+ protected:
+  struct Client {
+    uint32_t addr;
+    StateCallback on_state;
+    uint32_t request_ms;        // last refresh of the current request; 0 = none
+    uint32_t wait_start_ms;     // first request since the last grant
+    bool urgent;
+    uint32_t grants;
+    uint32_t last_wait_ms;      // request → grant for the most recent grant
+  };
+  bool live_(const Client &c, uint32_t now) const { return c.request_ms != 0 && now - c.request_ms < kRequestTtlMs; }
+  uint8_t next_in_turn_(uint32_t now) const;
+
+  Client clients_[kMaxClients]{};
+  uint8_t count_{0};
+  uint8_t owner_{kNone};
+  uint8_t last_owner_{kNone};
+};
+
+}  // namespace diesel_heater_rf
+}  // namespace esphome
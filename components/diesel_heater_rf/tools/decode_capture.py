@@ -0,0 +1,143 @@
+#!/usr/bin/env python3
+"""Decode diesel_heater_rf debug-mode raw captures.
+
+In RF debug mode the component logs every received frame as a `CAP <hex>` line
+(see capture_ring.h for the record layout). Pipe `esphome logs` output or a saved
+log file into this script to get a decoded table, and optionally a pcap file
+(LINKTYPE_USER0) for Wireshark or offline analysis.
+
+    esphome logs diesel-heater.yaml | tee heater.log
+    python3 decode_capture.py heater.log
+    python3 decode_capture.py heater.log --pcap heater.pcap
+    python3 decode_capture.py heater.log --addr 0x12AB34CD --csv > frames.csv
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+RECORD_MAGIC = 0xD1
+RECORD_HEADER = struct.Struct("<BIbBbB")  # magic, t_ms, rssi, lqi, freq_est, len
+LINKTYPE_USER0 = 147
+FREQEST_HZ = 26_000_000 / 16384
+
+CAP_RE = re.compile(r"\bCAP ([0-9A-Fa-f]+)")
+
+STATES = {
+    0x00: "Off",
+    0x01: "Startup",
+    0x02: "Warming",
+    0x03: "Warming Wait",
+    0x04: "Pre-Run",
+    0x05: "Running",
+    0x06: "Shutdown",
+    0x07: "Shutting Down",
+    0x08: "Cooling",
+}
+COMMANDS = {0x23: "GET_STATUS", 0x24: "MODE", 0x2B: "POWER", 0x3C: "UP", 0x3E: "DOWN"}
+
+
+def parse_records(lines):
+    for lineno, line in enumerate(lines, 1):
+        m = CAP_RE.search(line)
+        if not m:
+            continue
+        raw = bytes.fromhex(m.group(1))
+        if len(raw) < RECORD_HEADER.size or raw[0] != RECORD_MAGIC:
+            print(f"line {lineno}: not a v1 capture record", file=sys.stderr)
+            continue
+        _, t_ms, rssi, lqi, freq_est, length = RECORD_HEADER.unpack_from(raw)
+        data = raw[RECORD_HEADER.size:]
+        if len(data) != length:
+            print(f"line {lineno}: truncated record ({len(data)}/{length} bytes)", file=sys.stderr)
+            continue
+        yield {
+            "t_ms": t_ms,
+            "rssi": rssi,
+            "crc_ok": bool(lqi & 0x80),
+            "lqi": lqi & 0x7F,
+            "freq_est": freq_est,
+            "data": data,
+        }
+
+
+def crc16_modbus(data):
+    crc = 0xFFFF
+    for b in data:
+        crc ^= b
+        for _ in range(8):
+            crc = (crc >> 1) ^ 0xA001 if crc & 1 else crc >> 1
+    return crc
+
+
+def describe(data):
+    """Human-readable summary of a frame (APPEND_STATUS bytes included)."""
+    if len(data) < 6:
+        return "short frame"
+    addr = int.from_bytes(data[2:6], "big")
+    if len(data) == 26 and data[0] == 0x17:
+        auto = data[14] == 0x32
+        return (
+            f"state addr=0x{addr:08X} {STATES.get(data[6], f'0x{data[6]:02X}')} "
+            f"power={data[7]} err={data[11]} {data[9] / 10:.1f}V "
+            f"ambient={struct.unpack('b', data[10:11])[0]}C case={data[12]}C "
+            f"{'auto' if auto else 'manual'} setpoint={data[13]}C pump={data[15] / 10:.1f}Hz"
+        )
+    if len(data) == 12 and data[0] == 0x09:
+        crc = crc16_modbus(data[:7])
+        crc_ok = crc == int.from_bytes(data[7:9], "big")
+        return (
+            f"command addr=0x{addr:08X} {COMMANDS.get(data[1], f'0x{data[1]:02X}')} "
+            f"seq={data[6]} sw-crc={'ok' if crc_ok else 'BAD'}"
+        )
+    return f"unknown len={len(data)} addr?=0x{addr:08X}"
+
+
+def write_pcap(path, records):
+    with open(path, "wb") as f:
+        f.write(struct.pack("<IHHiIII", 0xA1B2C3D4, 2, 4, 0, 0, 65535, LINKTYPE_USER0))
+        for r in records:
+            # Pseudo-header so per-frame radio metadata survives in the pcap
+            payload = struct.pack("<bBb", r["rssi"], r["lqi"] | (0x80 if r["crc_ok"] else 0), r["freq_est"]) + r["data"]
+            sec, ms = divmod(r["t_ms"], 1000)
+            f.write(struct.pack("<IIII", sec, ms * 1000, len(payload), len(payload)))
+            f.write(payload)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("log", nargs="?", help="log file (default: stdin)")
+    ap.add_argument("--pcap", help="also write frames to this pcap file")
+    ap.add_argument("--addr", type=lambda s: int(s, 0), help="only show frames for this address")
+    ap.add_argument("--csv", action="store_true", help="CSV output instead of a table")
+    args = ap.parse_args()
+
+    src = open(args.log, encoding="utf-8", errors="replace") if args.log else sys.stdin
+    with src:
+        records = list(parse_records(src))
+    if args.addr is not None:
+        records = [r for r in records if len(r["data"]) >= 6 and int.from_bytes(r["data"][2:6], "big") == args.addr]
+
+    seen = set()
+    for r in records:
+        key = (r["t_ms"], r["data"])  # dump_capture replays frames already streamed
+        if key in seen:
+            continue
+        seen.add(key)
+        if args.csv:
+            print(f"{r['t_ms']},{r['rssi']},{r['lqi']},{int(r['crc_ok'])},{r['freq_est']},{r['data'].hex()}")
+        else:
+            print(
+                f"{r['t_ms'] / 1000:10.3f}s {r['rssi']:4d}dBm LQI={r['lqi']:3d} "
+                f"CRC={'ok ' if r['crc_ok'] else 'BAD'} df={r['freq_est'] * FREQEST_HZ / 1000:+6.1f}kHz  "
+                f"{describe(r['data'])}"
+            )
+
+    if args.pcap:
+        write_pcap(args.pcap, records)
+        print(f"wrote {len(records)} frames to {args.pcap}", file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,128 @@
+#!/usr/bin/env python3
+"""Decode a diesel_heater_rf state history dump.
+
+The dump_history service fires an `esphome.diesel_heater_rf_history` event whose `data`
+field is the base64 export of the on-device history ring (see history_ring.h for the
+format). Copy the event from Home Assistant (Developer tools → Events, listening to
+`esphome.diesel_heater_rf_history`) and pass the base64 string, or the event JSON,
+to this script:
+
+    python3 decode_history.py 'AQIDBA...'
+    python3 decode_history.py --json event.json --csv > history.csv
+
+Times are seconds of device uptime. With --json, or --uptime set to the event's
+`uptime_s`, they are also printed relative to the dump.
+"""
+
+import argparse
+import base64
+import json
+import struct
+import sys
+
+KEYFRAME = 0x00
+ESCAPE = 0x8
+FIELDS = ("state", "power", "error", "voltage", "ambient", "case", "setpoint", "pump")
+STATES = {
+    0x00: "Off",
+    0x01: "Startup",
+    0x02: "Warming",
+    0x03: "Warming Wait",
+    0x04: "Pre-Run",
+    0x05: "Running",
+    0x06: "Shutdown",
+    0x07: "Shutting Down",
+    0x08: "Cooling",
+}
+
+
+def nibbles(data):
+    for b in data:
+        yield b >> 4
+        yield b & 0x0F
+
+
+def decode_block(block):
+    """Yield (t_s, fields) for every sample in one block."""
+    pos = 0
+    t = None
+    f = None
+    while pos < len(block):
+        if block[pos] == KEYFRAME:
+            if pos + 13 > len(block):
+                raise ValueError("truncated keyframe")
+            t = struct.unpack_from("<I", block, pos + 1)[0]
+            f = list(block[pos + 5:pos + 13])
+            pos += 13
+        else:
+            if f is None:
+                raise ValueError("block does not start with a keyframe")
+            dt, mask = block[pos], block[pos + 1]
+            pos += 2
+            nib = nibbles(block[pos:])
+            used = 0
+            for i in range(8):
+                if not mask & (1 << i):
+                    continue
+                n = next(nib)
+                used += 1
+                if n == ESCAPE:
+                    f[i] = (next(nib) << 4) | next(nib)
+                    used += 2
+                else:
+                    f[i] = (f[i] + (n - 16 if n & 0x8 else n)) & 0xFF
+            pos += (used + 1) // 2
+            t += dt
+        yield t, list(f)
+
+
+def decode(export):
+    pos = 0
+    while pos + 2 <= len(export):
+        length = export[pos] | (export[pos + 1] << 8)
+        pos += 2
+        yield from decode_block(export[pos:pos + length])
+        pos += length
+
+
+def signed(v):
+    return v - 256 if v >= 128 else v
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("data", nargs="?", help="base64 export (default: stdin)")
+    ap.add_argument("--json", help="event JSON file with data and uptime_s")
+    ap.add_argument("--uptime", type=int, help="device uptime at dump time (event uptime_s)")
+    ap.add_argument("--csv", action="store_true", help="CSV output instead of a table")
+    args = ap.parse_args()
+
+    uptime = args.uptime
+    if args.json:
+        with open(args.json, encoding="utf-8") as fh:
+            event = json.load(fh)
+        event = event.get("data", event) if isinstance(event.get("data"), dict) else event
+        raw = event["data"]
+        uptime = int(event.get("uptime_s", 0)) or uptime
+    else:
+        raw = args.data if args.data else sys.stdin.read()
+    export = base64.b64decode(raw.strip())
+
+    if args.csv:
+        print("t_s,state,auto,power,error,voltage,ambient,case,setpoint,pump_hz")
+    for t, f in decode(export):
+        state, auto = f[0] & 0x7F, bool(f[0] & 0x80)
+        if args.csv:
+            print(f"{t},{state},{int(auto)},{f[1]},{f[2]},{f[3] / 10:.1f},{signed(f[4])},{f[5]},"
+                  f"{signed(f[6])},{f[7] / 10:.1f}")
+            continue
+        ago = f" ({(uptime - t) / 60:7.1f} min ago)" if uptime else ""
+        print(
+            f"{t:9d}s{ago} {STATES.get(state, f'0x{state:02X}'):13s} {'auto  ' if auto else 'manual'} "
+            f"power={f[1]} err={f[2]} {f[3] / 10:4.1f}V ambient={signed(f[4])}C case={f[5]}C "
+            f"setpoint={signed(f[6])}C pump={f[7] / 10:.1f}Hz"
+        )
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,402 @@
+#include <string.h>
+#include "cc1101_model.h"
+
+// Power-on reset values of 0x00–0x2E (CC1101 datasheet, table 43).
+static const uint8_t kResetRegs[0x2F] = {
+  0x29, 0x2E, 0x3F, 0x07, 0xD3, 0x91, 0xFF, 0x04, 0x45, 0x00, 0x00, 0x0F, 0x00, 0x1E, 0xC4, 0xEC,
+  0x8C, 0x22, 0x02, 0x22, 0xF8, 0x47, 0x07, 0x30, 0x04, 0x36, 0x6C, 0x03, 0x40, 0x91, 0x87, 0x6B,
+  0xF8, 0x56, 0x10, 0xA9, 0x0A, 0x20, 0x0D, 0x41, 0x00, 0x59, 0x7F, 0x3F, 0x88, 0x31, 0x0B,
+};
+static const uint8_t kResetPatable[8] = {0xC6, 0, 0, 0, 0, 0, 0, 0};
+static const uint8_t kPreambleBytes[8] = {2, 3, 4, 6, 8, 12, 16, 24};  // MDMCFG1 NUM_PREAMBLE
+
+// FSCAL3..1 a calibration finds for a frequency. Only has to differ between frequencies,
+// so a calibration restored for the wrong one fails to lock.
+static void calibratedFscal(uint32_t freq, uint8_t *f3, uint8_t *f2, uint8_t *f1) {
+  *f3 = 0xE9;
+  *f2 = 0x2A;
+  *f1 = (uint8_t)((freq * 2654435761u) >> 27);
+}
+
+CC1101Model::CC1101Model(SimWorld &world) : _world(world) {
+  resetRegs();
+  _world.attach(this);
+}
+
+void CC1101Model::resetRegs() {
+  memcpy(_regs, kResetRegs, sizeof(_regs));
+  memcpy(_patable, kResetPatable, sizeof(_patable));
+  _txCount = _rxCount = _rxHead = 0;
+  _rxOverflow = _txUnderflow = _pktReady = false;
+  _state = IDLE;
+  _until = -1;
+  _worPending = false;
+}
+
+void CC1101Model::resetSleepLost() {
+  _regs[0x2C] = kResetRegs[0x2C];
+  _regs[0x2D] = kResetRegs[0x2D];
+  _regs[0x2E] = kResetRegs[0x2E];
+  memcpy(_patable, kResetPatable, sizeof(_patable));
+}
+
+void CC1101Model::brownout() {
+  _stats.brownouts++;
+  resetRegs();
+}
+
+SimPhy CC1101Model::phy() const {
+  return SimPhy{((uint32_t)_regs[0x0D] << 16) | ((uint32_t)_regs[0x0E] << 8) | _regs[0x0F],
+                (uint16_t)((_regs[0x04] << 8) | _regs[0x05]),
+                _regs[0x12],
+                (uint8_t)(_regs[0x10] & 0x0F),
+                _regs[0x11],
+                _regs[0x15],
+                _regs[0x08]};
+}
+
+bool CC1101Model::locked() const {
+  uint8_t f3, f2, f1;
+  calibratedFscal(phy().freq, &f3, &f2, &f1);
+  return _regs[0x23] == f3 && _regs[0x24] == f2 && _regs[0x25] == f1;
+}
+
+// Frequency-offset compensation range in FREQOFF steps: FOCCFG FOC_LIMIT of the RX
+// filter bandwidth (MDMCFG4), at least BW/16 for the demodulator itself.
+int CC1101Model::focTolerance() const {
+  uint8_t e = _regs[0x10] >> 6, m = (_regs[0x10] >> 4) & 0x03;
+  double bw = 26e6 / (8.0 * (4 + m) * (1 << e));
+  static const double kLimit[4] = {1.0 / 16, 1.0 / 8, 1.0 / 4, 1.0 / 2};
+  return (int)(bw * kLimit[_regs[0x19] & 0x03] / (26e6 / 16384));
+}
+
+void CC1101Model::update() {
+  int64_t now = _world.clock.now();
+  while (_until >= 0 && _until <= now) {
+    int64_t t = _until;
+    _until = -1;
+    switch (_then) {
+      case GO_IDLE:      _state = IDLE; break;
+      case GO_FSTXON:    _state = FSTXON; break;
+      case GO_RX:        enterRx(t); break;
+      case GO_TX:        startTx(t); break;
+      case TX_DONE:      finishTx(t); break;
+      case TX_UNDERFLOW:
+        _state = TXFIFO_UNDERFLOW;
+        _txUnderflow = true;
+        _txCount = 0;
+        _stats.txUnderflows++;
+        break;
+    }
+  }
+}
+
+void CC1101Model::after(int64_t t, uint8_t state, Then then) {
+  _state = state;
+  _until = t;
+  _then = then;
+  _world.clock.at(t, [this] { update(); });
+}
+
+// Leaving IDLE for RX/TX/FSTXON: calibrate first with FS_AUTOCAL = 1 (MCSM0[5:4]),
+// otherwise only let the PLL settle on the FSCAL values in the registers.
+void CC1101Model::synthStart(Then then) {
+  int64_t now = _world.clock.now();
+  if (((_regs[0x18] >> 4) & 0x03) == 1) {
+    if (!calibrate()) return;
+    after(now + kCalUs, STARTCAL, then);
+  } else {
+    after(now + kSettleUs, FS_LOCK, then);
+  }
+}
+
+bool CC1101Model::calibrate() {
+  _stats.calibrations++;
+  if (_world.droop(true)) {
+    brownout();
+    return false;
+  }
+  calibratedFscal(phy().freq, &_regs[0x23], &_regs[0x24], &_regs[0x25]);
+  return true;
+}
+
+void CC1101Model::enterRx(int64_t t) {
+  _state = RX;
+  _rxSince = t;
+}
+
+void CC1101Model::startTx(int64_t t) {
+  if (_world.droop(false)) {
+    brownout();
+    return;
+  }
+  SimPhy p = phy();
+  uint8_t preamble = kPreambleBytes[(_regs[0x13] >> 4) & 0x07];
+  uint8_t need = (_regs[0x08] & 0x03) == 1 ? (uint8_t)(_txFifo[0] + 1) : _regs[0x06];
+  if (_txCount == 0 || need > 64 || _txCount < need) {
+    // The modulator runs dry where the FIFO ends.
+    after(t + p.airtimeUs(preamble, _txCount) - p.airtimeUs(0, 0), TX, TX_UNDERFLOW);
+    return;
+  }
+  _tx = AirFrame{};
+  memcpy(_tx.bytes, _txFifo, need);
+  _tx.len = need;
+  _tx.phy = p;
+  _tx.freqOff = (int8_t)_regs[0x0C];
+  _tx.crcOk = true;
+  _tx.start = t;
+  _tx.syncAt = t + p.syncOffsetUs(preamble);
+  _tx.end = t + p.airtimeUs(preamble, need);
+  memmove(_txFifo, _txFifo + need, _txCount - need);
+  _txCount -= need;
+  after(_tx.end, TX, TX_DONE);
+}
+
+void CC1101Model::finishTx(int64_t t) {
+  uint8_t pa = _patable[_regs[0x22] & 0x07];  // FREND0 PA_POWER
+  if (pa != 0 && locked()) {
+    _stats.txFrames++;
+    _world.fromRadio(_tx);
+  } else {
+    _stats.txSilent++;
+  }
+  switch (_regs[0x17] & 0x03) {  // MCSM1 TXOFF_MODE
+    case 1: _state = FSTXON; break;
+    case 3: enterRx(t); break;
+    default: _state = IDLE; break;
+  }
+}
+
+bool CC1101Model::sniffCatches(const AirFrame &f) const {
+  if (_state != SLEEP || (_regs[0x20] & 0x80)) return false;  // WORCTRL RC_PD
+  uint32_t event0 = ((uint32_t)_regs[0x1E] << 8) | _regs[0x1F];
+  int64_t period = (int64_t)event0 * 750 / 26 << (5 * (_regs[0x20] & 0x03));
+  if (period <= 0) return false;
+  uint8_t rxTime = _regs[0x16] & 0x07;
+  int64_t settle = ((_regs[0x18] >> 4) & 0x03) == 1 ? kCalUs + kSettleUs : kSettleUs;
+  int64_t since = f.syncAt - _worStart;
+  if (since < period) return false;  // first EVENT0 one period after SWOR/SWORRST
+  int64_t phase = since % period - settle;
+  int64_t window = rxTime == 7 ? period : period >> (rxTime + 3);
+  return phase >= 0 && phase < window;
+}
+
+void CC1101Model::receive(const AirFrame &f) {
+  update();
+  bool sniff = sniffCatches(f);
+  if (!sniff && !(_state == RX && _rxSince <= f.syncAt)) {
+    _stats.rxAway++;
+    return;
+  }
+  int tolerance = focTolerance();
+  if (!locked() || !SimWorld::decodable(f, phy(), (int8_t)_regs[0x0C], tolerance)) {
+    _stats.rxDeaf++;
+    return;
+  }
+  if (sniff) _stats.worHits++;
+
+  int residual = (int)f.freqOff - (int8_t)_regs[0x0C];
+  _freqEst = (int8_t)residual;
+  _rssi = HeaterRadio::dbmToRssi(f.rssiDbm);
+  _lqi = (uint8_t)((f.crcOk ? 0x80 : 0) | (4 + (residual < 0 ? -residual : residual) * 2));
+  bool append = _regs[0x07] & 0x04;  // PKTCTRL1 APPEND_STATUS
+  bool flush = !f.crcOk && (_regs[0x07] & 0x08);  // CRC_AUTOFLUSH
+  if (!flush) {
+    uint8_t n = f.len + (append ? 2 : 0);
+    if (_rxCount + n > 64) {
+      _rxOverflow = true;
+      _state = RXFIFO_OVERFLOW;
+      _stats.rxOverflows++;
+      return;
+    }
+    if (_rxHead != 0) {
+      memmove(_rxFifo, _rxFifo + _rxHead, _rxCount);
+      _rxHead = 0;
+    }
+    uint8_t *dst = _rxFifo + _rxCount;
+    memcpy(dst, f.bytes, f.len);
+    if (append) {
+      dst[f.len] = _rssi;
+      dst[f.len + 1] = _lqi;
+    }
+    _rxCount += n;
+    _pktReady = f.crcOk;
+    _stats.rxFrames++;
+  }
+
+  int64_t t = _world.clock.now();
+  switch ((_regs[0x17] >> 2) & 0x03) {  // MCSM1 RXOFF_MODE
+    case 1: _state = FSTXON; break;
+    case 3: enterRx(t); break;
+    default: _state = IDLE; break;  // TX after RX not modelled
+  }
+}
+
+void CC1101Model::sleep() {
+  _worPending = false;
+  _state = SLEEP;
+  _until = -1;
+  _stats.sleeps++;
+  resetSleepLost();  // not retained in SLEEP
+}
+
+bool CC1101Model::wake() {
+  update();
+  if (_state != SLEEP) return true;
+  _world.clock.advance(kXoscStartUs);
+  _state = IDLE;
+  _stats.wakes++;
+  return true;
+}
+
+bool CC1101Model::gdo2() {
+  _world.clock.advance(1);
+  update();
+  uint8_t cfg = _regs[0x00];
+  bool v;
+  switch (cfg & 0x3F) {
+    case 0x01: v = _rxCount > 0; break;  // packets land whole: end of packet or threshold
+    case 0x07: v = _pktReady; break;
+    default:   v = false; break;         // 0x29 CHIP_RDYn: ready, low
+  }
+  return (cfg & 0x40) ? !v : v;
+}
+
+uint8_t CC1101Model::statusByte(bool read) const {
+  uint8_t s;
+  switch (_state) {
+    case IDLE:             s = 0; break;
+    case RX:               s = 1; break;
+    case TX:               s = 2; break;
+    case FSTXON:           s = 3; break;
+    case MANCAL:
+    case STARTCAL:         s = 4; break;
+    case RXFIFO_OVERFLOW:  s = 6; break;
+    case TXFIFO_UNDERFLOW: s = 7; break;
+    default:               s = 5; break;  // settling
+  }
+  uint8_t fifo = read ? _rxCount : (uint8_t)(64 - _txCount);
+  return (uint8_t)((s << 4) | (fifo > 15 ? 15 : fifo));
+}
+
+uint8_t CC1101Model::statusReg(uint8_t addr) const {
+  switch (addr) {
+    case 0x30: return 0x00;  // PARTNUM
+    case 0x31: return 0x14;  // VERSION
+    case 0x32: return (uint8_t)_freqEst;
+    case 0x33: return _lqi;
+    case 0x34: return _rssi;
+    case 0x35: return _state;
+    case 0x38: return (uint8_t)((_lqi & 0x80) | (_state == RX ? 0x10 : 0));  // PKTSTATUS: CRC_OK, CS
+    case 0x3A: return (uint8_t)((_txUnderflow ? 0x80 : 0) | _txCount);
+    case 0x3B: return (uint8_t)((_rxOverflow ? 0x80 : 0) | _rxCount);
+    default:   return 0x00;
+  }
+}
+
+void CC1101Model::strobe(uint8_t cmd) {
+  int64_t now = _world.clock.now();
+  switch (cmd) {
+    case 0x30:  // SRES
+      resetRegs();
+      break;
+    case 0x31:  // SFSTXON
+      if (_state == IDLE) synthStart(GO_FSTXON);
+      else if (_state == RX) _state = FSTXON;
+      break;
+    case 0x33:  // SCAL
+      if (_state == IDLE && calibrate()) after(now + kCalUs, MANCAL, GO_IDLE);
+      break;
+    case 0x34:  // SRX
+      if (_state == IDLE) synthStart(GO_RX);
+      else if (_state == FSTXON) enterRx(now);
+      break;
+    case 0x35:  // STX
+      if (_state == IDLE) synthStart(GO_TX);
+      else if (_state == FSTXON || _state == RX) startTx(now);
+      break;
+    case 0x36:  // SIDLE
+      if (_state != IDLE) {
+        _state = IDLE;
+        _until = -1;
+      }
+      break;
+    case 0x38:  // SWOR
+      if (_state == IDLE) _worPending = true;
+      break;
+    case 0x3A:  // SFRX
+      if (_state == IDLE || _state == RXFIFO_OVERFLOW) {
+        _rxCount = _rxHead = 0;
+        _rxOverflow = _pktReady = false;
+        _state = IDLE;
+      }
+      break;
+    case 0x3B:  // SFTX
+      if (_state == IDLE || _state == TXFIFO_UNDERFLOW) {
+        _txCount = 0;
+        _txUnderflow = false;
+        _state = IDLE;
+      }
+      break;
+    case 0x3C:  // SWORRST
+      _worStart = now;
+      break;
+    default:  // SXOFF, SPWD, SAFC, SNOP — not used by the driver
+      break;
+  }
+}
+
+const uint8_t *CC1101Model::transfer(const uint8_t *tx, size_t len, bool wait) {
+  if (len == 0) return _rx;
+  if (len > sizeof(_rx)) len = sizeof(_rx);
+  int64_t cost = kXferOverheadUs + (int64_t)len * 8;  // 1 MHz SCLK
+  _world.clock.advance(cost);
+  _spiUs += (uint32_t)cost;
+  update();
+  if (_state == SLEEP) _state = IDLE;  // CSn low wakes the chip
+
+  uint8_t hdr = tx[0];
+  bool read = hdr & 0x80, burst = hdr & 0x40;
+  uint8_t addr = hdr & 0x3F;
+  uint8_t status = statusByte(read);
+  _rx[0] = status;
+  for (size_t i = 1; i < len; i++) _rx[i] = status;
+
+  if (addr < 0x30) {
+    for (size_t i = 1; i < len; i++) {
+      uint8_t a = burst ? (uint8_t)(addr + i - 1) : addr;
+      if (a > 0x2E) break;
+      if (read) _rx[i] = _regs[a];
+      else _regs[a] = tx[i];
+      if (!burst) break;
+    }
+  } else if (addr == 0x3E) {  // PATABLE, index reset by CSn high
+    for (size_t i = 1; i < len; i++) {
+      if (read) _rx[i] = _patable[(i - 1) & 0x07];
+      else _patable[(i - 1) & 0x07] = tx[i];
+      if (!burst) break;
+    }
+  } else if (addr == 0x3F) {  // FIFOs
+    for (size_t i = 1; i < len; i++) {
+      if (read) {
+        if (_rxCount > 0) {
+          _rx[i] = _rxFifo[_rxHead++];
+          if (--_rxCount == 0) _rxHead = 0;
+        } else {
+          _rx[i] = 0;
+        }
+        _pktReady = false;  // IOCFG2 0x07 de-asserts on the first FIFO read
+      } else if (_txCount < 64) {
+        _txFifo[_txCount++] = tx[i];
+      }
+      if (!burst) break;
+    }
+  } else if (read && burst) {
+    if (len > 1) _rx[1] = statusReg(addr);
+  } else {
+    strobe(addr);
+  }
+
+  if (_worPending) sleep();  // SWOR takes effect when CSn goes high
+  return _rx;
+}
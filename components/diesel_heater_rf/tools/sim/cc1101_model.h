@@ -0,0 +1,124 @@
+/*
+ * cc1101_model.h — register- and MARCSTATE-level CC1101 model behind DieselHeaterBus.
+ *
+ * Decodes SPI transactions the way the chip does (header R/W and burst bits, config
+ * registers 0x00–0x2E, status registers and command strobes at 0x30–0x3D, PATABLE, the
+ * 64-byte TX and RX FIFOs) and returns the status byte first. Modelled behaviour:
+ *   - IDLE → (FS_AUTOCAL calibration or PLL settling) → RX / TX / FSTXON; SCAL; TXOFF and
+ *     RXOFF modes; FSTXON → TX/RX without calibration; SIDLE, SRES, SFRX, SFTX
+ *   - TX airtime from the data rate, preamble, sync mode and CRC registers; TXFIFO
+ *     underflow when the FIFO holds less than the length byte announces
+ *   - RX: variable-length packets with APPEND_STATUS (RSSI, CRC_OK|LQI), FREQEST,
+ *     RXFIFO overflow, GDO2 per IOCFG2 (0x07 CRC-OK packet, 0x01 FIFO/end of packet)
+ *   - calibration: FSCAL3..1 get values derived from FREQ; with FS_AUTOCAL off the
+ *     synthesizer only locks if FSCAL3..1 hold the values for the current frequency
+ *   - wake-on-radio: SWOR sleeps when CSn goes high, losing TEST2..0 and PATABLE; sniffs
+ *     every EVENT0 for the MCSM2 RX_TIME share; CSn low wakes the chip to IDLE, after
+ *     kXoscStartUs when the driver waits for it (wake())
+ *   - brownout(): power-on reset values, as after a VCC droop
+ * Not modelled: CCA, address filtering, whitening, Manchester, RX_TIME outside WOR.
+ *
+ * Every call costs virtual time: SPI at 1 MHz plus kXferOverheadUs per transaction, so
+ * the driver's MARCSTATE polling loops make progress without a real clock.
+ */
+
+#ifndef CC1101Model_h
+#define CC1101Model_h
+
+#include <stdint.h>
+#include "DieselHeaterRF.h"
+#include "sim_world.h"
+
+class CC1101Model : public DieselHeaterBus {
+  public:
+    static constexpr int64_t kCalUs = 721;          // FS calibration from IDLE
+    static constexpr int64_t kSettleUs = 90;        // PLL settling, calibration skipped
+    static constexpr int64_t kXferOverheadUs = 10;  // CS setup and driver overhead per transaction
+    static constexpr int64_t kYieldUs = 1000;
+    static constexpr int64_t kXoscStartUs = 150;    // crystal start-up after SLEEP
+
+    explicit CC1101Model(SimWorld &world);
+
+    const uint8_t *transfer(const uint8_t *tx, size_t len, bool wait) override;
+    bool wake() override;
+    bool gdo2() override;
+    int64_t micros() override { return _world.clock.now(); }
+    void delay(uint32_t ms) override { _world.clock.advance((int64_t)ms * 1000); }
+    void yield() override { _world.clock.advance(kYieldUs); }
+    uint32_t cpuUs() const override { return _spiUs; }
+
+    // Air side (SimWorld): a frame that ends now.
+    void receive(const AirFrame &f);
+    // Power-on reset: registers, PATABLE, FIFOs and state.
+    void brownout();
+
+    uint8_t marcstate() {
+      update();
+      return _state;
+    }
+    uint8_t reg(uint8_t addr) const { return _regs[addr]; }
+    SimPhy phy() const;
+
+    struct Stats {
+      uint32_t calibrations{0};
+      uint32_t brownouts{0};
+      uint32_t txFrames{0};
+      uint32_t txSilent{0};     // transmitted without a carrier: PA off or synthesizer unlocked
+      uint32_t txUnderflows{0};
+      uint32_t rxFrames{0};     // into the RX FIFO
+      uint32_t rxAway{0};       // ended while the chip was not listening
+      uint32_t rxDeaf{0};       // listening, but PHY, lock or offset did not fit
+      uint32_t rxOverflows{0};
+      uint32_t worHits{0};      // caught by a wake-on-radio sniff
+      uint32_t sleeps{0};
+      uint32_t wakes{0};        // wake() found the chip in SLEEP
+    };
+    const Stats &stats() const { return _stats; }
+
+  private:
+    enum Marc : uint8_t {
+      SLEEP = 0x00, IDLE = 0x01, MANCAL = 0x05, STARTCAL = 0x08, FS_LOCK = 0x0A, RX = 0x0D,
+      RXFIFO_OVERFLOW = 0x11, FSTXON = 0x12, TX = 0x13, TXFIFO_UNDERFLOW = 0x16,
+    };
+    // What happens when the timed state ends.
+    enum Then : uint8_t { GO_IDLE, GO_RX, GO_TX, GO_FSTXON, TX_DONE, TX_UNDERFLOW };
+
+    void update();
+    void after(int64_t t, uint8_t state, Then then);
+    void synthStart(Then then);
+    bool calibrate();
+    bool locked() const;
+    void enterRx(int64_t t);
+    void startTx(int64_t t);
+    void finishTx(int64_t t);
+    void strobe(uint8_t cmd);
+    void sleep();
+    bool sniffCatches(const AirFrame &f) const;
+    uint8_t statusByte(bool read) const;
+    uint8_t statusReg(uint8_t addr) const;
+    int focTolerance() const;
+    void resetRegs();
+    void resetSleepLost();
+
+    SimWorld &_world;
+    uint8_t _regs[0x2F];
+    uint8_t _patable[8];
+    uint8_t _txFifo[64], _rxFifo[64];
+    uint8_t _txCount{0}, _rxCount{0}, _rxHead{0};
+    bool _rxOverflow{false}, _txUnderflow{false};
+    bool _pktReady{false};      // IOCFG2 0x07: CRC-OK packet, cleared by the first FIFO read
+    uint8_t _state{IDLE};
+    int64_t _until{-1};         // end of the timed state, -1 = none
+    Then _then{GO_IDLE};
+    int64_t _rxSince{0};
+    AirFrame _tx{};             // frame on the air while in TX
+    bool _worPending{false};    // SWOR seen, sleeps when CSn goes high
+    int64_t _worStart{0};       // SWORRST / SWOR
+    int8_t _freqEst{0};
+    uint8_t _lqi{0}, _rssi{0x80};
+    uint8_t _rx[66];
+    uint32_t _spiUs{0};
+    Stats _stats;
+};
+
+#endif
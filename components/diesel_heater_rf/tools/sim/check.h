@@ -0,0 +1,38 @@
+/*
+ * check.h — assertions for the tools/sim check programs. A failed CHECK prints its
+ * expression and line and the program carries on; checkExit() prints the totals and
+ * returns the exit status for make.
+ */
+
+#ifndef SimCheck_h
+#define SimCheck_h
+
+#include <stdio.h>
+
+inline unsigned g_checks = 0;
+inline unsigned g_checkFailures = 0;
+
+inline bool checkResult(bool ok, const char *expr, const char *file, int line) {
+  g_checks++;
+  if (!ok) {
+    g_checkFailures++;
+    printf("FAIL: %s:%d: %s\n", file, line, expr);
+  }
+  return ok;
+}
+
+inline bool checkEqual(long long a, long long b, const char *expr, const char *file, int line) {
+  if (checkResult(a == b, expr, file, line)) return true;
+  printf("      got %lld (0x%llX), expected %lld (0x%llX)\n", a, (unsigned long long)a, b, (unsigned long long)b);
+  return false;
+}
+
+#define CHECK(cond) checkResult((cond), #cond, __FILE__, __LINE__)
+#define CHECK_EQ(a, b) checkEqual((long long)(a), (long long)(b), #a " == " #b, __FILE__, __LINE__)
+
+inline int checkExit(const char *name) {
+  printf("%s: %u checks, %u failed\n", name, g_checks, g_checkFailures);
+  return g_checkFailures != 0 ? 1 : 0;
+}
+
+#endif
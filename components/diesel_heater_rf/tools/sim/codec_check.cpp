@@ -0,0 +1,164 @@
+/*
+ * codec_check.cpp — HeaterProtocol.h on the host: CommandFrame::finish() against a
+ * bitwise CRC-16/MODBUS for every sequence number, StateView decoding of a 26-byte
+ * raw-capture frame, and the throughput of the table CRC against the bitwise one.
+ *
+ *   make codec_check && ./codec_check [--bench-mb N]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+#include "HeaterProtocol.h"
+#include "check.h"
+
+using namespace HeaterProtocol;
+
+// Reference: CRC-16/MODBUS one bit at a time (reflected poly 0xA001, seed 0xFFFF).
+static uint16_t crcBitwise(const uint8_t *buf, size_t len) {
+  uint16_t crc = 0xFFFF;
+  for (size_t i = 0; i < len; i++) {
+    crc ^= buf[i];
+    for (int b = 0; b < 8; b++) crc = (crc & 1) ? (uint16_t)((crc >> 1) ^ 0xA001) : (uint16_t)(crc >> 1);
+  }
+  return crc;
+}
+
+static void checkCommandFrames() {
+  printf("CommandFrame::finish() against the bitwise CRC, every seq\n");
+  static const uint8_t kCmds[] = {HEATER_CMD_GET_STATUS, HEATER_CMD_MODE, HEATER_CMD_POWER, HEATER_CMD_UP,
+                                  HEATER_CMD_DOWN};
+  static const uint32_t kAddrs[] = {0x00000000, 0x12AB34CD, 0x80000000, 0x9C8AF1E3, 0xFFFFFFFF};
+  const uint8_t check[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+  CHECK_EQ(crcBitwise(check, sizeof(check)), 0x4B37);
+
+  unsigned mismatches = 0;
+  for (uint8_t cmd : kCmds) {
+    for (uint32_t addr : kAddrs) {
+      CommandFrame frame(cmd, addr);
+      CHECK(frame.matches(cmd, addr));
+      for (int seq = 0; seq < 256; seq++) {
+        const uint8_t *b = frame.finish((uint8_t)seq);
+        uint8_t want[kCommandFrame] = {kCommandLen, cmd, (uint8_t)(addr >> 24), (uint8_t)(addr >> 16),
+                                       (uint8_t)(addr >> 8), (uint8_t)addr, (uint8_t)seq, 0, 0, 0};
+        uint16_t crc = crcBitwise(want, OFF_CRC);
+        want[OFF_CRC] = (uint8_t)(crc >> 8);
+        want[OFF_CRC + 1] = (uint8_t)crc;
+        if (memcmp(b, want, kCommandFrame) != 0 && mismatches++ < 4) {
+          printf("FAIL: cmd 0x%02X addr 0x%08X seq 0x%02X:", cmd, (unsigned)addr, seq);
+          for (int i = 0; i < kCommandFrame; i++) printf(" %02X/%02X", b[i], want[i]);
+          printf("\n");
+        }
+        if (readAddress(b) != addr) mismatches++;
+      }
+    }
+  }
+  CHECK_EQ(mismatches, 0);
+
+  // crc16() itself on every length up to a FIFO, and continued from a partial CRC.
+  uint8_t buf[64];
+  uint32_t x = 0x2545F491;
+  for (uint8_t &v : buf) {
+    x ^= x << 13, x ^= x >> 17, x ^= x << 5;
+    v = (uint8_t)x;
+  }
+  for (size_t len = 0; len <= sizeof(buf); len++) CHECK_EQ(crc16(buf, len), crcBitwise(buf, len));
+  CHECK_EQ(crc16(buf + 20, 44, crc16(buf, 20)), crcBitwise(buf, 64));
+}
+
+// A running heater's state packet in the raw-capture layout (debug mode, readRawFrame):
+// length byte, 23 payload bytes, RSSI, CRC_OK|LQI. Every address byte is ≥ 0x80, and the
+// ambient temperature is below zero.
+static const uint8_t kCaptured[kStateRxLen] = {
+  0x17, 0x00, 0x9C, 0x8A, 0xF1, 0xE3, 0x05, 0x04, 0x00, 0x7C, 0xFD, 0x00, 0x6E,
+  0x16, 0x32, 0x2A, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xD0, 0x9E,
+};
+
+static void checkStateView() {
+  printf("StateView: captured 26-byte frame\n");
+  StateView v(kCaptured);
+  CHECK_EQ(v.length(), kStateLen);
+  CHECK_EQ(v.address(), 0x9C8AF1E3u);
+  CHECK_EQ(readAddress(kCaptured), 0x9C8AF1E3u);
+  CHECK_EQ(v.state(), HEATER_STATE_RUNNING);
+  CHECK_EQ(v.power(), 4);
+  CHECK_EQ(v.errorCode(), 0);
+  CHECK(v.voltage() > 12.39f && v.voltage() < 12.41f);
+  CHECK_EQ(v.ambientTemp(), -3);
+  CHECK_EQ(v.caseTemp(), 110);
+  CHECK_EQ(v.setpoint(), 22);
+  CHECK(v.autoMode());
+  CHECK(v.pumpFreq() > 4.19f && v.pumpFreq() < 4.21f);
+  CHECK_EQ(v.rssiRaw(), 0xD0);
+  CHECK(v.crcOk());
+  CHECK_EQ(v.lqi(), 0x1E);
+
+  heater_state_t st;
+  v.decode(&st);
+  CHECK_EQ(st.state, HEATER_STATE_RUNNING);
+  CHECK_EQ(st.ambientTemp, -3);
+  CHECK_EQ(st.setpoint, 22);
+  CHECK(st.autoMode);
+
+  // The same address in a remote-command frame, and a negative setpoint byte.
+  uint8_t remote[kRemoteRxLen];
+  memcpy(remote, CommandFrame(HEATER_CMD_POWER, 0x9C8AF1E3).bytes(), kCommandFrame);
+  CHECK_EQ(readAddress(remote), 0x9C8AF1E3u);
+  uint8_t cold[kStateRxLen];
+  memcpy(cold, kCaptured, sizeof(cold));
+  cold[OFF_SETPOINT] = 0xF6;
+  cold[OFF_AUTO] = 0xCD;
+  CHECK_EQ(StateView(cold).setpoint(), -10);
+  CHECK(!StateView(cold).autoMode());
+}
+
+template <typename F>
+static double mbPerS(F crc, const std::vector<uint8_t> &data, size_t chunk, uint32_t *sink) {
+  auto t0 = std::chrono::steady_clock::now();
+  for (size_t i = 0; i + chunk <= data.size(); i += chunk) *sink += crc(data.data() + i, chunk);
+  double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  return s > 0 ? data.size() / s / 1e6 : 0.0;
+}
+
+static void benchmark(size_t mb) {
+  printf("CRC throughput, %zu MB\n", mb);
+  std::vector<uint8_t> data(mb << 20);
+  uint32_t x = 1;
+  for (uint8_t &v : data) {
+    x = x * 1664525u + 1013904223u;
+    v = (uint8_t)(x >> 24);
+  }
+  uint32_t sink = 0;
+  // Chunks the size of a command frame prefix and of a full FIFO.
+  for (size_t chunk : {(size_t)OFF_CRC, (size_t)64}) {
+    double table = mbPerS([](const uint8_t *b, size_t n) { return crc16(b, n); }, data, chunk, &sink);
+    double bitwise = mbPerS(crcBitwise, data, chunk, &sink);
+    printf("  %2zu-byte chunks: table %7.1f MB/s, bitwise %7.1f MB/s (%.1fx)\n", chunk, table, bitwise,
+           bitwise > 0 ? table / bitwise : 0.0);
+  }
+
+  CommandFrame frame(HEATER_CMD_GET_STATUS, 0x9C8AF1E3);
+  const uint32_t n = 1u << 24;
+  auto t0 = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < n; i++) sink += frame.finish((uint8_t)i)[OFF_CRC];
+  double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  printf("  finish(): %.2f ns per frame (sink %u)\n", s * 1e9 / n, (unsigned)(sink & 1));
+}
+
+int main(int argc, char **argv) {
+  size_t mb = 16;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--bench-mb") && i + 1 < argc) {
+      mb = (size_t)atoi(argv[++i]);
+    } else {
+      fprintf(stderr, "usage: %s [--bench-mb N]   (0 skips the benchmark)\n", argv[0]);
+      return 2;
+    }
+  }
+  checkCommandFrames();
+  checkStateView();
+  if (mb > 0) benchmark(mb);
+  return checkExit("codec_check");
+}
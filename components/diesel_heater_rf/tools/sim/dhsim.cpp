@@ -0,0 +1,432 @@
+/*
+ * dhsim.cpp — host harness: the real DieselHeaterRF driver, CommandCycle, LinkPolicy and
+ * CoexScheduler against the CC1101 model and a simulated heater, on a virtual clock.
+ *
+ * Runs N command sequences — a status poll or a user command (power, mode, up, down,
+ * set_value) — through the component's command cycle and reports time-to-ACK, attempts per
+ * ACK, burst and recovery counts, and the simulation rate. HostLoop below stands in for the
+ * ESPHome side of DieselHeaterRFComponent only; the TX/RX cycle is the component's own.
+ *
+ *   make && ./dhsim -n 5000
+ *   ./dhsim -n 2000 --loss 0.3 --reply-loss 0.2 --adaptive
+ *   ./dhsim -n 2000 --cal-brownout 0.05 --wifi-period 20000 --wifi-brownout 0.3 --cal-cache
+ *   ./dhsim -n 2000 --pipelined                                        # set_value steps back-to-back
+ *   ./dhsim -n 2000 --loss 0.2 --max-p99-ms 4000 --min-ack-rate 0.99   # exit 1 on a regression
+ *   ./dhsim -n 3 -v 4                                                  # driver log, virtual time
+ *
+ * A run is reproducible from its seed (--seed).
+ */
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <vector>
+#include "DieselHeaterRF.h"
+#include "coex_scheduler.h"
+#include "command_cycle.h"
+#include "link_policy.h"
+#include "cc1101_model.h"
+#include "sim_heater.h"
+#include "sim_world.h"
+
+using esphome::diesel_heater_rf::CalibrationMark;
+using esphome::diesel_heater_rf::CoexScheduler;
+using esphome::diesel_heater_rf::CommandCycle;
+using esphome::diesel_heater_rf::LinkPolicy;
+
+static const VirtualClock *g_clock = nullptr;
+static int g_logLevel = 0;
+
+void simLog(int level, char letter, const char *tag, const char *fmt, ...) {
+  if (level > g_logLevel) return;
+  fprintf(stderr, "[%11.3f][%c][%s] ", g_clock != nullptr ? g_clock->now() / 1e6 : 0.0, letter, tag);
+  va_list ap;
+  va_start(ap, fmt);
+  vfprintf(stderr, fmt, ap);
+  va_end(ap);
+  fputc('\n', stderr);
+}
+
+struct Options {
+  uint32_t sequences{1000};
+  uint32_t seed{1};
+  SimFaults faults;
+  int freqErr{6};
+  bool calCache{false};
+  bool coex{true};
+  bool afc{true};
+  bool adaptive{false};
+  bool pipelined{false};
+  uint32_t loopMs{16};    // ESPHome's default loop interval
+  uint32_t gapMs{3000};   // between sequences
+  double maxP99Ms{0};     // gates, 0 = off
+  double minAckRate{0};
+};
+
+// DieselHeaterRFComponent's side of the CommandCycle for one heater: the service guards,
+// update()'s health check and poll, deferred publishing (a coexistence hold only) and the
+// instrumentation hooks. The cycle itself — queue, idempotency checks, set_value stepping,
+// TX burst, RX window, retransmit/offline escalation, AFC and calibration caching — is the
+// component's own code. Passive listening, the shared-radio scheduler and persistence are
+// left out.
+class HostLoop : public CommandCycle::Host {
+  public:
+    static constexpr uint32_t kAddr = 0x12ABF4CD;
+    static constexpr uint32_t kPublishMessages = 5;  // sensors that change on a typical reply
+
+    HostLoop(DieselHeaterRF &radio, SimWorld &world, const Options &o) : _radio(radio), _world(world), _o(o) {
+      if (o.adaptive) _policy.set_bounds(8, 14, 400, 1500, 1600);
+      _cycle.bind(this, &radio, &_policy, o.coex ? &_coex : nullptr, &_cal);
+      _cycle.set_address(kAddr);
+      _cycle.set_cal_cache(o.calCache);
+      _cycle.set_freq_tracking(o.afc);
+      _cycle.set_pipelined(o.pipelined);
+    }
+
+    std::function<void(uint32_t id, bool ok)> onDone;
+
+    // Service handlers: false where the component rejects the command.
+    bool submit(uint8_t cmd, uint32_t id) {
+      if (_cycle.offline()) return false;
+      if (cmd == HEATER_CMD_POWER) {
+        uint8_t s = _state.state;
+        if (s != HEATER_STATE_OFF && s != HEATER_STATE_RUNNING) return false;
+        _cycle.expect_power(s == HEATER_STATE_OFF);
+      } else if (cmd == HEATER_CMD_MODE) {
+        _cycle.expect_mode(!_state.autoMode);
+      }
+      _cycle.push(cmd, id);
+      return true;
+    }
+
+    // set_value with a target already clamped to the current mode's range.
+    bool submitSetValue(float target, uint32_t id) {
+      if (_cycle.offline()) return false;
+      _cycle.set_value_target(target);
+      _cycle.push(CommandCycle::CMD_SET_VALUE, id);
+      return true;
+    }
+
+    // update(): health check, then a status poll.
+    void poll(uint32_t id) {
+      if (_radio.checkHealth(false) == HeaterRadio::HEALTH_LOST) {
+        _stats.healthReinits++;
+        _radio.reinitRadio();
+      }
+      _cycle.push(HEATER_CMD_GET_STATUS, id);
+    }
+
+    void onWifiEvent(uint32_t now, uint32_t holdMs) {
+      if (_o.coex) _coex.on_wifi_event(now, holdMs);
+    }
+
+    void loop() {
+      if (_cycle.loop_rx()) return;
+      if (_publishPending && !_cycle.pipelining()) {
+        _publishPending = false;
+        if (_o.coex) _coex.on_publish(ms(), kPublishMessages);
+        return;
+      }
+      _cycle.loop_tx();
+    }
+
+    bool busy() const { return _cycle.listening() || !_cycle.empty(); }
+    bool offline() const { return _cycle.offline(); }
+    uint32_t nextProbeMs() const { return _cycle.next_probe_ms(); }
+    uint32_t offlineMs() const { return _stats.offlineMs + (_cycle.offline() ? ms() - _offlineSinceMs : 0); }
+    const heater_state_t &state() const { return _state; }
+    const CommandCycle &cycle() const { return _cycle; }
+    const LinkPolicy &policy() const { return _policy; }
+    const CoexScheduler &coex() const { return _coex; }
+
+    struct Stats {
+      uint32_t healthReinits{0};   // update() health check
+      uint32_t offlineMs{0};       // ended episodes, see HostLoop::offlineMs()
+      uint64_t burstCpuUs{0};
+      uint64_t burstWallUs{0};
+      uint32_t attempts[CommandCycle::kMaxAttempts + 1]{};  // per ACK
+    };
+    const Stats &stats() const { return _stats; }
+
+    // CommandCycle::Host
+    uint32_t cycle_millis() override { return ms(); }
+    void cycle_delay(uint32_t delayMs) override { _world.clock.advance((int64_t)delayMs * 1000); }
+    const heater_state_t &cycle_state() override { return _state; }
+    bool cycle_state_valid() override { return _stateValid; }
+    uint8_t cycle_take_seq() override { return _radio.nextSeq(); }
+    void cycle_sent(uint32_t reinitMs) override {
+      _stats.burstCpuUs += _radio.getLastBurstCpuUs();
+      _stats.burstWallUs += _radio.getLastBurstWallUs();
+    }
+    void cycle_acked(const heater_state_t &state, uint32_t id, uint8_t attempts, uint32_t ackDelayMs) override {
+      _stats.attempts[attempts]++;
+      _state = state;
+      _stateValid = true;
+      _publishPending = true;
+    }
+    void cycle_completed(uint32_t id, bool ok) override {
+      if (onDone) onDone(id, ok);
+    }
+    void cycle_offline(bool first) override {
+      if (first) _offlineSinceMs = ms();
+    }
+    void cycle_online() override { _stats.offlineMs += ms() - _offlineSinceMs; }
+
+  private:
+    uint32_t ms() const { return _world.clock.millis(); }
+
+    DieselHeaterRF &_radio;
+    SimWorld &_world;
+    const Options &_o;
+    LinkPolicy _policy;
+    CoexScheduler _coex;
+    CalibrationMark _cal;
+    CommandCycle _cycle;
+    heater_state_t _state{};
+    bool _stateValid{false};
+    bool _publishPending{false};
+    uint32_t _offlineSinceMs{0};
+    Stats _stats;
+};
+
+static void usage() {
+  fprintf(stderr,
+          "usage: dhsim [options]\n"
+          "  -n N                 command sequences (default 1000)\n"
+          "  --seed S             RNG seed (default 1)\n"
+          "  --loss P             probability the heater misses one of our packets\n"
+          "  --reply-loss P       probability we miss the heater's reply\n"
+          "  --crc-error P        probability a reply arrives with CRC_OK clear\n"
+          "  --cal-brownout P     probability a calibration resets the CC1101\n"
+          "  --wifi-period MS     mean gap between WiFi events (0 = none)\n"
+          "  --wifi-brownout P    probability TX/calibration during WiFi TX resets the CC1101\n"
+          "  --freq-err STEPS     heater carrier offset, FREQOFF steps (default 6)\n"
+          "  --cal-cache          calibration caching (cal_cache: true)\n"
+          "  --adaptive           adaptive_tx with the default bounds\n"
+          "  --pipelined          set_value_pipelined: all UP/DOWN steps of a set_value back-to-back\n"
+          "  --no-coex            ignore WiFi events\n"
+          "  --no-afc             no frequency-offset tracking\n"
+          "  --loop-ms MS         loop() interval (default 16)\n"
+          "  --gap-ms MS          time between sequences (default 3000)\n"
+          "  --max-p99-ms MS      fail if the p99 time-to-ACK exceeds MS\n"
+          "  --min-ack-rate R     fail if fewer than R of the sequences are acknowledged\n"
+          "  -v LEVEL             driver log to stderr, 1 = errors … 5 = verbose\n");
+}
+
+static bool parseArgs(int argc, char **argv, Options *o) {
+  for (int i = 1; i < argc; i++) {
+    const char *a = argv[i];
+    const char *v = i + 1 < argc ? argv[i + 1] : nullptr;
+    auto takes = [&](const char *name) {
+      if (strcmp(a, name) != 0) return false;
+      if (v == nullptr) {
+        fprintf(stderr, "%s needs a value\n", name);
+        exit(2);
+      }
+      i++;
+      return true;
+    };
+    if (takes("-n")) o->sequences = (uint32_t)strtoul(v, nullptr, 0);
+    else if (takes("--seed")) o->seed = (uint32_t)strtoul(v, nullptr, 0);
+    else if (takes("--loss")) o->faults.cmdLoss = atof(v);
+    else if (takes("--reply-loss")) o->faults.replyLoss = atof(v);
+    else if (takes("--crc-error")) o->faults.crcError = atof(v);
+    else if (takes("--cal-brownout")) o->faults.calBrownout = atof(v);
+    else if (takes("--wifi-period")) o->faults.wifiPeriodMs = (uint32_t)strtoul(v, nullptr, 0);
+    else if (takes("--wifi-brownout")) o->faults.wifiBrownout = atof(v);
+    else if (takes("--freq-err")) o->freqErr = atoi(v);
+    else if (takes("--loop-ms")) o->loopMs = (uint32_t)strtoul(v, nullptr, 0);
+    else if (takes("--gap-ms")) o->gapMs = (uint32_t)strtoul(v, nullptr, 0);
+    else if (takes("--max-p99-ms")) o->maxP99Ms = atof(v);
+    else if (takes("--min-ack-rate")) o->minAckRate = atof(v);
+    else if (takes("-v")) g_logLevel = atoi(v);
+    else if (strcmp(a, "--cal-cache") == 0) o->calCache = true;
+    else if (strcmp(a, "--adaptive") == 0) o->adaptive = true;
+    else if (strcmp(a, "--pipelined") == 0) o->pipelined = true;
+    else if (strcmp(a, "--no-coex") == 0) o->coex = false;
+    else if (strcmp(a, "--no-afc") == 0) o->afc = false;
+    else {
+      usage();
+      return false;
+    }
+  }
+  if (o->loopMs == 0) o->loopMs = 1;
+  return true;
+}
+
+static double percentile(const std::vector<uint32_t> &sorted, double p) {
+  if (sorted.empty()) return 0;
+  size_t i = (size_t)ceil(p * sorted.size());
+  return sorted[i == 0 ? 0 : i - 1];
+}
+
+int main(int argc, char **argv) {
+  Options o;
+  if (!parseArgs(argc, argv, &o)) return 2;
+
+  SimWorld world(o.seed);
+  world.faults = o.faults;
+  g_clock = &world.clock;
+  CC1101Model chip(world);
+  SimHeater heater(world, HostLoop::kAddr);
+  heater.freqErr = (int8_t)o.freqErr;
+
+  DieselHeaterRF radio;
+  radio.setBus(&chip);
+  radio.setCalCache(o.calCache);
+  world.clock.advance(100 * 1000);  // setup(): power-on settling
+  radio.begin(HostLoop::kAddr);
+  char info[64];
+  if (!radio.probe(info, sizeof(info))) {
+    fprintf(stderr, "probe failed: %s\n", info);
+    return 2;
+  }
+
+  HostLoop host(radio, world, o);
+  world.startWifi([&](uint32_t now, uint32_t holdMs) { host.onWifiEvent(now, holdMs); });
+
+  // The loop() cadence; the driver's own SPI, delays and yields advance the clock too.
+  auto runUntil = [&](std::function<bool()> done) {
+    while (!done()) {
+      host.loop();
+      world.clock.advance((int64_t)o.loopMs * 1000);
+    }
+  };
+
+  struct Outcome {
+    bool done{false}, ok{false};
+    uint32_t doneMs{0};
+  };
+  Outcome cur;
+  uint32_t curId = 0;
+  host.onDone = [&](uint32_t id, bool ok) {
+    if (id != curId) return;
+    cur.done = true;
+    cur.ok = ok;
+    cur.doneMs = world.clock.millis();
+  };
+
+  std::vector<uint32_t> ackMs, setMs;  // time-to-ACK; set_value time to target (many bursts)
+  uint32_t acked = 0, failed = 0, rejected = 0, extraToggles = 0, stalled = 0, missedTargets = 0;
+  uint32_t byCmd[6] = {};
+  auto wall0 = std::chrono::steady_clock::now();
+
+  for (uint32_t id = 1; id <= o.sequences; id++) {
+    uint32_t gapEnd = world.clock.millis() + o.gapMs;
+    runUntil([&] { return !host.busy() && (int32_t)(world.clock.millis() - gapEnd) >= 0; });
+
+    // Mix: half status polls, the rest user commands. The first sequence learns the state.
+    static const uint8_t kCmds[] = {HEATER_CMD_GET_STATUS, HEATER_CMD_POWER, HEATER_CMD_MODE, HEATER_CMD_UP,
+                                    HEATER_CMD_DOWN, CommandCycle::CMD_SET_VALUE};
+    uint32_t r = world.uniform(0, 99);
+    int pick = id == 1 || r < 50 ? 0 : r < 62 ? 1 : r < 70 ? 2 : r < 80 ? 3 : r < 90 ? 4 : 5;
+    uint8_t cmd = kCmds[pick];
+
+    curId = id;
+    cur = Outcome{};
+    uint32_t toggles0 = heater.stats().toggles;
+    uint32_t t0;
+    // set_value: a target a few steps away, within on_set_value()'s clamp for the mode.
+    bool autoMode = host.state().autoMode;
+    int target = autoMode ? (int)world.uniform(8, 35) : (int)world.uniform(17, 55);
+    bool accepted = cmd == CommandCycle::CMD_SET_VALUE
+                        ? host.submitSetValue(autoMode ? (float)target : target / 10.0f, id)
+                        : cmd != HEATER_CMD_GET_STATUS && host.submit(cmd, id);
+    if (!accepted) {
+      if (cmd != HEATER_CMD_GET_STATUS) rejected++;
+      pick = 0;
+      // Offline, update() polls only when the backoff has run out.
+      if (host.offline()) runUntil([&] { return (int32_t)(world.clock.millis() - host.nextProbeMs()) >= 0; });
+      t0 = world.clock.millis();
+      host.poll(id);
+    } else {
+      t0 = world.clock.millis();
+    }
+    byCmd[pick]++;
+
+    uint32_t limit = t0 + 3600 * 1000;
+    runUntil([&] { return cur.done || (int32_t)(world.clock.millis() - limit) >= 0; });
+    if (!cur.done) {
+      stalled++;
+      fprintf(stderr, "sequence %u: no outcome after 1 h of virtual time\n", (unsigned)id);
+      break;
+    }
+    if (cur.ok) {
+      acked++;
+      (pick == 5 ? setMs : ackMs).push_back(cur.doneMs - t0);
+      // The heater may have switched mode meanwhile only through our own MODE commands,
+      // which are not in flight here — a confirmed set_value must have reached its target.
+      if (pick == 5 && (autoMode ? heater.setpoint() != target : heater.pump() != target)) missedTargets++;
+    } else {
+      failed++;
+    }
+    uint32_t toggles = heater.stats().toggles - toggles0;
+    if (toggles > 1) extraToggles += toggles - 1;
+  }
+
+  double wallS = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall0).count();
+  std::sort(ackMs.begin(), ackMs.end());
+  std::sort(setMs.begin(), setMs.end());
+  uint32_t total = acked + failed;
+  double ackRate = total != 0 ? (double)acked / total : 0;
+  double p99 = percentile(ackMs, 0.99);
+  const HostLoop::Stats &hs = host.stats();
+  const CommandCycle::Stats &cy = host.cycle().stats();
+  const CC1101Model::Stats &cs = chip.stats();
+  const SimWorld::Stats &ws = world.stats();
+  const SimHeater::Stats &he = heater.stats();
+
+  printf("sequences   %u (%u polls, %u power, %u mode, %u up, %u down, %u set_value; %u rejected as polls)\n",
+         (unsigned)total, (unsigned)byCmd[0], (unsigned)byCmd[1], (unsigned)byCmd[2], (unsigned)byCmd[3],
+         (unsigned)byCmd[4], (unsigned)byCmd[5], (unsigned)rejected);
+  printf("acked       %u (%.2f %%), failed %u\n", (unsigned)acked, ackRate * 100, (unsigned)failed);
+  printf("time-to-ACK p50 %.0f ms  p90 %.0f ms  p99 %.0f ms  max %.0f ms\n", percentile(ackMs, 0.5),
+         percentile(ackMs, 0.9), p99, ackMs.empty() ? 0.0 : (double)ackMs.back());
+  printf("set_value   time to target p50 %.0f ms  p90 %.0f ms  max %.0f ms%s\n", percentile(setMs, 0.5),
+         percentile(setMs, 0.9), setMs.empty() ? 0.0 : (double)setMs.back(), o.pipelined ? " (pipelined)" : "");
+  printf("attempts    ");
+  for (int i = 1; i <= CommandCycle::kMaxAttempts; i++) {
+    if (hs.attempts[i] != 0) printf(" %d:%u", i, (unsigned)hs.attempts[i]);
+  }
+  printf("\n");
+  printf("bursts      %u, %u RX timeouts, %u bad packets, %u idempotent skips; avg burst %.1f ms wall, %.0f us SPI\n",
+         (unsigned)cy.bursts, (unsigned)cy.timeouts, (unsigned)cy.bad_packets, (unsigned)cy.skipped,
+         cy.bursts != 0 ? hs.burstWallUs / 1000.0 / cy.bursts : 0.0,
+         cy.bursts != 0 ? (double)hs.burstCpuUs / cy.bursts : 0.0);
+  printf("link        burst %u, RX window %u ms, success %.0f %%, FREQOFF %d (heater %d)\n",
+         (unsigned)host.policy().burst_packets(), (unsigned)host.policy().rx_window_ms(),
+         host.policy().success_rate() * 100, host.cycle().freq_offset(), o.freqErr);
+  printf("recovery    %u brownouts (%u calibration, %u WiFi), %u health reinits, %u reinits after 12 failures\n",
+         (unsigned)cs.brownouts, (unsigned)ws.calBrownouts, (unsigned)ws.wifiBrownouts, (unsigned)hs.healthReinits,
+         (unsigned)cy.lost_reinits);
+  printf("offline     %u episodes, %.1f s\n", (unsigned)cy.offline_episodes, host.offlineMs() / 1000.0);
+  printf("coex        %u WiFi events, %u waits, %u ms total\n", (unsigned)ws.wifiEvents, (unsigned)host.coex().waits(),
+         (unsigned)host.coex().wait_total_ms());
+  printf("CC1101      %u calibrations, %u frames sent, %u silent, %u underflows; %u received, %u missed (not in RX), "
+         "%u undecodable, %u overflows\n",
+         (unsigned)cs.calibrations, (unsigned)cs.txFrames, (unsigned)cs.txSilent, (unsigned)cs.txUnderflows,
+         (unsigned)cs.rxFrames, (unsigned)cs.rxAway, (unsigned)cs.rxDeaf, (unsigned)cs.rxOverflows);
+  printf("heater      %u packets heard, %u replies, %u toggles (%u extra), %u steps; %u lost, %u replies lost, "
+         "%u CRC errors\n",
+         (unsigned)he.heard, (unsigned)he.replies, (unsigned)he.toggles, (unsigned)extraToggles, (unsigned)he.steps,
+         (unsigned)ws.cmdLost, (unsigned)ws.replyLost, (unsigned)ws.crcErrors);
+  printf("rate        %.0f sequences/s (%.1f h simulated in %.2f s)\n", wallS > 0 ? total / wallS : 0.0,
+         world.clock.now() / 3.6e9, wallS);
+
+  if (missedTargets != 0) printf("FAIL: %u set_value sequences confirmed off target\n", (unsigned)missedTargets);
+  int rc = stalled != 0 || missedTargets != 0 ? 1 : 0;
+  if (o.maxP99Ms > 0 && p99 > o.maxP99Ms) {
+    printf("FAIL: p99 time-to-ACK %.0f ms > %.0f ms\n", p99, o.maxP99Ms);
+    rc = 1;
+  }
+  if (o.minAckRate > 0 && ackRate < o.minAckRate) {
+    printf("FAIL: ACK rate %.4f < %.4f\n", ackRate, o.minAckRate);
+    rc = 1;
+  }
+  return rc;
+}
@@ -0,0 +1,19 @@
+/*
+ * esp_log.h — host stand-in for the ESP-IDF header, so DieselHeaterRF.cpp builds unchanged
+ * for the simulator. simLog() is defined by dhsim.cpp: it prefixes the virtual time and
+ * prints to stderr up to the level set with -v, otherwise nothing.
+ */
+
+#ifndef SimEspLog_h
+#define SimEspLog_h
+
+void simLog(int level, char letter, const char *tag, const char *fmt, ...)
+    __attribute__((format(printf, 4, 5)));
+
+#define ESP_LOGE(tag, fmt, ...) simLog(1, 'E', tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) simLog(2, 'W', tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) simLog(3, 'I', tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGD(tag, fmt, ...) simLog(4, 'D', tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGV(tag, fmt, ...) simLog(5, 'V', tag, fmt, ##__VA_ARGS__)
+
+#endif
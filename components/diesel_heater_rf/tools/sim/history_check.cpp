@@ -0,0 +1,280 @@
+/*
+ * history_check.cpp — round trip of the state history: history_ring.cpp encodes generated
+ * heater runs, and tools/decode_history.py has to give back every retained sample.
+ *
+ * For each scenario the program writes NAME.b64 (the dump_history export, base64) and
+ * NAME.csv (the retained samples in decode_history.py's --csv format) to the output
+ * directory; `make history` decodes every .b64 with the script and diffs it against the
+ * .csv. The program itself checks what the decoder can't see: which samples are retained
+ * after block drops, oldest_s(), the export size, and the capacity at a 300 s idle poll.
+ *
+ *   make history
+ *   ./history_check --out DIR [--seed N]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "check.h"
+#include "history_ring.h"
+
+using esphome::diesel_heater_rf::HistoryRing;
+
+struct Sample {
+  uint32_t t;
+  uint8_t f[HistoryRing::kFields];
+};
+
+static std::string g_out = ".";
+static uint32_t g_rng = 1;
+
+static uint32_t rnd(uint32_t n) {
+  g_rng ^= g_rng << 13;
+  g_rng ^= g_rng >> 17;
+  g_rng ^= g_rng << 5;
+  return g_rng % n;
+}
+
+static std::string base64(const uint8_t *d, size_t n) {
+  static const char *kAlphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  std::string s;
+  for (size_t i = 0; i < n; i += 3) {
+    uint32_t v = (uint32_t)d[i] << 16 | (i + 1 < n ? d[i + 1] << 8 : 0) | (i + 2 < n ? d[i + 2] : 0);
+    s += kAlphabet[v >> 18];
+    s += kAlphabet[(v >> 12) & 0x3F];
+    s += i + 1 < n ? kAlphabet[(v >> 6) & 0x3F] : '=';
+    s += i + 2 < n ? kAlphabet[v & 0x3F] : '=';
+  }
+  return s;
+}
+
+// Heater state with the given history fields, as the component would hand it over.
+static heater_state_t toState(const uint8_t *f) {
+  heater_state_t s;
+  s.state = f[0] & 0x7F;
+  s.autoMode = f[0] & 0x80;
+  s.power = f[1];
+  s.errorCode = f[2];
+  s.voltage = f[3] / 10.0f;
+  s.ambientTemp = (int8_t)f[4];
+  s.caseTemp = f[5];
+  s.setpoint = (int8_t)f[6];
+  s.pumpFreq = f[7] / 10.0f;
+  return s;
+}
+
+// Runs one scenario: feeds the samples, checks retention, writes NAME.b64 and NAME.csv.
+// Returns the retained samples.
+static std::vector<Sample> roundTrip(const char *name, size_t bytes, const std::vector<Sample> &in) {
+  std::vector<uint8_t> buf(bytes);
+  HistoryRing ring;
+  ring.begin(buf.data(), buf.size());
+  std::vector<Sample> added;
+  for (const Sample &s : in) {
+    uint32_t before = ring.total();
+    ring.add(s.t, toState(s.f));
+    if (ring.total() != before) added.push_back(s);
+    // Round trip through heater_state_t is lossless.
+    uint8_t f[HistoryRing::kFields];
+    HistoryRing::fields(toState(s.f), f);
+    if (memcmp(f, s.f, sizeof(f)) != 0) CHECK(!"fields(toState(f)) != f");
+  }
+  uint32_t kept = ring.samples();
+  CHECK(kept > 0 && kept <= added.size());
+  std::vector<Sample> retained(added.end() - kept, added.end());
+  CHECK_EQ(ring.oldest_s(), retained.front().t);
+
+  std::vector<uint8_t> out(ring.export_size());
+  CHECK_EQ(ring.export_to(out.data(), out.size()), out.size());
+  CHECK_EQ(ring.export_to(out.data(), out.size() - 1), 0);
+
+  std::string path = g_out + "/" + name;
+  FILE *b64 = fopen((path + ".b64").c_str(), "w");
+  FILE *csv = fopen((path + ".csv").c_str(), "w");
+  if (b64 == nullptr || csv == nullptr) {
+    printf("FAIL: cannot write %s.*\n", path.c_str());
+    exit(1);
+  }
+  fprintf(b64, "%s\n", base64(out.data(), out.size()).c_str());
+  fprintf(csv, "t_s,state,auto,power,error,voltage,ambient,case,setpoint,pump_hz\n");
+  for (const Sample &s : retained) {
+    fprintf(csv, "%u,%u,%d,%u,%u,%u.%u,%d,%u,%d,%u.%u\n", (unsigned)s.t, s.f[0] & 0x7F, s.f[0] >> 7, s.f[1], s.f[2],
+            s.f[3] / 10, s.f[3] % 10, (int8_t)s.f[4], s.f[5], (int8_t)s.f[6], s.f[7] / 10, s.f[7] % 10);
+  }
+  fclose(b64);
+  fclose(csv);
+  printf("%-14s %6zu bytes  %5zu added  %5u kept  %5zu exported  %6.1f h\n", name, bytes, added.size(),
+         (unsigned)kept, out.size(), (retained.back().t - retained.front().t) / 3600.0);
+  return retained;
+}
+
+// Generator state: the last fields, stepped by the phases below.
+struct Run {
+  std::vector<Sample> samples;
+  uint32_t t{1000};
+  uint8_t f[HistoryRing::kFields]{0x00, 0, 0, 124, (uint8_t)-2, 4, 21, 0};
+
+  void emit(uint32_t dt) {
+    t += dt;
+    Sample s;
+    s.t = t;
+    memcpy(s.f, f, sizeof(f));
+    samples.push_back(s);
+  }
+  void set(uint8_t field, int value) { f[field] = (uint8_t)value; }
+  void step(uint8_t field, int delta) { f[field] = (uint8_t)(f[field] + delta); }
+  void state(uint8_t st) { f[0] = (uint8_t)((f[0] & 0x80) | st); }
+
+  // Off, polled every interval s; the voltage wanders by one step now and then.
+  void idle(uint32_t n, uint32_t interval) {
+    state(HEATER_STATE_OFF);
+    set(1, 0);
+    set(7, 0);
+    for (uint32_t i = 0; i < n; i++) {
+      if (rnd(8) == 0) step(3, rnd(2) ? 1 : -1);
+      emit(interval);
+    }
+  }
+  // Startup to running at 10 s: state steps, case temperature climbing, pump ramp.
+  void start() {
+    for (uint8_t st = HEATER_STATE_STARTUP; st <= HEATER_STATE_PRE_RUN; st++) {
+      state(st);
+      for (int i = 0; i < 6; i++) {
+        step(5, 1 + rnd(3));
+        if (f[7] < 50) step(7, 2 + rnd(5));
+        emit(10);
+      }
+    }
+    state(HEATER_STATE_RUNNING);
+    set(1, 5);
+  }
+  // Running at 10 s: small changes in every field that moves.
+  void running(uint32_t n) {
+    state(HEATER_STATE_RUNNING);
+    for (uint32_t i = 0; i < n; i++) {
+      if (rnd(3) == 0) step(3, (int)rnd(3) - 1);
+      if (rnd(4) == 0) step(5, (int)rnd(5) - 2);
+      if (rnd(6) == 0) step(7, (int)rnd(7) - 3);
+      if (rnd(30) == 0) step(4, rnd(2) ? 1 : -1);
+      emit(10);
+    }
+  }
+  void shutdown() {
+    for (uint8_t st : {HEATER_STATE_SHUTDOWN, HEATER_STATE_SHUTTING_DOWN, HEATER_STATE_COOLING}) {
+      state(st);
+      for (int i = 0; i < 10; i++) {
+        if (f[5] > 20) step(5, -(int)(2 + rnd(12)));  // −8 and below need the escape
+        if (f[7] > 0) set(7, f[7] > 10 ? f[7] - 10 : 0);
+        emit(10);
+      }
+    }
+    set(1, 0);
+  }
+};
+
+static void checkIdleRunningGaps() {
+  printf("idle / running / gaps\n");
+  Run r;
+  for (int cycle = 0; cycle < 3; cycle++) {
+    r.idle(20, 60 + rnd(120));
+    r.start();
+    r.running(150);
+    r.emit(256 + rnd(1800));  // RF lost mid-run — gap keyframe
+    r.running(50);
+    r.shutdown();
+    r.idle(10, 300);
+  }
+  roundTrip("mixed", 16384, r.samples);
+}
+
+static void checkEscapes() {
+  printf("escape nibbles: deltas at and beyond ±7, wrap-around\n");
+  Run r;
+  r.emit(1);
+  static const int kDeltas[] = {7, -7, 8, -8, 9, -9, 127, -128, 100, -100, 1, -1};
+  for (int d : kDeltas) {
+    for (uint8_t field = 0; field < HistoryRing::kFields; field++) r.step(field, d);
+    r.emit(1);
+  }
+  r.set(2, 0x0B);  // error code from 0 straight to E11
+  r.set(6, 35);
+  r.set(4, (uint8_t)-20);
+  r.emit(5);
+  r.set(3, 0);     // voltage 124 → 0 → 255 → 0
+  r.emit(5);
+  r.set(3, 255);
+  r.emit(5);
+  r.set(3, 0);
+  r.emit(5);
+  r.set(0, 0x80 | HEATER_STATE_RUNNING);  // auto mode bit alone is one nibble
+  r.emit(5);
+  r.set(0, HEATER_STATE_RUNNING);
+  r.emit(255);  // longest delta
+  r.emit(256);  // first gap keyframe
+  r.emit(1);
+  std::vector<Sample> kept = roundTrip("escapes", 1024, r.samples);
+  CHECK_EQ(kept.size(), r.samples.size());
+}
+
+static void checkWrap() {
+  printf("wrap-around with block drops\n");
+  // Two blocks is the smallest ring; three leaves one block between head and tail.
+  for (size_t blocks : {2, 3, 16}) {
+    Run r;
+    for (int cycle = 0; cycle < 8; cycle++) {
+      r.idle(30, 30);
+      r.start();
+      r.running(200);
+      r.shutdown();
+      if (rnd(2)) r.emit(300 + rnd(3000));
+    }
+    char name[32];
+    snprintf(name, sizeof(name), "wrap_%zu", blocks);
+    std::vector<Sample> kept = roundTrip(name, blocks * HistoryRing::kBlockSize, r.samples);
+    CHECK(kept.size() < r.samples.size());  // blocks were dropped
+  }
+  // Not a whole number of blocks: the tail of the buffer is not used.
+  Run r;
+  r.running(2000);
+  roundTrip("wrap_partial", 3 * HistoryRing::kBlockSize + 100, r.samples);
+}
+
+static void checkIdleCapacity() {
+  printf("capacity: 300 s idle poll, default 4 KB\n");
+  // Every sample is > 255 s after the previous one, so each is a 13-byte keyframe and a
+  // block holds 19 of them.
+  Run r;
+  r.idle(2 * 24 * 12, 300);
+  std::vector<Sample> kept = roundTrip("idle_300s", 4096, r.samples);
+  const uint32_t perBlock = HistoryRing::kBlockSize / (5 + HistoryRing::kFields);
+  CHECK_EQ(perBlock, 19);
+  CHECK(kept.size() >= 15 * perBlock + 1);
+  CHECK(kept.size() <= 16 * perBlock);
+  CHECK(kept.back().t - kept.front().t >= 23 * 3600);
+
+  // For comparison, the same day at a 240 s poll fits deltas.
+  Run d;
+  d.idle(2 * 24 * 15, 240);
+  std::vector<Sample> dk = roundTrip("idle_240s", 4096, d.samples);
+  CHECK(dk.back().t - dk.front().t > kept.back().t - kept.front().t);
+}
+
+int main(int argc, char **argv) {
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--out") && i + 1 < argc) {
+      g_out = argv[++i];
+    } else if (!strcmp(argv[i], "--seed") && i + 1 < argc) {
+      g_rng = (uint32_t)strtoul(argv[++i], nullptr, 0) | 1;
+    } else {
+      fprintf(stderr, "usage: %s [--out DIR] [--seed N]\n", argv[0]);
+      return 2;
+    }
+  }
+  checkIdleRunningGaps();
+  checkEscapes();
+  checkWrap();
+  checkIdleCapacity();
+  return checkExit("history_check");
+}
@@ -0,0 +1,112 @@
+#include <string.h>
+#include "HeaterProtocol.h"
+#include "sim_heater.h"
+
+using namespace HeaterProtocol;
+
+static constexpr int64_t kStartupUs = 10000000;
+static constexpr int64_t kWarmingUntilUs = 40000000;
+static constexpr int64_t kShutdownUs = 60000000;
+
+SimHeater::SimHeater(SimWorld &world, uint32_t addr) : _world(world), _addr(addr) {
+  _world.attach(this);
+}
+
+uint8_t SimHeater::state() const {
+  int64_t since = _world.clock.now() - _switchedAt;
+  if (_on) {
+    if (since < kStartupUs) return HEATER_STATE_STARTUP;
+    if (since < kWarmingUntilUs) return HEATER_STATE_WARMING;
+    return HEATER_STATE_RUNNING;
+  }
+  if (_switchedAt >= 0 && since < kShutdownUs) return HEATER_STATE_SHUTTING_DOWN;
+  return HEATER_STATE_OFF;
+}
+
+void SimHeater::receive(const AirFrame &f) {
+  const uint8_t *b = f.bytes;
+  if (!f.crcOk || f.len != kCommandFrame || b[OFF_LEN] != kCommandLen) return;
+  uint16_t crc = crc16(b, OFF_CRC);
+  if (b[OFF_CRC] != (uint8_t)(crc >> 8) || b[OFF_CRC + 1] != (uint8_t)crc) {
+    _stats.badCrc++;
+    return;
+  }
+  if (readAddress(b) != _addr) {
+    _stats.otherAddr++;
+    return;
+  }
+  _stats.heard++;
+
+  // Repeats of a burst carry the same sequence number and act once.
+  uint8_t cmd = b[OFF_CMD], seq = b[OFF_SEQ];
+  if (seq != _lastSeq || cmd != _lastCmd) {
+    _lastSeq = seq;
+    _lastCmd = cmd;
+    act(cmd);
+  }
+
+  uint32_t gen = ++_gen;
+  int64_t delay = (int64_t)(replyDelayMs + _world.uniform(0, replyJitterMs)) * 1000;
+  _world.clock.at(f.end + delay, [this, gen] {
+    if (gen == _gen) reply();
+  });
+}
+
+void SimHeater::act(uint8_t cmd) {
+  switch (cmd) {
+    case HEATER_CMD_POWER:
+      _on = !_on;
+      _switchedAt = _world.clock.now();
+      _stats.toggles++;
+      break;
+    case HEATER_CMD_MODE:
+      _auto = !_auto;
+      _stats.toggles++;
+      break;
+    case HEATER_CMD_UP:
+    case HEATER_CMD_DOWN: {
+      int d = cmd == HEATER_CMD_UP ? 1 : -1;
+      if (_auto) {
+        if (_setpoint + d >= 8 && _setpoint + d <= 36) _setpoint = (int8_t)(_setpoint + d);
+      } else if (_pump + d >= 16 && _pump + d <= 55) {
+        _pump = (uint8_t)(_pump + d);
+      }
+      _stats.steps++;
+      break;
+    }
+    default:  // GET_STATUS: reply only
+      break;
+  }
+}
+
+void SimHeater::reply() {
+  AirFrame f{};
+  uint8_t *b = f.bytes;
+  uint8_t st = state();
+  b[OFF_LEN] = kStateLen;
+  b[OFF_ADDR] = (uint8_t)(_addr >> 24);
+  b[OFF_ADDR + 1] = (uint8_t)(_addr >> 16);
+  b[OFF_ADDR + 2] = (uint8_t)(_addr >> 8);
+  b[OFF_ADDR + 3] = (uint8_t)_addr;
+  b[OFF_STATE] = st;
+  b[OFF_POWER] = st == HEATER_STATE_RUNNING ? 5 : 0;
+  b[OFF_VOLTAGE] = 124;
+  b[OFF_AMBIENT] = 18;
+  b[OFF_ERROR] = 0;
+  b[OFF_CASE] = st == HEATER_STATE_OFF ? 18 : 80;
+  b[OFF_SETPOINT] = (uint8_t)_setpoint;
+  b[OFF_AUTO] = _auto ? 0x32 : 0xCD;
+  b[OFF_PUMP] = _pump;
+  f.len = kStateFrame;
+  f.phy = kHeaterPhy;
+  f.freqOff = freqErr;
+  f.rssiDbm = rssiDbm;
+  f.crcOk = true;
+  f.start = _world.clock.now();
+  f.syncAt = f.start + kHeaterPhy.syncOffsetUs(kHeaterPreamble);
+  f.end = f.start + kHeaterPhy.airtimeUs(kHeaterPreamble, f.len);
+  _txStart = f.start;
+  _txEnd = f.end;
+  _stats.replies++;
+  _world.clock.at(f.end, [this, f] { _world.fromHeater(f); });
+}
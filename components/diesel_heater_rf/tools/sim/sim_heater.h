@@ -0,0 +1,71 @@
+/*
+ * sim_heater.h — the heater end of the link for the host simulator.
+ *
+ * Receives command frames (length 9, CRC-16/MODBUS over bytes 0–6, its own address) and
+ * answers each burst with one state packet, replyDelayMs (± replyJitterMs) after the last
+ * packet it heard — every packet heard moves the reply back, so it goes out once the
+ * burst is over. Toggles act once per sequence number, like the real heater:
+ *   POWER  off → STARTUP (10 s) → WARMING (until 40 s) → RUNNING; on → SHUTTING_DOWN
+ *          (60 s) → OFF
+ *   MODE   flips automatic mode
+ *   UP/DOWN  setpoint 8–36 °C in automatic mode, pump 1.6–5.5 Hz otherwise
+ * The reply is sent with kHeaterPhy and freqErr, half duplex: nothing is heard while
+ * it transmits.
+ */
+
+#ifndef SimHeater_h
+#define SimHeater_h
+
+#include <stdint.h>
+#include "sim_world.h"
+
+class SimHeater {
+  public:
+    static constexpr int kFreqTolerance = 18;  // FREQOFF steps the heater's receiver accepts
+
+    SimHeater(SimWorld &world, uint32_t addr);
+
+    int8_t freqErr{0};        // carrier offset of the heater's crystal, FREQOFF steps
+    int16_t rssiDbm{-65};     // at our receiver
+    uint32_t replyDelayMs{40};
+    uint32_t replyJitterMs{20};
+
+    // Air side (SimWorld): our frame, ending now.
+    void receive(const AirFrame &f);
+    bool transmitting(int64_t from, int64_t to) const { return _txEnd > from && _txStart < to; }
+
+    uint8_t state() const;
+    bool autoMode() const { return _auto; }
+    int8_t setpoint() const { return _setpoint; }
+    uint8_t pump() const { return _pump; }  // 0.1 Hz
+    uint32_t addr() const { return _addr; }
+
+    struct Stats {
+      uint32_t heard{0};      // valid frames for our address
+      uint32_t badCrc{0};
+      uint32_t otherAddr{0};
+      uint32_t replies{0};
+      uint32_t toggles{0};    // POWER and MODE actions taken
+      uint32_t steps{0};      // UP/DOWN actions taken
+    };
+    const Stats &stats() const { return _stats; }
+
+  private:
+    void act(uint8_t cmd);
+    void reply();
+
+    SimWorld &_world;
+    uint32_t _addr;
+    bool _on{false};
+    int64_t _switchedAt{-1};   // last POWER, -1 = never (off since start)
+    bool _auto{false};
+    int8_t _setpoint{20};
+    uint8_t _pump{17};         // 0.1 Hz
+    int _lastSeq{-1};
+    uint8_t _lastCmd{0};
+    uint32_t _gen{0};          // pending reply; a newer packet supersedes it
+    int64_t _txStart{0}, _txEnd{0};
+    Stats _stats;
+};
+
+#endif
@@ -0,0 +1,63 @@
+#include <stdlib.h>
+#include <math.h>
+#include "sim_world.h"
+#include "cc1101_model.h"
+#include "sim_heater.h"
+
+void SimWorld::fromRadio(const AirFrame &f) {
+  for (SimHeater *h : _heaters) {
+    if (h->transmitting(f.start, f.end)) continue;  // half duplex
+    if (!decodable(f, kHeaterPhy, h->freqErr, SimHeater::kFreqTolerance)) continue;
+    if (chance(faults.cmdLoss)) {
+      _stats.cmdLost++;
+      continue;
+    }
+    h->receive(f);
+  }
+}
+
+void SimWorld::fromHeater(AirFrame f) {
+  if (_radio == nullptr) return;
+  if (chance(faults.replyLoss)) {
+    _stats.replyLost++;
+    return;
+  }
+  if (chance(faults.crcError)) {
+    f.crcOk = false;
+    _stats.crcErrors++;
+  }
+  _radio->receive(f);
+}
+
+bool SimWorld::decodable(const AirFrame &f, const SimPhy &phy, int8_t freqOff, int tolerance) {
+  return f.phy == phy && abs((int)f.freqOff - (int)freqOff) <= tolerance;
+}
+
+bool SimWorld::droop(bool calibration) {
+  if (calibration && chance(faults.calBrownout)) {
+    _stats.calBrownouts++;
+    return true;
+  }
+  if (wifiTx() && chance(faults.wifiBrownout)) {
+    _stats.wifiBrownouts++;
+    return true;
+  }
+  return false;
+}
+
+void SimWorld::startWifi(std::function<void(uint32_t, uint32_t)> onEvent) {
+  _onWifi = std::move(onEvent);
+  if (faults.wifiPeriodMs != 0) scheduleWifi();
+}
+
+void SimWorld::scheduleWifi() {
+  double u = std::uniform_real_distribution<double>(1e-9, 1.0)(_rng);
+  int64_t gap = (int64_t)(-log(u) * faults.wifiPeriodMs * 1000.0);
+  clock.at(clock.now() + gap, [this] {
+    static constexpr uint32_t kHoldMs[] = {200, 500, 300};  // scan done, connected, disconnected
+    _stats.wifiEvents++;
+    _wifiTxUntil = clock.now() + (int64_t)faults.wifiTxMs * 1000;
+    if (_onWifi) _onWifi(clock.millis(), kHoldMs[uniform(0, 2)]);
+    scheduleWifi();
+  });
+}
@@ -0,0 +1,125 @@
+/*
+ * sim_world.h — what lies between the CC1101 model and the simulated heaters: the air,
+ * the 3.3 V rail and WiFi, with the faults the harness injects.
+ *
+ * A frame reaches a receiver if it was listening when the sync word started and still is
+ * when the frame ends, its PHY registers match the sender's, the carrier offset is inside
+ * its frequency-offset compensation, and the fault dice let it through. Everything is
+ * driven by one VirtualClock and one seeded RNG, so a run is reproducible from its seed.
+ */
+
+#ifndef SimWorld_h
+#define SimWorld_h
+
+#include <stdint.h>
+#include <functional>
+#include <random>
+#include <vector>
+#include "virtual_clock.h"
+
+class CC1101Model;
+class SimHeater;
+
+// The registers that decide what goes on the air; a receiver only decodes a frame whose
+// PHY matches its own. Frequency offsets are carried separately (AirFrame::freqOff).
+struct SimPhy {
+  uint32_t freq;     // FREQ2/1/0
+  uint16_t sync;     // SYNC1/0
+  uint8_t mdmcfg2;   // modulation, Manchester, sync mode
+  uint8_t drateE;    // MDMCFG4[3:0]
+  uint8_t drateM;    // MDMCFG3
+  uint8_t deviatn;
+  uint8_t pktctrl0;  // whitening, CRC, length mode
+
+  bool operator==(const SimPhy &o) const {
+    return freq == o.freq && sync == o.sync && mdmcfg2 == o.mdmcfg2 && drateE == o.drateE && drateM == o.drateM &&
+           deviatn == o.deviatn && pktctrl0 == o.pktctrl0;
+  }
+  bool operator!=(const SimPhy &o) const { return !(*this == o); }
+
+  double bitrate() const { return (256.0 + drateM) * (double)(1u << drateE) * 26e6 / 268435456.0; }
+  uint8_t syncBytes() const {
+    uint8_t mode = mdmcfg2 & 0x03;
+    return mode == 0 ? 0 : mode == 3 ? 4 : 2;  // 30/32 mode sends the sync word twice
+  }
+  uint8_t crcBytes() const { return (pktctrl0 & 0x04) ? 2 : 0; }
+  // Preamble, sync word, frame (length byte included) and CRC, µs.
+  int64_t airtimeUs(uint8_t preambleBytes, uint8_t frameBytes) const {
+    uint32_t bytes = preambleBytes + syncBytes() + frameBytes + crcBytes();
+    return (int64_t)(bytes * 8 * 1e6 / bitrate() + 0.5);
+  }
+  int64_t syncOffsetUs(uint8_t preambleBytes) const { return (int64_t)(preambleBytes * 8 * 1e6 / bitrate() + 0.5); }
+};
+
+// The heater's PHY: the values DieselHeaterRF::initRadio() writes for the default
+// frequency, with the 4-byte preamble of the original remote.
+inline constexpr SimPhy kHeaterPhy{0x10B09E, 0x7E3C, 0x13, 0x08, 0x93, 0x26, 0x05};
+inline constexpr uint8_t kHeaterPreamble = 4;
+
+struct AirFrame {
+  uint8_t bytes[64];  // length byte + payload, as in the FIFO
+  uint8_t len;
+  SimPhy phy;
+  int8_t freqOff;     // carrier offset, FREQOFF steps (f_XOSC/2^14 ≈ 1.59 kHz)
+  int16_t rssiDbm;    // at the receiver
+  bool crcOk;         // the hardware CRC survived the channel
+  int64_t start, syncAt, end;
+};
+
+struct SimFaults {
+  double cmdLoss{0};           // our packets the heater misses
+  double replyLoss{0};         // heater packets the CC1101 misses
+  double crcError{0};          // heater packets that arrive with CRC_OK clear
+  double calBrownout{0};       // a calibration's VCC droop resets the CC1101
+  uint32_t wifiPeriodMs{0};    // mean gap between WiFi events (exponential), 0 = none
+  uint32_t wifiTxMs{150};      // WiFi TX activity after each event
+  double wifiBrownout{0};      // TX or calibration during WiFi TX resets the CC1101
+};
+
+class SimWorld {
+  public:
+    explicit SimWorld(uint32_t seed) : _rng(seed) {}
+
+    VirtualClock clock;
+    SimFaults faults;
+
+    void attach(CC1101Model *radio) { _radio = radio; }
+    void attach(SimHeater *heater) { _heaters.push_back(heater); }
+
+    // Air. Called by the transmitter when its frame ends.
+    void fromRadio(const AirFrame &f);
+    void fromHeater(AirFrame f);
+    // Could a receiver with this PHY, carrier offset and compensation range decode f?
+    static bool decodable(const AirFrame &f, const SimPhy &phy, int8_t freqOff, int tolerance);
+
+    // Supply rail: does the CC1101 brown out as a calibration or TX starts now?
+    bool droop(bool calibration);
+
+    // WiFi events at exponential intervals (faults.wifiPeriodMs). Each makes WiFi TX active
+    // for faults.wifiTxMs and calls onEvent(now_ms, hold_ms) like the component's event
+    // handler: scan done 200 ms, connected 500 ms, disconnected 300 ms.
+    void startWifi(std::function<void(uint32_t, uint32_t)> onEvent);
+    bool wifiTx() const { return clock.now() < _wifiTxUntil; }
+
+    bool chance(double p) { return p > 0 && std::uniform_real_distribution<double>(0.0, 1.0)(_rng) < p; }
+    uint32_t uniform(uint32_t lo, uint32_t hi) { return std::uniform_int_distribution<uint32_t>(lo, hi)(_rng); }
+
+    struct Stats {
+      uint32_t cmdLost{0}, replyLost{0}, crcErrors{0};
+      uint32_t calBrownouts{0}, wifiBrownouts{0};
+      uint32_t wifiEvents{0};
+    };
+    const Stats &stats() const { return _stats; }
+
+  private:
+    void scheduleWifi();
+
+    std::mt19937 _rng;
+    CC1101Model *_radio{nullptr};
+    std::vector<SimHeater *> _heaters;
+    std::function<void(uint32_t, uint32_t)> _onWifi;
+    int64_t _wifiTxUntil{0};
+    Stats _stats;
+};
+
+#endif
@@ -0,0 +1,279 @@
+/*
+ * sx1262_check.cpp — the real DieselHeaterSX1262 driver against the SX1262 command model
+ * (sx1262_model.h) on a virtual clock. Checks the port-guide corrections (opcodes, IRQ
+ * bits, modulation registers), the sync word and CC1101 CRC registers, the TCXO setup
+ * per board, the TxDone/Timeout flow of a burst, RxDone with a good and a bad CRC, and
+ * the hardware RX timeout after a burst.
+ *
+ *   make sx1262_check && ./sx1262_check [-v LEVEL]
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "DieselHeaterSX1262.h"
+#include "check.h"
+#include "sx1262_model.h"
+
+static const VirtualClock *g_clock = nullptr;
+static int g_logLevel = 0;
+
+void simLog(int level, char letter, const char *tag, const char *fmt, ...) {
+  if (level > g_logLevel) return;
+  fprintf(stderr, "[%11.3f][%c][%s] ", g_clock != nullptr ? g_clock->now() / 1e6 : 0.0, letter, tag);
+  va_list ap;
+  va_start(ap, fmt);
+  vfprintf(stderr, fmt, ap);
+  va_end(ap);
+  fputc('\n', stderr);
+}
+
+static constexpr uint32_t kAddr = 0x12ABF4CD;  // address of HeaterProtocol's check frame
+static constexpr uint8_t kTcxo18 = 0x02;       // 1.8 V, T3-S3
+static constexpr uint8_t kCrystal = DieselHeaterSX1262::kNoTcxo;
+
+// Driver and chip model on their own clock; begin() has run.
+struct Rig {
+  VirtualClock clock;
+  SX1262Model chip;
+  DieselHeaterSX1262 radio;
+
+  Rig(uint8_t boardTcxo, uint8_t driverTcxo)
+      : chip(clock, boardTcxo),
+        radio(SX1262_SCK_PIN, SX1262_MISO_PIN, SX1262_MOSI_PIN, SX1262_NSS_PIN, SX1262_DIO1_PIN, SX1262_BUSY_PIN,
+              SX1262_RST_PIN) {
+    g_clock = &clock;
+    radio.setBus(&chip);
+    radio.setTcxoVoltage(driverTcxo);
+    radio.begin(kAddr);
+  }
+
+  // The chip model saw nothing it would reject.
+  void checkClean() {
+    CHECK_EQ(chip.stats().badCommands, 0);
+    CHECK_EQ(chip.stats().busyViolations, 0);
+    CHECK_EQ(chip.stats().modeErrors, 0);
+  }
+};
+
+static size_t indexOf(const SX1262Model &chip, uint8_t opcode, size_t from = 0) {
+  for (size_t i = from; i < chip.log().size(); i++)
+    if (chip.log()[i][0] == opcode) return i;
+  return (size_t)-1;
+}
+
+static void checkSetup() {
+  printf("setup, 1.8 V TCXO board\n");
+  Rig r(kTcxo18, kTcxo18);
+  r.checkClean();
+  CHECK_EQ(r.chip.stats().resets, 1);
+
+  const auto *type = r.chip.find(0x8A);  // SetPacketType
+  CHECK(type != nullptr && type->size() == 2 && (*type)[1] == 0x00);
+  CHECK(r.chip.find(0x01) == nullptr);   // the port guide's "SetPacketType" is no opcode
+  CHECK_EQ(r.chip.packetType(), 0x00);
+
+  const auto *irq = r.chip.find(0x08);  // SetDioIrqParams: TxDone, RxDone, CrcErr, Timeout on DIO1
+  CHECK(irq != nullptr && irq->size() == 9);
+  if (irq != nullptr && irq->size() == 9) {
+    CHECK_EQ(((*irq)[1] << 8) | (*irq)[2], 0x0243);
+    CHECK_EQ(((*irq)[3] << 8) | (*irq)[4], 0x0243);
+  }
+  CHECK_EQ(r.chip.dio1Mask(), 0x0243);
+
+  CHECK_EQ(r.chip.bitrateReg(), 0x019052);
+  CHECK_EQ(r.chip.bandwidthReg(), 0x0C);
+  CHECK_EQ(r.chip.reg(0x06C0), 0x7E);
+  CHECK_EQ(r.chip.reg(0x06C1), 0x3C);
+  CHECK_EQ(r.chip.reg(0x06BC), 0xFF);
+  CHECK_EQ(r.chip.reg(0x06BD), 0xFF);
+  CHECK_EQ(r.chip.reg(0x06BE), 0x80);
+  CHECK_EQ(r.chip.reg(0x06BF), 0x05);
+
+  // SetDio3AsTcxoCtrl at the configured voltage, then the full calibration it enables.
+  size_t tcxo = indexOf(r.chip, 0x97);
+  CHECK(tcxo != (size_t)-1);
+  if (tcxo != (size_t)-1) {
+    CHECK_EQ(r.chip.log()[tcxo][1], kTcxo18);
+    size_t cal = indexOf(r.chip, 0x89, tcxo);
+    CHECK(cal != (size_t)-1 && r.chip.log()[cal][1] == 0x7F);
+  }
+
+  char info[64];
+  CHECK(r.radio.probe(info, sizeof(info)));
+  CHECK(r.radio.checkHealth(true) == HeaterRadio::HEALTH_OK);
+}
+
+static void checkReferenceClock() {
+  printf("reference clock: tcxo_voltage against the board\n");
+  {
+    Rig r(kCrystal, kCrystal);
+    CHECK(r.chip.find(0x97) == nullptr);
+    r.radio.sendCommand(HEATER_CMD_GET_STATUS, kAddr, 1, 0);
+    CHECK_EQ(r.radio.getLastBurstCompleted(), 1);
+    CHECK_EQ(r.chip.stats().txSilent, 0);
+    r.checkClean();
+  }
+  {
+    Rig r(kTcxo18, kCrystal);  // TCXO never powered
+    r.radio.sendCommand(HEATER_CMD_GET_STATUS, kAddr, 1, 0);
+    CHECK_EQ(r.radio.getLastBurstCompleted(), 0);
+    CHECK(r.chip.stats().txSilent > 0);
+  }
+  {
+    Rig r(kCrystal, kTcxo18);  // crystal told to expect a TCXO
+    r.radio.sendCommand(HEATER_CMD_GET_STATUS, kAddr, 1, 0);
+    CHECK_EQ(r.radio.getLastBurstCompleted(), 0);
+  }
+  {
+    Rig r(0x06, 0x06);  // 3.0 V TCXO
+    r.radio.sendCommand(HEATER_CMD_GET_STATUS, kAddr, 1, 0);
+    CHECK_EQ(r.radio.getLastBurstCompleted(), 1);
+  }
+}
+
+static void checkTxBurst() {
+  printf("TX burst: TxDone per packet, frame contents\n");
+  Rig r(kTcxo18, kTcxo18);
+  r.chip.clearLog();
+  r.radio.sendCommand(HEATER_CMD_POWER, kAddr, 3, 0x42);
+  CHECK_EQ(r.radio.getLastBurstRequested(), 3);
+  CHECK_EQ(r.radio.getLastBurstCompleted(), 3);
+  CHECK_EQ(r.radio.getP1Timeouts(), 0);
+  CHECK_EQ(r.radio.getP2Timeouts(), 0);
+  CHECK_EQ(r.chip.stats().txFrames, 3);
+  CHECK_EQ(r.chip.irqStatus(), 0);
+
+  const auto *setTx = r.chip.find(0x83);
+  CHECK(setTx != nullptr && setTx->size() == 4);
+  if (setTx != nullptr && setTx->size() == 4)
+    CHECK_EQ(((*setTx)[1] << 16) | ((*setTx)[2] << 8) | (*setTx)[3], 50 * 64);  // 50 ms hardware timeout
+
+  HeaterProtocol::CommandFrame frame(HEATER_CMD_POWER, kAddr);
+  const uint8_t *want = frame.finish(0x42);
+  for (const auto &sent : r.chip.sent()) {
+    CHECK(sent.size() == HeaterProtocol::kCommandFrame &&
+          memcmp(sent.data(), want, HeaterProtocol::kCommandFrame) == 0);
+  }
+
+  int64_t air = r.chip.airtimeUs(HeaterProtocol::kCommandLen);
+  CHECK(r.radio.getLastBurstWallUs() >= 3 * air);
+  CHECK(r.radio.getLastBurstWallUs() < 3 * (air + 2000));
+  r.checkClean();
+}
+
+static void checkTxTimeout() {
+  printf("TX timeout: no TxDone, P2 timeout, standby\n");
+  Rig r(kTcxo18, kTcxo18);
+  r.chip.setTxStuck(true);
+  r.radio.sendCommand(HEATER_CMD_POWER, kAddr, 3, 0x01);
+  CHECK_EQ(r.radio.getLastBurstCompleted(), 0);
+  CHECK_EQ(r.radio.getP2Timeouts(), 1);
+  CHECK_EQ(r.chip.stats().txTimeouts, 1);
+  CHECK_EQ(r.chip.mode(), SX1262Model::STBY_RC);
+  CHECK_EQ(r.chip.irqStatus(), 0);
+
+  r.chip.setTxStuck(false);
+  r.radio.sendCommand(HEATER_CMD_POWER, kAddr, 1, 0x02);
+  CHECK_EQ(r.radio.getLastBurstCompleted(), 1);
+  r.checkClean();
+}
+
+static void checkRx() {
+  using HeaterProtocol::detail::kStateCheck;
+  printf("RX after TX: RxDone, CrcErr\n");
+  Rig r(kTcxo18, kTcxo18);
+  r.radio.sendCommand(HEATER_CMD_GET_STATUS, kAddr, 1, 0x10);
+  r.radio.startRxAfterTx();
+  CHECK_EQ(r.chip.mode(), SX1262Model::RX);
+  CHECK_EQ(r.chip.lastRxTimeout(), (uint32_t)HEATER_RX_TIMEOUT * 64);
+  CHECK(!r.radio.isRxAvailable());
+
+  r.clock.advance(150000);
+  r.chip.receive(kStateCheck, HeaterProtocol::kStateFrame, true, -60);
+  CHECK(r.radio.isRxAvailable());
+  heater_state_t state;
+  uint32_t addr = 0;
+  CHECK(r.radio.readPacket(&state, &addr));
+  CHECK_EQ(addr, kAddr);
+  CHECK_EQ(state.state, HEATER_STATE_RUNNING);
+  CHECK_EQ(state.ambientTemp, -5);
+  CHECK_EQ(state.rssi, -60);
+  CHECK_EQ(r.chip.mode(), SX1262Model::STBY_RC);
+  CHECK_EQ(r.chip.irqStatus(), 0);
+
+  // Corrupted on the air: RxDone with CrcErr — readable as a raw frame, not as a packet.
+  r.radio.startRxAfterTx();
+  r.chip.receive(kStateCheck, HeaterProtocol::kStateFrame, false, -60);
+  CHECK(r.radio.isRxAvailable());
+  CHECK(!r.radio.readPacket(&state));
+  CHECK_EQ(r.chip.stats().rxCrcErrors, 1);
+
+  r.radio.startRawCapture();
+  r.chip.receive(kStateCheck, HeaterProtocol::kStateFrame, false, -70);
+  uint8_t raw[64];
+  uint8_t len = 0;
+  int8_t freqEst = 1;
+  CHECK(r.radio.readRawFrame(raw, &len, &freqEst));
+  CHECK_EQ(len, HeaterProtocol::kStateRxLen);
+  CHECK_EQ(raw[HeaterProtocol::OFF_LQI] & 0x80, 0);
+  CHECK_EQ(freqEst, 0);
+  CHECK(HeaterProtocol::StateView(raw).address() == kAddr);
+  r.checkClean();
+}
+
+static void checkRxTimeout() {
+  printf("RX timeout: DIO1 on Timeout, no packet, late reply ignored\n");
+  Rig r(kTcxo18, kTcxo18);
+  r.radio.sendCommand(HEATER_CMD_GET_STATUS, kAddr, 1, 0x20);
+  r.radio.startRxAfterTx();
+  r.clock.advance((int64_t)HEATER_RX_TIMEOUT * 1000 - 1000);
+  CHECK(!r.radio.isRxAvailable());
+  r.clock.advance(2000);
+  CHECK(r.radio.isRxAvailable());
+  CHECK(r.chip.irqStatus() & 0x0200);
+  CHECK(r.chip.mode() != SX1262Model::RX);
+  heater_state_t state;
+  CHECK(!r.radio.readPacket(&state));
+  CHECK_EQ(r.chip.stats().rxTimeouts, 1);
+  CHECK_EQ(r.chip.irqStatus(), 0);
+  CHECK_EQ(r.chip.mode(), SX1262Model::STBY_RC);
+
+  r.chip.receive(HeaterProtocol::detail::kStateCheck, HeaterProtocol::kStateFrame, true, -60);
+  CHECK_EQ(r.chip.stats().rxAway, 1);
+  CHECK(!r.radio.isRxAvailable());
+  r.checkClean();
+}
+
+static void checkBrownout() {
+  printf("brownout: health check, reinit\n");
+  Rig r(kTcxo18, kTcxo18);
+  r.chip.brownout();
+  r.clock.advance(5000);
+  CHECK(r.radio.checkHealth(false) == HeaterRadio::HEALTH_LOST);
+  r.radio.reinitRadio();
+  CHECK(r.radio.checkHealth(true) == HeaterRadio::HEALTH_OK);
+  r.radio.sendCommand(HEATER_CMD_GET_STATUS, kAddr, 2, 0x30);
+  CHECK_EQ(r.radio.getLastBurstCompleted(), 2);
+  r.checkClean();
+}
+
+int main(int argc, char **argv) {
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-v") && i + 1 < argc) {
+      g_logLevel = atoi(argv[++i]);
+    } else {
+      fprintf(stderr, "usage: %s [-v LEVEL]\n", argv[0]);
+      return 2;
+    }
+  }
+  checkSetup();
+  checkReferenceClock();
+  checkTxBurst();
+  checkTxTimeout();
+  checkRx();
+  checkRxTimeout();
+  checkBrownout();
+  return checkExit("sx1262_check");
+}
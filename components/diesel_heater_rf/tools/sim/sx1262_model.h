@@ -0,0 +1,142 @@
+/*
+ * sx1262_model.h — command-level SX1262 model behind DieselHeaterSX1262Bus.
+ *
+ * Decodes SPI transactions the way the chip does: opcode, parameters, the status byte
+ * clocked back and the data of the Get/Read commands. Modelled behaviour:
+ *   - the command set the driver uses, with its parameter counts; an unknown opcode or a
+ *     wrong count is recorded (stats().badCommands), as is a transaction started while
+ *     BUSY is high, which the chip drops (stats().busyViolations)
+ *   - BUSY after every command, milliseconds for Calibrate, CalibrateImage and reset
+ *   - registers: sync word (0x06C0) and CRC seed/polynomial (0x06BC) with their reset
+ *     values; the data buffer with the TX and RX base addresses
+ *   - STDBY_RC → TX / RX → fallback mode (STDBY_RC, STDBY_XOSC or FS); SetTx and SetRx
+ *     hardware timeouts in 15.625 µs steps, continuous (0xFFFFFF) and single (0) RX
+ *   - IRQ status and the DIO1 mask of SetDioIrqParams: TxDone, RxDone, CrcErr, Timeout;
+ *     DIO1 follows IrqStatus & mask, edges are latched until clearDio1()
+ *   - TX airtime from the modulation and packet parameters; received frames only match
+ *     the configured sync word, and only pass the CRC with the CC1101 setup (2 bytes,
+ *     seed 0xFFFF, polynomial 0x8005, not inverted)
+ *   - reference clock: a board with a TCXO on DIO3 transmits and receives nothing until
+ *     SetDio3AsTcxoCtrl has powered it
+ *   - brownout(): power-on reset values, as after a VCC droop
+ * Not modelled: LoRa, sleep, address filtering, whitening, CAD, the PA and RF switch.
+ *
+ * Every call costs virtual time: SPI at 8 MHz plus kXferOverheadUs per transaction, and
+ * kPollUs per BUSY/DIO1 read, so the driver's BUSY wait makes progress without a real clock.
+ */
+
+#ifndef SX1262Model_h
+#define SX1262Model_h
+
+#include <stdint.h>
+#include <vector>
+#include "DieselHeaterSX1262.h"
+#include "virtual_clock.h"
+
+class SX1262Model : public DieselHeaterSX1262Bus {
+  public:
+    static constexpr int64_t kXferOverheadUs = 5;
+    static constexpr int64_t kPollUs = 2;
+    static constexpr int64_t kYieldUs = 100;
+    static constexpr int64_t kCmdBusyUs = 10;
+    static constexpr int64_t kCalibrateUs = 3500;   // Calibrate(all)
+    static constexpr int64_t kCalImageUs = 1000;
+    static constexpr int64_t kResetUs = 3500;       // POR calibration after RST
+    static constexpr int64_t kTxStartUs = 120;      // STDBY_RC → TX, PLL lock
+
+    enum Mode : uint8_t { STBY_RC = 0x2, STBY_XOSC = 0x3, FS = 0x4, RX = 0x5, TX = 0x6 };
+
+    // tcxo: the board's TCXO voltage code, or DieselHeaterSX1262::kNoTcxo for a crystal.
+    SX1262Model(VirtualClock &clock, uint8_t tcxo);
+
+    void transfer(const uint8_t *tx, uint8_t *rx, uint8_t len) override;
+    bool busy() override;
+    bool dio1() override;
+    void reset(bool level) override;
+    void clearDio1() override { _dio1Edge = false; }
+    bool waitDio1(uint32_t timeoutMs) override;
+    int64_t micros() override { return _clock.now(); }
+    void delay(uint32_t ms) override { _clock.advance((int64_t)ms * 1000); }
+    void yield() override { _clock.advance(kYieldUs); }
+
+    // Air side: a frame (length byte first, CC1101 CRC appended by the sender) that ends
+    // now. crcOk false corrupts it on the air.
+    void receive(const uint8_t *frame, uint8_t len, bool crcOk, int16_t rssiDbm);
+    // Power-on reset, as after a brownout.
+    void brownout();
+    // Fault: TX never completes, only the SetTx timeout ends it.
+    void setTxStuck(bool stuck) { _txStuck = stuck; }
+
+    Mode mode() const { return _mode; }
+    uint16_t irqStatus() const { return _irq; }
+    uint16_t dio1Mask() const { return _dio1Mask; }
+    uint8_t reg(uint16_t addr) const;
+    uint8_t packetType() const { return _packetType; }
+    uint32_t bitrateReg() const { return ((uint32_t)_mod[0] << 16) | ((uint32_t)_mod[1] << 8) | _mod[2]; }
+    uint8_t bandwidthReg() const { return _mod[4]; }
+    uint32_t lastRxTimeout() const { return _lastRxTimeout; }
+    int64_t airtimeUs(uint8_t payloadLen) const;
+
+    // Every command since the last clearLog(): opcode, then its parameters.
+    const std::vector<std::vector<uint8_t>> &log() const { return _log; }
+    void clearLog() { _log.clear(); }
+    // First logged command with this opcode, nullptr if none.
+    const std::vector<uint8_t> *find(uint8_t opcode) const;
+
+    // Transmitted frames: length byte + payload, as the packet engine sent them.
+    const std::vector<std::vector<uint8_t>> &sent() const { return _sent; }
+
+    struct Stats {
+      uint32_t badCommands{0};     // unknown opcode or wrong parameter count
+      uint32_t busyViolations{0};  // transaction started while BUSY
+      uint32_t modeErrors{0};      // command not allowed in the current mode
+      uint32_t txFrames{0};
+      uint32_t txSilent{0};        // TX without a running reference clock
+      uint32_t txTimeouts{0};
+      uint32_t rxFrames{0};        // RxDone, CRC good
+      uint32_t rxCrcErrors{0};
+      uint32_t rxTimeouts{0};
+      uint32_t rxAway{0};          // ended while not in RX
+      uint32_t rxNoSync{0};        // sync word or reference clock did not match
+      uint32_t resets{0};
+    };
+    const Stats &stats() const { return _stats; }
+
+  private:
+    void execute(const uint8_t *tx, uint8_t *rx, uint8_t len);
+    void setIrq(uint16_t bits);
+    void fallback();
+    void startTx(uint32_t timeout);
+    void startRx(uint32_t timeout);
+    bool clockRunning() const;
+    void powerOn();
+    uint8_t status() const;
+
+    VirtualClock &_clock;
+    uint8_t _tcxoBoard;
+    int64_t _busyUntil{0};
+    bool _inReset{false};
+    Mode _mode{STBY_RC};
+    uint16_t _irq{0}, _irqMask{0}, _dio1Mask{0};
+    bool _dio1Edge{false};
+    uint8_t _packetType{0};
+    uint8_t _mod[8]{};
+    uint8_t _pkt[9]{};
+    uint8_t _fallback{0x20};  // STDBY_RC
+    uint8_t _txBase{0}, _rxBase{0};
+    uint8_t _buffer[256]{};
+    uint8_t _rxLen{0};
+    uint8_t _rxRssi{0};
+    uint8_t _tcxoOn{0xFF};     // voltage code of SetDio3AsTcxoCtrl since reset
+    uint16_t _errors{0};
+    uint8_t _syncReg[8]{}, _crcReg[4]{};
+    uint32_t _lastRxTimeout{0};
+    bool _rxContinuous{false};
+    uint32_t _epoch{0};        // invalidates the pending TX/RX timer on a mode change
+    bool _txStuck{false};
+    std::vector<std::vector<uint8_t>> _log;
+    std::vector<std::vector<uint8_t>> _sent;
+    Stats _stats;
+};
+
+#endif
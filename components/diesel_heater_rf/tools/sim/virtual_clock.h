@@ -0,0 +1,56 @@
+/*
+ * virtual_clock.h — simulated time for the host harness.
+ *
+ * Time is µs since the start of the run and only moves in advance(): the CC1101 model
+ * calls it for every SPI transfer, delay and yield of the driver, the harness for the
+ * gaps between loop() iterations. Events scheduled with at() fire in time order (FIFO
+ * at equal times) as time passes them, with now() set to their own time.
+ */
+
+#ifndef VirtualClock_h
+#define VirtualClock_h
+
+#include <stdint.h>
+#include <functional>
+#include <queue>
+#include <vector>
+
+class VirtualClock {
+  public:
+    int64_t now() const { return _now; }
+    uint32_t millis() const { return (uint32_t)(_now / 1000); }
+
+    // fn runs when time reaches t (at the next advance() if t is already past).
+    void at(int64_t t, std::function<void()> fn) {
+      _events.push(Event{t < _now ? _now : t, _seq++, std::move(fn)});
+    }
+
+    void advance(int64_t us) { advanceTo(_now + us); }
+
+    void advanceTo(int64_t t) {
+      while (!_events.empty() && _events.top().t <= t) {
+        Event e = _events.top();
+        _events.pop();
+        _now = e.t;
+        e.fn();
+      }
+      if (t > _now) _now = t;
+    }
+
+    size_t pending() const { return _events.size(); }
+
+  private:
+    struct Event {
+      int64_t t;
+      uint64_t seq;
+      std::function<void()> fn;
+    };
+    struct Later {
+      bool operator()(const Event &a, const Event &b) const { return a.t != b.t ? a.t > b.t : a.seq > b.seq; }
+    };
+    std::priority_queue<Event, std::vector<Event>, Later> _events;
+    int64_t _now{0};
+    uint64_t _seq{0};
+};
+
+#endif
@@ -9,11 +9,14 @@ CONF_SCANNING_TIMEOUT = "scanning_timeout"
 CONF_ON_SCAN = "on_scan"
 CONF_ON_LONG_PRESS = "on_long_press"
 CONF_ON_SHORT_PRESS = "on_short_press"
+CONF_ON_RELEASE = "on_release"
 CONF_ON_START_SCAN = "on_start_scan"
 CONF_ON_STOP_SCAN = "on_stop_scan"
 CONF_SCAN_TRIGGER_PIN = "scan_trigger_pin"
 CONF_LED_PIN = "led_pin"
 CONF_SCANNER_TRIGGER_PIN = "scanner_trigger_pin"
+CONF_FRAME_GAP = "frame_gap"
+CONF_DEBOUNCE = "debounce"
 
 qrcode2_uart_ns = cg.esphome_ns.namespace('qrcode2_uart')
 QRCode2UARTComponent = qrcode2_uart_ns.class_('QRCode2UARTComponent', cg.Component, uart.UARTDevice)
@@ -32,9 +35,19 @@ CONFIG_SCHEMA = cv.Schema({
     cv.GenerateID(): cv.declare_id(QRCode2UARTComponent),
     cv.Required(CONF_UART_ID): cv.use_id(uart.UARTComponent),
     cv.Optional(CONF_SCANNING_TIMEOUT, default="20s"): cv.positive_time_period_milliseconds,
-    cv.Optional(CONF_SCAN_TRIGGER_PIN): pins.gpio_input_pin_schema,
+    # Edge interrupts, so an internal GPIO
+    cv.Optional(CONF_SCAN_TRIGGER_PIN): pins.internal_gpio_input_pin_schema,
+    cv.Optional(CONF_DEBOUNCE, default="20ms"): cv.All(
+        cv.positive_time_period_microseconds,
+        cv.Range(max=cv.TimePeriod(milliseconds=1000)),
+    ),
     cv.Optional(CONF_LED_PIN): pins.gpio_output_pin_schema,
     cv.Optional(CONF_SCANNER_TRIGGER_PIN): pins.gpio_output_pin_schema,
+    # Silence that ends a scan sent without a terminator; derived from the UART baud rate if not set
+    cv.Optional(CONF_FRAME_GAP): cv.All(
+        cv.positive_time_period_milliseconds,
+        cv.Range(min=cv.TimePeriod(milliseconds=1), max=cv.TimePeriod(milliseconds=1000)),
+    ),
     cv.Optional(CONF_ON_SCAN): automation.validate_automation({
         cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(ScanTrigger),
     }),
@@ -44,6 +57,9 @@ CONFIG_SCHEMA = cv.Schema({
     cv.Optional(CONF_ON_SHORT_PRESS): automation.validate_automation({
         cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(ScanTrigger),
     }),
+    cv.Optional(CONF_ON_RELEASE): automation.validate_automation({
+        cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(ScanTrigger),
+    }),
     cv.Optional(CONF_ON_START_SCAN): automation.validate_automation({
         cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(ScanTrigger),
     }),
@@ -59,9 +75,13 @@ async def to_code(config):
     
     cg.add(var.set_scanning_timeout(config[CONF_SCANNING_TIMEOUT]))
     
+    if CONF_FRAME_GAP in config:
+        cg.add(var.set_frame_gap(config[CONF_FRAME_GAP]))
+    
     if CONF_SCAN_TRIGGER_PIN in config:
         pin = await cg.gpio_pin_expression(config[CONF_SCAN_TRIGGER_PIN])
         cg.add(var.set_trigger_pin(pin))
+        cg.add(var.set_debounce(config[CONF_DEBOUNCE]))
     
     if CONF_LED_PIN in config:
         pin = await cg.gpio_pin_expression(config[CONF_LED_PIN])
@@ -88,6 +108,11 @@ async def to_code(config):
         cg.add(var.add_short_press_trigger(trigger))
         await automation.build_automation(trigger, [(cg.std_string, "press_type")], conf)
         
+    for conf in config.get(CONF_ON_RELEASE, []):
+        trigger = cg.new_Pvariable(conf[CONF_TRIGGER_ID])
+        cg.add(var.add_release_trigger(trigger))
+        await automation.build_automation(trigger, [(cg.std_string, "press_type")], conf)
+        
     for conf in config.get(CONF_ON_START_SCAN, []):
         trigger = cg.new_Pvariable(conf[CONF_TRIGGER_ID])
         cg.add(var.add_start_scan_trigger(trigger))
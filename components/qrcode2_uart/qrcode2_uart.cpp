@@ -10,6 +10,19 @@ static const char *const TAG = "qrcode2_uart";
 
 // Command constants are defined in the header file
 
+void IRAM_ATTR QRCode2ButtonStore::gpio_intr(QRCode2ButtonStore *arg) {
+  uint32_t now = micros();
+  bool level = arg->pin.digital_read();
+  uint8_t head = arg->head.load(std::memory_order_relaxed);
+  uint8_t next = (head + 1) % SIZE;
+  if (next == arg->tail.load(std::memory_order_acquire)) {
+    arg->overflow.store(true, std::memory_order_relaxed);
+    return;
+  }
+  arg->edges[head] = {now, level};
+  arg->head.store(next, std::memory_order_release);
+}
+
 void QRCode2UARTComponent::setup() {
   ESP_LOGI(TAG, "=== QRCode2 UART Component Setup Starting ===");
   ESP_LOGI(TAG, "Component pointer: %p", this);
@@ -41,179 +54,231 @@ void QRCode2UARTComponent::setup() {
     bool initial_pin_state = this->trigger_pin_->digital_read();
     // With inverted: false in YAML, GPIO39 reads: HIGH = not pressed, LOW = pressed
     this->button_pressed_ = !initial_pin_state;  // LOW = pressed, HIGH = not pressed
+    this->button_raw_pressed_ = this->button_pressed_;
     ESP_LOGI(TAG, "🔘 Button initialized - GPIO39 raw: %s, interpreted as button_pressed_: %s", 
              initial_pin_state ? "HIGH" : "LOW",
              this->button_pressed_ ? "TRUE (pressed)" : "FALSE (not pressed)");
+    
+    // Edges are queued by the interrupt and debounced in loop(), the pin is not polled
+    this->button_store_.pin = this->trigger_pin_->to_isr();
+    this->trigger_pin_->attach_interrupt(QRCode2ButtonStore::gpio_intr, &this->button_store_,
+                                         gpio::INTERRUPT_ANY_EDGE);
+  }
+  
+  // Component heartbeat every 60 seconds (reduced frequency)
+  this->set_interval("heartbeat", 60000, [this]() {
+    ESP_LOGD(TAG, "QRCode2 component running, scanning: %s", this->scanning_ ? "YES" : "NO");
+  });
+  
+  if (this->frame_gap_ms_ == 0) {
+    this->frame_gap_ms_ = this->derive_frame_gap_ms();
   }
   
-  // Small delay to let scanner boot up
-  delay(500);
+  // Let the scanner boot up before the first command, without blocking setup()
+  this->command_ready_time_ = millis() + SCANNER_BOOT_MS;
   
-  // Configure the scanner
+  // Configure the scanner (queued, sent from loop())
   this->configure_scanner();
   
   // Get device information at startup - COMMENTED OUT
-  delay(1000);  // Give scanner time to fully initialize
   ESP_LOGI(TAG, "Scanner setup complete - device info requests disabled");
   // this->get_device_info();  // Function commented out - preserved for reference
 }
 
 void QRCode2UARTComponent::loop() {
-  // Component heartbeat every 60 seconds (reduced frequency)
-  static uint32_t last_heartbeat = 0;
-  if (millis() - last_heartbeat > 60000) {
-    ESP_LOGD(TAG, "QRCode2 component running, scanning: %s", this->scanning_ ? "YES" : "NO");
-    last_heartbeat = millis();
+  // Debounce button edges queued by the interrupt
+  if (this->trigger_pin_ != nullptr) {
+    this->process_button_edges();
   }
   
-  // Check trigger button with proper state machine
-  if (this->trigger_pin_ != nullptr) {
-    bool pin_state = this->trigger_pin_->digital_read();  // Read raw GPIO state
-    
-    // Debug raw pin state every few seconds
-    static uint32_t last_pin_debug = 0;
-    if (millis() - last_pin_debug > 5000) {
-      ESP_LOGD(TAG, "🔍 GPIO39 raw: %s (expect HIGH when not pressed, LOW when pressed)", 
-               pin_state ? "HIGH" : "LOW");
-      last_pin_debug = millis();
-    }
-    
+  // Process incoming UART data
+  this->process_uart_data();
+  this->process_command_queue();
+  
+  // Unterminated scans (Atomic QRCode2 Base) are completed by the frame gap timer, see on_frame_gap()
+  // Check for scan timeout
+  if (this->scanning_) {
+    this->check_scan_timeout();
+  }
+}
+
+void QRCode2UARTComponent::process_button_edges() {
+  QRCode2ButtonStore &store = this->button_store_;
+  uint8_t tail = store.tail.load(std::memory_order_relaxed);
+  uint8_t head = store.head.load(std::memory_order_acquire);
+  while (tail != head) {
+    const QRCode2ButtonStore::Edge &edge = store.edges[tail];
     // With YAML inverted: false, GPIO39 reads: HIGH = not pressed, LOW = pressed
-    bool button_currently_pressed = !pin_state;  // LOW = pressed, HIGH = not pressed
-    
-    // Detect button press (transition from HIGH to LOW on GPIO39)
-    if (button_currently_pressed && !this->button_pressed_) {
-      // Button just pressed (GPIO39 went LOW)
-      this->button_pressed_ = true;
-      this->button_press_start_time_ = millis();
-      this->long_press_detected_ = false;
-      ESP_LOGI(TAG, "🔘 Button PRESSED (GPIO39: HIGH→LOW) at %lu ms", this->button_press_start_time_);
-      
-      // Trigger short press automation for immediate feedback
-      for (auto *trigger : this->short_press_triggers_) {
-        trigger->trigger("short_press");
-      }
+    this->button_raw_pressed_ = !edge.level;
+    if (!this->button_change_pending_) {
+      this->button_change_pending_ = true;
+      this->button_change_start_us_ = edge.time_us;
     }
-    
-    // Check for long press while button is held (GPIO39 stays LOW)
-    if (button_currently_pressed && this->button_pressed_ && !this->long_press_detected_) {
-      uint32_t press_duration = millis() - this->button_press_start_time_;
-      if (press_duration >= this->long_press_duration_) {  // Configurable duration
-        this->long_press_detected_ = true;
-        ESP_LOGI(TAG, "🔘 LONG PRESS detected after %lu ms (threshold: %lu ms) - triggering mode switch", 
-                 press_duration, this->long_press_duration_);
-        
-        // Trigger long press automations
-        for (auto *trigger : this->long_press_triggers_) {
-          trigger->trigger("long_press");
-        }
-      }
+    this->button_last_edge_us_ = edge.time_us;
+    ESP_LOGV(TAG, "🔍 GPIO39 edge: %s at %lu us", edge.level ? "HIGH" : "LOW", (unsigned long) edge.time_us);
+    tail = (tail + 1) % QRCode2ButtonStore::SIZE;
+  }
+  store.tail.store(tail, std::memory_order_release);
+  
+  if (store.overflow.exchange(false, std::memory_order_relaxed)) {
+    // Edges were lost, the pin's level now is the only thing we know
+    ESP_LOGW(TAG, "⚠️ Button edge queue overflowed, re-reading pin");
+    uint32_t now = micros();
+    this->button_raw_pressed_ = !store.pin.digital_read();
+    if (!this->button_change_pending_) {
+      this->button_change_pending_ = true;
+      this->button_change_start_us_ = now;
     }
+    this->button_last_edge_us_ = now;
+  }
+  
+  // Accept the change once the pin has been stable for the debounce time
+  if (!this->button_change_pending_ || micros() - this->button_last_edge_us_ < this->debounce_us_) {
+    return;
+  }
+  this->button_change_pending_ = false;
+  if (this->button_raw_pressed_ != this->button_pressed_) {
+    this->on_button_change(this->button_raw_pressed_, this->button_change_start_us_);
+  } else {
+    ESP_LOGV(TAG, "Ignoring button glitch shorter than %lu us", (unsigned long) this->debounce_us_);
+  }
+}
+
+void QRCode2UARTComponent::on_button_change(bool pressed, uint32_t time_us) {
+  if (pressed) {
+    // Button just pressed (GPIO39 went LOW)
+    this->button_pressed_ = true;
+    this->button_press_start_us_ = time_us;
+    this->long_press_detected_ = false;
+    ESP_LOGI(TAG, "🔘 Button PRESSED (GPIO39: HIGH→LOW) at %lu us", (unsigned long) time_us);
     
-    // Detect button release (transition from LOW to HIGH on GPIO39)
-    if (!button_currently_pressed && this->button_pressed_) {
-      // Button just released (GPIO39 went HIGH)
-      uint32_t press_duration = millis() - this->button_press_start_time_;
-      ESP_LOGI(TAG, "🔘 Button RELEASED (GPIO39: LOW→HIGH) after %lu ms", press_duration);
-      
-      if (!this->long_press_detected_) {
-        // Short press - toggle scanning state
-        if (this->scanning_) {
-          ESP_LOGI(TAG, "⏹️ SHORT PRESS - stopping scan (scanner was active)");
-          this->stop_scan();
-        } else {
-          ESP_LOGI(TAG, "▶️ SHORT PRESS - starting scan (scanner was idle)");
-          this->buffer_.clear();
-          this->parsing_qr_code_ = false;
-          this->start_scan();
-        }
-      } else {
-        ESP_LOGI(TAG, "🔄 LONG PRESS completed - mode already switched");
-      }
-      
-      // Reset button state
-      this->button_pressed_ = false;
-      this->long_press_detected_ = false;
+    // Trigger short press automation for immediate feedback
+    for (auto *trigger : this->short_press_triggers_) {
+      trigger->trigger("short_press");
     }
+    
+    // Long press fires on a timer counted from the press edge, not from when loop() saw it
+    uint32_t held_ms = (micros() - time_us) / 1000;
+    uint32_t remaining_ms = this->long_press_duration_ > held_ms ? this->long_press_duration_ - held_ms : 0;
+    this->set_timeout("long_press", remaining_ms, [this]() { this->on_long_press(); });
+    return;
   }
   
-  // Process incoming UART data
-  this->process_uart_data();
+  // Button just released (GPIO39 went HIGH)
+  uint32_t press_duration = (time_us - this->button_press_start_us_) / 1000;
+  this->cancel_timeout("long_press");
+  this->last_press_duration_ms_ = press_duration;
+  ESP_LOGI(TAG, "🔘 Button RELEASED (GPIO39: LOW→HIGH) after %lu ms", (unsigned long) press_duration);
   
-  // Handle QR data timeout for Atomic QRCode2 Base when it sends ASCII without terminators
-  // ONLY process data as QR codes when we're actually scanning
-  if (this->parsing_qr_code_ && !this->buffer_.empty() && this->scanning_) {
-    uint32_t time_since_last_data = millis() - this->last_qr_data_time_;
-    if (time_since_last_data > 300) {
-      // Only process as QR code if it's reasonable length and we're in scanning mode
-      if (this->buffer_.length() >= 3) {
-        ESP_LOGI(TAG, "QR Code scanned: %s", this->buffer_.c_str());
-        this->handle_scan_result(this->buffer_);
-      } else {
-        ESP_LOGV(TAG, "Ignoring short buffer (likely protocol fragment): '%s'", this->buffer_.c_str());
-      }
-      // CRITICAL: Reset state immediately after processing to prevent multiple triggers
-      this->buffer_.clear();
-      this->parsing_qr_code_ = false;
-      this->last_qr_data_time_ = 0;  // Reset timestamp to prevent re-triggering
+  // The edge timestamps decide: a press held long enough is a long press even if the
+  // timer had no chance to run before the release was seen
+  if (!this->long_press_detected_ && press_duration >= this->long_press_duration_) {
+    this->on_long_press();
+  }
+  this->button_pressed_ = false;
+  
+  for (auto *trigger : this->release_triggers_) {
+    trigger->trigger("release");
+  }
+  
+  if (!this->long_press_detected_) {
+    // Short press - toggle scanning state
+    if (this->scanning_) {
+      ESP_LOGI(TAG, "⏹️ SHORT PRESS - stopping scan (scanner was active)");
+      this->stop_scan();
     } else {
-      // Debug: Show when we're waiting for timeout
-      static uint32_t last_debug = 0;
-      if (millis() - last_debug > 1000) {  // Debug every 1000ms (reduced frequency)
-        ESP_LOGV(TAG, "⏱️ Waiting for timeout: buffer='%s', time_since_last=%lu ms", this->buffer_.c_str(), time_since_last_data);
-        last_debug = millis();
-      }
-    }
-  } else if (this->parsing_qr_code_ && !this->buffer_.empty() && !this->scanning_) {
-    // If we're accumulating data but not scanning, clear it after a timeout
-    uint32_t time_since_last_data = millis() - this->last_qr_data_time_;
-    if (time_since_last_data > 300) {
-      ESP_LOGD(TAG, "📋 Clearing non-scan data after timeout: '%s'", this->buffer_.c_str());
+      ESP_LOGI(TAG, "▶️ SHORT PRESS - starting scan (scanner was idle)");
       this->buffer_.clear();
       this->parsing_qr_code_ = false;
-      this->last_qr_data_time_ = 0;
+      this->start_scan();
     }
+  } else {
+    ESP_LOGI(TAG, "🔄 LONG PRESS completed - mode already switched");
   }
   
-  // Check for scan timeout
-  if (this->scanning_) {
-    this->check_scan_timeout();
+  // Reset button state
+  this->long_press_detected_ = false;
+}
+
+void QRCode2UARTComponent::on_long_press() {
+  if (!this->button_pressed_ || this->long_press_detected_) {
+    return;
+  }
+  this->long_press_detected_ = true;
+  ESP_LOGI(TAG, "🔘 LONG PRESS detected (threshold: %lu ms) - triggering mode switch", (unsigned long) this->long_press_duration_);
+  
+  // Trigger long press automations
+  for (auto *trigger : this->long_press_triggers_) {
+    trigger->trigger("long_press");
   }
 }
 
 void QRCode2UARTComponent::dump_config() {
   ESP_LOGCONFIG(TAG, "QRCode2 UART Scanner:");
-  ESP_LOGCONFIG(TAG, "  Scanning timeout: %u ms", this->scanning_timeout_);
+  ESP_LOGCONFIG(TAG, "  Scanning timeout: %lu ms", (unsigned long) this->scanning_timeout_);
   
   if (this->trigger_pin_ != nullptr) {
     LOG_PIN("  Trigger Pin: ", this->trigger_pin_);
+    ESP_LOGCONFIG(TAG, "  Button debounce: %lu us", (unsigned long) this->debounce_us_);
   }
   
   if (this->led_pin_ != nullptr) {
     LOG_PIN("  LED Pin (firmware-controlled): ", this->led_pin_);
   }
   
+  ESP_LOGCONFIG(TAG, "  Frame gap: %lu ms", (unsigned long) this->frame_gap_ms_);
+  ESP_LOGCONFIG(TAG, "  Configuration: %s", this->configured_ ? "accepted by scanner" : "not confirmed");
+  if (this->commands_failed_ > 0) {
+    ESP_LOGCONFIG(TAG, "  Failed commands: %lu", (unsigned long) this->commands_failed_);
+  }
+  if (this->scan_counter_ > 0) {
+    ESP_LOGCONFIG(TAG, "  Scan latency: last %.1f ms, avg %.1f ms, max %.1f ms", this->scan_latency_last_us_ / 1000.0f,
+                  this->scan_latency_sum_us_ / 1000.0f / this->scan_counter_, this->scan_latency_max_us_ / 1000.0f);
+  }
+  
   this->check_uart_settings(115200);
 }
 
+uint32_t QRCode2UARTComponent::derive_frame_gap_ms() {
+  uint32_t baud = 115200;
+  uint32_t char_bits = 10;  // 8N1
+  if (this->parent_ != nullptr) {
+    baud = this->parent_->get_baud_rate();
+    char_bits = 1 + this->parent_->get_data_bits() + this->parent_->get_stop_bits() +
+                (this->parent_->get_parity() != uart::UART_CONFIG_PARITY_NONE ? 1 : 0);
+  }
+  // Round up to whole milliseconds, the scheduler's resolution
+  uint64_t gap_us = (uint64_t) FRAME_GAP_CHARS * char_bits * 1000000 / baud;
+  uint32_t gap_ms = (uint32_t) ((gap_us + 999) / 1000);
+  return gap_ms > 0 ? gap_ms : 1;
+}
+
 void QRCode2UARTComponent::configure_scanner() {
   ESP_LOGI(TAG, "Configuring QRCode2 scanner with correct protocol...");
   
+  this->configured_ = false;
+  this->config_accepted_ = 0;
+  
   // Set button trigger mode (Configuration Command)
   ESP_LOGI(TAG, "Setting button trigger mode: 0x%02X 0x%02X 0x%02X 0x%02X", 
            CMD_SET_BUTTON_TRIGGER[0], CMD_SET_BUTTON_TRIGGER[1], CMD_SET_BUTTON_TRIGGER[2], CMD_SET_BUTTON_TRIGGER[3]);
-  this->write_array(CMD_SET_BUTTON_TRIGGER, sizeof(CMD_SET_BUTTON_TRIGGER));
-  this->flush();
-  delay(200);
+  this->queue_command(CMD_SET_BUTTON_TRIGGER, sizeof(CMD_SET_BUTTON_TRIGGER), "button trigger mode",
+                      [this](bool accepted) { this->config_accepted_ += accepted; });
   
   // Enable all barcode types
   ESP_LOGI(TAG, "Enabling all barcode types: 0x%02X 0x%02X 0x%02X 0x%02X", 
            CMD_ENABLE_ALL_CODES[0], CMD_ENABLE_ALL_CODES[1], CMD_ENABLE_ALL_CODES[2], CMD_ENABLE_ALL_CODES[3]);
-  this->write_array(CMD_ENABLE_ALL_CODES, sizeof(CMD_ENABLE_ALL_CODES));
-  this->flush();
-  delay(200);
-  
-  ESP_LOGI(TAG, "QRCode2 scanner configuration complete");
+  this->queue_command(CMD_ENABLE_ALL_CODES, sizeof(CMD_ENABLE_ALL_CODES), "enable all barcodes",
+                      [this](bool accepted) {
+                        this->config_accepted_ += accepted;
+                        this->configured_ = this->config_accepted_ == 2;
+                        if (this->configured_) {
+                          ESP_LOGI(TAG, "✅ QRCode2 scanner configuration accepted");
+                        } else {
+                          ESP_LOGW(TAG, "⚠️ QRCode2 scanner configuration not confirmed (%u of 2 settings accepted)",
+                                   this->config_accepted_);
+                        }
+                      });
 }
 
 void QRCode2UARTComponent::start_scan() {
@@ -237,9 +302,7 @@ void QRCode2UARTComponent::start_scan() {
   
   // Send start scan command (Control Command)
   ESP_LOGI(TAG, "Sending start scan command: 0x%02X 0x%02X 0x%02X", CMD_START_SCAN[0], CMD_START_SCAN[1], CMD_START_SCAN[2]);
-  this->write_array(CMD_START_SCAN, sizeof(CMD_START_SCAN));
-  this->flush();
-  delay(100);
+  this->queue_command(CMD_START_SCAN, sizeof(CMD_START_SCAN), "start scan");
   
   // Trigger start scan automations
   for (auto *trigger : this->start_scan_triggers_) {
@@ -270,8 +333,7 @@ void QRCode2UARTComponent::stop_scan() {
   
   // Send stop scan command (Control Command)
   ESP_LOGI(TAG, "Sending stop scan command: 0x%02X 0x%02X 0x%02X", CMD_STOP_SCAN[0], CMD_STOP_SCAN[1], CMD_STOP_SCAN[2]);
-  this->write_array(CMD_STOP_SCAN, sizeof(CMD_STOP_SCAN));
-  this->flush();
+  this->queue_command(CMD_STOP_SCAN, sizeof(CMD_STOP_SCAN), "stop scan");
 }
 
 void QRCode2UARTComponent::set_auto_scan_mode(bool enabled) {
@@ -283,9 +345,7 @@ void QRCode2UARTComponent::set_auto_scan_mode(bool enabled) {
 void QRCode2UARTComponent::set_trigger_mode() {
   ESP_LOGW(TAG, "Old trigger mode method - using button trigger mode instead");
   // Use the button trigger configuration instead
-  this->write_array(CMD_SET_BUTTON_TRIGGER, sizeof(CMD_SET_BUTTON_TRIGGER));
-  this->flush();
-  delay(100);
+  this->queue_command(CMD_SET_BUTTON_TRIGGER, sizeof(CMD_SET_BUTTON_TRIGGER), "button trigger mode");
 }
 
 
@@ -342,114 +402,222 @@ void QRCode2UARTComponent::set_trigger_mode() {
 void QRCode2UARTComponent::reset_scanner() {
   ESP_LOGI(TAG, "Resetting scanner: 0x%02X 0x%02X 0x%02X", 
            CMD_FACTORY_RESET[0], CMD_FACTORY_RESET[1], CMD_FACTORY_RESET[2]);
-  this->write_array(CMD_FACTORY_RESET, sizeof(CMD_FACTORY_RESET));
+  // Sent once: a resend could land while the scanner restarts and reset it again. Its
+  // reply may be lost in the restart too, so hold the queue and put our settings back
+  // whether or not it was acknowledged.
+  this->queue_command(CMD_FACTORY_RESET, sizeof(CMD_FACTORY_RESET), "factory reset",
+                      [this](bool) { this->configure_scanner(); }, FACTORY_RESET_HOLD_MS, 1);
+}
+
+void QRCode2UARTComponent::queue_command(const uint8_t *cmd, size_t len, const char *name,
+                                         std::function<void(bool accepted)> &&on_done, uint32_t hold_ms,
+                                         uint8_t max_attempts) {
+  if (this->command_queue_.size() >= COMMAND_QUEUE_MAX) {
+    ESP_LOGW(TAG, "⚠️ Command queue full, dropping %s", name);
+    if (on_done) {
+      on_done(false);
+    }
+    return;
+  }
+  this->command_queue_.push_back({cmd, static_cast<uint8_t>(len), name, hold_ms, std::move(on_done), 0, max_attempts});
+}
+
+void QRCode2UARTComponent::process_command_queue() {
+  if (this->command_in_flight_) {
+    if (millis() - this->command_sent_time_ < COMMAND_REPLY_TIMEOUT_MS) {
+      return;
+    }
+    QueuedCommand &cmd = this->command_queue_.front();
+    ESP_LOGW(TAG, "⏰ No reply to %s (attempt %u/%u)", cmd.name, cmd.attempts, cmd.max_attempts);
+    this->reply_parser_.reset();
+    this->reply_parser_.clear_expect();
+    this->command_in_flight_ = false;
+    if (cmd.attempts >= cmd.max_attempts) {
+      this->finish_command(false);
+      return;
+    }
+  }
+  
+  if (this->command_queue_.empty() || static_cast<int32_t>(millis() - this->command_ready_time_) < 0) {
+    return;
+  }
+  
+  QueuedCommand &cmd = this->command_queue_.front();
+  cmd.attempts++;
+  ESP_LOGD(TAG, "📤 Sending %s (attempt %u/%u)", cmd.name, cmd.attempts, cmd.max_attempts);
+  this->send_command(cmd.data, cmd.len);
+  this->command_in_flight_ = true;
+  this->command_sent_time_ = millis();
+}
+
+void QRCode2UARTComponent::finish_command(bool accepted) {
+  QueuedCommand cmd = std::move(this->command_queue_.front());
+  this->command_queue_.pop_front();
+  this->command_in_flight_ = false;
+  this->command_ready_time_ = millis() + cmd.hold_ms;
+  
+  if (accepted) {
+    ESP_LOGD(TAG, "✅ Scanner accepted %s", cmd.name);
+  } else {
+    this->commands_failed_++;
+    ESP_LOGW(TAG, "❌ Scanner did not accept %s after %u attempts", cmd.name, cmd.attempts);
+  }
+  if (cmd.on_done) {
+    cmd.on_done(accepted);
+  }
+}
+
+void QRCode2UARTComponent::send_command(const uint8_t *cmd, size_t len) {
+  this->write_array(cmd, len);
   this->flush();
-  delay(1000);  // Wait longer for reset to complete
+  // Replies echo the command's PID/FID, arm the parser for this one
+  this->reply_parser_.expect(cmd, len);
 }
 
 void QRCode2UARTComponent::process_uart_data() {
-  static std::vector<uint8_t> protocol_buffer;
-  
+  uint32_t last_data_us = this->last_qr_data_us_;
+  if (this->reply_parser_.busy() && millis() - this->last_reply_byte_time_ > REPLY_BYTE_TIMEOUT_MS) {
+    ESP_LOGW(TAG, "⚠️ Protocol reply stalled mid-frame, dropping it");
+    this->reply_parser_.reset();
+    this->reply_parser_.clear_expect();
+  }
+
   while (this->available()) {
     uint8_t data;
     this->read_byte(&data);
-    
-    // Add to protocol buffer for status responses
-    protocol_buffer.push_back(data);
-    
-    // Keep only last 100 bytes to avoid memory issues
-    if (protocol_buffer.size() > 100) {
-      protocol_buffer.erase(protocol_buffer.begin());
-    }
-    
-    // Check for protocol status reply (0x44 = Status Reply or 0x33 for Atomic QRCode2)
-    if (protocol_buffer.size() >= 3) {
-      size_t pos = protocol_buffer.size() - 3;
-      if ((protocol_buffer[pos] == 0x44 || protocol_buffer[pos] == 0x33) && 
-          (protocol_buffer[pos+1] == 0x02 || protocol_buffer[pos+1] == 0x75)) {
-        uint8_t fid = protocol_buffer[pos+2];
-        ESP_LOGV(TAG, "Protocol response detected: 0x%02X 0x%02X 0x%02X", 
-                 protocol_buffer[pos], protocol_buffer[pos+1], protocol_buffer[pos+2]);
-        
-        // Clear any ASCII buffer that might contain protocol data
-        if (!this->buffer_.empty() && this->buffer_.length() <= 2) {
-          ESP_LOGV(TAG, "Clearing buffer with potential protocol data: '%s'", this->buffer_.c_str());
-          this->buffer_.clear();
-          this->parsing_qr_code_ = false;
-        }
-        
-        if (protocol_buffer.size() >= 4) {
-          uint8_t status = protocol_buffer[pos+3];
-          if (status == 0x00) {  // Success
-            // Check if there's a length byte for data
-            if (protocol_buffer.size() >= 5) {
-              uint8_t length = protocol_buffer[pos+4];
-              this->handle_status_response(fid, length, protocol_buffer, pos + 5);
-            }
-          }
+
+    switch (this->reply_parser_.feed(data)) {
+      case QRCode2ReplyParser::Result::IDLE:
+        this->process_scan_byte(data);
+        break;
+      case QRCode2ReplyParser::Result::BUSY:
+        this->last_reply_byte_time_ = millis();
+        break;
+      case QRCode2ReplyParser::Result::DONE:
+        this->handle_status_response(this->reply_parser_.reply());
+        break;
+      case QRCode2ReplyParser::Result::REJECT:
+        // Looked like the start of a reply but wasn't, the bytes are scan data
+        for (uint8_t i = 0; i < this->reply_parser_.held_len(); i++) {
+          this->process_scan_byte(this->reply_parser_.held()[i]);
         }
-      }
+        break;
     }
-    
-    // Handle QR code scanning (ASCII data ending with \r or \n OR timeout for Atomic QRCode2)
-    char c = static_cast<char>(data);
-    
-    // Check if this looks like QR code data (printable ASCII)
-    if (c >= 0x20 && c <= 0x7E) {
-      this->buffer_ += c;
-      this->parsing_qr_code_ = true;
-      this->last_qr_data_time_ = millis();  // Update timestamp for timeout
-      if (this->scanning_) {
-        ESP_LOGV(TAG, "📝 QR char: '%c' (0x%02X), buffer now: '%s'", c, data, this->buffer_.c_str());
+  }
+  
+  // One timer per batch of scan data rather than a check on every loop(); re-arming
+  // replaces the pending one, so it fires frame_gap_ms_ after the scanner goes quiet
+  if (this->last_qr_data_us_ != last_data_us && this->parsing_qr_code_ && !this->buffer_.empty()) {
+    this->set_timeout("frame_gap", this->frame_gap_ms_, [this]() { this->on_frame_gap(); });
+  }
+}
+
+void QRCode2UARTComponent::on_frame_gap() {
+  // loop() may not have run since the timer was armed: drain the UART first, and if the
+  // scan is still arriving the drain has re-armed the timer
+  uint32_t last_data_us = this->last_qr_data_us_;
+  this->process_uart_data();
+  if (this->last_qr_data_us_ != last_data_us || !this->parsing_qr_code_ || this->buffer_.empty()) {
+    return;
+  }
+  
+  // ONLY process data as QR codes when we're actually scanning
+  if (this->scanning_) {
+    // Only process as QR code if it's reasonable length
+    if (this->buffer_.length() >= 3) {
+      ESP_LOGI(TAG, "QR Code scanned: %s", this->buffer_.c_str());
+      this->handle_scan_result(this->buffer_);
+    } else {
+      ESP_LOGV(TAG, "Ignoring short buffer (likely protocol fragment): '%s'", this->buffer_.c_str());
+    }
+  } else {
+    ESP_LOGD(TAG, "📋 Clearing non-scan data after frame gap: '%s'", this->buffer_.c_str());
+  }
+  // CRITICAL: Reset state immediately after processing to prevent multiple triggers
+  this->buffer_.clear();
+  this->parsing_qr_code_ = false;
+}
+
+void QRCode2UARTComponent::process_scan_byte(uint8_t data) {
+  // Handle QR code scanning (ASCII data ending with \r or \n OR frame gap for Atomic QRCode2)
+  char c = static_cast<char>(data);
+  this->last_qr_data_us_ = micros();
+
+  // Check if this looks like QR code data (printable ASCII)
+  if (c >= 0x20 && c <= 0x7E) {
+    this->buffer_ += c;
+    this->parsing_qr_code_ = true;
+    if (this->scanning_) {
+      ESP_LOGV(TAG, "📝 QR char: '%c' (0x%02X), buffer now: '%s'", c, data, this->buffer_.c_str());
+    } else {
+      ESP_LOGV(TAG, "📄 Data char (not scanning): '%c' (0x%02X), buffer now: '%s'", c, data, this->buffer_.c_str());
+    }
+  } else if ((c == '\r' || c == '\n') && this->parsing_qr_code_) {
+    if (!this->buffer_.empty() && this->scanning_) {
+      if (this->buffer_.length() >= 3) {
+        ESP_LOGI(TAG, "✅ QR Code scanned (terminated): '%s'", this->buffer_.c_str());
+        this->handle_scan_result(this->buffer_);
       } else {
-        ESP_LOGV(TAG, "📄 Data char (not scanning): '%c' (0x%02X), buffer now: '%s'", c, data, this->buffer_.c_str());
-      }
-    } else if ((c == '\r' || c == '\n') && this->parsing_qr_code_) {
-      if (!this->buffer_.empty() && this->scanning_) {
-        if (this->buffer_.length() >= 3) {
-          ESP_LOGI(TAG, "✅ QR Code scanned (terminated): '%s'", this->buffer_.c_str());
-          this->handle_scan_result(this->buffer_);
-        } else {
-          ESP_LOGV(TAG, "Ignoring short terminated buffer: '%s'", this->buffer_.c_str());
-        }
-      } else if (!this->buffer_.empty()) {
-        ESP_LOGD(TAG, "📋 Ignoring data received when not scanning: '%s'", this->buffer_.c_str());
+        ESP_LOGV(TAG, "Ignoring short terminated buffer: '%s'", this->buffer_.c_str());
       }
+    } else if (!this->buffer_.empty()) {
+      ESP_LOGD(TAG, "📋 Ignoring data received when not scanning: '%s'", this->buffer_.c_str());
+    }
+    this->buffer_.clear();
+    this->parsing_qr_code_ = false;
+    this->cancel_timeout("frame_gap");
+    ESP_LOGV(TAG, "Reset parsing due to terminator");
+  } else if (c == '\r' || c == '\n') {
+    // End of some data, reset QR buffer if it has content
+    if (!this->buffer_.empty()) {
+      ESP_LOGV(TAG, "Clearing buffer due to unexpected terminator: '%s'", this->buffer_.c_str());
       this->buffer_.clear();
-      this->parsing_qr_code_ = false;
-      this->last_qr_data_time_ = 0;  // Reset timestamp
-      ESP_LOGV(TAG, "Reset parsing due to terminator");
-    } else if (c == '\r' || c == '\n') {
-      // End of some data, reset QR buffer if it has content
-      if (!this->buffer_.empty()) {
-        ESP_LOGV(TAG, "Clearing buffer due to unexpected terminator: '%s'", this->buffer_.c_str());
-        this->buffer_.clear();
-      }
-      this->parsing_qr_code_ = false;
-    } else {
-      // Log non-ASCII data
-      ESP_LOGD(TAG, "🔍 Non-ASCII byte: 0x%02X (%d)", data, data);
     }
+    this->parsing_qr_code_ = false;
+  } else {
+    // Log non-ASCII data
+    ESP_LOGD(TAG, "🔍 Non-ASCII byte: 0x%02X (%d)", data, data);
   }
-  
-
 }
 
-void QRCode2UARTComponent::handle_status_response(uint8_t fid, uint8_t length, const std::vector<uint8_t> &buffer, size_t data_start) {
-  // Just log protocol responses, don't use them for device info
+void QRCode2UARTComponent::handle_status_response(const QRCode2Reply &reply) {
+  // Replies complete the queued command in flight, see process_command_queue()
   // Device info is handled via raw ASCII startup messages instead
-  
-  std::string response_data = "";
-  if (length > 0 && data_start < buffer.size()) {
-    for (size_t i = data_start; i < data_start + length && i < buffer.size(); i++) {
-      uint8_t byte = buffer[i];
-      if (byte >= 0x20 && byte <= 0x7E) {  // Printable ASCII
-        response_data += static_cast<char>(byte);
-      }
-    }
+  if (reply.rid > 0) {
+    ESP_LOGW(TAG, "❌ Scanner rejected command: TYPE=0x%02X PID=0x%02X FID=0x%02X RID=0x%02X", reply.type, reply.pid,
+             reply.fid, reply.rid);
+  } else {
+    this->log_reply(reply);
   }
   
-  ESP_LOGD(TAG, "📋 Protocol Response: FID=0x%02X, length=%d, data='%s'", fid, length, response_data.c_str());
+  // The parser only accepts the reply to the command in flight
+  if (!this->command_in_flight_) {
+    return;
+  }
+  const QueuedCommand &cmd = this->command_queue_.front();
+  if (reply.rid <= 0) {
+    this->finish_command(true);
+  } else if (cmd.attempts >= cmd.max_attempts) {
+    this->finish_command(false);
+  } else {
+    // NAK: resent from the next process_command_queue()
+    this->command_in_flight_ = false;
+  }
+}
+
+void QRCode2UARTComponent::log_reply(const QRCode2Reply &reply) {
+  // Log the printable part of the payload straight from the parser's frame buffer
+  char text[QRCode2ReplyParser::MAX_PARAM + 1];
+  size_t n = 0;
+  for (size_t i = 0; i < reply.param_len; i++) {
+    uint8_t byte = reply.param[i];
+    if (byte >= 0x20 && byte <= 0x7E) text[n++] = static_cast<char>(byte);  // Printable ASCII
+  }
+  text[n] = '\0';
+
+  ESP_LOGD(TAG, "📋 Protocol Response: TYPE=0x%02X PID=0x%02X FID=0x%02X, length=%u%s, data='%s'", reply.type,
+           reply.pid, reply.fid, reply.declared_len, reply.declared_len > reply.param_len ? " (truncated)" : "",
+           text);
 }
 
 void QRCode2UARTComponent::handle_scan_result(const std::string &result) {
@@ -469,7 +637,15 @@ void QRCode2UARTComponent::handle_scan_result(const std::string &result) {
     trigger->trigger(result);
   }
   
-  ESP_LOGI(TAG, "✅ Scan #%lu complete: %s", this->scan_counter_, result.c_str());
+  // Scan end (last byte read) to publish done
+  uint32_t latency_us = micros() - this->last_qr_data_us_;
+  this->scan_latency_last_us_ = latency_us;
+  this->scan_latency_sum_us_ += latency_us;
+  if (latency_us > this->scan_latency_max_us_) {
+    this->scan_latency_max_us_ = latency_us;
+  }
+  
+  ESP_LOGI(TAG, "✅ Scan #%lu complete in %.1f ms: %s", this->scan_counter_, latency_us / 1000.0f, result.c_str());
   ESP_LOGI(TAG, "📱 Updated sensor with raw code: %s", result.c_str());
 }
 
@@ -9,6 +9,9 @@
 #include "esphome/components/uart/uart.h"
 #include "esphome/components/text_sensor/text_sensor.h"
 #include "esphome/components/binary_sensor/binary_sensor.h"
+#include "reply_parser.h"
+#include <atomic>
+#include <deque>
 #include <vector>
 #include <string>
 #include <functional>
@@ -25,6 +28,24 @@ class ScanTrigger : public Trigger<std::string> {
   explicit ScanTrigger() {}
 };
 
+// Raw button edges, queued by the pin's edge interrupt with their micros() timestamp and
+// debounced in loop(). Single producer (the ISR), single consumer (loop()).
+struct QRCode2ButtonStore {
+  static constexpr uint8_t SIZE = 32;  // a bounce burst; on overflow loop() re-reads the pin
+  struct Edge {
+    uint32_t time_us;
+    bool level;
+  };
+  
+  ISRInternalGPIOPin pin;
+  Edge edges[SIZE];
+  std::atomic<uint8_t> head{0};  // written by the ISR
+  std::atomic<uint8_t> tail{0};  // written by loop()
+  std::atomic<bool> overflow{false};
+  
+  static void gpio_intr(QRCode2ButtonStore *arg);
+};
+
 class QRCode2UARTComponent : public Component, public uart::UARTDevice {
  public:
   void setup() override;
@@ -34,15 +55,18 @@ class QRCode2UARTComponent : public Component, public uart::UARTDevice {
   void set_scanning_timeout(uint32_t timeout) { scanning_timeout_ = timeout; }
   void update_scanning_timeout(uint32_t timeout_seconds) { scanning_timeout_ = timeout_seconds * 1000; }  // Convert seconds to milliseconds
   void update_long_press_duration(uint32_t duration_ms) { long_press_duration_ = duration_ms; }
-  void set_trigger_pin(GPIOPin *pin) { trigger_pin_ = pin; }
+  void set_trigger_pin(InternalGPIOPin *pin) { trigger_pin_ = pin; }
+  void set_debounce(uint32_t debounce_us) { debounce_us_ = debounce_us; }
   void set_led_pin(GPIOPin *pin) { led_pin_ = pin; }
   void set_scanner_trigger_pin(GPIOPin *pin) { scanner_trigger_pin_ = pin; }
+  void set_frame_gap(uint32_t gap_ms) { frame_gap_ms_ = gap_ms; }  // 0 = derive from the UART settings
   
   void add_scan_trigger(ScanTrigger *trigger) { scan_triggers_.push_back(trigger); }
   void add_text_sensor(QRCode2TextSensor *sensor) { text_sensors_.push_back(sensor); }
   void add_binary_sensor(QRCode2BinarySensor *sensor) { binary_sensors_.push_back(sensor); }
   void add_long_press_trigger(ScanTrigger *trigger) { long_press_triggers_.push_back(trigger); }
   void add_short_press_trigger(ScanTrigger *trigger) { short_press_triggers_.push_back(trigger); }
+  void add_release_trigger(ScanTrigger *trigger) { release_triggers_.push_back(trigger); }
   void add_start_scan_trigger(ScanTrigger *trigger) { start_scan_triggers_.push_back(trigger); }
   void add_stop_scan_trigger(ScanTrigger *trigger) { stop_scan_triggers_.push_back(trigger); }
   
@@ -52,9 +76,24 @@ class QRCode2UARTComponent : public Component, public uart::UARTDevice {
   void start_scan();
   void stop_scan();
   bool is_scanning() const { return scanning_; }
+  // Time from the last byte of a scan to the end of its publish (sensors and on_scan)
+  uint32_t get_last_scan_latency_us() const { return scan_latency_last_us_; }
+  uint32_t get_max_scan_latency_us() const { return scan_latency_max_us_; }
+  // Press to release of the last button press, from the edge timestamps
+  uint32_t get_last_press_duration_ms() const { return last_press_duration_ms_; }
   
   // LED is controlled by scanner firmware automatically
   
+  // Scanner commands are queued and sent one at a time: the next goes out once the
+  // scanner has replied (or the reply timed out). A NAK or a timeout is retried until
+  // max_attempts sends; on_done then gets whether the scanner accepted it.
+  // hold_ms keeps the queue quiet after completion, e.g. while the scanner restarts.
+  void queue_command(const uint8_t *cmd, size_t len, const char *name,
+                     std::function<void(bool accepted)> &&on_done = nullptr, uint32_t hold_ms = 0,
+                     uint8_t max_attempts = COMMAND_MAX_ATTEMPTS);
+  // True once the scanner has accepted the configure_scanner() settings
+  bool is_configured() const { return configured_; }
+  
   // Configuration commands for the scanner
   void configure_scanner();
   void set_auto_scan_mode(bool enabled);
@@ -70,9 +109,19 @@ class QRCode2UARTComponent : public Component, public uart::UARTDevice {
 
   
  protected:
+  void process_button_edges();
+  void on_button_change(bool pressed, uint32_t time_us);
+  void on_long_press();
   void process_uart_data();
+  void process_scan_byte(uint8_t data);
+  uint32_t derive_frame_gap_ms();
+  void on_frame_gap();
+  void send_command(const uint8_t *cmd, size_t len);
+  void process_command_queue();
+  void finish_command(bool accepted);
   void handle_scan_result(const std::string &result);
-  void handle_status_response(uint8_t fid, uint8_t length, const std::vector<uint8_t> &buffer, size_t data_start);
+  void handle_status_response(const QRCode2Reply &reply);
+  void log_reply(const QRCode2Reply &reply);
 
   void check_scan_timeout();
   
@@ -81,6 +130,7 @@ class QRCode2UARTComponent : public Component, public uart::UARTDevice {
   std::vector<QRCode2BinarySensor *> binary_sensors_;
   std::vector<ScanTrigger *> long_press_triggers_;
   std::vector<ScanTrigger *> short_press_triggers_;
+  std::vector<ScanTrigger *> release_triggers_;
   std::vector<ScanTrigger *> start_scan_triggers_;
   std::vector<ScanTrigger *> stop_scan_triggers_;
   std::string buffer_;
@@ -91,17 +141,63 @@ class QRCode2UARTComponent : public Component, public uart::UARTDevice {
   uint32_t long_press_duration_{5000};  // 5 seconds default
   uint32_t scan_counter_{0}; // Counter for scan uniqueness
   
-  GPIOPin *trigger_pin_{nullptr};        // Button pin (GPIO39)
+  InternalGPIOPin *trigger_pin_{nullptr};  // Button pin (GPIO39)
   GPIOPin *led_pin_{nullptr};           // LED pin (GPIO33) 
   GPIOPin *scanner_trigger_pin_{nullptr}; // Scanner trigger pin (GPIO23)
   
-  uint32_t button_press_start_time_{0};  // For long press detection
+  // Button, debounced from the edge queue: a change is accepted once the pin has held the
+  // new level for debounce_us_, and is timestamped with the first edge of its bounce burst
+  QRCode2ButtonStore button_store_;
+  uint32_t debounce_us_{20000};
+  bool button_raw_pressed_{false};      // level after the last queued edge
+  bool button_change_pending_{false};
+  uint32_t button_change_start_us_{0};  // first edge away from the debounced state
+  uint32_t button_last_edge_us_{0};
+  uint32_t button_press_start_us_{0};  // For long press detection
+  uint32_t last_press_duration_ms_{0};
   bool long_press_detected_{false};
   bool button_pressed_{false};  // Current button state - false = not pressed
   
   // QR data timeout tracking for Atomic QRCode2 Base
   bool parsing_qr_code_{false};
-  uint32_t last_qr_data_time_{0};
+  uint32_t last_qr_data_us_{0};  // micros() of the last byte on the scan path
+  uint32_t frame_gap_ms_{0};     // silence that ends an unterminated scan
+
+  // Scan end to publish latency
+  uint32_t scan_latency_last_us_{0};
+  uint32_t scan_latency_max_us_{0};
+  uint64_t scan_latency_sum_us_{0};
+
+  // Protocol replies, parsed out of the UART stream byte by byte
+  QRCode2ReplyParser reply_parser_;
+  uint32_t last_reply_byte_time_{0};
+  // Scanner command queue, see queue_command()
+  struct QueuedCommand {
+    const uint8_t *data;
+    uint8_t len;
+    const char *name;
+    uint32_t hold_ms;
+    std::function<void(bool)> on_done;
+    uint8_t attempts;
+    uint8_t max_attempts;
+  };
+  std::deque<QueuedCommand> command_queue_;
+  bool command_in_flight_{false};
+  uint32_t command_sent_time_{0};
+  uint32_t command_ready_time_{0};  // queue holds until this millis()
+  bool configured_{false};
+  uint8_t config_accepted_{0};
+  uint32_t commands_failed_{0};
+  static constexpr uint32_t COMMAND_REPLY_TIMEOUT_MS = 200;
+  static constexpr uint8_t COMMAND_MAX_ATTEMPTS = 3;
+  static constexpr size_t COMMAND_QUEUE_MAX = 8;
+  static constexpr uint32_t SCANNER_BOOT_MS = 500;          // before the first command after power-up
+  static constexpr uint32_t FACTORY_RESET_HOLD_MS = 1000;   // scanner restarts after a factory reset
+  
+  static constexpr uint32_t REPLY_BYTE_TIMEOUT_MS = 100;  // drop a reply that stalls mid-frame
+  // Derived frame gap in character times. Longer than the ESP-IDF UART driver's RX timeout
+  // (10 symbols), so a scan's tail is never still sitting in the FIFO when the gap expires.
+  static constexpr uint32_t FRAME_GAP_CHARS = 12;
   
   // Scanner command constants - Based on actual protocol documentation
   // Control Commands (TYPE=0x32)
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome {
+namespace qrcode2_uart {
+
+// A reply frame from the scanner, as parsed by QRCode2ReplyParser. param points into the
+// parser's frame buffer and is valid until the next feed().
+struct QRCode2Reply {
+  uint8_t type{0};
+  uint8_t pid{0};
+  uint8_t fid{0};
+  const uint8_t *param{nullptr};
+  uint16_t param_len{0};     // bytes in param (at most QRCode2ReplyParser::MAX_PARAM)
+  uint16_t declared_len{0};  // PARAM length on the wire; larger than param_len if truncated
+  int16_t rid{-1};           // write/control result: 0x00 success, 0x01 invalid PID/FID; -1 = none
+
+  bool ok() const { return this->rid <= 0; }
+};
+
+// Byte-at-a-time parser for scanner replies, O(1) per byte, no heap and no shared state.
+//
+// Reply layout (protocol doc, "Protocol Format"): TYPE PID FID [PARAM] [RID]
+//   TYPE   command TYPE + 1: 0x22 config write, 0x24 config read, 0x33 control, 0x44 status
+//   PARAM  length from FID bits 7..6: 00 none, 01 one byte, 10 two bytes, 11 a 2-byte
+//          big-endian length followed by that many bytes
+//   RID    write and control replies only (0x22, 0x33)
+// e.g. 22 61 41 00 00 (write 61/41 = 00 accepted), 44 02 C1 00 09 "BF531_1.0".
+//
+// Reply TYPE bytes are printable ASCII ('"', '$', '3', 'D') and arrive on the same UART
+// as scan data, so only the reply to the last command sent (expect()) is parsed. A
+// header that stops matching is rejected and its bytes handed back through held().
+// Without a dependency on ESPHome the parser builds and runs on the host as is.
+class QRCode2ReplyParser {
+ public:
+  static constexpr size_t MAX_PARAM = 64;
+
+  enum class Result : uint8_t {
+    IDLE,    // byte is not part of a reply — scan data
+    BUSY,    // byte consumed, reply incomplete
+    DONE,    // reply complete, see reply()
+    REJECT,  // header mismatch — held() bytes (this one included) are scan data
+  };
+
+  // Arm for the reply to cmd (TYPE PID FID ...); replaces any earlier expectation.
+  void expect(const uint8_t *cmd, size_t len) {
+    if (len < 3) return;
+    this->exp_type_ = cmd[0] + 1;
+    this->exp_pid_ = cmd[1];
+    this->exp_fid_ = cmd[2];
+    this->expecting_ = true;
+  }
+  void clear_expect() { this->expecting_ = false; }
+  bool expecting() const { return this->expecting_; }
+  bool busy() const { return this->state_ != State::TYPE; }
+  // Drop a frame in progress (e.g. the scanner went quiet mid-reply).
+  void reset() { this->state_ = State::TYPE; }
+
+  Result feed(uint8_t b) {
+    switch (this->state_) {
+      case State::TYPE:
+        if (!this->expecting_ || b != this->exp_type_) return Result::IDLE;
+        this->header_[0] = b;
+        this->state_ = State::PID;
+        return Result::BUSY;
+      case State::PID:
+        this->header_[1] = b;
+        if (b != this->exp_pid_) return this->reject_(2);
+        this->state_ = State::FID;
+        return Result::BUSY;
+      case State::FID:
+        this->header_[2] = b;
+        if (b != this->exp_fid_) return this->reject_(3);
+        this->stored_ = 0;
+        switch (b >> 6) {
+          case 0: return this->end_param_(0);
+          case 1: return this->start_param_(1);
+          case 2: return this->start_param_(2);
+          default: this->state_ = State::LEN_HI; return Result::BUSY;
+        }
+      case State::LEN_HI:
+        this->remaining_ = b << 8;
+        this->state_ = State::LEN_LO;
+        return Result::BUSY;
+      case State::LEN_LO:
+        this->remaining_ |= b;
+        return this->remaining_ == 0 ? this->end_param_(0) : this->start_param_(this->remaining_);
+      case State::PARAM:
+        if (this->stored_ < MAX_PARAM) this->frame_[this->stored_++] = b;
+        if (--this->remaining_ == 0) return this->end_param_(this->declared_);
+        return Result::BUSY;
+      case State::RID:
+        return this->finish_(b);
+    }
+    return Result::IDLE;
+  }
+
+  const QRCode2Reply &reply() const { return this->reply_; }
+  const uint8_t *held() const { return this->header_; }
+  uint8_t held_len() const { return this->held_len_; }
+
+ protected:
+  enum class State : uint8_t { TYPE, PID, FID, LEN_HI, LEN_LO, PARAM, RID };
+
+  static bool has_rid(uint8_t type) { return type == 0x22 || type == 0x33; }
+
+  Result start_param_(uint16_t len) {
+    this->declared_ = len;
+    this->remaining_ = len;
+    this->state_ = State::PARAM;
+    return Result::BUSY;
+  }
+  Result end_param_(uint16_t declared) {
+    this->declared_ = declared;
+    if (has_rid(this->header_[0])) {
+      this->state_ = State::RID;
+      return Result::BUSY;
+    }
+    return this->finish_(-1);
+  }
+  Result finish_(int16_t rid) {
+    this->reply_.type = this->header_[0];
+    this->reply_.pid = this->header_[1];
+    this->reply_.fid = this->header_[2];
+    this->reply_.param = this->frame_;
+    this->reply_.param_len = this->stored_;
+    this->reply_.declared_len = this->declared_;
+    this->reply_.rid = rid;
+    this->state_ = State::TYPE;
+    this->expecting_ = false;
+    return Result::DONE;
+  }
+  Result reject_(uint8_t held) {
+    this->held_len_ = held;
+    this->state_ = State::TYPE;
+    return Result::REJECT;
+  }
+
+  State state_{State::TYPE};
+  bool expecting_{false};
+  uint8_t exp_type_{0};
+  uint8_t exp_pid_{0};
+  uint8_t exp_fid_{0};
+  uint8_t header_[3]{};
+  uint8_t held_len_{0};
+  uint16_t remaining_{0};
+  uint16_t declared_{0};
+  uint16_t stored_{0};
+  uint8_t frame_[MAX_PARAM]{};
+  QRCode2Reply reply_;
+};
+
+}  // namespace qrcode2_uart
+}  // namespace esphome